@@ -0,0 +1,254 @@
+// per-operation cost of the HashMap and LinkedList hot paths, with hardware
+// counters (see perf_counters.h) next to the wall-clock time, so that layout
+// changes can be judged by cache misses per operation.
+//
+// workloads:
+//   hash_map insert       n distinct keys into an empty map (includes resizes)
+//   hash_map get hit      every key, in shuffled order
+//   hash_map get many     the same, with hashMapGetMany in batches of 256
+//   hash_map get miss     n keys that aren't in the map
+//   hash_set add          n distinct keys into an empty set (includes resizes)
+//   hash_set contains     every key, in shuffled order
+//   hash_set miss         n keys that aren't in the set
+//   linked_list push      n elements at the tail
+//   linked_list walk      searches for a missing element, per node visited
+//
+// usage: container_bench [n]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hash_map.h"
+#include "hash_set.h"
+#include "linked_list.h"
+#include "perf_counters.h"
+
+#define DEFAULT_N 1000000
+#define WALKS 10
+#define BATCH 256
+
+typedef struct {
+    PerfCounters counters;
+    uint64_t start;
+} Measurement;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void measure_begin(Measurement* m) {
+    perfCountersStart(&m->counters);
+    m->start = now_ns();
+}
+
+static void measure_end(Measurement* m, const char* name, uint64_t ops) {
+    uint64_t elapsed = now_ns() - m->start;
+    PerfSample sample;
+    perfCountersStop(&m->counters, &sample);
+    perfPrintRow(name, elapsed, &sample, ops);
+}
+
+static size_t hash_key(const void* key, size_t size) {
+    // the keys are dense, spread them over the buckets anyway
+    uint64_t k = *(const uint64_t*) key * 0x9E3779B97F4A7C15ull;
+
+    return (size_t) (k >> 32) % size;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+static void* copy_key(const void* key) {
+    uint64_t* copy = malloc(sizeof(*copy));
+    if (copy) {
+        *copy = *(const uint64_t*) key;
+    }
+
+    return copy;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static void shuffle(uint64_t* keys, size_t n) {
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    for (size_t i = n - 1; i > 0; --i) {
+        size_t j = next_random(&state) % (i + 1);
+        uint64_t tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+static void bench_hash_map(Measurement* m, uint64_t* keys, size_t n) {
+    HashMapEntryHandlers handlers = {copy_key, free, copy_key, free};
+    HashMap* map = hashMapInit(hash_key, compare_keys, handlers);
+    if (!map) {
+        fprintf(stderr, "hashMapInit failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+
+    measure_begin(m);
+    for (size_t i = 0; i < n; ++i) {
+        hashMapInsert(map, &keys[i], &keys[i]);
+    }
+    measure_end(m, "hash_map insert", n);
+
+    shuffle(keys, n);
+    size_t found = 0;
+    measure_begin(m);
+    for (size_t i = 0; i < n; ++i) {
+        found += NULL != hashMapGet(map, &keys[i]);
+    }
+    measure_end(m, "hash_map get hit", n);
+
+    const void* batch_keys[BATCH];
+    void* batch_values[BATCH];
+    size_t found_many = 0;
+    measure_begin(m);
+    for (size_t i = 0; i < n; i += BATCH) {
+        size_t count = n - i < BATCH ? n - i : BATCH;
+        for (size_t j = 0; j < count; ++j) {
+            batch_keys[j] = &keys[i + j];
+        }
+        hashMapGetMany(map, batch_keys, count, batch_values);
+        for (size_t j = 0; j < count; ++j) {
+            found_many += NULL != batch_values[j];
+        }
+    }
+    measure_end(m, "hash_map get many", n);
+    if (found_many != n) {
+        fprintf(stderr, "hash_map: found %zu keys out of %zu in batches\n", found_many, n);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] += n;
+    }
+    measure_begin(m);
+    for (size_t i = 0; i < n; ++i) {
+        found += NULL != hashMapGet(map, &keys[i]);
+    }
+    measure_end(m, "hash_map get miss", n);
+
+    if (found != n) {
+        fprintf(stderr, "hash_map: found %zu keys out of %zu\n", found, n);
+        exit(EXIT_FAILURE);
+    }
+    hashMapDestroy(map);
+}
+
+static void bench_hash_set(Measurement* m, uint64_t* keys, size_t n) {
+    HashSet* set = hashSetInit(hash_key, compare_keys, copy_key, free);
+    if (!set) {
+        fprintf(stderr, "hashSetInit failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+
+    measure_begin(m);
+    for (size_t i = 0; i < n; ++i) {
+        hashSetAdd(set, &keys[i]);
+    }
+    measure_end(m, "hash_set add", n);
+
+    shuffle(keys, n);
+    size_t found = 0;
+    measure_begin(m);
+    for (size_t i = 0; i < n; ++i) {
+        found += hashSetContains(set, &keys[i]);
+    }
+    measure_end(m, "hash_set contains", n);
+
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] += n;
+    }
+    measure_begin(m);
+    for (size_t i = 0; i < n; ++i) {
+        found += hashSetContains(set, &keys[i]);
+    }
+    measure_end(m, "hash_set miss", n);
+
+    if (found != n) {
+        fprintf(stderr, "hash_set: found %zu keys out of %zu\n", found, n);
+        exit(EXIT_FAILURE);
+    }
+    hashSetDestroy(set);
+}
+
+static void bench_linked_list(Measurement* m, size_t n) {
+    LinkedList* list = linkedListCreate(copy_key, free, compare_keys);
+    if (!list) {
+        fprintf(stderr, "linkedListCreate failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < n; ++i) {
+        linkedListPush(list, &i);
+    }
+    measure_end(m, "linked_list push", n);
+
+    uint64_t missing = n;
+    ssize_t index = 0;
+    measure_begin(m);
+    for (int i = 0; i < WALKS; ++i) {
+        index += linkedListIndexOf(list, &missing);
+    }
+    measure_end(m, "linked_list walk", (uint64_t) n * WALKS);
+
+    if (index != -WALKS) {
+        fprintf(stderr, "linked_list: found a missing element\n");
+        exit(EXIT_FAILURE);
+    }
+    linkedListDestroy(list);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_N;
+    if (n < 2) {
+        fprintf(stderr, "usage: %s [n]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t* keys = malloc(n * sizeof(*keys));
+    if (!keys) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    Measurement m;
+    int available = perfCountersOpen(&m.counters);
+    printf("n = %zu, %d of %d hardware counters available%s\n\n", n, available, PERF_COUNTER_COUNT,
+           available ? "" : " (check perf_event_paranoid, or the container's seccomp profile)");
+
+    perfPrintHeader("workload (per op)");
+    bench_hash_map(&m, keys, n);
+    bench_hash_set(&m, keys, n);
+    bench_linked_list(&m, n);
+
+    perfCountersClose(&m.counters);
+    free(keys);
+
+    return EXIT_SUCCESS;
+}
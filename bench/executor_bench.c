@@ -0,0 +1,107 @@
+// fork/join scaling of the work-stealing Executor: a recursive fibonacci that
+// spawns one subtask per call above a sequential cutoff, run with 1, 2, 4, ...
+// worker threads.
+//
+// usage: executor_bench [n] [max_threads]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "executor.h"
+
+#define DEFAULT_N 36
+#define CUTOFF 20
+
+typedef struct {
+    Executor* executor;
+    int n;
+    uint64_t result;
+} FibTask;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t fib_sequential(int n) {
+    return n < 2 ? (uint64_t) n : fib_sequential(n - 1) + fib_sequential(n - 2);
+}
+
+static void fib_parallel(void* arg) {
+    FibTask* task = arg;
+    if (task->n < CUTOFF) {
+        task->result = fib_sequential(task->n);
+        return;
+    }
+
+    FibTask left = {task->executor, task->n - 1, 0};
+    FibTask right = {task->executor, task->n - 2, 0};
+
+    ExecutorTaskGroup group;
+    executorTaskGroupInit(&group);
+    if (EXECUTOR_SUCCESS != executorSpawn(task->executor, &group, fib_parallel, &left)) {
+        fib_parallel(&left);
+    }
+    fib_parallel(&right);
+    executorJoin(task->executor, &group);
+
+    task->result = left.result + right.result;
+}
+
+// doubles the thread count, finishing with exactly `max_threads`
+static long next_thread_count(long threads, long max_threads) {
+    if (threads < max_threads && threads * 2 > max_threads) {
+        return max_threads;
+    }
+
+    return threads * 2;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : DEFAULT_N;
+    long max_threads = argc > 2 ? atol(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 0 || max_threads < 1) {
+        fprintf(stderr, "usage: %s [n] [max_threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t start = now_ns();
+    uint64_t expected = fib_sequential(n);
+    double sequential_ms = (double) (now_ns() - start) / 1e6;
+    printf("fib(%d), cutoff %d\n", n, CUTOFF);
+    printf("sequential  %10.2f ms\n", sequential_ms);
+
+    for (long threads = 1; threads <= max_threads; threads = next_thread_count(threads, max_threads)) {
+        Executor* executor = executorCreate((size_t) threads);
+        if (!executor) {
+            fprintf(stderr, "failed to create executor\n");
+            return EXIT_FAILURE;
+        }
+
+        FibTask root = {executor, n, 0};
+        ExecutorTaskGroup group;
+        executorTaskGroupInit(&group);
+
+        start = now_ns();
+        executorSpawn(executor, &group, fib_parallel, &root);
+        executorJoin(executor, &group);
+        double elapsed_ms = (double) (now_ns() - start) / 1e6;
+
+        executorDestroy(executor);
+
+        if (root.result != expected) {
+            fprintf(stderr, "wrong result with %ld threads\n", threads);
+            return EXIT_FAILURE;
+        }
+
+        printf("%2ld threads %10.2f ms  speedup %5.2fx  efficiency %3.0f%%\n", threads, elapsed_ms,
+               sequential_ms / elapsed_ms, 100.0 * sequential_ms / elapsed_ms / (double) threads);
+    }
+
+    return EXIT_SUCCESS;
+}
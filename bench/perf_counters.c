@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* const names[PERF_COUNTER_COUNT] = {
+    "cycles", "instr", "L1d-miss", "LLC-miss", "br-miss", "dTLB-miss",
+};
+
+#ifdef __linux__
+
+#define CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[PERF_COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_LL)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+static int open_counter(PerfCounter counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[counter].type;
+    attr.config = events[counter].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // this thread, any CPU. the counters aren't grouped, so that the PMU may
+    // schedule whichever fit, and multiplexing is corrected for when reading
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perfCountersOpen(PerfCounters* counters) {
+    int available = 0;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        counters->fds[i] = open_counter((PerfCounter) i);
+        if (counters->fds[i] >= 0) {
+            ++available;
+        }
+    }
+
+    return available;
+}
+
+void perfCountersClose(PerfCounters* counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+}
+
+void perfCountersStart(PerfCounters* counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perfCountersStop(PerfCounters* counters, PerfSample* sample) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        uint64_t values[3]; // value, time enabled, time running
+        sample->valid[i] = counters->fds[i] >= 0 &&
+                           sizeof(values) == read(counters->fds[i], values, sizeof(values)) &&
+                           values[2] > 0;
+        sample->values[i] = 0;
+        if (sample->valid[i]) {
+            sample->values[i] = values[2] < values[1]
+                                ? (uint64_t) ((double) values[0] * (double) values[1] / (double) values[2])
+                                : values[0];
+        }
+    }
+}
+
+#else
+
+int perfCountersOpen(PerfCounters* counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        counters->fds[i] = -1;
+    }
+
+    return 0;
+}
+
+void perfCountersClose(PerfCounters* counters) {
+    (void) counters;
+}
+
+void perfCountersStart(PerfCounters* counters) {
+    (void) counters;
+}
+
+void perfCountersStop(PerfCounters* counters, PerfSample* sample) {
+    (void) counters;
+    memset(sample, 0, sizeof(*sample));
+}
+
+#endif // __linux__
+
+const char* perfCounterName(PerfCounter counter) {
+    return names[counter];
+}
+
+void perfPrintHeader(const char* name_title) {
+    printf("%-24s %9s", name_title, "ns/op");
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        printf(" %9s", names[i]);
+    }
+    printf("\n");
+}
+
+void perfPrintRow(const char* name, uint64_t elapsed_ns, const PerfSample* sample, uint64_t ops) {
+    printf("%-24s %9.2f", name, (double) elapsed_ns / (double) ops);
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (sample->valid[i]) {
+            printf(" %9.2f", (double) sample->values[i] / (double) ops);
+        } else {
+            printf(" %9s", "-");
+        }
+    }
+    printf("\n");
+}
@@ -0,0 +1,53 @@
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <stdint.h>
+
+// hardware performance counters for the benchmarks, read with Linux
+// perf_event_open around a workload. only user space is counted, which is what
+// unprivileged processes may do (perf_event_paranoid <= 2).
+//
+// counters the CPU, the kernel or the sandbox don't provide are skipped one by
+// one; with none available (or on other systems) the benchmarks still report
+// their timings.
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+
+    PERF_COUNTER_COUNT
+} PerfCounter;
+
+typedef struct {
+    int fds[PERF_COUNTER_COUNT]; // -1 for unavailable counters
+} PerfCounters;
+
+typedef struct {
+    // scaled up when the kernel multiplexed a counter
+    uint64_t values[PERF_COUNTER_COUNT];
+    int valid[PERF_COUNTER_COUNT];
+} PerfSample;
+
+// opens every available counter (disabled). returns how many are available
+int perfCountersOpen(PerfCounters* counters);
+void perfCountersClose(PerfCounters* counters);
+
+// reset and enable / disable and read the counters
+void perfCountersStart(PerfCounters* counters);
+void perfCountersStop(PerfCounters* counters, PerfSample* sample);
+
+// short name for table headers
+const char* perfCounterName(PerfCounter counter);
+
+// prints the header of a table with a name column, ns/op and every counter
+void perfPrintHeader(const char* name_title);
+
+// prints a row: elapsed ns and counter values divided by `ops`.
+// unavailable counters are shown as "-"
+void perfPrintRow(const char* name, uint64_t elapsed_ns, const PerfSample* sample, uint64_t ops);
+
+#endif // __PERF_COUNTERS_H__
@@ -0,0 +1,247 @@
+// throughput and latency of passing messages between two threads:
+// RingBuffer (single element and batched) against a mutex-protected LinkedList.
+//
+// usage: ring_buffer_bench [messages]
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "linked_list.h"
+#include "ring_buffer.h"
+
+#define DEFAULT_MESSAGES 10000000
+#define RING_CAPACITY 1024
+#define BATCH_SIZE 32
+#define PING_PONGS 100000
+
+typedef struct {
+    uint64_t sequence;
+    uint64_t payload;
+} Message;
+
+typedef struct {
+    RingBuffer* buffer;
+    RingBuffer* reply;
+    LinkedList* list;
+    pthread_mutex_t lock;
+    size_t messages;
+    int batched;
+} BenchContext;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void* copy_message(const void* src) {
+    Message* dest = malloc(sizeof(Message));
+    if (dest) {
+        *dest = *(const Message*) src;
+    }
+
+    return dest;
+}
+
+// called when a side can't make progress. yielding keeps the benchmark usable
+// when both threads share a core
+static void wait_for_peer(void) {
+    sched_yield();
+}
+
+static void report(const char* name, size_t messages, uint64_t elapsed) {
+    printf("%-24s %8.2f Mmsg/s  %6.2f ns/msg\n", name,
+           (double) messages * 1e3 / (double) elapsed, (double) elapsed / (double) messages);
+}
+
+
+static void* ring_producer(void* arg) {
+    BenchContext* ctx = arg;
+
+    Message batch[BATCH_SIZE];
+    for (size_t sent = 0; sent < ctx->messages;) {
+        size_t count = ctx->batched ? BATCH_SIZE : 1;
+        if (count > ctx->messages - sent) count = ctx->messages - sent;
+
+        for (size_t i = 0; i < count; ++i) {
+            batch[i].sequence = sent + i;
+            batch[i].payload = sent + i;
+        }
+
+        size_t written = 0;
+        while (written < count) {
+            size_t n = ringBufferWriteBatch(ctx->buffer, batch + written, count - written);
+            if (0 == n) wait_for_peer();
+            written += n;
+        }
+        sent += count;
+    }
+
+    return NULL;
+}
+
+static uint64_t bench_ring(size_t messages, int batched) {
+    BenchContext ctx = {.messages = messages, .batched = batched};
+    ctx.buffer = ringBufferCreateInline(RING_CAPACITY, sizeof(Message));
+
+    uint64_t start = now_ns();
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, ring_producer, &ctx);
+
+    Message batch[BATCH_SIZE];
+    uint64_t checksum = 0;
+    for (size_t received = 0; received < messages;) {
+        size_t read = ringBufferReadBatch(ctx.buffer, batch, batched ? BATCH_SIZE : 1);
+        if (0 == read) wait_for_peer();
+        for (size_t i = 0; i < read; ++i) {
+            checksum += batch[i].payload;
+        }
+        received += read;
+    }
+
+    pthread_join(producer, NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    if (checksum != (uint64_t) messages * (messages - 1) / 2) {
+        fprintf(stderr, "ring buffer: bad checksum\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ringBufferDestroy(ctx.buffer);
+
+    return elapsed;
+}
+
+
+static void* list_producer(void* arg) {
+    BenchContext* ctx = arg;
+
+    for (size_t sent = 0; sent < ctx->messages; ++sent) {
+        Message message = {sent, sent};
+
+        pthread_mutex_lock(&ctx->lock);
+        linkedListPush(ctx->list, &message);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    return NULL;
+}
+
+static uint64_t bench_locked_list(size_t messages) {
+    BenchContext ctx = {.messages = messages};
+    ctx.list = linkedListCreate(copy_message, free, NULL);
+    pthread_mutex_init(&ctx.lock, NULL);
+
+    uint64_t start = now_ns();
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, list_producer, &ctx);
+
+    uint64_t checksum = 0;
+    for (size_t received = 0; received < messages;) {
+        pthread_mutex_lock(&ctx.lock);
+        Message* message = linkedListPopFront(ctx.list);
+        pthread_mutex_unlock(&ctx.lock);
+
+        if (message) {
+            checksum += message->payload;
+            free(message);
+            ++received;
+        } else {
+            wait_for_peer();
+        }
+    }
+
+    pthread_join(producer, NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    if (checksum != (uint64_t) messages * (messages - 1) / 2) {
+        fprintf(stderr, "locked list: bad checksum\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_mutex_destroy(&ctx.lock);
+    linkedListDestroy(ctx.list);
+
+    return elapsed;
+}
+
+
+// echoes every message back on the reply buffer
+static void* echo(void* arg) {
+    BenchContext* ctx = arg;
+
+    Message message;
+    for (size_t i = 0; i < ctx->messages; ++i) {
+        while (RING_BUFFER_SUCCESS != ringBufferRead(ctx->buffer, &message)) wait_for_peer();
+        while (RING_BUFFER_SUCCESS != ringBufferWrite(ctx->reply, &message)) wait_for_peer();
+    }
+
+    return NULL;
+}
+
+static int compare_u64(const void* first, const void* second) {
+    uint64_t a = *(const uint64_t*) first;
+    uint64_t b = *(const uint64_t*) second;
+
+    return (a > b) - (a < b);
+}
+
+static void bench_latency(void) {
+    BenchContext ctx = {.messages = PING_PONGS};
+    ctx.buffer = ringBufferCreateInline(RING_CAPACITY, sizeof(Message));
+    ctx.reply = ringBufferCreateInline(RING_CAPACITY, sizeof(Message));
+
+    uint64_t* samples = malloc(PING_PONGS * sizeof(uint64_t));
+
+    pthread_t echoer;
+    pthread_create(&echoer, NULL, echo, &ctx);
+
+    Message message = {0, 0};
+    for (size_t i = 0; i < PING_PONGS; ++i) {
+        uint64_t start = now_ns();
+
+        message.sequence = i;
+        while (RING_BUFFER_SUCCESS != ringBufferWrite(ctx.buffer, &message)) wait_for_peer();
+        while (RING_BUFFER_SUCCESS != ringBufferRead(ctx.reply, &message)) wait_for_peer();
+
+        samples[i] = now_ns() - start;
+    }
+
+    pthread_join(echoer, NULL);
+
+    qsort(samples, PING_PONGS, sizeof(uint64_t), compare_u64);
+    printf("round trip latency: p50 %llu ns  p99 %llu ns  p99.9 %llu ns\n",
+           (unsigned long long) samples[PING_PONGS / 2],
+           (unsigned long long) samples[PING_PONGS * 99 / 100],
+           (unsigned long long) samples[PING_PONGS * 999 / 1000]);
+
+    free(samples);
+    ringBufferDestroy(ctx.buffer);
+    ringBufferDestroy(ctx.reply);
+}
+
+
+int main(int argc, char** argv) {
+    size_t messages = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_MESSAGES;
+    if (0 == messages) {
+        fprintf(stderr, "usage: %s [messages]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu messages of %zu bytes\n", messages, sizeof(Message));
+
+    report("ring buffer", messages, bench_ring(messages, 0));
+    report("ring buffer (batched)", messages, bench_ring(messages, 1));
+    report("mutex + linked list", messages, bench_locked_list(messages));
+
+    bench_latency();
+
+    return EXIT_SUCCESS;
+}
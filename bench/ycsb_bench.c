@@ -0,0 +1,646 @@
+// YCSB-style macro benchmark of HashMap: N threads run a mix of reads,
+// updates, inserts and scans over keys drawn from a zipfian, uniform or
+// latest distribution, and report the throughput and per-operation latency
+// percentiles.
+//
+// HashMap isn't thread-safe, so it's driven through one of these wrappers:
+//   mutex    one map behind a mutex
+//   rwlock   one map behind a reader-writer lock (reads run concurrently)
+//   striped  16 maps, each behind its own mutex, picked by the key's hash
+//
+// usage: ycsb_bench [options]
+//   -w a|b|c|d|e   YCSB core workload preset (default a):
+//                    a  50% read, 50% update, zipfian
+//                    b  95% read, 5% update, zipfian
+//                    c  100% read, zipfian
+//                    d  95% read, 5% insert, latest
+//                    e  95% scan, 5% insert, zipfian
+//   -r/-u/-i/-s %  read / update / insert / scan percentage (overrides -w)
+//   -d zipfian|uniform|latest   key distribution (overrides -w)
+//   -l mutex|rwlock|striped|all (default all)
+//   -t threads     (default: online CPUs)
+//   -n records     loaded before the run (default 100000)
+//   -o operations  per thread (default 200000)
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hash_map.h"
+
+#define DEFAULT_RECORDS 100000
+#define DEFAULT_OPERATIONS 200000
+#define STRIPES 16
+#define MAX_SCAN_LENGTH 100
+#define RECORD_WORDS 8 // 64-byte values
+#define ZIPFIAN_THETA 0.99
+
+typedef enum { OP_READ, OP_UPDATE, OP_INSERT, OP_SCAN, OP_COUNT } Operation;
+
+static const char* const operation_names[OP_COUNT] = {"read", "update", "insert", "scan"};
+
+typedef enum { DIST_ZIPFIAN, DIST_UNIFORM, DIST_LATEST } Distribution;
+
+typedef enum { LOCK_MUTEX, LOCK_RWLOCK, LOCK_STRIPED, LOCK_MODE_COUNT } LockMode;
+
+static const char* const lock_mode_names[LOCK_MODE_COUNT] = {"mutex", "rwlock", "striped"};
+
+typedef struct {
+    int percent[OP_COUNT];
+    Distribution distribution;
+} Workload;
+
+typedef struct {
+    uint64_t words[RECORD_WORDS]; // words[0] is the key, the rest a version
+} Record;
+
+// zipfian ranks over [0, n), following Gray et al., "Quickly generating
+// billion-record synthetic databases" (as YCSB does)
+typedef struct {
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zeta_n;
+    double eta;
+} Zipfian;
+
+// log-linear latency histogram: exact below 16 ns, then 16 buckets per power
+// of two (about 6% resolution)
+#define HISTOGRAM_SUB_BUCKETS 16
+#define HISTOGRAM_BUCKETS (61 * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+typedef struct {
+    LockMode mode;
+    size_t map_count;
+    HashMap* maps[STRIPES];
+    pthread_mutex_t mutexes[STRIPES];
+    pthread_rwlock_t rwlock;
+} Store;
+
+typedef struct {
+    Store* store;
+    const Workload* workload;
+    const Zipfian* zipfian;
+    uint64_t records;
+    atomic_uint_least64_t next_key; // next key to insert
+    size_t operations;
+} BenchContext;
+
+typedef struct {
+    BenchContext* context;
+    pthread_t thread;
+    uint64_t random;
+    uint64_t failures;
+    Histogram histograms[OP_COUNT];
+} Worker;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static double next_unit(uint64_t* state) {
+    return (double) (next_random(state) >> 11) / (double) (1ull << 53);
+}
+
+static uint64_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+
+    return key;
+}
+
+// hashing
+
+static size_t hash_key(const void* key, size_t size) {
+    return (size_t) (mix(*(const uint64_t*) key) % size);
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+static void* copy_key(const void* key) {
+    uint64_t* copy = malloc(sizeof(*copy));
+    if (copy) {
+        *copy = *(const uint64_t*) key;
+    }
+
+    return copy;
+}
+
+static void* copy_record(const void* record) {
+    Record* copy = malloc(sizeof(*copy));
+    if (copy) {
+        *copy = *(const Record*) record;
+    }
+
+    return copy;
+}
+
+// key distributions
+
+static double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) {
+        sum += 1 / pow((double) i, theta);
+    }
+
+    return sum;
+}
+
+static void zipfian_init(Zipfian* zipfian, uint64_t n, double theta) {
+    zipfian->n = n;
+    zipfian->theta = theta;
+    zipfian->alpha = 1 / (1 - theta);
+    zipfian->zeta_n = zeta(n, theta);
+    zipfian->eta = (1 - pow(2.0 / (double) n, 1 - theta)) / (1 - zeta(2, theta) / zipfian->zeta_n);
+}
+
+// rank 0 is the most popular
+static uint64_t zipfian_next(const Zipfian* zipfian, uint64_t* random) {
+    double u = next_unit(random);
+    double uz = u * zipfian->zeta_n;
+    if (uz < 1) {
+        return 0;
+    }
+    if (uz < 1 + pow(0.5, zipfian->theta)) {
+        return 1;
+    }
+
+    uint64_t rank = (uint64_t) ((double) zipfian->n * pow(zipfian->eta * u - zipfian->eta + 1, zipfian->alpha));
+    return rank < zipfian->n ? rank : zipfian->n - 1;
+}
+
+// a key that exists (unless an insert of it is still in flight)
+static uint64_t choose_key(Worker* worker) {
+    BenchContext* context = worker->context;
+    uint64_t inserted = atomic_load_explicit(&context->next_key, memory_order_relaxed);
+
+    switch (context->workload->distribution) {
+    case DIST_UNIFORM:
+        return next_random(&worker->random) % inserted;
+    case DIST_LATEST: {
+        // the most recently inserted keys are the most popular
+        uint64_t back = zipfian_next(context->zipfian, &worker->random);
+        return back < inserted ? inserted - 1 - back : 0;
+    }
+    case DIST_ZIPFIAN:
+    default:
+        // scrambled, so that the popular keys aren't neighbours (which would
+        // make scans of them unrealistically hot)
+        return mix(zipfian_next(context->zipfian, &worker->random)) % context->records;
+    }
+}
+
+// histograms
+
+static size_t histogram_index(uint64_t ns) {
+    if (ns < HISTOGRAM_SUB_BUCKETS) {
+        return (size_t) ns;
+    }
+
+    int exponent = 63 - __builtin_clzll(ns); // >= 4
+    size_t sub = (size_t) (ns >> (exponent - 4)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return (size_t) (exponent - 3) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// the lowest latency of a bucket
+static uint64_t histogram_value(size_t index) {
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+
+    int exponent = (int) (index / HISTOGRAM_SUB_BUCKETS) + 3;
+    return (uint64_t) (HISTOGRAM_SUB_BUCKETS + index % HISTOGRAM_SUB_BUCKETS) << (exponent - 4);
+}
+
+static void histogram_record(Histogram* histogram, uint64_t ns) {
+    ++histogram->counts[histogram_index(ns)];
+    ++histogram->total;
+    if (ns > histogram->max) {
+        histogram->max = ns;
+    }
+}
+
+static void histogram_merge(Histogram* dest, const Histogram* src) {
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        dest->counts[i] += src->counts[i];
+    }
+    dest->total += src->total;
+    if (src->max > dest->max) {
+        dest->max = src->max;
+    }
+}
+
+static uint64_t histogram_percentile(const Histogram* histogram, double percentile) {
+    uint64_t rank = (uint64_t) ceil(percentile / 100 * (double) histogram->total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->counts[i];
+        if (seen >= rank && seen > 0) {
+            return histogram_value(i);
+        }
+    }
+
+    return histogram->max;
+}
+
+// the store: a HashMap behind a lock
+
+static int store_init(Store* store, LockMode mode) {
+    HashMapEntryHandlers handlers = {copy_key, free, copy_record, free};
+
+    store->mode = mode;
+    store->map_count = LOCK_STRIPED == mode ? STRIPES : 1;
+    for (size_t i = 0; i < store->map_count; ++i) {
+        store->maps[i] = hashMapInit(hash_key, compare_keys, handlers);
+        if (!store->maps[i]) {
+            return -1;
+        }
+        pthread_mutex_init(&store->mutexes[i], NULL);
+    }
+    pthread_rwlock_init(&store->rwlock, NULL);
+
+    return 0;
+}
+
+static void store_destroy(Store* store) {
+    for (size_t i = 0; i < store->map_count; ++i) {
+        hashMapDestroy(store->maps[i]);
+        pthread_mutex_destroy(&store->mutexes[i]);
+    }
+    pthread_rwlock_destroy(&store->rwlock);
+}
+
+static size_t store_stripe(const Store* store, uint64_t key) {
+    // the top bits, the maps' buckets are chosen with the low ones
+    return store->map_count > 1 ? (size_t) (mix(key) >> 60) % store->map_count : 0;
+}
+
+static void store_lock(Store* store, size_t stripe, int write) {
+    if (LOCK_RWLOCK == store->mode) {
+        if (write) {
+            pthread_rwlock_wrlock(&store->rwlock);
+        } else {
+            pthread_rwlock_rdlock(&store->rwlock);
+        }
+    } else {
+        pthread_mutex_lock(&store->mutexes[stripe]);
+    }
+}
+
+static void store_unlock(Store* store, size_t stripe) {
+    if (LOCK_RWLOCK == store->mode) {
+        pthread_rwlock_unlock(&store->rwlock);
+    } else {
+        pthread_mutex_unlock(&store->mutexes[stripe]);
+    }
+}
+
+// copies the value out while the lock is held: an update frees the old one.
+// returns 1 if key was found
+static int store_read(Store* store, uint64_t key, Record* record) {
+    size_t stripe = store_stripe(store, key);
+    store_lock(store, stripe, 0);
+    const Record* value = hashMapGet(store->maps[stripe], &key);
+    if (value) {
+        *record = *value;
+    }
+    store_unlock(store, stripe);
+
+    return NULL != value;
+}
+
+static int store_write(Store* store, uint64_t key, const Record* record) {
+    size_t stripe = store_stripe(store, key);
+    store_lock(store, stripe, 1);
+    HashMapStatus status = hashMapInsert(store->maps[stripe], &key, record);
+    store_unlock(store, stripe);
+
+    return HASH_MAP_SUCCESS == status ? 0 : -1;
+}
+
+// the run
+
+static void make_record(Record* record, uint64_t key, uint64_t version) {
+    record->words[0] = key;
+    for (size_t i = 1; i < RECORD_WORDS; ++i) {
+        record->words[i] = version;
+    }
+}
+
+static Operation choose_operation(Worker* worker) {
+    int roll = (int) (next_random(&worker->random) % 100);
+    for (int op = 0; op < OP_COUNT - 1; ++op) {
+        roll -= worker->context->workload->percent[op];
+        if (roll < 0) {
+            return (Operation) op;
+        }
+    }
+
+    return OP_SCAN;
+}
+
+// returns 0, or -1 if a read found a record that doesn't belong to its key
+static int run_operation(Worker* worker, Operation op) {
+    BenchContext* context = worker->context;
+    Record record;
+
+    switch (op) {
+    case OP_READ: {
+        uint64_t key = choose_key(worker);
+        if (store_read(context->store, key, &record) && record.words[0] != key) {
+            return -1;
+        }
+        return 0;
+    }
+    case OP_UPDATE: {
+        uint64_t key = choose_key(worker);
+        make_record(&record, key, next_random(&worker->random));
+        return store_write(context->store, key, &record);
+    }
+    case OP_INSERT: {
+        uint64_t key = atomic_fetch_add_explicit(&context->next_key, 1, memory_order_relaxed);
+        make_record(&record, key, 0);
+        return store_write(context->store, key, &record);
+    }
+    case OP_SCAN:
+    default: {
+        // HashMap is unordered: a scan reads a run of consecutive keys one by
+        // one (and isn't atomic)
+        uint64_t key = choose_key(worker);
+        uint64_t length = 1 + next_random(&worker->random) % MAX_SCAN_LENGTH;
+        for (uint64_t i = 0; i < length; ++i) {
+            if (store_read(context->store, key + i, &record) && record.words[0] != key + i) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    }
+}
+
+static void* worker_run(void* arg) {
+    Worker* worker = arg;
+    for (size_t i = 0; i < worker->context->operations; ++i) {
+        Operation op = choose_operation(worker);
+
+        uint64_t start = now_ns();
+        if (0 != run_operation(worker, op)) {
+            ++worker->failures;
+        }
+        histogram_record(&worker->histograms[op], now_ns() - start);
+    }
+
+    return NULL;
+}
+
+static int run(LockMode mode, const Workload* workload, const Zipfian* zipfian, uint64_t records,
+               long threads, size_t operations) {
+    Store store;
+    if (0 != store_init(&store, mode)) {
+        fprintf(stderr, "hashMapInit failed\n");
+        return -1;
+    }
+
+    Record record;
+    for (uint64_t key = 0; key < records; ++key) {
+        make_record(&record, key, 0);
+        if (0 != store_write(&store, key, &record)) {
+            fprintf(stderr, "load failed\n");
+            store_destroy(&store);
+            return -1;
+        }
+    }
+
+    BenchContext context = {&store, workload, zipfian, records, records, operations};
+    Worker* workers = calloc((size_t) threads, sizeof(*workers));
+    if (!workers) {
+        fprintf(stderr, "out of memory\n");
+        store_destroy(&store);
+        return -1;
+    }
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < threads; ++i) {
+        workers[i].context = &context;
+        workers[i].random = mix((uint64_t) i + 1);
+        pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+    }
+    for (long i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    Histogram totals[OP_COUNT];
+    memset(totals, 0, sizeof(totals));
+    uint64_t failures = 0;
+    for (long i = 0; i < threads; ++i) {
+        for (int op = 0; op < OP_COUNT; ++op) {
+            histogram_merge(&totals[op], &workers[i].histograms[op]);
+        }
+        failures += workers[i].failures;
+    }
+
+    uint64_t total_operations = (uint64_t) threads * operations;
+    printf("%-8s %10.0f ops/s  %.3f s\n", lock_mode_names[mode],
+           (double) total_operations * 1e9 / (double) elapsed, (double) elapsed / 1e9);
+    for (int op = 0; op < OP_COUNT; ++op) {
+        const Histogram* histogram = &totals[op];
+        if (histogram->total) {
+            printf("  %-7s %10llu ops  p50 %8llu ns  p99 %8llu ns  p99.9 %8llu ns  max %10llu ns\n",
+                   operation_names[op], (unsigned long long) histogram->total,
+                   (unsigned long long) histogram_percentile(histogram, 50),
+                   (unsigned long long) histogram_percentile(histogram, 99),
+                   (unsigned long long) histogram_percentile(histogram, 99.9),
+                   (unsigned long long) histogram->max);
+        }
+    }
+
+    free(workers);
+    store_destroy(&store);
+
+    if (failures) {
+        fprintf(stderr, "%llu operations failed\n", (unsigned long long) failures);
+        return -1;
+    }
+    return 0;
+}
+
+static int set_preset(Workload* workload, char preset) {
+    static const Workload presets[] = {
+        {{50, 50, 0, 0}, DIST_ZIPFIAN},
+        {{95, 5, 0, 0}, DIST_ZIPFIAN},
+        {{100, 0, 0, 0}, DIST_ZIPFIAN},
+        {{95, 0, 5, 0}, DIST_LATEST},
+        {{0, 0, 5, 95}, DIST_ZIPFIAN},
+    };
+    if (preset < 'a' || preset > 'e') {
+        return -1;
+    }
+
+    *workload = presets[preset - 'a'];
+    return 0;
+}
+
+static int parse_distribution(const char* name, Distribution* distribution) {
+    if (0 == strcmp(name, "zipfian")) {
+        *distribution = DIST_ZIPFIAN;
+    } else if (0 == strcmp(name, "uniform")) {
+        *distribution = DIST_UNIFORM;
+    } else if (0 == strcmp(name, "latest")) {
+        *distribution = DIST_LATEST;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int parse_lock_mode(const char* name, int* mode) {
+    if (0 == strcmp(name, "all")) {
+        *mode = LOCK_MODE_COUNT;
+        return 0;
+    }
+    for (int i = 0; i < LOCK_MODE_COUNT; ++i) {
+        if (0 == strcmp(name, lock_mode_names[i])) {
+            *mode = i;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [-w a|b|c|d|e] [-r %%] [-u %%] [-i %%] [-s %%] [-d zipfian|uniform|latest]\n"
+            "       [-l mutex|rwlock|striped|all] [-t threads] [-n records] [-o operations]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    Workload workload;
+    set_preset(&workload, 'a');
+    int percent[OP_COUNT] = {-1, -1, -1, -1};
+    int distribution_set = 0;
+    Distribution distribution = DIST_ZIPFIAN;
+    int lock_mode = LOCK_MODE_COUNT;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long records = DEFAULT_RECORDS;
+    long operations = DEFAULT_OPERATIONS;
+
+    int option;
+    while (-1 != (option = getopt(argc, argv, "w:r:u:i:s:d:l:t:n:o:"))) {
+        int ok = 1;
+        switch (option) {
+        case 'w':
+            ok = 0 == set_preset(&workload, optarg[0]) && !optarg[1];
+            break;
+        case 'r':
+            percent[OP_READ] = atoi(optarg);
+            break;
+        case 'u':
+            percent[OP_UPDATE] = atoi(optarg);
+            break;
+        case 'i':
+            percent[OP_INSERT] = atoi(optarg);
+            break;
+        case 's':
+            percent[OP_SCAN] = atoi(optarg);
+            break;
+        case 'd':
+            ok = 0 == parse_distribution(optarg, &distribution);
+            distribution_set = 1;
+            break;
+        case 'l':
+            ok = 0 == parse_lock_mode(optarg, &lock_mode);
+            break;
+        case 't':
+            threads = atol(optarg);
+            break;
+        case 'n':
+            records = atol(optarg);
+            break;
+        case 'o':
+            operations = atol(optarg);
+            break;
+        default:
+            ok = 0;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // explicit percentages replace the preset's mix, unset ones being 0
+    if (percent[OP_READ] >= 0 || percent[OP_UPDATE] >= 0 || percent[OP_INSERT] >= 0 || percent[OP_SCAN] >= 0) {
+        for (int op = 0; op < OP_COUNT; ++op) {
+            workload.percent[op] = percent[op] > 0 ? percent[op] : 0;
+        }
+    }
+    if (distribution_set) {
+        workload.distribution = distribution;
+    }
+
+    int sum = 0;
+    for (int op = 0; op < OP_COUNT; ++op) {
+        sum += workload.percent[op];
+    }
+    if (100 != sum || optind != argc || threads < 1 || records < 2 || operations < 1) {
+        if (100 != sum) {
+            fprintf(stderr, "the operation percentages must add up to 100\n");
+        }
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Zipfian zipfian;
+    zipfian_init(&zipfian, (uint64_t) records, ZIPFIAN_THETA);
+
+    static const char* const distribution_names[] = {"zipfian", "uniform", "latest"};
+    printf("%ld threads, %ld records, %ld operations per thread\n", threads, records, operations);
+    printf("read %d%%, update %d%%, insert %d%%, scan %d%%, %s keys\n\n", workload.percent[OP_READ],
+           workload.percent[OP_UPDATE], workload.percent[OP_INSERT], workload.percent[OP_SCAN],
+           distribution_names[workload.distribution]);
+
+    for (int mode = 0; mode < LOCK_MODE_COUNT; ++mode) {
+        if (LOCK_MODE_COUNT != lock_mode && mode != lock_mode) {
+            continue;
+        }
+        if (0 != run((LockMode) mode, &workload, &zipfian, (uint64_t) records, threads, (size_t) operations)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#ifndef __BLOOM_FILTER_H__
+#define __BLOOM_FILTER_H__
+
+#include <stddef.h>	// size_t
+#include <stdint.h>	// uint64_t
+
+#include "ds_allocator.h"
+
+typedef struct bloom_filter BloomFilter;
+
+/**
+ * A blocked Bloom filter over 64 bit hashes.
+ * Each hash maps to a single 64 byte block (one cache line), and sets one bit
+ * in each of the block's eight words, so a query touches one cache line and
+ * its eight bit tests are independent of each other.
+ *
+ * The filter never reports a false negative. The false positive rate grows
+ * once more than the expected number of hashes were added.
+ * The filter stores hashes, not keys: callers hash their keys themselves, and
+ * should pass well mixed 64 bit values.
+ **/
+
+/**
+ * Creates an empty filter sized for expected_elements hashes at roughly the
+ * given false positive rate (between 0 and 1, exclusive).
+ * In case of a memory allocation error, NULL is returned.
+ **/
+BloomFilter* bloomFilterCreate(size_t expected_elements, double false_positive_rate);
+
+/**
+ * Like bloomFilterCreate, but the filter takes its memory (the filter object
+ * and its blocks) from allocator. If allocator is NULL, the default
+ * allocator is used.
+ **/
+BloomFilter* bloomFilterCreateWithAllocator(size_t expected_elements,
+					    double false_positive_rate,
+					    const DsAllocator* allocator);
+
+/**
+ * Frees the given filter.
+ * Passing NULL has no effect.
+ **/
+void bloomFilterDestroy(BloomFilter* filter);
+
+/**
+ * Removes all hashes from the given filter.
+ **/
+void bloomFilterClear(BloomFilter* filter);
+
+/**
+ * Adds hash to the given filter.
+ **/
+void bloomFilterAdd(BloomFilter* filter, uint64_t hash);
+
+/**
+ * Returns 0 if hash was definitely never added to the filter, and 1 if it
+ * may have been.
+ **/
+int bloomFilterMayContain(const BloomFilter* filter, uint64_t hash);
+
+/**
+ * Starts loading the block of hash into the cache, for a later
+ * bloomFilterMayContain.
+ **/
+void bloomFilterPrefetch(const BloomFilter* filter, uint64_t hash);
+
+/**
+ * Returns the size of the filter's bit array, in bytes.
+ **/
+size_t bloomFilterSizeBytes(const BloomFilter* filter);
+
+
+#endif // __BLOOM_FILTER_H__
@@ -0,0 +1,86 @@
+#ifndef __CONCURRENT_LIST_H__
+#define __CONCURRENT_LIST_H__
+
+#include <stddef.h> // size_t
+#include <sys/types.h> // ssize_t
+
+#include "linked_list.h" // copy_func_t, free_func_t, cmp_func_t
+
+typedef struct __concurrent_list ConcurrentList;
+
+/*
+A linked list for read-mostly data shared between threads.
+Readers never lock: they walk the list concurrently with writers, and see every node
+either before or after a change. Writers lock a mutex among themselves, and publish
+each change with a single atomic pointer store.
+
+Removed nodes (and their elements) are reclaimed with epoch-based reclamation: a
+node is only freed once every reader that might still be looking at it has left its
+read section. Reading inside a read section costs no more than walking a LinkedList;
+entering and leaving one costs a memory fence and two stores.
+
+Elements are copied, compared and freed like in LinkedList. A copy function is
+required to add elements.
+
+Read sections:
+    concurrentListReadBegin(list);
+    const Config* config = concurrentListGetAt(list, 3);
+    ... // config stays valid here, even if a writer removes it
+    concurrentListReadEnd(list);
+Read sections may be nested, and may span several lists. concurrentListIndexOf and
+concurrentListForEach open their own read section.
+A thread must not call concurrentListSynchronize (or destroy a list) inside a read
+section.
+*/
+
+typedef enum {
+    CONCURRENT_LIST_SUCCESS,
+    CONCURRENT_LIST_MEM_ERROR,
+    CONCURRENT_LIST_NOT_FOUND
+
+} ConcurrentListStatus;
+
+typedef void (*visit_func_t)(const void* element, void* params);
+
+// create a new empty list
+ConcurrentList* concurrentListCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func);
+
+// free all memory associated with the list (including elements).
+// must not run concurrently with any other operation on the list
+void concurrentListDestroy(ConcurrentList* list);
+
+// get list size. while writers are active, this is only a snapshot
+size_t concurrentListSize(const ConcurrentList* list);
+
+// enter/leave a read section on the calling thread
+void concurrentListReadBegin(const ConcurrentList* list);
+void concurrentListReadEnd(const ConcurrentList* list);
+
+// readers: get index of a given element. return -1 if `element` is not found
+ssize_t concurrentListIndexOf(const ConcurrentList* list, const void* element);
+
+// readers, inside a read section: returns the element located at `index`, or NULL if
+// `index` is out of range. the element stays valid until the read section ends
+const void* concurrentListGetAt(const ConcurrentList* list, size_t index);
+
+// readers: call `visit` on every element, in order
+void concurrentListForEach(const ConcurrentList* list, visit_func_t visit, void* params);
+
+// writers: insert a copy of `element` so that it ends up at `index`.
+// if `index` is past the last element, the element is appended
+ConcurrentListStatus concurrentListInsertAt(ConcurrentList* list, size_t index, const void* element);
+
+// writers: add a copy of `element` to the end/start of the list
+ConcurrentListStatus concurrentListPush(ConcurrentList* list, const void* element);
+ConcurrentListStatus concurrentListPushFront(ConcurrentList* list, const void* element);
+
+// writers: unlink the element at `index` / the first element equal to `element`.
+// the element is freed once no reader can reach it anymore.
+// returns CONCURRENT_LIST_NOT_FOUND if there's no such element
+ConcurrentListStatus concurrentListRemoveAt(ConcurrentList* list, size_t index);
+ConcurrentListStatus concurrentListRemove(ConcurrentList* list, const void* element);
+
+// writers: wait until every removed element has been freed
+void concurrentListSynchronize(ConcurrentList* list);
+
+#endif // __CONCURRENT_LIST_H__
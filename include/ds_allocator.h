@@ -0,0 +1,116 @@
+#ifndef __DS_ALLOCATOR_H__
+#define __DS_ALLOCATOR_H__
+
+#include <stddef.h> // size_t
+
+/*
+A pluggable memory allocator for the library's containers.
+
+Containers created with an allocator (the *WithAllocator functions) take all of
+their own memory from it: the container object, nodes, entries and arrays. Elements
+are still allocated by the user's copy functions.
+
+Containers always pass back the size they asked for when freeing or reallocating,
+so allocators don't need to keep any per-block header.
+
+Three allocators are provided besides the default (malloc based) one:
+- an arena, which bumps a pointer through large blocks and frees everything at once.
+  freeing is a no-op (except for the most recent allocation), so containers using
+  an arena are best thrown away with the arena itself (dsArenaReset/Destroy).
+- a pool of fixed-size objects, kept on a free list. larger requests go to the
+  parent allocator.
+- a tracker, which forwards to a parent allocator and counts what goes through it.
+
+Only the default allocator is thread-safe. Any other allocator must only be used
+by one thread at a time, which is the case for the containers using it as long as
+they aren't shared between threads.
+*/
+
+typedef struct {
+    // returns NULL on failure
+    void* (*alloc)(void* context, size_t size);
+
+    // `ptr` may be NULL (with `old_size` 0). on failure, returns NULL and leaves
+    // `ptr` untouched
+    void* (*realloc)(void* context, void* ptr, size_t old_size, size_t new_size);
+
+    // `ptr` may be NULL
+    void (*free)(void* context, void* ptr, size_t size);
+
+    void* context;
+} DsAllocator;
+
+// the malloc/realloc/free allocator. containers created without an allocator
+// (or with a NULL one) use it
+const DsAllocator* dsDefaultAllocator(void);
+
+static inline void* dsAlloc(const DsAllocator* allocator, size_t size) {
+    return allocator->alloc(allocator->context, size);
+}
+
+static inline void* dsRealloc(const DsAllocator* allocator, void* ptr, size_t old_size, size_t new_size) {
+    return allocator->realloc(allocator->context, ptr, old_size, new_size);
+}
+
+static inline void dsFree(const DsAllocator* allocator, void* ptr, size_t size) {
+    allocator->free(allocator->context, ptr, size);
+}
+
+
+typedef struct __ds_arena DsArena;
+
+// create an arena carving `block_size` byte blocks taken from `parent` (the default
+// allocator if NULL). requests larger than a block get a block of their own.
+// allocations are aligned like malloc's
+DsArena* dsArenaCreate(size_t block_size, const DsAllocator* parent);
+
+// free every block of the arena
+void dsArenaDestroy(DsArena* arena);
+
+// free every allocation at once. the first block is kept for reuse
+void dsArenaReset(DsArena* arena);
+
+// an allocator handing out memory from `arena`. freeing gives the memory back only
+// if it is the most recent allocation
+DsAllocator dsArenaAllocator(DsArena* arena);
+
+// bytes handed out since the arena was created or reset
+size_t dsArenaBytesUsed(const DsArena* arena);
+
+
+typedef struct __ds_pool DsPool;
+
+// create a pool of `object_size` byte objects, taken from `parent` (the default
+// allocator if NULL) in chunks of `objects_per_chunk`
+DsPool* dsPoolCreate(size_t object_size, size_t objects_per_chunk, const DsAllocator* parent);
+
+// free every chunk of the pool. objects still in use are freed too
+void dsPoolDestroy(DsPool* pool);
+
+// an allocator handing out pool objects for requests of up to `object_size` bytes,
+// and forwarding larger ones to the parent allocator
+DsAllocator dsPoolAllocator(DsPool* pool);
+
+
+typedef struct {
+    size_t allocations; // successful alloc calls, and realloc calls that moved from NULL
+    size_t frees;       // free calls with a non-NULL pointer
+    size_t bytes_in_use;
+    size_t peak_bytes;  // highest `bytes_in_use` seen
+    size_t total_bytes; // bytes requested over the tracker's lifetime (growth for realloc)
+} DsAllocatorStats;
+
+typedef struct __ds_tracker DsTracker;
+
+// create a tracker forwarding to `parent` (the default allocator if NULL)
+DsTracker* dsTrackerCreate(const DsAllocator* parent);
+
+// free the tracker. memory allocated through it belongs to the parent allocator
+void dsTrackerDestroy(DsTracker* tracker);
+
+// an allocator forwarding to the parent, and counting every call
+DsAllocator dsTrackerAllocator(DsTracker* tracker);
+
+DsAllocatorStats dsTrackerStats(const DsTracker* tracker);
+
+#endif // __DS_ALLOCATOR_H__
@@ -0,0 +1,54 @@
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+
+#include <stdatomic.h>
+#include <stddef.h> // size_t
+
+typedef struct __executor Executor;
+
+/*
+A fixed-size pool of worker threads that schedules tasks by work stealing.
+Every worker owns a WorkStealingDeque: tasks spawned by a running task go to the
+bottom of its worker's deque, and idle workers steal from the top of the others'.
+Tasks spawned from outside the pool go through a shared queue.
+
+Fork/join parallelism uses task groups: spawn subtasks into a group, then join the
+group. A worker that joins keeps running other tasks until the group completes, so
+nested joins never block a worker thread.
+*/
+
+typedef void (*task_func_t)(void* arg);
+
+typedef enum {
+    EXECUTOR_SUCCESS,
+    EXECUTOR_MEM_ERROR
+
+} ExecutorStatus;
+
+// a set of spawned tasks that can be waited for. initialize it with
+// executorTaskGroupInit before spawning into it
+typedef struct {
+    atomic_size_t pending;
+} ExecutorTaskGroup;
+
+void executorTaskGroupInit(ExecutorTaskGroup* group);
+
+// create an executor with `num_threads` worker threads
+Executor* executorCreate(size_t num_threads);
+
+// wait for all spawned tasks to finish, then stop the workers and free the executor.
+// must not be called from one of its tasks
+void executorDestroy(Executor* executor);
+
+// get the number of worker threads
+size_t executorThreads(const Executor* executor);
+
+// schedule `func(arg)` to run on one of the workers. if `group` isn't NULL, the task
+// joins it. may be called from any thread, including from tasks
+ExecutorStatus executorSpawn(Executor* executor, ExecutorTaskGroup* group, task_func_t func, void* arg);
+
+// wait until every task of `group` has finished. inside a task, the calling worker
+// runs other tasks meanwhile
+void executorJoin(Executor* executor, ExecutorTaskGroup* group);
+
+#endif // __EXECUTOR_H__
@@ -3,7 +3,10 @@
 
 #include <stddef.h>	// size_t
 
+#include "ds_allocator.h"
+
 typedef struct hash_map HashMap;
+typedef struct __executor Executor;	// see executor.h
 
 typedef size_t (*key_hash_func_t)(const void*, size_t size);
 typedef void* (*key_copy_func_t)(const void*);
@@ -21,6 +24,25 @@ typedef struct
 	value_free_func_t value_free;
 } HashMapEntryHandlers;
 
+typedef size_t (*serialize_func_t)(const void* object, void* buffer, size_t capacity);
+typedef void* (*deserialize_func_t)(const void* buffer, size_t size);
+
+/**
+ * Turns keys and values into bytes and back, for the log of hash_map_log.h.
+ * A serialize function writes object to buffer if its encoding fits in
+ * capacity, and returns the size of the encoding either way. A deserialize
+ * function returns a new object, which is freed by the matching free handler,
+ * or NULL if the bytes are invalid or memory runs out. Keys are always
+ * compared deserialized, with the key functions of the map, never by bytes.
+ **/
+typedef struct
+{
+	serialize_func_t key_serialize;
+	deserialize_func_t key_deserialize;
+	serialize_func_t value_serialize;
+	deserialize_func_t value_deserialize;
+} HashMapSerializers;
+
 typedef enum
 {
 	HASH_MAP_SUCCESS,
@@ -30,12 +52,76 @@ typedef enum
 
 /**
  * Initializes an empty hash table.
+ *
+ * Keys are placed by their full hash: key_hash_func is called with a size of
+ * SIZE_MAX, and its result is mixed with a random seed of the map, so that
+ * which keys share a bucket can't be predicted from outside. Keys whose full
+ * hashes are equal still do: once a chain grows past eight entries, it gets
+ * a balanced tree ordered by hash and key_cmp_func, which keeps operations on
+ * it O(log n). key_cmp_func must therefore order keys consistently (negative,
+ * zero or positive), rather than only tell them apart.
+ *
+ * The map starts without a table: its first eight pairs are kept in an array
+ * inside the map object, and looked up by comparing keys, without hashing.
+ * The table is allocated when a ninth key is inserted, so an empty map costs
+ * a single allocation (the map itself), and a small one only adds its keys
+ * and values.
+ *
  * In case of a memory allocation error, NULL is returned.
  **/
 HashMap* hashMapInit(key_hash_func_t key_hash_func,
 		     key_cmp_func_t key_cmp_func,
 	       	     HashMapEntryHandlers handlers);
 
+/**
+ * Like hashMapInit, but the map takes its own memory (the map object, its
+ * bucket array, buckets and entries) from allocator. The allocator is
+ * copied, but the memory it hands out (an arena, a pool) must outlive the
+ * map. Keys and values are still allocated by the entry handlers.
+ * If allocator is NULL, the default allocator is used.
+ **/
+HashMap* hashMapInitWithAllocator(key_hash_func_t key_hash_func,
+				  key_cmp_func_t key_cmp_func,
+				  HashMapEntryHandlers handlers,
+				  const DsAllocator* allocator);
+
+/**
+ * Initializes an empty hash table that uses bucketized cuckoo hashing instead
+ * of chaining. Every key is kept in one of the four slots of one of its two
+ * buckets, and a bucket fills one cache line, so a lookup probes at most two
+ * cache lines (plus the keys whose 16-bit tag matches, usually just the one
+ * looked for), however long chains would have grown. Insertions may move
+ * other keys to their other bucket to make room, and grow the table when no
+ * room can be found, which happens at load factors around 95%.
+ *
+ * The buckets are picked from the seeded full hash of a key (see
+ * hashMapInit). Keys with equal full hashes share their buckets: beyond eight
+ * of them, the rest is kept in an overflow list, which lookups scan while it
+ * isn't empty.
+ *
+ * In case of a memory allocation error, NULL is returned.
+ **/
+HashMap* hashMapInitCuckoo(key_hash_func_t key_hash_func,
+			   key_cmp_func_t key_cmp_func,
+			   HashMapEntryHandlers handlers);
+
+/**
+ * Like hashMapInitCuckoo, with the map's memory taken from allocator (see
+ * hashMapInitWithAllocator).
+ **/
+HashMap* hashMapInitCuckooWithAllocator(key_hash_func_t key_hash_func,
+					key_cmp_func_t key_cmp_func,
+					HashMapEntryHandlers handlers,
+					const DsAllocator* allocator);
+
+/**
+ * Initializes an empty hash table with the key_hash_func and key_cmp_func of
+ * map, so that it tells keys apart the way map does, and the given handlers.
+ * The new map is chained, and takes its memory from the default allocator.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+HashMap* hashMapInitLike(const HashMap* map, HashMapEntryHandlers handlers);
+
 /**
  * Removes all elements from the given map.
  **/
@@ -59,6 +145,14 @@ void hashMapDestroy(HashMap* map);
  **/
 HashMapStatus hashMapInsert(HashMap* map, const void* key, const void* value);
 
+/**
+ * Like hashMapInsert, but key and value aren't copied: on success, the map
+ * takes ownership of them, and frees them with the key_free and value_free
+ * handlers (key right away, if it was already in the map). On failure,
+ * ownership stays with the caller.
+ **/
+HashMapStatus hashMapInsertOwned(HashMap* map, void* key, void* value);
+
 /**
  * Checks whether the given map contains key.
  * Returns 1 if true, and 0 otherwise.
@@ -71,6 +165,18 @@ int hashMapContains(const HashMap* map, const void* key);
  **/
 void* hashMapGet(HashMap* map, const void* key);
 
+/**
+ * Looks up n keys at once, and stores the value of keys[i] in values[i] (a
+ * reference, or NULL if the key doesn't exist, as hashMapGet returns).
+ *
+ * The lookups are interleaved in small groups: every key of a group is
+ * hashed, then every bucket is fetched, and so on down the chains, so that
+ * the cache misses of the group overlap instead of following one another.
+ * On maps larger than the cache, this does a multiple of the lookups per
+ * second of a loop of hashMapGet calls.
+ **/
+void hashMapGetMany(HashMap* map, const void* const* keys, size_t n, void** values);
+
 /**
  * Removes a key/value pair from the map.
  * This function has no effect if key doesn't exist
@@ -83,6 +189,21 @@ void hashMapRemove(HashMap* map, const void* key);
  **/
 size_t hashMapSize(const HashMap* map);
 
+/**
+ * Makes the map keep a Bloom filter of its keys, so that most lookups of
+ * missing keys (hashMapGet, hashMapContains) are rejected after probing a
+ * single cache line, without walking a bucket or calling key_cmp_func.
+ *
+ * The filter is fed the same full hash that picks the bucket, so keys are
+ * hashed once either way.
+ * Removed keys stay in the filter until the next resize, which rebuilds it.
+ * Calling this function again replaces the filter.
+ *
+ * In case of a memory allocation error, HASH_MAP_MEM_ERROR is returned, and
+ * the map keeps working as before.
+ **/
+HashMapStatus hashMapEnableBloomFilter(HashMap* map, double false_positive_rate);
+
 typedef void (*for_each_func_t) (void* data, void* params);
 
 /**
@@ -90,5 +211,55 @@ typedef void (*for_each_func_t) (void* data, void* params);
  **/
 void hashMapForEach(HashMap* map, for_each_func_t func, void* params);
 
+typedef void (*for_each_entry_func_t) (const void* key, void* value, void* params);
+
+/**
+ * Applies func to every key/value pair in the map. Keys must not be modified.
+ **/
+void hashMapForEachEntry(HashMap* map, for_each_entry_func_t func, void* params);
+
+
+/**
+ * Combines the values of a key found in both maps of a merge, and returns the
+ * value to keep: dst_value, src_value, or a new value. The map frees the
+ * values that aren't kept.
+ **/
+typedef void* (*value_combine_func_t)(void* dst_value, void* src_value);
+
+/**
+ * Moves every pair of src into dst, and leaves src empty. Keys found in both
+ * keep the value returned by combine, or src's value if combine is NULL.
+ * Nothing is copied: the pairs are handed over, and between chained maps
+ * taking their memory from the same allocator, so are their entries. The maps
+ * must therefore share their key functions and entry handlers.
+ *
+ * In case of a memory allocation error, HASH_MAP_MEM_ERROR is returned, and
+ * the pairs that weren't moved yet stay in src.
+ **/
+HashMapStatus hashMapMerge(HashMap* dst, HashMap* src, value_combine_func_t combine);
+
+/**
+ * Returns the partition of key, between 0 and partitions - 1. Partitions are
+ * ranges of a hash that, unlike the placement of keys, is the same for every
+ * map with the same key_hash_func.
+ **/
+size_t hashMapPartition(const HashMap* map, const void* key, size_t partitions);
+
+/**
+ * Merges sharded maps in parallel, for aggregations where every worker fills
+ * maps of its own without synchronization. shards holds workers rows of
+ * partitions maps each: shards[w * partitions + p] is the map of worker w for
+ * the keys in partition p (see hashMapPartition).
+ * Partition p of every worker is merged into shards[p] (see hashMapMerge),
+ * one task per partition on executor, so that each thread owns a range of
+ * keys and no two of them touch the same map. The first row then holds the
+ * result; the other maps are left empty.
+ *
+ * If a merge runs out of memory, HASH_MAP_MEM_ERROR is returned, and the
+ * pairs of that partition that weren't moved stay where they were.
+ **/
+HashMapStatus hashMapMergePartitions(Executor* executor, HashMap** shards, size_t workers,
+				     size_t partitions, value_combine_func_t combine);
+
 
 #endif // __HASH_MAP_H__
@@ -0,0 +1,113 @@
+#ifndef __HASH_MAP_LOG_H__
+#define __HASH_MAP_LOG_H__
+
+#include <stddef.h>	// size_t
+
+#include "hash_map.h"
+
+typedef struct hash_map_log HashMapLog;
+
+/**
+ * A write-ahead log that makes a HashMap durable.
+ * Updates made through the log are applied to the map, and recorded as
+ * binary records appended to a log file in a directory of their own. The
+ * records are collected in memory and written in batches by a background
+ * thread, so an update costs a buffered append rather than a write(2), let
+ * alone an fsync. On open, the directory is replayed into the map.
+ *
+ * Compaction turns the records into a snapshot of the live pairs: the log
+ * moves on to a new file, and a background thread folds the old files into
+ * the snapshot (reading only files, never the map), then deletes them.
+ * Compaction deserializes keys, and keeps the last record of every key as
+ * told apart by the key functions of the map, so keys that the map takes
+ * as equal need not serialize to the same bytes.
+ *
+ * Records carry a checksum. A record cut short by a crash, and whatever
+ * follows it, is dropped on replay.
+ * Files are written in the byte order of the machine.
+ *
+ * The map and the log are used by one thread at a time, like the map alone.
+ * Updating the map other than through the log is fine as long as those
+ * updates need not survive.
+ **/
+
+typedef enum
+{
+	HASH_MAP_LOG_SUCCESS,
+	HASH_MAP_LOG_MEM_ERROR,
+	HASH_MAP_LOG_IO_ERROR
+} HashMapLogStatus;
+
+typedef enum
+{
+	HASH_MAP_LOG_SYNC_NEVER,	// batches are written when full, and
+					// reach the disk when the OS decides
+	HASH_MAP_LOG_SYNC_PERIODIC,	// buffered records are written and synced
+					// every sync_interval_ms
+	HASH_MAP_LOG_SYNC_ALWAYS	// each update is synced before it returns
+} HashMapLogSyncPolicy;
+
+typedef struct
+{
+	HashMapLogSyncPolicy sync_policy;
+	unsigned sync_interval_ms;
+	size_t buffer_size;	// bytes buffered before a batch is written
+	size_t compact_size;	// log file size that starts a compaction, or 0
+} HashMapLogOptions;
+
+/**
+ * Returns the default options: periodic syncs every 100 ms, 64 KiB buffers,
+ * and compaction once the log file grows past 64 MiB.
+ **/
+HashMapLogOptions hashMapLogDefaultOptions(void);
+
+/**
+ * Opens the log in directory (which is created if it doesn't exist), and
+ * replays it into map, which should be empty. The keys and values read back
+ * are handed to the map with hashMapInsertOwned; handlers should be the ones
+ * of map, and are used to free them when they don't go to the map.
+ * If options is NULL, the defaults are used.
+ *
+ * Returns NULL if the directory can't be read or written, a record can't be
+ * deserialized, or memory runs out.
+ **/
+HashMapLog* hashMapLogOpen(HashMap* map, const char* directory,
+			   HashMapEntryHandlers handlers,
+			   HashMapSerializers serializers,
+			   const HashMapLogOptions* options);
+
+/**
+ * Writes out and syncs the buffered records, waits for a running
+ * compaction, and frees the log. The map is left to the caller.
+ * Passing NULL has no effect.
+ **/
+HashMapLogStatus hashMapLogClose(HashMapLog* log);
+
+/**
+ * Inserts the key/value pair into the map (see hashMapInsert), and records
+ * it. If the map can't take the pair, nothing is recorded.
+ * HASH_MAP_LOG_IO_ERROR is returned once writing the log failed: the map is
+ * updated, but the update, and any later one, may be lost on a crash.
+ **/
+HashMapLogStatus hashMapLogInsert(HashMapLog* log, const void* key, const void* value);
+
+/**
+ * Removes key from the map (see hashMapRemove), and records it if it was
+ * there.
+ **/
+HashMapLogStatus hashMapLogRemove(HashMapLog* log, const void* key);
+
+/**
+ * Writes out and syncs the buffered records, so that every update made so
+ * far survives a crash.
+ **/
+HashMapLogStatus hashMapLogSync(HashMapLog* log);
+
+/**
+ * Starts compacting the log in the background, unless a compaction is
+ * already running. The log switches to a new file first, which takes a sync.
+ **/
+HashMapLogStatus hashMapLogCompact(HashMapLog* log);
+
+
+#endif // __HASH_MAP_LOG_H__
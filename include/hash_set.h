@@ -0,0 +1,107 @@
+#ifndef __HASH_SET_H__
+#define __HASH_SET_H__
+
+#include <stddef.h>	// size_t
+
+#include "ds_allocator.h"
+#include "hash_map.h"	// key_hash_func_t, key_cmp_func_t, HashMapStatus
+
+typedef struct hash_set HashSet;
+
+/**
+ * A set of keys, for the cases where a HashMap would hold dummy values.
+ * Nothing but the keys is stored: the set is two flat arrays, a byte of
+ * hash per slot and a key pointer per slot, probed linearly (open
+ * addressing). A lookup scans consecutive tag bytes, usually within one
+ * cache line, and only compares the keys whose tag matches.
+ *
+ * Keys are placed by the same seeded full hash as the keys of a HashMap (see
+ * hashMapInit), so key_hash_func is called with a size of SIZE_MAX.
+ * The bulk operations expect both sets to share their key functions.
+ **/
+
+/**
+ * Initializes an empty set. Keys are copied with key_copy and freed with
+ * key_free.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+HashSet* hashSetInit(key_hash_func_t key_hash_func,
+		     key_cmp_func_t key_cmp_func,
+		     key_copy_func_t key_copy,
+		     key_free_func_t key_free);
+
+/**
+ * Like hashSetInit, but the set takes its own memory (the set object and its
+ * arrays) from allocator (see hashMapInitWithAllocator).
+ * If allocator is NULL, the default allocator is used.
+ **/
+HashSet* hashSetInitWithAllocator(key_hash_func_t key_hash_func,
+				  key_cmp_func_t key_cmp_func,
+				  key_copy_func_t key_copy,
+				  key_free_func_t key_free,
+				  const DsAllocator* allocator);
+
+/**
+ * Removes all keys from the given set.
+ **/
+void hashSetClear(HashSet* set);
+
+/**
+ * Frees the given set object, and all keys contained in it.
+ * Passing NULL has no effect.
+ **/
+void hashSetDestroy(HashSet* set);
+
+
+/**
+ * Adds a copy of key to the set. This function has no effect if key is
+ * already in the set.
+ * In case of a memory allocation error, HASH_MAP_MEM_ERROR is returned, and
+ * the set is left as it was.
+ **/
+HashMapStatus hashSetAdd(HashSet* set, const void* key);
+
+/**
+ * Checks whether the given set contains key.
+ * Returns 1 if true, and 0 otherwise.
+ **/
+int hashSetContains(const HashSet* set, const void* key);
+
+/**
+ * Removes key from the set.
+ * This function has no effect if key doesn't exist.
+ **/
+void hashSetRemove(HashSet* set, const void* key);
+
+/**
+ * Returns the number of keys in the given set.
+ **/
+size_t hashSetSize(const HashSet* set);
+
+typedef void (*set_for_each_func_t) (const void* key, void* params);
+
+/**
+ * Applies func to every key in the set. Keys must not be modified.
+ **/
+void hashSetForEach(const HashSet* set, set_for_each_func_t func, void* params);
+
+
+/**
+ * Adds a copy of every key of src to dst.
+ * In case of a memory allocation error, HASH_MAP_MEM_ERROR is returned, and
+ * dst keeps the keys added so far.
+ **/
+HashMapStatus hashSetUnion(HashSet* dst, const HashSet* src);
+
+/**
+ * Removes from dst every key that isn't in other.
+ **/
+void hashSetIntersection(HashSet* dst, const HashSet* other);
+
+/**
+ * Removes from dst every key that is in other.
+ **/
+void hashSetDifference(HashSet* dst, const HashSet* other);
+
+
+#endif // __HASH_SET_H__
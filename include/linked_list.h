@@ -1,7 +1,10 @@
 #ifndef __LINKED_LIST_H__
 #define __LINKED_LIST_H__
 
-#include <stddef.h> // size_t, ssize_t
+#include <stddef.h> // size_t
+#include <sys/types.h> // ssize_t
+
+#include "ds_allocator.h"
 
 typedef struct __linked_list LinkedList;
 
@@ -10,6 +13,13 @@ A generic linked list.
 Elements are stored by value (copied using the copy function passed at list creation)
 Elements are compared using the compare function passed at list creation.
 Elements are freed using the free function passed at list creation.
+
+Any of the handlers may be NULL (handler-less mode):
+- without a copy function, elements can only be added with the *Owned functions,
+  and clones copy the element pointers (which requires a NULL free function too).
+- without a free function, the list never frees its elements.
+- without a compare function, linkedListIndexOf can't be used, and sorting and
+  merging need an explicit compare function.
 */
 
 typedef void* (*copy_func_t)(const void* element);
@@ -25,21 +35,55 @@ typedef enum {
 // create a new empty linked list
 LinkedList* linkedListCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func);
 
+// create a new empty linked list in indexed mode.
+// an indexed list keeps a skip list with span counts over its nodes, which makes
+// linkedListGetAt, linkedListRemoveAt and linkedListInsertAt O(log n) at the cost
+// of a few extra links per node and O(log n) push/pop.
+// bulk operations (splice, split, sort, merge) rebuild the index in O(n).
+// elements moved in from a list that isn't indexed don't get index links.
+LinkedList* linkedListCreateIndexed(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func);
+
+// create a new empty linked list whose own memory (the list, its nodes and clones)
+// comes from `allocator` (the default allocator if NULL). elements are still
+// allocated by the copy function. the allocator is copied, but the memory it hands
+// out (an arena, a pool) must outlive the list
+LinkedList* linkedListCreateWithAllocator(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func,
+                                          const DsAllocator* allocator);
+LinkedList* linkedListCreateIndexedWithAllocator(copy_func_t copy_func, free_func_t free_func,
+                                                 cmp_func_t compare_func, const DsAllocator* allocator);
+
 // free all memory associated with the list (including elements)
 void linkedListDestroy(LinkedList* list);
 
-// deep clone a list
+// deep clone a list. elements are copied with the list's copy function,
+// and all nodes are allocated as a single block
 LinkedList* linkedListClone(const LinkedList* list);
 
+// clone a list by sharing its nodes (copy-on-write) in O(1).
+// both lists keep reading the same nodes until one of them is modified,
+// at which point that list makes a private deep copy first. this suits
+// read-only snapshots that are released before the source changes again.
+// a shared clone may be handed to (and destroyed by) another thread, as long
+// as each list is only used by one thread at a time.
+// modifications of a list that can't make its private copy fail with
+// LINKED_LIST_MEM_ERROR (or NULL for functions returning elements).
+// returns NULL in case of a memory allocation error
+LinkedList* linkedListCloneShared(LinkedList* list);
+
 // get list size (number of elements in the list)
 size_t linkedListSize(const LinkedList* list);
 
 // get index of a given element. return -1 if `element` is not found
 ssize_t linkedListIndexOf(const LinkedList* list, const void* element);
 
-// returns a pointer to the element located at `index`
+// returns a pointer to the element located at `index`, or NULL if `index` is out of range.
+// walks from the closer end of the list (O(log n) for indexed lists)
 void* linkedListGetAt(const LinkedList* list, size_t index);
 
+// insert a copy of `element` so that it ends up at `index`.
+// if `index` is past the last element, the element is appended
+LinkedListStatus linkedListInsertAt(LinkedList* list, size_t index, const void* element);
+
 // unlinks the element located at `index` from the list, and returns its address
 // it's the user's responsibility is to free the memory address.
 void* linkedListRemoveAt(LinkedList* list, size_t index);
@@ -50,9 +94,42 @@ void* linkedListRemoveAt(LinkedList* list, size_t index);
 // associated with the element's address
 LinkedListStatus linkedListPush(LinkedList* list, const void* element);
 void* linkedListPop(LinkedList* list);
-LinkedListStatus linkedListPushFront(LinkedList* list, void* element);
+LinkedListStatus linkedListPushFront(LinkedList* list, const void* element);
 void* linkedListPopFront(LinkedList* list);
 
+// add an element to the end/front of the list without copying it.
+// on success, the list takes ownership of `element` (it is freed with the
+// list's free function, or handed back by the pop functions). on failure,
+// ownership stays with the caller
+LinkedListStatus linkedListPushOwned(LinkedList* list, void* element);
+LinkedListStatus linkedListPushFrontOwned(LinkedList* list, void* element);
+
+// move all elements of `src` in front of the element located at `pos` in `dst`
+// (or to the end of `dst` if `pos` is past its last element). the nodes are
+// relinked, no element is copied, and `src` is left empty.
+// both lists must have been created with the same handlers and allocator.
+LinkedListStatus linkedListSplice(LinkedList* dst, size_t pos, LinkedList* src);
+
+// move all elements of `src` to the end of `dst` in O(1), leaving `src` empty
+LinkedListStatus linkedListAppendList(LinkedList* dst, LinkedList* src);
+
+// detach the elements located at `index` and after it into a new list.
+// `list` keeps the first `index` elements. if `index` is past the last element,
+// the returned list is empty. returns NULL if the new list can't be allocated
+// (in which case `list` is left untouched)
+LinkedList* linkedListSplitAt(LinkedList* list, size_t index);
+
+// sort the list in place using a stable, bottom-up merge sort.
+// nodes are relinked; no element is copied and nothing is allocated.
+// if `compare` is NULL, the list's compare function is used
+LinkedListStatus linkedListSort(LinkedList* list, cmp_func_t compare);
+
+// merge the sorted list `src` into the sorted list `dst`, leaving `src` empty.
+// like with splicing, both lists must share their allocator.
+// equal elements of `dst` stay in front of those of `src`.
+// if `compare` is NULL, the compare function of `dst` is used
+LinkedListStatus linkedListMergeSorted(LinkedList* dst, LinkedList* src, cmp_func_t compare);
+
 
 // a function that prints a string representation of the given element
 typedef void (*print_func_t)(const void*);
@@ -0,0 +1,123 @@
+#ifndef __ORDERED_MAP_H__
+#define __ORDERED_MAP_H__
+
+#include <stddef.h>	// size_t
+
+#include "hash_map.h"	// key_cmp_func_t, HashMapEntryHandlers
+
+typedef struct ordered_map OrderedMap;
+
+typedef enum
+{
+	ORDERED_MAP_SUCCESS,
+	ORDERED_MAP_MEM_ERROR
+} OrderedMapStatus;
+
+/**
+ * A position in the map, used for ordered (range) scans.
+ * An iterator is invalidated by any insertion or removal.
+ **/
+typedef struct
+{
+	void* leaf;
+	size_t index;
+} OrderedMapIterator;
+
+
+/**
+ * Initializes an empty ordered map (a B+ tree).
+ * Keys are ordered by key_cmp_func, and keys/values are copied and freed
+ * using the given handlers, as in hashMapInit.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+OrderedMap* orderedMapInit(key_cmp_func_t key_cmp_func,
+			   HashMapEntryHandlers handlers);
+
+/**
+ * Like orderedMapInit, but the map takes its own memory (the map object and
+ * its nodes) from allocator (see hashMapInitWithAllocator).
+ * If allocator is NULL, the default allocator is used.
+ **/
+OrderedMap* orderedMapInitWithAllocator(key_cmp_func_t key_cmp_func,
+					HashMapEntryHandlers handlers,
+					const DsAllocator* allocator);
+
+/**
+ * Removes all elements from the given map.
+ **/
+void orderedMapClear(OrderedMap* map);
+
+/**
+ * Frees the given map object, and all elements contained in it.
+ * Passing NULL has no effect.
+ **/
+void orderedMapDestroy(OrderedMap* map);
+
+
+/**
+ * Inserts the key/value pair to the given map.
+ * The values are copied by value using the functions that were passed to
+ * orderedMapInit.
+ *
+ * If key already exists, its value is updated.
+ * In case of a memory allocation error, ORDERED_MAP_MEM_ERROR is returned,
+ * and the map is left unchanged.
+ * On success, ORDERED_MAP_SUCCESS is returned.
+ **/
+OrderedMapStatus orderedMapInsert(OrderedMap* map, const void* key, const void* value);
+
+/**
+ * Checks whether the given map contains key.
+ * Returns 1 if true, and 0 otherwise.
+ **/
+int orderedMapContains(const OrderedMap* map, const void* key);
+
+/**
+ * Returns a reference to the value corresponding to the requested key.
+ * If key doesn't exist, NULL is returned.
+ **/
+void* orderedMapGet(const OrderedMap* map, const void* key);
+
+/**
+ * Removes a key/value pair from the map.
+ * This function has no effect if key doesn't exist
+ **/
+void orderedMapRemove(OrderedMap* map, const void* key);
+
+/**
+ * Returns the size of the given map.
+ **/
+size_t orderedMapSize(const OrderedMap* map);
+
+
+/**
+ * Returns an iterator to the smallest key of the map.
+ **/
+OrderedMapIterator orderedMapBegin(const OrderedMap* map);
+
+/**
+ * Returns an iterator to the first key that is not less than key.
+ * Scanning from it until a key is past the end of the range gives a
+ * range query in O(log n + k).
+ **/
+OrderedMapIterator orderedMapLowerBound(const OrderedMap* map, const void* key);
+
+/**
+ * Returns 1 if the iterator points to an element, and 0 once it moved
+ * past the largest key.
+ **/
+int orderedMapIteratorValid(OrderedMapIterator itr);
+
+/**
+ * Advances the iterator to the next key in order.
+ **/
+void orderedMapIteratorNext(OrderedMapIterator* itr);
+
+/**
+ * Return references to the key and value the (valid) iterator points to.
+ **/
+const void* orderedMapIteratorKey(OrderedMapIterator itr);
+void* orderedMapIteratorValue(OrderedMapIterator itr);
+
+
+#endif // __ORDERED_MAP_H__
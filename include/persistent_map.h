@@ -0,0 +1,89 @@
+#ifndef __PERSISTENT_MAP_H__
+#define __PERSISTENT_MAP_H__
+
+#include <stddef.h>	// size_t
+
+#include "hash_map.h"	// key_hash_func_t, key_cmp_func_t, HashMapEntryHandlers
+
+typedef struct persistent_map PersistentMap;
+
+/**
+ * An immutable hash map (a hash array mapped trie).
+ * A PersistentMap is a version of the map, which never changes: updates
+ * return a new version, which copies the path from the root to the updated
+ * key (a handful of nodes) and shares everything else with the old version.
+ * Taking a snapshot of a version is taking a reference to it, in O(1).
+ *
+ * Versions, and the nodes and pairs they share, are reference counted with
+ * atomic counters, so versions can be read and released from any thread.
+ * A thread can only take a reference to a version it holds one to already:
+ * versions published through a shared pointer must be retained under the
+ * same lock as the pointer is read under.
+ *
+ * Keys are placed by their full hash (key_hash_func called with a size of
+ * SIZE_MAX); keys whose full hashes are equal share a node, which is scanned
+ * with key_cmp_func.
+ **/
+
+/**
+ * Returns an empty version.
+ * Keys/values are copied and freed using the given handlers, as in
+ * hashMapInit, and freed once no version holds them anymore.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+PersistentMap* persistentMapInit(key_hash_func_t key_hash_func,
+				 key_cmp_func_t key_cmp_func,
+				 HashMapEntryHandlers handlers);
+
+/**
+ * Takes another reference to the given version, and returns it.
+ **/
+PersistentMap* persistentMapRetain(PersistentMap* map);
+
+/**
+ * Drops a reference to the given version, which is freed with the last
+ * one (and, with it, the nodes and pairs no other version holds).
+ * Passing NULL has no effect.
+ **/
+void persistentMapRelease(PersistentMap* map);
+
+
+/**
+ * Returns a new version, which maps key to value, and is otherwise equal to
+ * map. map is left as it was; the caller owns a reference to both.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+PersistentMap* persistentMapInsert(PersistentMap* map, const void* key, const void* value);
+
+/**
+ * Returns a new version without key, and otherwise equal to map.
+ * If key doesn't exist, that is another reference to map.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+PersistentMap* persistentMapRemove(PersistentMap* map, const void* key);
+
+/**
+ * Checks whether the given version contains key.
+ * Returns 1 if true, and 0 otherwise.
+ **/
+int persistentMapContains(const PersistentMap* map, const void* key);
+
+/**
+ * Returns a reference to the value corresponding to the requested key, which
+ * is valid as long as the version is. Values must not be modified.
+ * If key doesn't exist, NULL is returned.
+ **/
+void* persistentMapGet(const PersistentMap* map, const void* key);
+
+/**
+ * Returns the size of the given version.
+ **/
+size_t persistentMapSize(const PersistentMap* map);
+
+/**
+ * Applies func to every value in the given version.
+ **/
+void persistentMapForEach(const PersistentMap* map, for_each_func_t func, void* params);
+
+
+#endif // __PERSISTENT_MAP_H__
@@ -0,0 +1,82 @@
+#ifndef __PRIORITY_QUEUE_H__
+#define __PRIORITY_QUEUE_H__
+
+#include <stddef.h> // size_t
+
+#include "ds_allocator.h"
+#include "linked_list.h" // copy_func_t, free_func_t, cmp_func_t
+
+typedef struct __priority_queue PriorityQueue;
+
+/*
+A generic priority queue, implemented as an array-backed d-ary heap.
+The element that compares smallest (according to the compare function passed
+at creation) is at the top of the queue.
+Elements are copied, freed and compared like in LinkedList, and the same
+handler-less rules apply.
+
+Every element gets a handle when it is pushed, which can be used to look it up,
+decrease its key or remove it. A handle stays valid until its element leaves the
+queue, after which it may be reused for a new element.
+*/
+
+typedef size_t PriorityQueueHandle;
+
+typedef enum {
+    PRIORITY_QUEUE_SUCCESS,
+    PRIORITY_QUEUE_MEM_ERROR
+
+} PriorityQueueStatus;
+
+// create a new empty queue. `arity` is the number of children per heap node
+// (2 for a binary heap); wider heaps are shallower, which favors push and
+// decrease-key over pop
+PriorityQueue* priorityQueueCreate(size_t arity, copy_func_t copy_func, free_func_t free_func,
+                                   cmp_func_t compare_func);
+
+// same as above, but the queue, its heap and its handle table are allocated from
+// `allocator` (the default allocator if NULL). elements are still allocated by the
+// copy function. the allocator is copied, but the memory it hands out (an arena, a
+// pool) must outlive the queue
+PriorityQueue* priorityQueueCreateWithAllocator(size_t arity, copy_func_t copy_func, free_func_t free_func,
+                                                cmp_func_t compare_func, const DsAllocator* allocator);
+
+// free all memory associated with the queue (including elements)
+void priorityQueueDestroy(PriorityQueue* queue);
+
+// get queue size (number of elements in the queue)
+size_t priorityQueueSize(const PriorityQueue* queue);
+
+// add a copy of `element` in O(log n). if `handle` isn't NULL, the element's handle
+// is stored in it
+PriorityQueueStatus priorityQueuePush(PriorityQueue* queue, const void* element, PriorityQueueHandle* handle);
+
+// add `element` without copying it. on success, the queue takes ownership of it
+PriorityQueueStatus priorityQueuePushOwned(PriorityQueue* queue, void* element, PriorityQueueHandle* handle);
+
+// add copies of `count` elements in O(n) overall, by restoring the heap order
+// once (bottom-up heapify) instead of once per element.
+// `elements` is an array of element pointers. if `handles` isn't NULL, it receives
+// the handle of each element. on failure, the queue is left unchanged
+PriorityQueueStatus priorityQueueHeapify(PriorityQueue* queue, const void* const* elements, size_t count,
+                                         PriorityQueueHandle* handles);
+
+// returns the top element without removing it, or NULL if the queue is empty
+void* priorityQueuePeek(const PriorityQueue* queue);
+
+// removes the top element in O(log n), and returns its address.
+// it's the user's responsibility to free the memory block
+void* priorityQueuePop(PriorityQueue* queue);
+
+// returns the element of the given handle
+void* priorityQueueGet(const PriorityQueue* queue, PriorityQueueHandle handle);
+
+// restores the heap order after the element of `handle` was made smaller
+// (e.g. by modifying it through priorityQueueGet), in O(log n)
+void priorityQueueDecreaseKey(PriorityQueue* queue, PriorityQueueHandle handle);
+
+// removes the element of `handle`, and returns its address.
+// it's the user's responsibility to free the memory block
+void* priorityQueueRemove(PriorityQueue* queue, PriorityQueueHandle handle);
+
+#endif // __PRIORITY_QUEUE_H__
@@ -0,0 +1,74 @@
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <stddef.h> // size_t
+
+#include "linked_list.h" // free_func_t
+
+typedef struct __ring_buffer RingBuffer;
+
+/*
+A bounded, lock-free single-producer/single-consumer queue.
+One thread may write to the buffer while another thread reads from it, with no
+locking and no allocation per element. Using more than one producer or more than
+one consumer at a time is not supported.
+
+The capacity is rounded up to a power of two. Like Vector, a ring buffer works in
+one of two modes:
+- pointer mode (ringBufferCreate): the buffer stores element pointers, and takes
+  ownership of the elements pushed into it. elements that are still queued when the
+  buffer is destroyed are freed using the free function (which may be NULL).
+- inline mode (ringBufferCreateInline): elements are `element_size` bytes each, and
+  are copied into and out of the buffer's slots.
+
+The read/write functions work in both modes. In pointer mode an element is the
+pointer itself, so they take the address of a `void*` (or an array of `void*`).
+*/
+
+typedef enum {
+    RING_BUFFER_SUCCESS,
+    RING_BUFFER_FULL,
+    RING_BUFFER_EMPTY
+
+} RingBufferStatus;
+
+// create a new empty buffer in pointer mode, holding at least `capacity` elements
+RingBuffer* ringBufferCreate(size_t capacity, free_func_t free_func);
+
+// create a new empty buffer in inline mode, holding at least `capacity` elements
+RingBuffer* ringBufferCreateInline(size_t capacity, size_t element_size);
+
+// free all memory associated with the buffer. must not run concurrently with
+// any other operation
+void ringBufferDestroy(RingBuffer* buffer);
+
+// get the number of slots in the buffer
+size_t ringBufferCapacity(const RingBuffer* buffer);
+
+// get the number of queued elements. while the other thread is active, this is
+// only a snapshot
+size_t ringBufferSize(const RingBuffer* buffer);
+
+// producer only: copy `element` into the buffer.
+// returns RING_BUFFER_FULL if there's no free slot
+RingBufferStatus ringBufferWrite(RingBuffer* buffer, const void* element);
+
+// consumer only: copy the oldest element into `element` and remove it.
+// returns RING_BUFFER_EMPTY if there's nothing to read
+RingBufferStatus ringBufferRead(RingBuffer* buffer, void* element);
+
+// producer only: write up to `count` contiguous elements, publishing them to the
+// consumer at once. returns the number of elements written
+size_t ringBufferWriteBatch(RingBuffer* buffer, const void* elements, size_t count);
+
+// consumer only: read up to `count` elements into `elements`.
+// returns the number of elements read
+size_t ringBufferReadBatch(RingBuffer* buffer, void* elements, size_t count);
+
+// pointer mode only: ringBufferWrite/Read for a single element pointer.
+// on success, the push transfers ownership of `element` to the buffer, and the pop
+// transfers it back to the caller. pop returns NULL if the buffer is empty
+RingBufferStatus ringBufferPush(RingBuffer* buffer, void* element);
+void* ringBufferPop(RingBuffer* buffer);
+
+#endif // __RING_BUFFER_H__
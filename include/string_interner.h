@@ -0,0 +1,77 @@
+#ifndef __STRING_INTERNER_H__
+#define __STRING_INTERNER_H__
+
+#include <stddef.h>	// size_t
+
+typedef struct string_interner StringInterner;
+
+/**
+ * A table of unique, immutable strings.
+ * Interning a string returns its canonical copy: equal strings interned in
+ * the same interner always yield the same pointer, so they can be compared
+ * and hashed by address instead of by content.
+ *
+ * The canonical strings are packed into large memory blocks owned by the
+ * interner, and stay valid (at the same address) until it is destroyed.
+ * Every canonical string also has a small integer id, assigned in
+ * interning order starting from 0.
+ **/
+
+/**
+ * Initializes an empty interner.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+StringInterner* stringInternerCreate(void);
+
+/**
+ * Frees the given interner, and all of its canonical strings.
+ * Passing NULL has no effect.
+ **/
+void stringInternerDestroy(StringInterner* interner);
+
+/**
+ * Returns the canonical copy of string, copying it into the interner if it
+ * wasn't interned before.
+ * In case of a memory allocation error, NULL is returned.
+ **/
+const char* stringInternerIntern(StringInterner* interner, const char* string);
+
+/**
+ * Returns the canonical copy of string, or NULL if it was never interned.
+ **/
+const char* stringInternerFind(const StringInterner* interner, const char* string);
+
+/**
+ * Returns the id of a canonical string (as returned by stringInternerIntern).
+ **/
+size_t stringInternerId(const StringInterner* interner, const char* canonical);
+
+/**
+ * Returns the canonical string with the given id, or NULL if there's none.
+ **/
+const char* stringInternerString(const StringInterner* interner, size_t id);
+
+/**
+ * Returns the number of unique strings in the interner.
+ **/
+size_t stringInternerSize(const StringInterner* interner);
+
+
+/**
+ * Key functions for using canonical strings as HashMap keys.
+ * Keys are hashed by id and compared by address, and aren't copied: the map
+ * refers to the interner's strings, which must outlive it.
+ * All canonical keys of a map must come from the same interner.
+ *
+ * For example:
+ *	HashMapEntryHandlers handlers = {internedKeyCopy, internedKeyFree,
+ *					 value_copy, value_free};
+ *	HashMap* map = hashMapInit(internedKeyHash, internedKeyCompare, handlers);
+ **/
+size_t internedKeyHash(const void* key, size_t size);
+int internedKeyCompare(const void* a, const void* b);
+void* internedKeyCopy(const void* key);
+void internedKeyFree(void* key);
+
+
+#endif // __STRING_INTERNER_H__
@@ -0,0 +1,116 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+/**
+ * Low-overhead event tracing.
+ *
+ * Events are recorded into a per-thread ring buffer (a flight recorder: once
+ * full, the oldest events are overwritten). Recording takes no lock and makes
+ * no system call: it stores a timestamp (TSC ticks on x86) and two arguments,
+ * then publishes the slot with a single store.
+ *
+ * What gets recorded is chosen at compile time with TRACE_LEVEL:
+ *   TRACE_LEVEL_OFF	nothing; the trace points compile to nothing, and
+ *			their arguments aren't evaluated (the default)
+ *   TRACE_LEVEL_EVENTS	rare events (e.g. hash map resizes)
+ *   TRACE_LEVEL_DETAIL	every operation (e.g. hash map inserts and lookups)
+ * The library's level is set with the DS_TRACE_LEVEL CMake option.
+ *
+ * The buffers are written out with traceDump, or automatically at exit when
+ * the DS_TRACE_FILE environment variable names a file, and are decoded
+ * offline by the trace_dump tool.
+ **/
+
+#define TRACE_LEVEL_OFF 0
+#define TRACE_LEVEL_EVENTS 1
+#define TRACE_LEVEL_DETAIL 2
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_OFF
+#endif
+
+typedef enum
+{
+	TRACE_NONE,
+	TRACE_HASH_MAP_INSERT,		// element count, 1 if the key is new
+	TRACE_HASH_MAP_LOOKUP,		// entries compared, 1 if found
+	TRACE_HASH_MAP_RESIZE_BEGIN,	// bucket count, element count
+	TRACE_HASH_MAP_RESIZE_END,	// new bucket count, element count
+	TRACE_USER = 1024		// first type free for applications
+} TraceEventType;
+
+#if TRACE_LEVEL >= TRACE_LEVEL_EVENTS
+#define TRACE_EVENT(type, arg0, arg1) \
+	traceRecord((type), (uint64_t)(arg0), (uint64_t)(arg1))
+#else
+#define TRACE_EVENT(type, arg0, arg1) ((void)0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_LEVEL_DETAIL
+#define TRACE_DETAIL(type, arg0, arg1) \
+	traceRecord((type), (uint64_t)(arg0), (uint64_t)(arg1))
+#else
+#define TRACE_DETAIL(type, arg0, arg1) ((void)0)
+#endif
+
+
+/**
+ * Records an event into the calling thread's buffer, regardless of
+ * TRACE_LEVEL. The first event of a thread allocates its buffer; if that
+ * fails, the thread's events are dropped.
+ **/
+void traceRecord(uint32_t type, uint64_t arg0, uint64_t arg1);
+
+/**
+ * Returns the current timestamp, in the unit of the recorded events.
+ **/
+uint64_t traceTimestamp(void);
+
+/**
+ * Writes every thread's buffer to the file at path. Threads may keep
+ * recording meanwhile; the events they overwrite during the dump are left
+ * out.
+ * Returns 0 on success, and -1 if the file couldn't be written.
+ **/
+int traceDump(const char* path);
+
+/**
+ * Returns the name of a library event type, or NULL for an unknown type.
+ **/
+const char* traceEventName(uint32_t type);
+
+
+/**
+ * The file format written by traceDump (native byte order):
+ * a TraceFileHeader, then for each buffer a TraceBufferHeader followed by
+ * its events, oldest first. A buffer holds the events of one thread at a
+ * time, but may have been handed over from a thread that exited.
+ **/
+#define TRACE_FILE_MAGIC "DSTRACE1"
+
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t buffer_count;
+	double ticks_per_second;
+} TraceFileHeader;
+
+typedef struct
+{
+	uint64_t event_count;
+	uint64_t lost_count;	// overwritten before the dump
+} TraceBufferHeader;
+
+typedef struct
+{
+	uint64_t timestamp;
+	uint32_t type;
+	uint32_t thread_id;	// in order of the threads' first event
+	uint64_t arg0;
+	uint64_t arg1;
+} TraceEvent;
+
+#endif // __TRACE_H__
@@ -0,0 +1,103 @@
+#ifndef __VECTOR_H__
+#define __VECTOR_H__
+
+#include <stddef.h> // size_t, ssize_t
+
+#include "linked_list.h" // copy_func_t, free_func_t, cmp_func_t, print_func_t
+
+typedef struct __vector Vector;
+
+/*
+A generic, growable array.
+The functions mirror the LinkedList API, so that a list can be replaced by a vector.
+
+A vector works in one of two modes:
+- pointer mode (vectorCreate): like LinkedList, elements are copied using the copy
+  function, compared using the compare function and freed using the free function.
+  the vector stores the element pointers contiguously. the same handler-less rules
+  as for LinkedList apply.
+- inline mode (vectorCreateInline): elements are `element_size` bytes each, and are
+  copied into the array itself. the compare function receives pointers to elements,
+  and element pointers returned by the vector point into its storage (they stay valid
+  until the vector is modified).
+*/
+
+typedef enum {
+    VECTOR_SUCCESS,
+    VECTOR_MEM_ERROR
+
+} VectorStatus;
+
+// create a new empty vector in pointer mode
+Vector* vectorCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func);
+
+// create a new empty vector in inline mode
+Vector* vectorCreateInline(size_t element_size, cmp_func_t compare_func);
+
+// same as above, but the vector and its storage are allocated from `allocator` (the
+// default allocator if NULL). the allocator is copied, but the memory it hands out
+// (an arena, a pool) must outlive the vector
+Vector* vectorCreateWithAllocator(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func,
+                                  const DsAllocator* allocator);
+Vector* vectorCreateInlineWithAllocator(size_t element_size, cmp_func_t compare_func,
+                                        const DsAllocator* allocator);
+
+// free all memory associated with the vector (including elements)
+void vectorDestroy(Vector* vector);
+
+// deep clone a vector
+Vector* vectorClone(const Vector* vector);
+
+// get vector size (number of elements in the vector) and capacity
+size_t vectorSize(const Vector* vector);
+size_t vectorCapacity(const Vector* vector);
+
+// make sure the vector can hold `capacity` elements without reallocating
+VectorStatus vectorReserve(Vector* vector, size_t capacity);
+
+// remove (and free) all elements. the capacity is kept
+void vectorClear(Vector* vector);
+
+// get index of a given element. return -1 if `element` is not found
+ssize_t vectorIndexOf(const Vector* vector, const void* element);
+
+// returns a pointer to the element located at `index`, or NULL if `index` is out of range
+void* vectorGetAt(const Vector* vector, size_t index);
+
+// insert a copy of `element` so that it ends up at `index`.
+// if `index` is past the last element, the element is appended.
+// in inline mode, `element` may be an element of the vector itself
+VectorStatus vectorInsertAt(Vector* vector, size_t index, const void* element);
+
+// removes the element located at `index`, and returns its address.
+// in pointer mode, it's the user's responsibility to free the element.
+// in inline mode, the returned address points to a copy owned by the vector,
+// which stays valid until the vector is modified
+void* vectorRemoveAt(Vector* vector, size_t index);
+
+// add/remove an element to/from the end of the vector in amortized O(1).
+// the pop function follows the same ownership rules as vectorRemoveAt, and
+// as with vectorInsertAt, the element pushed may be one of the vector
+VectorStatus vectorPush(Vector* vector, const void* element);
+void* vectorPop(Vector* vector);
+
+// pointer mode only: add an element without copying it. on success, the
+// vector takes ownership of `element`
+VectorStatus vectorPushOwned(Vector* vector, void* element);
+
+// append copies of `count` elements. in pointer mode, `elements` is an array of
+// element pointers; in inline mode, it points to `count` contiguous elements,
+// which are copied with a single memcpy, and must not be elements of the vector
+// itself. on failure, the vector is left unchanged
+VectorStatus vectorAppend(Vector* vector, const void* elements, size_t count);
+
+// binary search in a vector sorted according to its compare function.
+// vectorBinarySearch returns the index of an element equal to `element`, or -1.
+// vectorLowerBound returns the index of the first element that isn't less
+// than `element` (the vector size if there is none)
+ssize_t vectorBinarySearch(const Vector* vector, const void* element);
+size_t vectorLowerBound(const Vector* vector, const void* element);
+
+void vectorPrint(const Vector* vector, print_func_t print_element);
+
+#endif // __VECTOR_H__
@@ -0,0 +1,47 @@
+#ifndef __WORK_STEALING_DEQUE_H__
+#define __WORK_STEALING_DEQUE_H__
+
+#include <stddef.h> // size_t
+
+typedef struct __work_stealing_deque WorkStealingDeque;
+
+/*
+A lock-free Chase-Lev work-stealing deque of element pointers.
+The deque has a single owner thread, which pushes and pops elements at the bottom
+(LIFO) without locking. Any number of other threads may concurrently steal elements
+from the top (FIFO), each steal costing one compare-and-swap.
+The slot array grows as needed.
+
+The deque never copies or frees elements: pushing an element hands it to whichever
+thread pops or steals it. NULL can't be pushed, since it marks a failed pop/steal.
+*/
+
+typedef enum {
+    WORK_STEALING_DEQUE_SUCCESS,
+    WORK_STEALING_DEQUE_MEM_ERROR
+
+} WorkStealingDequeStatus;
+
+// create a new empty deque, with room for at least `capacity` elements before it grows
+WorkStealingDeque* workStealingDequeCreate(size_t capacity);
+
+// free all memory associated with the deque. elements still in it aren't freed.
+// must not run concurrently with any other operation
+void workStealingDequeDestroy(WorkStealingDeque* deque);
+
+// get the number of elements in the deque. while other threads steal, this is only
+// a snapshot
+size_t workStealingDequeSize(const WorkStealingDeque* deque);
+
+// owner only: add an element at the bottom
+WorkStealingDequeStatus workStealingDequePush(WorkStealingDeque* deque, void* element);
+
+// owner only: remove the most recently pushed element, and return it.
+// returns NULL if the deque is empty
+void* workStealingDequePop(WorkStealingDeque* deque);
+
+// any thread: remove the oldest element, and return it.
+// returns NULL if the deque is empty, or if another thread took the element first
+void* workStealingDequeSteal(WorkStealingDeque* deque);
+
+#endif // __WORK_STEALING_DEQUE_H__
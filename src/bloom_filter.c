@@ -0,0 +1,160 @@
+#include <assert.h>
+#include <math.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bloom_filter.h"
+
+#define CACHE_LINE_SIZE 64
+#define BLOCK_WORDS 8
+
+/**
+ * Odd multipliers that derive the eight in-block bit positions from the low
+ * half of the hash (the high half picks the block).
+ **/
+static const uint32_t SALTS[BLOCK_WORDS] = {
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+typedef struct
+{
+	alignas(CACHE_LINE_SIZE) uint64_t words[BLOCK_WORDS];
+} Block;
+
+struct bloom_filter
+{
+	Block* blocks;
+	size_t num_blocks;
+	void* memory;		// blocks, before they were aligned
+	DsAllocator allocator;
+};
+
+/**
+ * The bytes asked of the allocator for num_blocks blocks: allocators only
+ * promise alignment for basic types, so the blocks are aligned by hand.
+ **/
+static size_t blocksMemorySize(size_t num_blocks)
+{
+	return num_blocks * sizeof(Block) + CACHE_LINE_SIZE - 1;
+}
+
+
+/**
+ * Maps the high half of the hash onto [0, num_blocks) with a multiply
+ * instead of a division.
+ **/
+static const Block* blockOf(const BloomFilter* filter, uint64_t hash)
+{
+	uint64_t high = hash >> 32;
+	return &filter->blocks[(high * filter->num_blocks) >> 32];
+}
+
+/**
+ * Computes the bit to set in each word of the block. The loop has no
+ * branches and no dependencies between iterations, so it vectorizes.
+ **/
+static void blockMasks(uint64_t hash, uint64_t masks[BLOCK_WORDS])
+{
+	uint32_t low = (uint32_t)hash;
+	for (size_t i = 0; i < BLOCK_WORDS; ++i)
+	{
+		masks[i] = (uint64_t)1 << ((uint32_t)(low * SALTS[i]) >> 26);
+	}
+}
+
+
+BloomFilter* bloomFilterCreate(size_t expected_elements, double false_positive_rate)
+{
+	return bloomFilterCreateWithAllocator(expected_elements, false_positive_rate, NULL);
+}
+
+BloomFilter* bloomFilterCreateWithAllocator(size_t expected_elements,
+					    double false_positive_rate,
+					    const DsAllocator* allocator)
+{
+	assert (false_positive_rate > 0 && false_positive_rate < 1);
+
+	if (!allocator) allocator = dsDefaultAllocator();
+
+	if (0 == expected_elements) expected_elements = 1;
+
+	// the optimal size of a standard filter with BLOCK_WORDS hash functions.
+	// confining the bits to one block costs a little accuracy, hence the slack
+	double bits_per_element = -(double)BLOCK_WORDS /
+		log(1 - pow(false_positive_rate, 1.0 / BLOCK_WORDS));
+	double bits = 1.1 * bits_per_element * (double)expected_elements;
+	double blocks = ceil(bits / (8 * sizeof(Block)));
+
+	// blockOf maps 32 bits of the hash onto the blocks
+	if (blocks > (double)UINT32_MAX) return NULL;
+
+	BloomFilter* filter = dsAlloc(allocator, sizeof(*filter));
+	if (filter)
+	{
+		filter->allocator = *allocator;
+		filter->num_blocks = (size_t)blocks;
+		filter->memory = dsAlloc(allocator, blocksMemorySize(filter->num_blocks));
+		if (!filter->memory)
+		{
+			dsFree(allocator, filter, sizeof(*filter));
+			return NULL;
+		}
+		filter->blocks = (Block*)(((uintptr_t)filter->memory + CACHE_LINE_SIZE - 1) &
+					  ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+		bloomFilterClear(filter);
+	}
+	return filter;
+}
+
+void bloomFilterDestroy(BloomFilter* filter)
+{
+	if (!filter) return;
+	DsAllocator allocator = filter->allocator;
+	dsFree(&allocator, filter->memory, blocksMemorySize(filter->num_blocks));
+	dsFree(&allocator, filter, sizeof(*filter));
+}
+
+void bloomFilterClear(BloomFilter* filter)
+{
+	memset(filter->blocks, 0, filter->num_blocks * sizeof(Block));
+}
+
+void bloomFilterAdd(BloomFilter* filter, uint64_t hash)
+{
+	uint64_t masks[BLOCK_WORDS];
+	blockMasks(hash, masks);
+
+	Block* block = (Block*)blockOf(filter, hash);
+	for (size_t i = 0; i < BLOCK_WORDS; ++i)
+	{
+		block->words[i] |= masks[i];
+	}
+}
+
+int bloomFilterMayContain(const BloomFilter* filter, uint64_t hash)
+{
+	uint64_t masks[BLOCK_WORDS];
+	blockMasks(hash, masks);
+
+	// accumulate the missing bits instead of returning early, so that the
+	// eight tests run side by side
+	const Block* block = blockOf(filter, hash);
+	uint64_t missing = 0;
+	for (size_t i = 0; i < BLOCK_WORDS; ++i)
+	{
+		missing |= masks[i] & ~block->words[i];
+	}
+	return 0 == missing;
+}
+
+void bloomFilterPrefetch(const BloomFilter* filter, uint64_t hash)
+{
+	__builtin_prefetch(blockOf(filter, hash));
+}
+
+size_t bloomFilterSizeBytes(const BloomFilter* filter)
+{
+	return filter->num_blocks * sizeof(Block);
+}
@@ -0,0 +1,408 @@
+#include <assert.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "concurrent_list.h"
+
+/*
+Epoch-based reclamation.
+
+A global epoch counter is shared by all lists. A reader entering a read section
+announces the epoch it observed in its thread's record; leaving resets the record
+to 0 (quiescent). A writer that unlinks a node stamps it with the epoch, then bumps
+the epoch. Any reader that announced a later epoch observed the bump, and with it
+the unlink, so it can't reach the node. The node is therefore freed once no reader
+announces an epoch up to its stamp.
+
+Reader records live in thread-local storage, and are linked into a registry the
+first time a thread reads. The registry is only walked by writers (which are rare),
+so it's protected by a plain mutex; a thread's record is unlinked when it exits.
+*/
+
+typedef struct __reader {
+    atomic_uint_least64_t epoch; // 0 outside read sections
+    unsigned nesting;
+    int registered;
+    struct __reader* prev;
+    struct __reader* next;
+} Reader;
+
+static atomic_uint_least64_t global_epoch = 1;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static Reader* registry = NULL;
+static pthread_key_t registry_key;
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+
+static _Thread_local Reader local_reader;
+
+static void reader_unregister(void* arg) {
+    Reader* reader = arg;
+
+    pthread_mutex_lock(&registry_lock);
+    if (reader->prev) {
+        reader->prev->next = reader->next;
+    } else {
+        registry = reader->next;
+    }
+    if (reader->next) {
+        reader->next->prev = reader->prev;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void registry_init(void) {
+    pthread_key_create(&registry_key, reader_unregister);
+}
+
+static Reader* reader_get(void) {
+    Reader* reader = &local_reader;
+    if (!reader->registered) {
+        pthread_once(&registry_once, registry_init);
+
+        pthread_mutex_lock(&registry_lock);
+        reader->prev = NULL;
+        reader->next = registry;
+        if (registry) {
+            registry->prev = reader;
+        }
+        registry = reader;
+        pthread_mutex_unlock(&registry_lock);
+
+        // the key's destructor unlinks the record when the thread exits
+        pthread_setspecific(registry_key, reader);
+        reader->registered = 1;
+    }
+
+    return reader;
+}
+
+static void read_begin(void) {
+    Reader* reader = reader_get();
+    if (0 == reader->nesting++) {
+        // acquire: a bumped epoch carries the unlink that preceded it
+        uint_least64_t epoch = atomic_load_explicit(&global_epoch, memory_order_acquire);
+        atomic_store_explicit(&reader->epoch, epoch, memory_order_relaxed);
+
+        // the announcement must be visible before we load any list pointer. pairs
+        // with the fence in oldest_active_epoch
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+}
+
+static void read_end(void) {
+    Reader* reader = &local_reader;
+    assert(reader->nesting > 0);
+
+    if (0 == --reader->nesting) {
+        atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+    }
+}
+
+// the smallest epoch announced by a reader, or UINT_LEAST64_MAX if none is reading
+static uint_least64_t oldest_active_epoch(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+
+    uint_least64_t oldest = UINT_LEAST64_MAX;
+    pthread_mutex_lock(&registry_lock);
+    for (Reader* reader = registry; reader; reader = reader->next) {
+        uint_least64_t epoch = atomic_load_explicit(&reader->epoch, memory_order_acquire);
+        if (epoch && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    return oldest;
+}
+
+
+typedef struct __node {
+    _Atomic(struct __node*) next;
+    void* data;
+
+    // once unlinked (writers only)
+    struct __node* retired_next;
+    uint_least64_t retire_epoch;
+} Node;
+
+struct __concurrent_list {
+    Node head; // sentinel; its `next` is the first node
+    atomic_size_t size;
+
+    // writers only, under `lock`
+    pthread_mutex_t lock;
+    Node* tail;
+    Node* retired_head; // unlinked nodes, oldest first
+    Node* retired_tail;
+
+    copy_func_t copy;
+    free_func_t free;
+    cmp_func_t compare;
+};
+
+static Node* next_of(const Node* node) {
+    return atomic_load_explicit(&((Node*) node)->next, memory_order_acquire);
+}
+
+static void node_destroy(ConcurrentList* list, Node* node) {
+    if (list->free) {
+        list->free(node->data);
+    }
+    free(node);
+}
+
+// frees the retired nodes no reader can reach anymore. returns 1 if none are left
+static int reclaim(ConcurrentList* list) {
+    if (!list->retired_head) {
+        return 1;
+    }
+
+    uint_least64_t oldest = oldest_active_epoch();
+    while (list->retired_head && list->retired_head->retire_epoch < oldest) {
+        Node* node = list->retired_head;
+        list->retired_head = node->retired_next;
+        node_destroy(list, node);
+    }
+
+    if (!list->retired_head) {
+        list->retired_tail = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+// unlinks the node after `prev`. the node itself is left intact, so readers standing
+// on it can move on
+static void unlink_after(ConcurrentList* list, Node* prev) {
+    Node* node = atomic_load_explicit(&prev->next, memory_order_relaxed);
+    Node* next = atomic_load_explicit(&node->next, memory_order_relaxed);
+
+    atomic_store_explicit(&prev->next, next, memory_order_release);
+    if (list->tail == node) {
+        list->tail = prev;
+    }
+    atomic_fetch_sub_explicit(&list->size, 1, memory_order_relaxed);
+
+    // readers that see an epoch above the stamp also see the unlink above
+    node->retire_epoch = atomic_fetch_add(&global_epoch, 1);
+    node->retired_next = NULL;
+    if (list->retired_tail) {
+        list->retired_tail->retired_next = node;
+    } else {
+        list->retired_head = node;
+    }
+    list->retired_tail = node;
+
+    reclaim(list);
+}
+
+// links a copy of `element` after `prev`
+static ConcurrentListStatus insert_after(ConcurrentList* list, Node* prev, const void* element) {
+    Node* node = malloc(sizeof(*node));
+    if (!node) {
+        return CONCURRENT_LIST_MEM_ERROR;
+    }
+
+    node->data = list->copy(element);
+    if (!node->data) {
+        free(node);
+        return CONCURRENT_LIST_MEM_ERROR;
+    }
+
+    // the node is fully initialized before the release store publishes it
+    Node* next = atomic_load_explicit(&prev->next, memory_order_relaxed);
+    atomic_init(&node->next, next);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+
+    if (list->tail == prev) {
+        list->tail = node;
+    }
+    atomic_fetch_add_explicit(&list->size, 1, memory_order_relaxed);
+
+    return CONCURRENT_LIST_SUCCESS;
+}
+
+// writers: the node before `index` (the sentinel for 0), or the tail if `index` is
+// past the end
+static Node* node_before(ConcurrentList* list, size_t index) {
+    Node* prev = &list->head;
+    for (size_t i = 0; i < index; ++i) {
+        Node* next = atomic_load_explicit(&prev->next, memory_order_relaxed);
+        if (!next) {
+            break;
+        }
+        prev = next;
+    }
+
+    return prev;
+}
+
+
+ConcurrentList* concurrentListCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func) {
+    ConcurrentList* new_list = malloc(sizeof(*new_list));
+    if (new_list) {
+        atomic_init(&new_list->head.next, NULL);
+        new_list->head.data = NULL;
+        atomic_init(&new_list->size, 0);
+
+        pthread_mutex_init(&new_list->lock, NULL);
+        new_list->tail = &new_list->head;
+        new_list->retired_head = NULL;
+        new_list->retired_tail = NULL;
+
+        new_list->copy = copy_func;
+        new_list->free = free_func;
+        new_list->compare = compare_func;
+    }
+
+    return new_list;
+}
+
+void concurrentListDestroy(ConcurrentList* list) {
+    if (list) {
+        concurrentListSynchronize(list);
+
+        Node* node = atomic_load_explicit(&list->head.next, memory_order_relaxed);
+        while (node) {
+            Node* next = atomic_load_explicit(&node->next, memory_order_relaxed);
+            node_destroy(list, node);
+            node = next;
+        }
+
+        pthread_mutex_destroy(&list->lock);
+        free(list);
+    }
+}
+
+size_t concurrentListSize(const ConcurrentList* list) {
+    assert(list);
+
+    return atomic_load_explicit(&list->size, memory_order_relaxed);
+}
+
+void concurrentListReadBegin(const ConcurrentList* list) {
+    assert(list);
+
+    read_begin();
+}
+
+void concurrentListReadEnd(const ConcurrentList* list) {
+    assert(list);
+
+    read_end();
+}
+
+ssize_t concurrentListIndexOf(const ConcurrentList* list, const void* element) {
+    assert(list); assert(list->compare);
+
+    ssize_t index = -1;
+
+    read_begin();
+    ssize_t i = 0;
+    for (const Node* node = next_of(&list->head); node; node = next_of(node), ++i) {
+        if (0 == list->compare(node->data, element)) {
+            index = i;
+            break;
+        }
+    }
+    read_end();
+
+    return index;
+}
+
+const void* concurrentListGetAt(const ConcurrentList* list, size_t index) {
+    assert(list); assert(local_reader.nesting > 0);
+
+    const Node* node = next_of(&list->head);
+    for (size_t i = 0; node && i < index; ++i) {
+        node = next_of(node);
+    }
+
+    return node ? node->data : NULL;
+}
+
+void concurrentListForEach(const ConcurrentList* list, visit_func_t visit, void* params) {
+    assert(list); assert(visit);
+
+    read_begin();
+    for (const Node* node = next_of(&list->head); node; node = next_of(node)) {
+        visit(node->data, params);
+    }
+    read_end();
+}
+
+ConcurrentListStatus concurrentListInsertAt(ConcurrentList* list, size_t index, const void* element) {
+    assert(list); assert(list->copy);
+
+    pthread_mutex_lock(&list->lock);
+    ConcurrentListStatus status = insert_after(list, node_before(list, index), element);
+    pthread_mutex_unlock(&list->lock);
+
+    return status;
+}
+
+ConcurrentListStatus concurrentListPush(ConcurrentList* list, const void* element) {
+    assert(list); assert(list->copy);
+
+    pthread_mutex_lock(&list->lock);
+    ConcurrentListStatus status = insert_after(list, list->tail, element);
+    pthread_mutex_unlock(&list->lock);
+
+    return status;
+}
+
+ConcurrentListStatus concurrentListPushFront(ConcurrentList* list, const void* element) {
+    return concurrentListInsertAt(list, 0, element);
+}
+
+ConcurrentListStatus concurrentListRemoveAt(ConcurrentList* list, size_t index) {
+    assert(list);
+
+    ConcurrentListStatus status = CONCURRENT_LIST_NOT_FOUND;
+
+    pthread_mutex_lock(&list->lock);
+    if (index < atomic_load_explicit(&list->size, memory_order_relaxed)) {
+        unlink_after(list, node_before(list, index));
+        status = CONCURRENT_LIST_SUCCESS;
+    }
+    pthread_mutex_unlock(&list->lock);
+
+    return status;
+}
+
+ConcurrentListStatus concurrentListRemove(ConcurrentList* list, const void* element) {
+    assert(list); assert(list->compare);
+
+    ConcurrentListStatus status = CONCURRENT_LIST_NOT_FOUND;
+
+    pthread_mutex_lock(&list->lock);
+    Node* prev = &list->head;
+    Node* node;
+    while ((node = atomic_load_explicit(&prev->next, memory_order_relaxed))) {
+        if (0 == list->compare(node->data, element)) {
+            unlink_after(list, prev);
+            status = CONCURRENT_LIST_SUCCESS;
+            break;
+        }
+        prev = node;
+    }
+    pthread_mutex_unlock(&list->lock);
+
+    return status;
+}
+
+void concurrentListSynchronize(ConcurrentList* list) {
+    assert(list); assert(0 == local_reader.nesting);
+
+    pthread_mutex_lock(&list->lock);
+    while (!reclaim(list)) {
+        sched_yield();
+    }
+    pthread_mutex_unlock(&list->lock);
+}
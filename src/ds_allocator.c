@@ -0,0 +1,448 @@
+#include <assert.h>
+#include <malloc.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds_allocator.h"
+
+#define ALIGNMENT alignof(max_align_t)
+
+static size_t align_up(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+
+static void* default_alloc(void* context, size_t size) {
+    (void) context;
+
+    return malloc(size);
+}
+
+static void* default_realloc(void* context, void* ptr, size_t old_size, size_t new_size) {
+    (void) context; (void) old_size;
+
+    return realloc(ptr, new_size);
+}
+
+static void default_free(void* context, void* ptr, size_t size) {
+    (void) context; (void) size;
+
+    free(ptr);
+}
+
+static const DsAllocator default_allocator = {default_alloc, default_realloc, default_free, NULL};
+
+const DsAllocator* dsDefaultAllocator(void) {
+    return &default_allocator;
+}
+
+
+typedef struct __arena_block {
+    struct __arena_block* next;
+    size_t capacity;
+    size_t used;
+    alignas(max_align_t) char data[];
+} ArenaBlock;
+
+struct __ds_arena {
+    ArenaBlock* head; // the block allocations are carved from
+    size_t block_size;
+    size_t bytes_used;
+    DsAllocator parent;
+};
+
+static void arena_block_free(DsArena* arena, ArenaBlock* block) {
+    dsFree(&arena->parent, block, sizeof(*block) + block->capacity);
+}
+
+static void* arena_alloc(void* context, size_t size) {
+    DsArena* arena = context;
+
+    size_t aligned = align_up(size ? size : 1, ALIGNMENT);
+    if (aligned < size) {
+        return NULL;
+    }
+    size = aligned;
+
+    ArenaBlock* head = arena->head;
+    if (head && head->capacity - head->used >= size) {
+        void* ptr = head->data + head->used;
+        head->used += size;
+        arena->bytes_used += size;
+        return ptr;
+    }
+
+    size_t capacity = size > arena->block_size ? size : arena->block_size;
+    if (capacity > SIZE_MAX - sizeof(ArenaBlock)) {
+        return NULL;
+    }
+
+    ArenaBlock* block = dsAlloc(&arena->parent, sizeof(*block) + capacity);
+    if (!block) {
+        return NULL;
+    }
+
+    block->capacity = capacity;
+    block->used = size;
+    if (head && capacity == size) {
+        // an oversized request gets a block of its own. link it behind the head,
+        // so the head's free space is still used
+        block->next = head->next;
+        head->next = block;
+    } else {
+        block->next = head;
+        arena->head = block;
+    }
+    arena->bytes_used += size;
+
+    return block->data;
+}
+
+// 1 if `ptr` (of `size` bytes, aligned) is the most recent allocation of the head
+static int arena_is_last(const DsArena* arena, const void* ptr, size_t size) {
+    const ArenaBlock* head = arena->head;
+
+    return head && (const char*) ptr + size == head->data + head->used;
+}
+
+static void arena_free(void* context, void* ptr, size_t size) {
+    DsArena* arena = context;
+
+    size = align_up(size ? size : 1, ALIGNMENT);
+    if (ptr && arena_is_last(arena, ptr, size)) {
+        arena->head->used -= size;
+        arena->bytes_used -= size;
+    }
+}
+
+static void* arena_realloc(void* context, void* ptr, size_t old_size, size_t new_size) {
+    DsArena* arena = context;
+    if (!ptr) {
+        return arena_alloc(arena, new_size);
+    }
+
+    size_t old_aligned = align_up(old_size ? old_size : 1, ALIGNMENT);
+    size_t new_aligned = align_up(new_size ? new_size : 1, ALIGNMENT);
+    if (new_aligned < new_size) {
+        return NULL;
+    }
+
+    // the most recent allocation grows (or shrinks) in place when it fits
+    ArenaBlock* head = arena->head;
+    if (arena_is_last(arena, ptr, old_aligned) &&
+        head->capacity - (head->used - old_aligned) >= new_aligned) {
+        head->used = head->used - old_aligned + new_aligned;
+        arena->bytes_used = arena->bytes_used - old_aligned + new_aligned;
+        return ptr;
+    }
+
+    if (new_aligned <= old_aligned) {
+        return ptr;
+    }
+
+    void* new_ptr = arena_alloc(arena, new_size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, old_size);
+    }
+
+    return new_ptr;
+}
+
+DsArena* dsArenaCreate(size_t block_size, const DsAllocator* parent) {
+    assert(block_size > 0);
+
+    if (!parent) {
+        parent = dsDefaultAllocator();
+    }
+
+    DsArena* new_arena = dsAlloc(parent, sizeof(*new_arena));
+    if (new_arena) {
+        new_arena->head = NULL;
+        new_arena->block_size = align_up(block_size, ALIGNMENT);
+        new_arena->bytes_used = 0;
+        new_arena->parent = *parent;
+    }
+
+    return new_arena;
+}
+
+void dsArenaDestroy(DsArena* arena) {
+    if (arena) {
+        ArenaBlock* block = arena->head;
+        while (block) {
+            ArenaBlock* next = block->next;
+            arena_block_free(arena, block);
+            block = next;
+        }
+
+        DsAllocator parent = arena->parent;
+        dsFree(&parent, arena, sizeof(*arena));
+    }
+}
+
+void dsArenaReset(DsArena* arena) {
+    assert(arena);
+
+    // keep one regular block, so that an arena reused per request doesn't go back to
+    // its parent every time
+    ArenaBlock* kept = NULL;
+    ArenaBlock* block = arena->head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        if (!kept && block->capacity == arena->block_size) {
+            kept = block;
+        } else {
+            arena_block_free(arena, block);
+        }
+        block = next;
+    }
+
+    if (kept) {
+        kept->next = NULL;
+        kept->used = 0;
+    }
+    arena->head = kept;
+    arena->bytes_used = 0;
+}
+
+DsAllocator dsArenaAllocator(DsArena* arena) {
+    assert(arena);
+
+    return (DsAllocator) {arena_alloc, arena_realloc, arena_free, arena};
+}
+
+size_t dsArenaBytesUsed(const DsArena* arena) {
+    assert(arena);
+
+    return arena->bytes_used;
+}
+
+
+typedef struct __pool_chunk {
+    struct __pool_chunk* next;
+    alignas(max_align_t) char objects[];
+} PoolChunk;
+
+// objects on the free list hold the link to the next free object
+typedef struct __pool_object {
+    struct __pool_object* next;
+} PoolObject;
+
+struct __ds_pool {
+    PoolObject* free_list;
+    PoolChunk* chunks;
+    size_t object_size; // largest request served by the pool
+    size_t stride;      // distance between objects
+    size_t objects_per_chunk;
+    DsAllocator parent;
+};
+
+static size_t pool_chunk_bytes(const DsPool* pool) {
+    return sizeof(PoolChunk) + pool->stride * pool->objects_per_chunk;
+}
+
+static int pool_add_chunk(DsPool* pool) {
+    PoolChunk* chunk = dsAlloc(&pool->parent, pool_chunk_bytes(pool));
+    if (!chunk) {
+        return 0;
+    }
+
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+
+    // thread the new objects so that they are handed out in address order
+    for (size_t i = pool->objects_per_chunk; i-- > 0;) {
+        PoolObject* object = (PoolObject*) (chunk->objects + i * pool->stride);
+        object->next = pool->free_list;
+        pool->free_list = object;
+    }
+
+    return 1;
+}
+
+static void* pool_alloc(void* context, size_t size) {
+    DsPool* pool = context;
+    if (size > pool->object_size) {
+        return dsAlloc(&pool->parent, size);
+    }
+
+    if (!pool->free_list && !pool_add_chunk(pool)) {
+        return NULL;
+    }
+
+    PoolObject* object = pool->free_list;
+    pool->free_list = object->next;
+
+    return object;
+}
+
+static void pool_free(void* context, void* ptr, size_t size) {
+    DsPool* pool = context;
+    if (size > pool->object_size) {
+        dsFree(&pool->parent, ptr, size);
+    } else if (ptr) {
+        PoolObject* object = ptr;
+        object->next = pool->free_list;
+        pool->free_list = object;
+    }
+}
+
+static void* pool_realloc(void* context, void* ptr, size_t old_size, size_t new_size) {
+    DsPool* pool = context;
+    if (!ptr) {
+        return pool_alloc(pool, new_size);
+    }
+
+    int old_pooled = old_size <= pool->object_size;
+    int new_pooled = new_size <= pool->object_size;
+    if (old_pooled && new_pooled) {
+        return ptr;
+    }
+    if (!old_pooled && !new_pooled) {
+        return dsRealloc(&pool->parent, ptr, old_size, new_size);
+    }
+
+    void* new_ptr = pool_alloc(pool, new_size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        pool_free(pool, ptr, old_size);
+    }
+
+    return new_ptr;
+}
+
+DsPool* dsPoolCreate(size_t object_size, size_t objects_per_chunk, const DsAllocator* parent) {
+    assert(object_size > 0); assert(objects_per_chunk > 0);
+
+    if (!parent) {
+        parent = dsDefaultAllocator();
+    }
+
+    // objects are a multiple of the pointer size apart, which keeps them aligned for
+    // any type of `object_size` bytes (a type's alignment divides its size)
+    size_t stride = align_up(object_size < sizeof(PoolObject) ? sizeof(PoolObject) : object_size,
+                             sizeof(PoolObject));
+    if (stride < object_size || objects_per_chunk > (SIZE_MAX - sizeof(PoolChunk)) / stride) {
+        return NULL;
+    }
+
+    DsPool* new_pool = dsAlloc(parent, sizeof(*new_pool));
+    if (new_pool) {
+        new_pool->free_list = NULL;
+        new_pool->chunks = NULL;
+        new_pool->object_size = object_size;
+        new_pool->stride = stride;
+        new_pool->objects_per_chunk = objects_per_chunk;
+        new_pool->parent = *parent;
+    }
+
+    return new_pool;
+}
+
+void dsPoolDestroy(DsPool* pool) {
+    if (pool) {
+        PoolChunk* chunk = pool->chunks;
+        while (chunk) {
+            PoolChunk* next = chunk->next;
+            dsFree(&pool->parent, chunk, pool_chunk_bytes(pool));
+            chunk = next;
+        }
+
+        DsAllocator parent = pool->parent;
+        dsFree(&parent, pool, sizeof(*pool));
+    }
+}
+
+DsAllocator dsPoolAllocator(DsPool* pool) {
+    assert(pool);
+
+    return (DsAllocator) {pool_alloc, pool_realloc, pool_free, pool};
+}
+
+
+struct __ds_tracker {
+    DsAllocatorStats stats;
+    DsAllocator parent;
+};
+
+static void tracker_grow(DsTracker* tracker, size_t bytes) {
+    tracker->stats.bytes_in_use += bytes;
+    tracker->stats.total_bytes += bytes;
+    if (tracker->stats.bytes_in_use > tracker->stats.peak_bytes) {
+        tracker->stats.peak_bytes = tracker->stats.bytes_in_use;
+    }
+}
+
+static void* tracker_alloc(void* context, size_t size) {
+    DsTracker* tracker = context;
+
+    void* ptr = dsAlloc(&tracker->parent, size);
+    if (ptr) {
+        ++tracker->stats.allocations;
+        tracker_grow(tracker, size);
+    }
+
+    return ptr;
+}
+
+static void* tracker_realloc(void* context, void* ptr, size_t old_size, size_t new_size) {
+    DsTracker* tracker = context;
+    if (!ptr) {
+        return tracker_alloc(tracker, new_size);
+    }
+
+    void* new_ptr = dsRealloc(&tracker->parent, ptr, old_size, new_size);
+    if (new_ptr) {
+        if (new_size > old_size) {
+            tracker_grow(tracker, new_size - old_size);
+        } else {
+            tracker->stats.bytes_in_use -= old_size - new_size;
+        }
+    }
+
+    return new_ptr;
+}
+
+static void tracker_free(void* context, void* ptr, size_t size) {
+    DsTracker* tracker = context;
+    if (ptr) {
+        ++tracker->stats.frees;
+        tracker->stats.bytes_in_use -= size;
+        dsFree(&tracker->parent, ptr, size);
+    }
+}
+
+DsTracker* dsTrackerCreate(const DsAllocator* parent) {
+    if (!parent) {
+        parent = dsDefaultAllocator();
+    }
+
+    DsTracker* new_tracker = dsAlloc(parent, sizeof(*new_tracker));
+    if (new_tracker) {
+        memset(&new_tracker->stats, 0, sizeof(new_tracker->stats));
+        new_tracker->parent = *parent;
+    }
+
+    return new_tracker;
+}
+
+void dsTrackerDestroy(DsTracker* tracker) {
+    if (tracker) {
+        DsAllocator parent = tracker->parent;
+        dsFree(&parent, tracker, sizeof(*tracker));
+    }
+}
+
+DsAllocator dsTrackerAllocator(DsTracker* tracker) {
+    assert(tracker);
+
+    return (DsAllocator) {tracker_alloc, tracker_realloc, tracker_free, tracker};
+}
+
+DsAllocatorStats dsTrackerStats(const DsTracker* tracker) {
+    assert(tracker);
+
+    return tracker->stats;
+}
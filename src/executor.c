@@ -0,0 +1,377 @@
+#include <assert.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "executor.h"
+#include "work_stealing_deque.h"
+
+#define CACHE_LINE_SIZE 64
+
+// rounds of failed task searches (each followed by a yield) before a worker sleeps
+#define IDLE_ROUNDS 64
+
+// finished tasks a worker keeps for reuse, instead of freeing them
+#define TASK_CACHE_SIZE 256
+
+typedef struct __task {
+    task_func_t func;
+    void* arg;
+    ExecutorTaskGroup* group;
+    struct __task* next; // link in the shared queue, or in a worker's task cache
+} Task;
+
+typedef struct {
+    alignas(CACHE_LINE_SIZE) Executor* executor;
+    WorkStealingDeque* deque;
+    pthread_t thread;
+    uint64_t rng; // picks steal victims
+
+    // owner only
+    Task* free_tasks;
+    size_t free_count;
+} Worker;
+
+struct __executor {
+    Worker* workers;
+    size_t num_workers;
+
+    // the shared queue, for tasks spawned outside the pool
+    pthread_mutex_t lock;
+    Task* shared_head;
+    Task* shared_tail;
+    atomic_size_t shared_count;
+
+    // idle workers sleep on `wakeup` (under `lock`) while nothing is queued
+    pthread_cond_t wakeup;
+    atomic_size_t sleepers;
+
+    atomic_size_t queued;     // spawned tasks no worker has taken yet
+    atomic_size_t unfinished; // spawned tasks that haven't finished
+    atomic_int shutdown;
+};
+
+// the worker running on this thread, if any
+static _Thread_local Worker* current_worker = NULL;
+
+static Worker* local_worker(const Executor* executor) {
+    return current_worker && current_worker->executor == executor ? current_worker : NULL;
+}
+
+static Task* task_alloc(Executor* executor) {
+    Worker* worker = local_worker(executor);
+    if (worker && worker->free_tasks) {
+        Task* task = worker->free_tasks;
+        worker->free_tasks = task->next;
+        --worker->free_count;
+        return task;
+    }
+
+    return malloc(sizeof(Task));
+}
+
+static void task_release(Task* task) {
+    Worker* worker = current_worker;
+    if (worker && worker->free_count < TASK_CACHE_SIZE) {
+        task->next = worker->free_tasks;
+        worker->free_tasks = task;
+        ++worker->free_count;
+        return;
+    }
+
+    free(task);
+}
+
+static uint64_t next_random(Worker* worker) {
+    // xorshift64
+    uint64_t x = worker->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    worker->rng = x;
+
+    return x;
+}
+
+static Task* shared_pop(Executor* executor) {
+    if (0 == atomic_load_explicit(&executor->shared_count, memory_order_relaxed)) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&executor->lock);
+    Task* task = executor->shared_head;
+    if (task) {
+        executor->shared_head = task->next;
+        if (!executor->shared_head) executor->shared_tail = NULL;
+        atomic_fetch_sub_explicit(&executor->shared_count, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&executor->lock);
+
+    return task;
+}
+
+// the worker's own tasks first (newest first, for locality), then a steal from the
+// other workers (oldest first, which tend to be the largest), then the shared queue
+static Task* find_task(Worker* worker) {
+    Executor* executor = worker->executor;
+
+    Task* task = workStealingDequePop(worker->deque);
+
+    size_t start = next_random(worker) % executor->num_workers;
+    for (size_t i = 0; !task && i < executor->num_workers; ++i) {
+        Worker* victim = &executor->workers[(start + i) % executor->num_workers];
+        if (victim != worker) {
+            task = workStealingDequeSteal(victim->deque);
+        }
+    }
+
+    if (!task) {
+        task = shared_pop(executor);
+    }
+
+    if (task) {
+        atomic_fetch_sub_explicit(&executor->queued, 1, memory_order_relaxed);
+    }
+
+    return task;
+}
+
+static void run_task(Executor* executor, Task* task) {
+    task->func(task->arg);
+
+    if (task->group) {
+        // pairs with the acquire load in executorJoin: the task's writes are
+        // visible once the group completes
+        atomic_fetch_sub_explicit(&task->group->pending, 1, memory_order_release);
+    }
+
+    task_release(task);
+    atomic_fetch_sub_explicit(&executor->unfinished, 1, memory_order_release);
+}
+
+static void* worker_main(void* arg) {
+    Worker* worker = arg;
+    Executor* executor = worker->executor;
+    current_worker = worker;
+
+    unsigned idle_rounds = 0;
+    for (;;) {
+        Task* task = find_task(worker);
+        if (task) {
+            run_task(executor, task);
+            idle_rounds = 0;
+            continue;
+        }
+
+        if (++idle_rounds < IDLE_ROUNDS && !atomic_load(&executor->shutdown)) {
+            sched_yield();
+            continue;
+        }
+
+        // a spawner increments `queued` before reading `sleepers`, and we increment
+        // `sleepers` before reading `queued` (all sequentially consistent), so at
+        // least one side sees the other: either we don't sleep, or it signals us
+        pthread_mutex_lock(&executor->lock);
+        atomic_fetch_add(&executor->sleepers, 1);
+        while (!atomic_load(&executor->shutdown) && 0 == atomic_load(&executor->queued)) {
+            pthread_cond_wait(&executor->wakeup, &executor->lock);
+        }
+        atomic_fetch_sub(&executor->sleepers, 1);
+        int stop = atomic_load(&executor->shutdown);
+        pthread_mutex_unlock(&executor->lock);
+
+        if (stop) {
+            break;
+        }
+        idle_rounds = 0;
+    }
+
+    current_worker = NULL;
+
+    return NULL;
+}
+
+static void stop_workers(Executor* executor, size_t started) {
+    pthread_mutex_lock(&executor->lock);
+    atomic_store(&executor->shutdown, 1);
+    pthread_cond_broadcast(&executor->wakeup);
+    pthread_mutex_unlock(&executor->lock);
+
+    for (size_t i = 0; i < started; ++i) {
+        pthread_join(executor->workers[i].thread, NULL);
+    }
+}
+
+static void free_workers(Executor* executor) {
+    for (size_t i = 0; i < executor->num_workers; ++i) {
+        Worker* worker = &executor->workers[i];
+        workStealingDequeDestroy(worker->deque);
+
+        while (worker->free_tasks) {
+            Task* next = worker->free_tasks->next;
+            free(worker->free_tasks);
+            worker->free_tasks = next;
+        }
+    }
+
+    free(executor->workers);
+}
+
+
+void executorTaskGroupInit(ExecutorTaskGroup* group) {
+    assert(group);
+
+    atomic_init(&group->pending, 0);
+}
+
+Executor* executorCreate(size_t num_threads) {
+    assert(num_threads > 0);
+
+    Executor* new_executor = malloc(sizeof(*new_executor));
+    if (!new_executor) {
+        return NULL;
+    }
+
+    new_executor->num_workers = num_threads;
+    new_executor->workers = num_threads <= SIZE_MAX / sizeof(Worker) ?
+                            aligned_alloc(CACHE_LINE_SIZE, num_threads * sizeof(Worker)) : NULL;
+    if (!new_executor->workers) {
+        free(new_executor);
+        return NULL;
+    }
+
+    new_executor->shared_head = NULL;
+    new_executor->shared_tail = NULL;
+    atomic_init(&new_executor->shared_count, 0);
+    atomic_init(&new_executor->sleepers, 0);
+    atomic_init(&new_executor->queued, 0);
+    atomic_init(&new_executor->unfinished, 0);
+    atomic_init(&new_executor->shutdown, 0);
+    pthread_mutex_init(&new_executor->lock, NULL);
+    pthread_cond_init(&new_executor->wakeup, NULL);
+
+    int failed = 0;
+    for (size_t i = 0; i < num_threads; ++i) {
+        Worker* worker = &new_executor->workers[i];
+        worker->executor = new_executor;
+        worker->deque = workStealingDequeCreate(0);
+        worker->rng = 0x9e3779b97f4a7c15ULL * (i + 1);
+        worker->free_tasks = NULL;
+        worker->free_count = 0;
+        failed |= !worker->deque;
+    }
+
+    size_t started = 0;
+    while (!failed && started < num_threads) {
+        Worker* worker = &new_executor->workers[started];
+        if (0 != pthread_create(&worker->thread, NULL, worker_main, worker)) {
+            failed = 1;
+        } else {
+            ++started;
+        }
+    }
+
+    if (failed) {
+        stop_workers(new_executor, started);
+        free_workers(new_executor);
+        pthread_mutex_destroy(&new_executor->lock);
+        pthread_cond_destroy(&new_executor->wakeup);
+        free(new_executor);
+        return NULL;
+    }
+
+    return new_executor;
+}
+
+void executorDestroy(Executor* executor) {
+    if (executor) {
+        assert(!local_worker(executor));
+
+        while (atomic_load_explicit(&executor->unfinished, memory_order_acquire) > 0) {
+            sched_yield();
+        }
+
+        stop_workers(executor, executor->num_workers);
+        free_workers(executor);
+        pthread_mutex_destroy(&executor->lock);
+        pthread_cond_destroy(&executor->wakeup);
+        free(executor);
+    }
+}
+
+size_t executorThreads(const Executor* executor) {
+    assert(executor);
+
+    return executor->num_workers;
+}
+
+ExecutorStatus executorSpawn(Executor* executor, ExecutorTaskGroup* group, task_func_t func, void* arg) {
+    assert(executor); assert(func);
+
+    Task* task = task_alloc(executor);
+    if (!task) {
+        return EXECUTOR_MEM_ERROR;
+    }
+
+    task->func = func;
+    task->arg = arg;
+    task->group = group;
+    task->next = NULL;
+
+    if (group) {
+        atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&executor->unfinished, 1, memory_order_relaxed);
+
+    // count the task before publishing it, so `queued` never drops below zero
+    atomic_fetch_add(&executor->queued, 1);
+
+    Worker* worker = local_worker(executor);
+    if (worker) {
+        if (WORK_STEALING_DEQUE_SUCCESS != workStealingDequePush(worker->deque, task)) {
+            atomic_fetch_sub(&executor->queued, 1);
+            atomic_fetch_sub_explicit(&executor->unfinished, 1, memory_order_relaxed);
+            if (group) {
+                atomic_fetch_sub_explicit(&group->pending, 1, memory_order_relaxed);
+            }
+            task_release(task);
+
+            return EXECUTOR_MEM_ERROR;
+        }
+    } else {
+        pthread_mutex_lock(&executor->lock);
+        if (executor->shared_tail) {
+            executor->shared_tail->next = task;
+        } else {
+            executor->shared_head = task;
+        }
+        executor->shared_tail = task;
+        atomic_fetch_add_explicit(&executor->shared_count, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&executor->lock);
+    }
+
+    if (atomic_load(&executor->sleepers) > 0) {
+        pthread_mutex_lock(&executor->lock);
+        pthread_cond_signal(&executor->wakeup);
+        pthread_mutex_unlock(&executor->lock);
+    }
+
+    return EXECUTOR_SUCCESS;
+}
+
+void executorJoin(Executor* executor, ExecutorTaskGroup* group) {
+    assert(executor); assert(group);
+
+    Worker* worker = local_worker(executor);
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        Task* task = worker ? find_task(worker) : NULL;
+        if (task) {
+            run_task(executor, task);
+        } else {
+            sched_yield();
+        }
+    }
+}
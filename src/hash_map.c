@@ -1,11 +1,32 @@
 #include <assert.h>
 #include <malloc.h>
+#include <stdint.h>
+#include <string.h>
 
+#include "bloom_filter.h"
+#include "executor.h"
 #include "hash_map.h"
-#include "logging.h"
+#include "hash_seed.h"
+#include "trace.h"
 
 static const float DEFAULT_LOAD_FACTOR = 0.75;
 
+#define DEFAULT_NUM_BUCKETS 32	// the first table of a chained map
+#define SMALL_MAP_CAPACITY 8	// pairs a chained map holds before its first table
+
+#define TREEIFY_THRESHOLD 8	// a longer chain gets a tree
+#define UNTREEIFY_THRESHOLD 6	// a chain this short drops its tree
+
+#define CUCKOO_SLOTS 4
+#define CUCKOO_DEFAULT_BUCKETS 8	// a power of two
+#define CUCKOO_CACHE_LINE 64
+#define CUCKOO_MAX_SEARCH 512	// buckets visited while making room
+#define CUCKOO_NOT_FOUND SIZE_MAX
+
+// lookups that hashMapGetMany keeps in flight: enough misses to cover the
+// memory latency, and few enough lines to stay in L1 from stage to stage
+#define GET_MANY_GROUP 16
+
 typedef struct bucket_entry
 {
 	void* key;
@@ -14,15 +35,34 @@ typedef struct bucket_entry
 } Entry;
 
 
+/**
+ * A node of a long chain's AVL tree. The chain stays in place (iterating,
+ * clearing and resizing walk it as before), and the tree indexes its entries
+ * by (hash, key_cmp_func). Each node knows its entry's predecessor in the
+ * chain, so that the entry can be unlinked without walking the chain.
+ **/
+typedef struct tree_node
+{
+	Entry* entry;
+	Entry* prev;
+	uint64_t hash;
+	struct tree_node* left;
+	struct tree_node* right;
+	int height;
+} TreeNode;
+
+
 typedef struct bucket
 {
 	Entry* dummy;
+	TreeNode* root;	// NULL unless the chain is longer than TREEIFY_THRESHOLD
+	size_t length;
 } Bucket;
 
 
-Entry* bucketEntryCreate()
+Entry* bucketEntryCreate(const DsAllocator* allocator)
 {
-	Entry* entry = malloc(sizeof(*entry));
+	Entry* entry = dsAlloc(allocator, sizeof(*entry));
 	if (entry)
 	{
 		entry->key = NULL;
@@ -32,15 +72,17 @@ Entry* bucketEntryCreate()
 	return entry;
 }
 
-Bucket* bucketCreate()
+Bucket* bucketCreate(const DsAllocator* allocator)
 {
-	Bucket* bucket = malloc(sizeof(*bucket));
+	Bucket* bucket = dsAlloc(allocator, sizeof(*bucket));
 	if (bucket)
 	{
-		bucket->dummy = bucketEntryCreate();
+		bucket->root = NULL;
+		bucket->length = 0;
+		bucket->dummy = bucketEntryCreate(allocator);
 		if (!bucket->dummy)
 		{
-			free(bucket);
+			dsFree(allocator, bucket, sizeof(*bucket));
 			return NULL;
 		}
 	}
@@ -48,8 +90,23 @@ Bucket* bucketCreate()
 }
 
 
-static void bucketClear(Bucket* bucket, HashMapEntryHandlers handlers)
+static void treeDestroy(TreeNode* node, const DsAllocator* allocator)
+{
+	if (!node) return;
+
+	treeDestroy(node->left, allocator);
+	treeDestroy(node->right, allocator);
+	dsFree(allocator, node, sizeof(*node));
+}
+
+
+static void bucketClear(Bucket* bucket, HashMapEntryHandlers handlers,
+			const DsAllocator* allocator)
 {
+	treeDestroy(bucket->root, allocator);
+	bucket->root = NULL;
+	bucket->length = 0;
+
 	Entry* itr = bucket->dummy->next;
 	while (itr)
 	{
@@ -57,43 +114,106 @@ static void bucketClear(Bucket* bucket, HashMapEntryHandlers handlers)
 		handlers.value_free(itr->value);
 		Entry* temp = itr;
 		itr = itr->next;
-		free(temp);
+		dsFree(allocator, temp, sizeof(*temp));
 	}
+	bucket->dummy->next = NULL;
 }
 
-void bucketDestroy(Bucket* bucket, HashMapEntryHandlers handlers)
+void bucketDestroy(Bucket* bucket, HashMapEntryHandlers handlers,
+		   const DsAllocator* allocator)
 {
 	if (!bucket) return;
 	
-	bucketClear(bucket, handlers);
-	free(bucket->dummy);
-	free(bucket);
+	bucketClear(bucket, handlers, allocator);
+	dsFree(allocator, bucket->dummy, sizeof(*bucket->dummy));
+	dsFree(allocator, bucket, sizeof(*bucket));
 }
 
 
+/**
+ * A cuckoo bucket fills one cache line. The tags (16 bits of the key's hash)
+ * rule out most non-matching slots without touching their keys, and the
+ * values are kept apart, so that they're only read on a hit.
+ **/
+typedef struct
+{
+	uint16_t tags[CUCKOO_SLOTS];	// 0 marks an empty slot
+	void* keys[CUCKOO_SLOTS];
+	char padding[CUCKOO_CACHE_LINE - CUCKOO_SLOTS * (sizeof(uint16_t) + sizeof(void*))];
+} CuckooBucket;
+
+typedef struct
+{
+	CuckooBucket* buckets;	// aligned to a cache line
+	void** values;		// slot i of bucket b is values[b * CUCKOO_SLOTS + i]
+	void* memory;		// the allocation buckets lives in
+	size_t num_buckets;	// a power of two
+} CuckooTable;
+
+/**
+ * Keys that couldn't be given a slot (only keys whose full hashes collide,
+ * in practice).
+ **/
+typedef struct
+{
+	void* key;
+	void* value;
+} CuckooOverflowEntry;
+
+typedef struct
+{
+	CuckooOverflowEntry* entries;
+	size_t count;
+	size_t capacity;
+} CuckooOverflow;
+
+
+/**
+ * A pair of a small map: a chained map starts without a table, and keeps
+ * its first pairs in an array inside the map, which is searched linearly.
+ **/
+typedef struct
+{
+	void* key;
+	void* value;
+} SmallEntry;
+
 struct hash_map
 {
-	Bucket** buckets;
+	Bucket** buckets;	// NULL in cuckoo mode, and in small mode
 	size_t num_buckets;
        	size_t num_elements;	
 	float load_factor;
 	HashMapEntryHandlers handlers;
 	key_hash_func_t key_hash_func;
 	key_cmp_func_t key_cmp_func;
+	BloomFilter* bloom_filter;	// NULL unless enabled
+	double bloom_false_positive_rate;
+	DsAllocator allocator;	// the map, its buckets and entries
+	uint64_t seed;
+	int cuckoo;
+	CuckooTable cuckoo_table;	// cuckoo mode only
+	CuckooOverflow cuckoo_overflow;
+	SmallEntry small[SMALL_MAP_CAPACITY];	// small mode only
 };
 
 
-static Bucket** createBucketArray(size_t size, HashMapStatus* status)
+static Bucket** createBucketArray(size_t size, HashMapStatus* status,
+				  const DsAllocator* allocator)
 {
 	assert (status);
 	size_t total_size = size * sizeof(Bucket*);
-	Bucket** buckets = calloc(1, total_size);
-	if (buckets)
+	Bucket** buckets = dsAlloc(allocator, total_size);
+	if (!buckets)
 	{
-
+		*status = HASH_MAP_MEM_ERROR;
+	}
+	else
+	{
+		memset(buckets, 0, total_size);
 		for (size_t i = 0; i < size; ++i)
 		{
-			buckets[i] = bucketCreate();
+			buckets[i] = bucketCreate(allocator);
 			if (!buckets[i])
 			{
 				*status = HASH_MAP_MEM_ERROR;	
@@ -106,40 +226,165 @@ static Bucket** createBucketArray(size_t size, HashMapStatus* status)
 
 static void destroyBucketArray(Bucket** buckets,
 			       size_t size,
-			       HashMapEntryHandlers handlers)
+			       HashMapEntryHandlers handlers,
+			       const DsAllocator* allocator)
 {
 	if (buckets)
 	{	
 		for (size_t i = 0; i < size; ++i)
 		{
-			bucketDestroy(buckets[i], handlers);
+			bucketDestroy(buckets[i], handlers, allocator);
+		}
+		dsFree(allocator, buckets, size * sizeof(Bucket*));
+	}
+}
+
+
+static size_t cuckooMemorySize(size_t num_buckets)
+{
+	return num_buckets * sizeof(CuckooBucket) + CUCKOO_CACHE_LINE - 1;
+}
+
+/**
+ * Allocates an empty table of num_buckets buckets.
+ * Returns HASH_MAP_MEM_ERROR (and leaves table untouched) on failure.
+ **/
+static HashMapStatus cuckooTableCreate(CuckooTable* table, size_t num_buckets,
+				       const DsAllocator* allocator)
+{
+	// allocators only promise max_align_t, so the buckets are aligned by hand
+	void* memory = dsAlloc(allocator, cuckooMemorySize(num_buckets));
+	void** values = dsAlloc(allocator, num_buckets * CUCKOO_SLOTS * sizeof(void*));
+	if (!memory || !values)
+	{
+		dsFree(allocator, memory, cuckooMemorySize(num_buckets));
+		dsFree(allocator, values, num_buckets * CUCKOO_SLOTS * sizeof(void*));
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	uintptr_t aligned = ((uintptr_t)memory + CUCKOO_CACHE_LINE - 1) &
+		~(uintptr_t)(CUCKOO_CACHE_LINE - 1);
+	table->buckets = (CuckooBucket*)aligned;
+	table->values = values;
+	table->memory = memory;
+	table->num_buckets = num_buckets;
+	memset(table->buckets, 0, num_buckets * sizeof(CuckooBucket));
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Frees the table's memory, but not its keys and values.
+ **/
+static void cuckooTableDestroy(CuckooTable* table, const DsAllocator* allocator)
+{
+	if (!table->memory) return;
+
+	dsFree(allocator, table->memory, cuckooMemorySize(table->num_buckets));
+	dsFree(allocator, table->values, table->num_buckets * CUCKOO_SLOTS * sizeof(void*));
+	table->memory = NULL;
+}
+
+static void cuckooOverflowDestroy(CuckooOverflow* overflow, const DsAllocator* allocator)
+{
+	dsFree(allocator, overflow->entries, overflow->capacity * sizeof(CuckooOverflowEntry));
+	overflow->entries = NULL;
+	overflow->count = 0;
+	overflow->capacity = 0;
+}
+
+/**
+ * Frees the keys and values of a cuckoo map, and empties it.
+ **/
+static void cuckooClear(HashMap* map)
+{
+	CuckooTable* table = &map->cuckoo_table;
+	if (!table->memory) return;
+
+	for (size_t i = 0; i < table->num_buckets; ++i)
+	{
+		CuckooBucket* bucket = &table->buckets[i];
+		for (size_t slot = 0; slot < CUCKOO_SLOTS; ++slot)
+		{
+			if (!bucket->tags[slot]) continue;
+
+			map->handlers.key_free(bucket->keys[slot]);
+			map->handlers.value_free(table->values[i * CUCKOO_SLOTS + slot]);
+			bucket->tags[slot] = 0;
 		}
-		free(buckets);
 	}
+
+	CuckooOverflow* overflow = &map->cuckoo_overflow;
+	for (size_t i = 0; i < overflow->count; ++i)
+	{
+		map->handlers.key_free(overflow->entries[i].key);
+		map->handlers.value_free(overflow->entries[i].value);
+	}
+	overflow->count = 0;
+}
+
+
+static int isSmall(const HashMap* map)
+{
+	return !map->cuckoo && !map->buckets;
+}
+
+/**
+ * Frees the keys and values of a small map, and empties it.
+ **/
+static void smallClear(HashMap* map)
+{
+	if (!isSmall(map)) return;
+
+	for (size_t i = 0; i < map->num_elements; ++i)
+	{
+		map->handlers.key_free(map->small[i].key);
+		map->handlers.value_free(map->small[i].value);
+	}
+	map->num_elements = 0;
 }
 
 
 HashMap* hashMapInit(key_hash_func_t key_hash_func,
 		     key_cmp_func_t key_cmp_func,
 	       	     HashMapEntryHandlers handlers)
+{
+	return hashMapInitWithAllocator(key_hash_func, key_cmp_func, handlers, NULL);
+}
+
+static HashMap* initMap(key_hash_func_t key_hash_func,
+			key_cmp_func_t key_cmp_func,
+			HashMapEntryHandlers handlers,
+			const DsAllocator* allocator,
+			int cuckoo)
 {
 	assert (key_hash_func);
 	assert (key_cmp_func);
 
-	HashMap* map = malloc(sizeof(*map));
+	if (!allocator) allocator = dsDefaultAllocator();
+
+	HashMap* map = dsAlloc(allocator, sizeof(*map));
 	if (map)
 	{
-		const size_t default_num_buckets = 32; 
-		map->num_buckets = default_num_buckets;
+		memset(map, 0, sizeof(*map));
+		map->allocator = *allocator;
+		// a chained map allocates its table once it outgrows small mode
+		map->num_buckets = cuckoo ? CUCKOO_DEFAULT_BUCKETS : 0;
 		map->num_elements = 0;
 		map->load_factor = 0;
 		map->key_hash_func = key_hash_func;
 		map->key_cmp_func = key_cmp_func;
 		map->handlers = handlers;
-		
-		HashMapStatus status = HASH_MAP_SUCCESS;	
-		Bucket** buckets = createBucketArray(map->num_buckets, &status);
-		map->buckets = buckets;
+		map->bloom_filter = NULL;
+		map->bloom_false_positive_rate = 0;
+		map->seed = hashSeedCreate();
+		map->cuckoo = cuckoo;
+
+		HashMapStatus status = HASH_MAP_SUCCESS;
+		if (cuckoo)
+		{
+			status = cuckooTableCreate(&map->cuckoo_table, map->num_buckets,
+						   &map->allocator);
+		}
 		if (HASH_MAP_SUCCESS != status)
 		{
 			hashMapDestroy(map);
@@ -150,13 +395,55 @@ HashMap* hashMapInit(key_hash_func_t key_hash_func,
 	return map;
 }
 
+HashMap* hashMapInitWithAllocator(key_hash_func_t key_hash_func,
+				  key_cmp_func_t key_cmp_func,
+				  HashMapEntryHandlers handlers,
+				  const DsAllocator* allocator)
+{
+	return initMap(key_hash_func, key_cmp_func, handlers, allocator, 0);
+}
+
+HashMap* hashMapInitCuckoo(key_hash_func_t key_hash_func,
+			   key_cmp_func_t key_cmp_func,
+			   HashMapEntryHandlers handlers)
+{
+	return initMap(key_hash_func, key_cmp_func, handlers, NULL, 1);
+}
+
+HashMap* hashMapInitCuckooWithAllocator(key_hash_func_t key_hash_func,
+					key_cmp_func_t key_cmp_func,
+					HashMapEntryHandlers handlers,
+					const DsAllocator* allocator)
+{
+	return initMap(key_hash_func, key_cmp_func, handlers, allocator, 1);
+}
+
+HashMap* hashMapInitLike(const HashMap* map, HashMapEntryHandlers handlers)
+{
+	return initMap(map->key_hash_func, map->key_cmp_func, handlers, NULL, 0);
+}
+
 void hashMapClear(HashMap* map)
 {
-	size_t size = map->num_buckets;
-	
-	for (size_t i = 0; i < size; ++i)
+	if (map->cuckoo)
 	{
-		bucketClear(map->buckets[i], map->handlers);
+		cuckooClear(map);
+	}
+	else
+	{
+		// a map that had a table keeps it
+		smallClear(map);
+		for (size_t i = 0; i < map->num_buckets; ++i)
+		{
+			bucketClear(map->buckets[i], map->handlers, &map->allocator);
+		}
+	}
+	map->num_elements = 0;
+	map->load_factor = 0;
+
+	if (map->bloom_filter)
+	{
+		bloomFilterClear(map->bloom_filter);
 	}
 }
 
@@ -164,22 +451,35 @@ void hashMapClear(HashMap* map)
 void hashMapDestroy(HashMap* map)
 {
 	if (!map) return;
-	destroyBucketArray(map->buckets, map->num_buckets, map->handlers);
-	free(map);
+	destroyBucketArray(map->buckets, map->num_buckets, map->handlers,
+			   &map->allocator);
+	smallClear(map);
+	cuckooClear(map);
+	cuckooTableDestroy(&map->cuckoo_table, &map->allocator);
+	cuckooOverflowDestroy(&map->cuckoo_overflow, &map->allocator);
+	bloomFilterDestroy(map->bloom_filter);
+
+	DsAllocator allocator = map->allocator;
+	dsFree(&allocator, map, sizeof(*map));
 }
 
 
 static Entry* findBucketEntry(Bucket* bucket, const void* key, key_cmp_func_t key_cmp_func)
 {
+	size_t compared = 0;	// only read when tracing
 	Entry* itr = bucket->dummy->next;
 	while (itr)
 	{
+		++compared;
 		if (0 == key_cmp_func(key, itr->key))
 		{
+			TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, compared, 1);
 			return itr;
 		}
 		itr = itr->next;
 	}
+	TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, compared, 0);
+	(void)compared;
 	return NULL;
 }
 
@@ -194,159 +494,1483 @@ static void addLast(Bucket* bucket, Entry* new_entry)
 
 static void updateLoadFactor(HashMap* map)
 {
-	map->load_factor = map->num_elements / (float)map->num_buckets;
+	map->load_factor = map->num_buckets ? map->num_elements / (float)map->num_buckets : 0;
 }
 
 
-static HashMapStatus resizeHashMap(HashMap* map)
+/**
+ * Returns the full hash of key under the map's seed (see hashSeedFullHash),
+ * which picks its bucket and feeds the Bloom filter. With the seed, which
+ * keys share a bucket can't be worked out from outside, unless their full
+ * hashes are equal.
+ **/
+static uint64_t fullHash(const HashMap* map, const void* key)
 {
-	debug("resizing map");
-	size_t new_size = 2 * map->num_buckets;
-	HashMapStatus status = HASH_MAP_SUCCESS;
-	Bucket** new_buckets = createBucketArray(new_size, &status);
-	if (HASH_MAP_SUCCESS != status)
-	{
-		destroyBucketArray(new_buckets, new_size, map->handlers);
-		return HASH_MAP_MEM_ERROR;
-	}
+	return hashSeedFullHash(map->key_hash_func, key, map->seed);
+}
 
-	Bucket** old_buckets = map->buckets;
-	size_t old_num_buckets = map->num_buckets;
-	
-	// reset statistics in the original hash table
-	map->num_buckets = new_size;
-	map->buckets = new_buckets;
-	map->load_factor = 0;
-	map->num_elements = 0;
+static size_t bucketIndex(const HashMap* map, uint64_t hash)
+{
+	return (size_t)hash & (map->num_buckets - 1);
+}
 
-	// rearrange old entries into the new table.
-	// this avoids unnecessary copy operations.
-	for (size_t i = 0; i < old_num_buckets; ++i)
+
+/* treeified buckets */
+
+static int treeHeight(const TreeNode* node)
+{
+	return node ? node->height : 0;
+}
+
+static void treeUpdateHeight(TreeNode* node)
+{
+	int left = treeHeight(node->left);
+	int right = treeHeight(node->right);
+	node->height = 1 + (left > right ? left : right);
+}
+
+static TreeNode* treeRotateRight(TreeNode* node)
+{
+	TreeNode* left = node->left;
+	node->left = left->right;
+	left->right = node;
+	treeUpdateHeight(node);
+	treeUpdateHeight(left);
+	return left;
+}
+
+static TreeNode* treeRotateLeft(TreeNode* node)
+{
+	TreeNode* right = node->right;
+	node->right = right->left;
+	right->left = node;
+	treeUpdateHeight(node);
+	treeUpdateHeight(right);
+	return right;
+}
+
+/**
+ * Restores the AVL balance of node, whose subtrees differ in height by at
+ * most two. Returns the root of the subtree.
+ **/
+static TreeNode* treeBalance(TreeNode* node)
+{
+	treeUpdateHeight(node);
+	int balance = treeHeight(node->left) - treeHeight(node->right);
+	if (balance > 1)
 	{
-		Entry* itr = old_buckets[i]->dummy->next;
-		while (itr)
+		if (treeHeight(node->left->left) < treeHeight(node->left->right))
 		{
-			Entry* next = itr->next;
-			itr->next = NULL;
-			size_t hash = map->key_hash_func(itr->key, map->num_buckets);
-			addLast(map->buckets[hash], itr);
-			itr = next;
-			++map->num_elements;
-			updateLoadFactor(map);
+			node->left = treeRotateLeft(node->left);
 		}
-		old_buckets[i]->dummy->next = NULL;
+		return treeRotateRight(node);
+	}
+	if (balance < -1)
+	{
+		if (treeHeight(node->right->right) < treeHeight(node->right->left))
+		{
+			node->right = treeRotateRight(node->right);
+		}
+		return treeRotateLeft(node);
 	}
+	return node;
+}
 
-	destroyBucketArray(old_buckets, old_num_buckets, map->handlers);
-	return HASH_MAP_SUCCESS;
+/**
+ * Orders keys by hash, then by key_cmp_func, which only breaks ties between
+ * keys with equal full hashes.
+ **/
+static int treeCompare(uint64_t hash, const void* key, const TreeNode* node,
+		       key_cmp_func_t key_cmp_func)
+{
+	if (hash != node->hash) return hash < node->hash ? -1 : 1;
+	return key_cmp_func(key, node->entry->key);
 }
 
+static TreeNode* treeInsert(TreeNode* root, TreeNode* node, key_cmp_func_t key_cmp_func)
+{
+	if (!root) return node;
 
-HashMapStatus hashMapInsert(HashMap* map, const void* key, const void* value)
+	if (treeCompare(node->hash, node->entry->key, root, key_cmp_func) < 0)
+	{
+		root->left = treeInsert(root->left, node, key_cmp_func);
+	}
+	else
+	{
+		root->right = treeInsert(root->right, node, key_cmp_func);
+	}
+	return treeBalance(root);
+}
+
+static TreeNode* treeFind(TreeNode* node, uint64_t hash, const void* key,
+			  key_cmp_func_t key_cmp_func, size_t* compared)
 {
-	size_t hash = map->key_hash_func(key, map->num_buckets);
-	
-	void* new_value = map->handlers.value_copy(value);
-	if (!new_value) return HASH_MAP_MEM_ERROR;
-	
-	Entry* bucket_entry = findBucketEntry(map->buckets[hash], key, map->key_cmp_func);
-	if (bucket_entry)
+	while (node)
 	{
-		debug("Updating existing entry");	
-		map->handlers.value_free(bucket_entry->value);
-		bucket_entry->value = new_value;
+		++*compared;
+		int order = treeCompare(hash, key, node, key_cmp_func);
+		if (0 == order) return node;
+		node = order < 0 ? node->left : node->right;
+	}
+	return NULL;
+}
+
+static TreeNode* treeRemoveMin(TreeNode* node, TreeNode** min)
+{
+	if (!node->left)
+	{
+		*min = node;
+		return node->right;
+	}
+	node->left = treeRemoveMin(node->left, min);
+	return treeBalance(node);
+}
+
+/**
+ * Unlinks the node of key from the tree, and stores it in removed.
+ * Returns the new root.
+ **/
+static TreeNode* treeRemove(TreeNode* node, uint64_t hash, const void* key,
+			    key_cmp_func_t key_cmp_func, TreeNode** removed)
+{
+	if (!node) return NULL;
+
+	int order = treeCompare(hash, key, node, key_cmp_func);
+	if (order < 0)
+	{
+		node->left = treeRemove(node->left, hash, key, key_cmp_func, removed);
+	}
+	else if (order > 0)
+	{
+		node->right = treeRemove(node->right, hash, key, key_cmp_func, removed);
 	}
 	else
 	{
-		debug("Adding new entry");
-		Entry* new_entry = bucketEntryCreate(); 
-		if (!new_entry)
-		{
-			map->handlers.value_free(new_value);
-			return HASH_MAP_MEM_ERROR;
-		}
-		
-		new_entry->key = map->handlers.key_copy(key);
-		if (!new_entry->key)
-		{
-			free(new_entry);
-			map->handlers.value_free(new_value);
-			return HASH_MAP_MEM_ERROR;
-		}
+		*removed = node;
+		if (!node->right) return node->left;
 
-		new_entry->value = new_value;
-		addLast(map->buckets[hash], new_entry);
-		++map->num_elements;
-		updateLoadFactor(map);
+		TreeNode* min;
+		TreeNode* right = treeRemoveMin(node->right, &min);
+		min->left = node->left;
+		min->right = right;
+		node = min;
+	}
+	return treeBalance(node);
+}
 
-		if (map->load_factor > DEFAULT_LOAD_FACTOR)
-		{
-			return resizeHashMap(map);
-		}
+static TreeNode* treeNodeCreate(HashMap* map, Entry* entry, Entry* prev, uint64_t hash)
+{
+	TreeNode* node = dsAlloc(&map->allocator, sizeof(*node));
+	if (node)
+	{
+		node->entry = entry;
+		node->prev = prev;
+		node->hash = hash;
+		node->left = NULL;
+		node->right = NULL;
+		node->height = 1;
 	}
-	
-	debug("%s", "Entry added");
-	return HASH_MAP_SUCCESS;
+	return node;
 }
 
-void* hashMapGet(HashMap* map, const void* key)
+/**
+ * Returns the tree node of an entry of a treeified bucket.
+ **/
+static TreeNode* treeNodeOf(const HashMap* map, const Bucket* bucket, const Entry* entry)
 {
-	size_t hash = map->key_hash_func(key, map->num_buckets);
-	Bucket* bucket = map->buckets[hash];
-	if (!bucket) return NULL;
+	size_t compared = 0;
+	return treeFind(bucket->root, fullHash(map, entry->key), entry->key,
+			map->key_cmp_func, &compared);
+}
 
-	Entry* itr = bucket->dummy->next;
-	while (itr)
+/**
+ * Builds the tree of a long chain. If that fails, the bucket stays a chain,
+ * and is treeified again on its next insertion.
+ **/
+static void treeify(HashMap* map, Bucket* bucket)
+{
+	Entry* prev = bucket->dummy;
+	for (Entry* itr = prev->next; itr; prev = itr, itr = itr->next)
 	{
-		if (0 == map->key_cmp_func(key, itr->key))
+		TreeNode* node = treeNodeCreate(map, itr, prev, fullHash(map, itr->key));
+		if (!node)
 		{
-			return itr->value;
+			treeDestroy(bucket->root, &map->allocator);
+			bucket->root = NULL;
+			return;
 		}
-		itr = itr->next;
+		bucket->root = treeInsert(bucket->root, node, map->key_cmp_func);
 	}
+}
 
-	return NULL;
+/**
+ * Looks key up in its bucket: a chain walk, or a tree search.
+ **/
+static Entry* findEntry(const HashMap* map, Bucket* bucket, const void* key, uint64_t hash)
+{
+	if (!bucket->root) return findBucketEntry(bucket, key, map->key_cmp_func);
+
+	size_t compared = 0;	// only read when tracing
+	TreeNode* node = treeFind(bucket->root, hash, key, map->key_cmp_func, &compared);
+	TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, compared, NULL != node);
+	(void)compared;
+	return node ? node->entry : NULL;
 }
 
-size_t hashMapSize(const HashMap* map)
+/**
+ * Adds a new entry to bucket: at the end of a chain, or at the front of a
+ * treeified one, along with its tree node.
+ **/
+static HashMapStatus linkEntry(HashMap* map, Bucket* bucket, Entry* entry, uint64_t hash)
 {
-	return map->num_elements;
+	if (bucket->root)
+	{
+		TreeNode* node = treeNodeCreate(map, entry, bucket->dummy, hash);
+		if (!node) return HASH_MAP_MEM_ERROR;
+
+		Entry* next = bucket->dummy->next;
+		treeNodeOf(map, bucket, next)->prev = entry;
+		entry->next = next;
+		bucket->dummy->next = entry;
+		bucket->root = treeInsert(bucket->root, node, map->key_cmp_func);
+	}
+	else
+	{
+		addLast(bucket, entry);
+	}
+
+	++bucket->length;
+	if (!bucket->root && bucket->length > TREEIFY_THRESHOLD)
+	{
+		treeify(map, bucket);
+	}
+	return HASH_MAP_SUCCESS;
 }
 
-void hashMapRemove(HashMap* map, const void* key)
+/**
+ * Unlinks entry (of the given hash) from bucket, dropping the bucket's tree
+ * once the chain is short again.
+ **/
+static void unlinkEntry(HashMap* map, Bucket* bucket, Entry* entry, uint64_t hash)
 {
-	size_t hash = map->key_hash_func(key, map->num_buckets);
-	Bucket* bucket = map->buckets[hash];
-	Entry* target = findBucketEntry(bucket, key, map->key_cmp_func);
-	if (target)
+	if (bucket->root)
+	{
+		TreeNode* node = NULL;
+		bucket->root = treeRemove(bucket->root, hash, entry->key, map->key_cmp_func, &node);
+		node->prev->next = entry->next;
+		if (entry->next)
+		{
+			treeNodeOf(map, bucket, entry->next)->prev = node->prev;
+		}
+		dsFree(&map->allocator, node, sizeof(*node));
+	}
+	else
 	{
 		Entry* itr = bucket->dummy;
-		while (itr->next != target) itr = itr->next;
-		itr->next = target->next;
-		target->next = NULL;
-		map->handlers.key_free(target->key);
-		map->handlers.value_free(target->value);
-		free(target);
-		--map->num_elements;
-		updateLoadFactor(map);
+		while (itr->next != entry) itr = itr->next;
+		itr->next = entry->next;
+	}
+	entry->next = NULL;
+
+	--bucket->length;
+	if (bucket->root && bucket->length <= UNTREEIFY_THRESHOLD)
+	{
+		treeDestroy(bucket->root, &map->allocator);
+		bucket->root = NULL;
 	}
 }
 
-void hashMapForEach(HashMap* map, for_each_func_t func, void* params)
+
+/**
+ * Applies func to every key/value pair of the map, in either mode.
+ **/
+static void forEachEntry(const HashMap* map, for_each_entry_func_t func, void* params)
 {
-	for (size_t bucket_itr = 0; bucket_itr < map->num_buckets; ++bucket_itr)
+	if (map->cuckoo)
 	{
-		Bucket* bucket = map->buckets[bucket_itr];
-		if (!bucket) continue;
-		
-		Entry* entry_itr = bucket->dummy->next;
+		const CuckooTable* table = &map->cuckoo_table;
+		for (size_t i = 0; i < table->num_buckets; ++i)
+		{
+			const CuckooBucket* bucket = &table->buckets[i];
+			for (size_t slot = 0; slot < CUCKOO_SLOTS; ++slot)
+			{
+				if (!bucket->tags[slot]) continue;
+				func(bucket->keys[slot], table->values[i * CUCKOO_SLOTS + slot], params);
+			}
+		}
 
-		while (entry_itr)
+		const CuckooOverflow* overflow = &map->cuckoo_overflow;
+		for (size_t i = 0; i < overflow->count; ++i)
 		{
-			func(entry_itr->value, params);
-			entry_itr = entry_itr->next;
+			func(overflow->entries[i].key, overflow->entries[i].value, params);
 		}
+		return;
 	}
-}
-
 
+	if (isSmall(map))
+	{
+		for (size_t i = 0; i < map->num_elements; ++i)
+		{
+			func(map->small[i].key, map->small[i].value, params);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < map->num_buckets; ++i)
+	{
+		for (Entry* itr = map->buckets[i]->dummy->next; itr; itr = itr->next)
+		{
+			func(itr->key, itr->value, params);
+		}
+	}
+}
+
+
+typedef struct
+{
+	const HashMap* map;
+	BloomFilter* filter;
+} BloomFilterBuild;
+
+static void addToBloomFilter(const void* key, void* value, void* params)
+{
+	BloomFilterBuild* build = params;
+	(void)value;
+	bloomFilterAdd(build->filter, fullHash(build->map, key));
+}
+
+/**
+ * Creates a Bloom filter holding every key of the map, sized for as many
+ * elements as the map can hold before it resizes again.
+ **/
+static BloomFilter* buildBloomFilter(const HashMap* map)
+{
+	// a small map is sized for its first table, which the filter carries over to
+	size_t num_buckets = isSmall(map) ? DEFAULT_NUM_BUCKETS : map->num_buckets;
+	size_t capacity = map->cuckoo ?
+		num_buckets * CUCKOO_SLOTS :
+		(size_t)(num_buckets * DEFAULT_LOAD_FACTOR) + 1;
+	BloomFilter* filter = bloomFilterCreateWithAllocator(capacity,
+							     map->bloom_false_positive_rate,
+							     &map->allocator);
+	if (!filter) return NULL;
+
+	BloomFilterBuild build = {map, filter};
+	forEachEntry(map, addToBloomFilter, &build);
+	return filter;
+}
+
+
+/**
+ * Returns 0 if the map's filter rules out the key of the given hash, and 1
+ * if it may be in the map (or no filter is enabled).
+ **/
+static int mayContain(const HashMap* map, uint64_t hash)
+{
+	return !map->bloom_filter || bloomFilterMayContain(map->bloom_filter, hash);
+}
+
+
+/* small mode */
+
+/**
+ * Returns the index of key in the small array, or SIZE_MAX if key isn't in
+ * the map.
+ **/
+static size_t smallFind(const HashMap* map, const void* key)
+{
+	for (size_t i = 0; i < map->num_elements; ++i)
+	{
+		if (0 == map->key_cmp_func(key, map->small[i].key))
+		{
+			TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, i + 1, 1);
+			return i;
+		}
+	}
+	TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, map->num_elements, 0);
+	return SIZE_MAX;
+}
+
+/**
+ * Moves the pairs of a small map into its first table, which is how a map
+ * leaves small mode. On failure, the map is left as it was.
+ * This isn't traced as a resize: resizes are of tables, and the first table
+ * used to come with the map.
+ **/
+static HashMapStatus leaveSmallMode(HashMap* map)
+{
+	HashMapStatus status = HASH_MAP_SUCCESS;
+	Bucket** buckets = createBucketArray(DEFAULT_NUM_BUCKETS, &status, &map->allocator);
+	Entry* entries[SMALL_MAP_CAPACITY];
+	size_t created = 0;
+	while (HASH_MAP_SUCCESS == status && created < map->num_elements)
+	{
+		entries[created] = bucketEntryCreate(&map->allocator);
+		if (!entries[created]) status = HASH_MAP_MEM_ERROR;
+		else ++created;
+	}
+	if (HASH_MAP_SUCCESS != status)
+	{
+		for (size_t i = 0; i < created; ++i)
+		{
+			dsFree(&map->allocator, entries[i], sizeof(*entries[i]));
+		}
+		destroyBucketArray(buckets, DEFAULT_NUM_BUCKETS, map->handlers, &map->allocator);
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	map->buckets = buckets;
+	map->num_buckets = DEFAULT_NUM_BUCKETS;
+	for (size_t i = 0; i < map->num_elements; ++i)
+	{
+		// too few entries for a chain to need a tree
+		Entry* entry = entries[i];
+		entry->key = map->small[i].key;
+		entry->value = map->small[i].value;
+		Bucket* bucket = map->buckets[bucketIndex(map, fullHash(map, entry->key))];
+		entry->next = bucket->dummy->next;
+		bucket->dummy->next = entry;
+		++bucket->length;
+	}
+	updateLoadFactor(map);
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Small mode counterpart of chainInsert, given the index smallFind returned
+ * for key. A new key needs room in the small array.
+ **/
+static HashMapStatus smallInsert(HashMap* map, size_t index, const void* key,
+				 void* new_value, void* new_key)
+{
+	if (SIZE_MAX != index)
+	{
+		map->handlers.value_free(map->small[index].value);
+		map->small[index].value = new_value;
+		if (new_key) map->handlers.key_free(new_key);
+		TRACE_DETAIL(TRACE_HASH_MAP_INSERT, map->num_elements, 0);
+		return HASH_MAP_SUCCESS;
+	}
+
+	void* added_key = new_key ? new_key : map->handlers.key_copy(key);
+	if (!added_key) return HASH_MAP_MEM_ERROR;
+	if (map->bloom_filter)
+	{
+		bloomFilterAdd(map->bloom_filter, fullHash(map, key));
+	}
+	map->small[map->num_elements].key = added_key;
+	map->small[map->num_elements].value = new_value;
+	++map->num_elements;
+	TRACE_DETAIL(TRACE_HASH_MAP_INSERT, map->num_elements, 1);
+	return HASH_MAP_SUCCESS;
+}
+
+static void smallRemove(HashMap* map, const void* key)
+{
+	size_t index = smallFind(map, key);
+	if (SIZE_MAX == index) return;
+
+	map->handlers.key_free(map->small[index].key);
+	map->handlers.value_free(map->small[index].value);
+	map->small[index] = map->small[--map->num_elements];
+}
+
+
+/* cuckoo mode */
+
+static uint16_t cuckooTag(uint64_t hash)
+{
+	uint16_t tag = (uint16_t)(hash >> 48);
+	return tag ? tag : 1;
+}
+
+/**
+ * Returns the other bucket of a key in bucket, given its tag. It only depends
+ * on the tag (partial-key cuckoo hashing), so that keys can be moved without
+ * hashing them again, and it never is bucket itself.
+ **/
+static size_t cuckooAltBucket(size_t bucket, uint16_t tag, size_t num_buckets)
+{
+	size_t offset = ((size_t)tag * 0x5bd1e995u) & (num_buckets - 1);
+	return bucket ^ (offset | 1);
+}
+
+static size_t cuckooFirstBucket(uint64_t hash, size_t num_buckets)
+{
+	return (size_t)hash & (num_buckets - 1);
+}
+
+/**
+ * Returns the slot index of key: below num_buckets * CUCKOO_SLOTS, a table
+ * slot, and above, an overflow entry. Returns CUCKOO_NOT_FOUND if key isn't
+ * in the map.
+ **/
+static size_t cuckooFind(const HashMap* map, const void* key, uint64_t hash)
+{
+	const CuckooTable* table = &map->cuckoo_table;
+	uint16_t tag = cuckooTag(hash);
+	size_t buckets[2];
+	buckets[0] = cuckooFirstBucket(hash, table->num_buckets);
+	buckets[1] = cuckooAltBucket(buckets[0], tag, table->num_buckets);
+	// both lines are loaded in parallel
+	__builtin_prefetch(&table->buckets[buckets[1]]);
+
+	size_t compared = 0;	// only read when tracing
+	for (size_t i = 0; i < 2; ++i)
+	{
+		const CuckooBucket* bucket = &table->buckets[buckets[i]];
+		for (size_t slot = 0; slot < CUCKOO_SLOTS; ++slot)
+		{
+			if (tag != bucket->tags[slot]) continue;
+
+			++compared;
+			if (0 == map->key_cmp_func(key, bucket->keys[slot]))
+			{
+				TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, compared, 1);
+				return buckets[i] * CUCKOO_SLOTS + slot;
+			}
+		}
+	}
+
+	const CuckooOverflow* overflow = &map->cuckoo_overflow;
+	for (size_t i = 0; i < overflow->count; ++i)
+	{
+		++compared;
+		if (0 == map->key_cmp_func(key, overflow->entries[i].key))
+		{
+			TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, compared, 1);
+			return table->num_buckets * CUCKOO_SLOTS + i;
+		}
+	}
+	TRACE_DETAIL(TRACE_HASH_MAP_LOOKUP, compared, 0);
+	(void)compared;
+	return CUCKOO_NOT_FOUND;
+}
+
+static void** cuckooValueAt(HashMap* map, size_t index)
+{
+	size_t table_slots = map->cuckoo_table.num_buckets * CUCKOO_SLOTS;
+	return index < table_slots ?
+		&map->cuckoo_table.values[index] :
+		&map->cuckoo_overflow.entries[index - table_slots].value;
+}
+
+
+typedef struct
+{
+	size_t bucket;
+	int parent;	// index in the search queue, -1 for the key's own buckets
+	int slot;	// the slot of parent whose key would move to bucket
+} CuckooSearchNode;
+
+/**
+ * Frees a slot in one of the two buckets of a key with the given hash, moving
+ * other keys to their alternate buckets if both are full. The moves follow the
+ * shortest path to a free slot found by a breadth-first search over at most
+ * CUCKOO_MAX_SEARCH buckets.
+ * Returns the index of the free slot, or CUCKOO_NOT_FOUND if there is no room.
+ **/
+static size_t cuckooMakeRoom(CuckooTable* table, uint64_t hash)
+{
+	CuckooSearchNode queue[CUCKOO_MAX_SEARCH];
+	size_t first = cuckooFirstBucket(hash, table->num_buckets);
+	queue[0] = (CuckooSearchNode){first, -1, -1};
+	queue[1] = (CuckooSearchNode){cuckooAltBucket(first, cuckooTag(hash), table->num_buckets), -1, -1};
+	int tail = 2;
+
+	for (int head = 0; head < tail; ++head)
+	{
+		CuckooBucket* bucket = &table->buckets[queue[head].bucket];
+		for (int slot = 0; slot < CUCKOO_SLOTS; ++slot)
+		{
+			if (bucket->tags[slot]) continue;
+
+			// walk the path back, moving each key into the slot freed by
+			// the previous move
+			int node = head;
+			int free_slot = slot;
+			while (queue[node].parent >= 0)
+			{
+				const CuckooSearchNode* from = &queue[queue[node].parent];
+				CuckooBucket* source = &table->buckets[from->bucket];
+				CuckooBucket* target = &table->buckets[queue[node].bucket];
+				int source_slot = queue[node].slot;
+
+				// a path through the same bucket twice may have replaced
+				// the key the search saw. every move so far was valid,
+				// so the table is consistent, there's just no room
+				uint16_t tag = source->tags[source_slot];
+				if (cuckooAltBucket(from->bucket, tag, table->num_buckets) != queue[node].bucket)
+				{
+					return CUCKOO_NOT_FOUND;
+				}
+
+				target->tags[free_slot] = tag;
+				target->keys[free_slot] = source->keys[source_slot];
+				table->values[queue[node].bucket * CUCKOO_SLOTS + free_slot] =
+					table->values[from->bucket * CUCKOO_SLOTS + source_slot];
+				source->tags[source_slot] = 0;
+
+				free_slot = source_slot;
+				node = queue[node].parent;
+			}
+			return queue[node].bucket * CUCKOO_SLOTS + free_slot;
+		}
+
+		for (int slot = 0; slot < CUCKOO_SLOTS && tail < CUCKOO_MAX_SEARCH; ++slot)
+		{
+			size_t alt = cuckooAltBucket(queue[head].bucket, bucket->tags[slot],
+						     table->num_buckets);
+			queue[tail++] = (CuckooSearchNode){alt, head, slot};
+		}
+	}
+	return CUCKOO_NOT_FOUND;
+}
+
+static void cuckooSetSlot(CuckooTable* table, size_t index, uint64_t hash, void* key, void* value)
+{
+	CuckooBucket* bucket = &table->buckets[index / CUCKOO_SLOTS];
+	bucket->tags[index % CUCKOO_SLOTS] = cuckooTag(hash);
+	bucket->keys[index % CUCKOO_SLOTS] = key;
+	table->values[index] = value;
+}
+
+static HashMapStatus cuckooOverflowPush(CuckooOverflow* overflow, void* key, void* value,
+					const DsAllocator* allocator)
+{
+	if (overflow->count == overflow->capacity)
+	{
+		size_t capacity = overflow->capacity ? 2 * overflow->capacity : 4;
+		CuckooOverflowEntry* entries = dsRealloc(allocator, overflow->entries,
+				overflow->capacity * sizeof(CuckooOverflowEntry),
+				capacity * sizeof(CuckooOverflowEntry));
+		if (!entries) return HASH_MAP_MEM_ERROR;
+
+		overflow->entries = entries;
+		overflow->capacity = capacity;
+	}
+
+	overflow->entries[overflow->count].key = key;
+	overflow->entries[overflow->count].value = value;
+	++overflow->count;
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Places a key that isn't in table yet, in the table if room can be made,
+ * or in overflow.
+ **/
+static HashMapStatus cuckooPlace(CuckooTable* table, CuckooOverflow* overflow, uint64_t hash,
+				 void* key, void* value, const DsAllocator* allocator)
+{
+	size_t index = cuckooMakeRoom(table, hash);
+	if (CUCKOO_NOT_FOUND == index)
+	{
+		return cuckooOverflowPush(overflow, key, value, allocator);
+	}
+
+	cuckooSetSlot(table, index, hash, key, value);
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Doubles the number of buckets. On failure, the map is left as it was.
+ **/
+static HashMapStatus cuckooResize(HashMap* map)
+{
+	TRACE_EVENT(TRACE_HASH_MAP_RESIZE_BEGIN, map->num_buckets, map->num_elements);
+	CuckooTable table = {NULL, NULL, NULL, 0};
+	CuckooOverflow overflow = {NULL, 0, 0};
+	HashMapStatus status = cuckooTableCreate(&table, 2 * map->num_buckets, &map->allocator);
+
+	// the keys are hashed again: the tags only tell the old bucket count apart
+	const CuckooTable* old_table = &map->cuckoo_table;
+	for (size_t i = 0; HASH_MAP_SUCCESS == status && i < old_table->num_buckets; ++i)
+	{
+		const CuckooBucket* bucket = &old_table->buckets[i];
+		for (size_t slot = 0; HASH_MAP_SUCCESS == status && slot < CUCKOO_SLOTS; ++slot)
+		{
+			if (!bucket->tags[slot]) continue;
+			status = cuckooPlace(&table, &overflow, fullHash(map, bucket->keys[slot]),
+					     bucket->keys[slot],
+					     old_table->values[i * CUCKOO_SLOTS + slot],
+					     &map->allocator);
+		}
+	}
+
+	const CuckooOverflow* old_overflow = &map->cuckoo_overflow;
+	for (size_t i = 0; HASH_MAP_SUCCESS == status && i < old_overflow->count; ++i)
+	{
+		void* key = old_overflow->entries[i].key;
+		status = cuckooPlace(&table, &overflow, fullHash(map, key), key,
+				     old_overflow->entries[i].value, &map->allocator);
+	}
+
+	if (HASH_MAP_SUCCESS != status)
+	{
+		// the keys and values still belong to the old table
+		cuckooTableDestroy(&table, &map->allocator);
+		cuckooOverflowDestroy(&overflow, &map->allocator);
+		TRACE_EVENT(TRACE_HASH_MAP_RESIZE_END, map->num_buckets, map->num_elements);
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	cuckooTableDestroy(&map->cuckoo_table, &map->allocator);
+	cuckooOverflowDestroy(&map->cuckoo_overflow, &map->allocator);
+	map->cuckoo_table = table;
+	map->cuckoo_overflow = overflow;
+	map->num_buckets = table.num_buckets;
+
+	if (map->bloom_filter)
+	{
+		// as for chaining: on failure, the old filter still holds every key
+		BloomFilter* filter = buildBloomFilter(map);
+		if (filter)
+		{
+			bloomFilterDestroy(map->bloom_filter);
+			map->bloom_filter = filter;
+		}
+	}
+	TRACE_EVENT(TRACE_HASH_MAP_RESIZE_END, map->num_buckets, map->num_elements);
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Inserts the pair, with new_value already copied. The key is copied if it is
+ * new and new_key is NULL; otherwise new_key is taken over (and freed if key
+ * already exists). On failure, new_value and new_key are left to the caller.
+ **/
+static HashMapStatus cuckooInsert(HashMap* map, const void* key, void* new_value,
+				  void* new_key)
+{
+	uint64_t hash = fullHash(map, key);
+	size_t index = cuckooFind(map, key, hash);
+	if (CUCKOO_NOT_FOUND != index)
+	{
+		void** value = cuckooValueAt(map, index);
+		map->handlers.value_free(*value);
+		*value = new_value;
+		if (new_key) map->handlers.key_free(new_key);
+		TRACE_DETAIL(TRACE_HASH_MAP_INSERT, map->num_elements, 0);
+		return HASH_MAP_SUCCESS;
+	}
+
+	void* owned_key = new_key ? new_key : map->handlers.key_copy(key);
+	if (!owned_key) return HASH_MAP_MEM_ERROR;
+
+	// grow while the table is at least half full: below that, a failed
+	// search means that the key's buckets are taken by keys with the same
+	// hashes, which more buckets wouldn't tell apart
+	index = cuckooMakeRoom(&map->cuckoo_table, hash);
+	while (CUCKOO_NOT_FOUND == index &&
+	       2 * map->num_elements >= map->num_buckets * CUCKOO_SLOTS &&
+	       HASH_MAP_SUCCESS == cuckooResize(map))
+	{
+		index = cuckooMakeRoom(&map->cuckoo_table, hash);
+	}
+
+	if (CUCKOO_NOT_FOUND != index)
+	{
+		cuckooSetSlot(&map->cuckoo_table, index, hash, owned_key, new_value);
+	}
+	else if (HASH_MAP_SUCCESS != cuckooOverflowPush(&map->cuckoo_overflow, owned_key,
+							 new_value, &map->allocator))
+	{
+		if (!new_key) map->handlers.key_free(owned_key);
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	if (map->bloom_filter)
+	{
+		bloomFilterAdd(map->bloom_filter, hash);
+	}
+	++map->num_elements;
+	TRACE_DETAIL(TRACE_HASH_MAP_INSERT, map->num_elements, 1);
+	return HASH_MAP_SUCCESS;
+}
+
+static void cuckooRemove(HashMap* map, const void* key)
+{
+	size_t index = cuckooFind(map, key, fullHash(map, key));
+	if (CUCKOO_NOT_FOUND == index) return;
+
+	size_t table_slots = map->num_buckets * CUCKOO_SLOTS;
+	if (index < table_slots)
+	{
+		CuckooBucket* bucket = &map->cuckoo_table.buckets[index / CUCKOO_SLOTS];
+		map->handlers.key_free(bucket->keys[index % CUCKOO_SLOTS]);
+		map->handlers.value_free(map->cuckoo_table.values[index]);
+		bucket->tags[index % CUCKOO_SLOTS] = 0;
+	}
+	else
+	{
+		CuckooOverflow* overflow = &map->cuckoo_overflow;
+		CuckooOverflowEntry* entry = &overflow->entries[index - table_slots];
+		map->handlers.key_free(entry->key);
+		map->handlers.value_free(entry->value);
+		*entry = overflow->entries[--overflow->count];
+	}
+	--map->num_elements;
+}
+
+
+static HashMapStatus resizeHashMap(HashMap* map)
+{
+	if (isSmall(map)) return leaveSmallMode(map);
+
+	TRACE_EVENT(TRACE_HASH_MAP_RESIZE_BEGIN, map->num_buckets, map->num_elements);
+	size_t new_size = 2 * map->num_buckets;
+	HashMapStatus status = HASH_MAP_SUCCESS;
+	Bucket** new_buckets = createBucketArray(new_size, &status, &map->allocator);
+	if (HASH_MAP_SUCCESS != status)
+	{
+		destroyBucketArray(new_buckets, new_size, map->handlers,
+				   &map->allocator);
+		// a failed resize ends with the bucket count unchanged
+		TRACE_EVENT(TRACE_HASH_MAP_RESIZE_END, map->num_buckets, map->num_elements);
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	Bucket** old_buckets = map->buckets;
+	size_t old_num_buckets = map->num_buckets;
+	
+	// reset statistics in the original hash table
+	map->num_buckets = new_size;
+	map->buckets = new_buckets;
+	map->load_factor = 0;
+	map->num_elements = 0;
+
+	// rearrange old entries into the new table.
+	// this avoids unnecessary copy operations. entries are moved to the
+	// front of their new chain, so that long chains move in linear time
+	for (size_t i = 0; i < old_num_buckets; ++i)
+	{
+		Entry* itr = old_buckets[i]->dummy->next;
+		while (itr)
+		{
+			Entry* next = itr->next;
+			Bucket* bucket = map->buckets[bucketIndex(map, fullHash(map, itr->key))];
+			itr->next = bucket->dummy->next;
+			bucket->dummy->next = itr;
+			++bucket->length;
+			itr = next;
+			++map->num_elements;
+			updateLoadFactor(map);
+		}
+		old_buckets[i]->dummy->next = NULL;
+	}
+
+	// the old trees go with their buckets, and long chains get new ones
+	destroyBucketArray(old_buckets, old_num_buckets, map->handlers,
+			   &map->allocator);
+	for (size_t i = 0; i < map->num_buckets; ++i)
+	{
+		if (map->buckets[i]->length > TREEIFY_THRESHOLD)
+		{
+			treeify(map, map->buckets[i]);
+		}
+	}
+
+	if (map->bloom_filter)
+	{
+		// drop removed keys from the filter, and size it for the new
+		// capacity. if that fails, the old filter still holds every key,
+		// it just gets less selective as it fills up
+		BloomFilter* filter = buildBloomFilter(map);
+		if (filter)
+		{
+			bloomFilterDestroy(map->bloom_filter);
+			map->bloom_filter = filter;
+		}
+	}
+	TRACE_EVENT(TRACE_HASH_MAP_RESIZE_END, map->num_buckets, map->num_elements);
+	return HASH_MAP_SUCCESS;
+}
+
+
+/**
+ * Chained counterpart of cuckooInsert.
+ **/
+static HashMapStatus chainInsert(HashMap* map, const void* key, void* new_value,
+				 void* new_key)
+{
+	// a full small map has just been searched: the key is new to its table
+	int searched = 0;
+	if (isSmall(map))
+	{
+		size_t index = smallFind(map, key);
+		if (SIZE_MAX != index || map->num_elements < SMALL_MAP_CAPACITY)
+		{
+			return smallInsert(map, index, key, new_value, new_key);
+		}
+		if (HASH_MAP_SUCCESS != leaveSmallMode(map)) return HASH_MAP_MEM_ERROR;
+		searched = 1;
+	}
+
+	uint64_t hash = fullHash(map, key);
+	Bucket* bucket = map->buckets[bucketIndex(map, hash)];
+	
+	Entry* bucket_entry = searched ? NULL : findEntry(map, bucket, key, hash);
+	if (bucket_entry)
+	{
+		map->handlers.value_free(bucket_entry->value);
+		bucket_entry->value = new_value;
+		if (new_key) map->handlers.key_free(new_key);
+		TRACE_DETAIL(TRACE_HASH_MAP_INSERT, map->num_elements, 0);
+		return HASH_MAP_SUCCESS;
+	}
+
+	Entry* new_entry = bucketEntryCreate(&map->allocator);
+	if (!new_entry) return HASH_MAP_MEM_ERROR;
+	
+	new_entry->key = new_key ? new_key : map->handlers.key_copy(key);
+	if (!new_entry->key)
+	{
+		dsFree(&map->allocator, new_entry, sizeof(*new_entry));
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	new_entry->value = new_value;
+	if (HASH_MAP_SUCCESS != linkEntry(map, bucket, new_entry, hash))
+	{
+		if (!new_key) map->handlers.key_free(new_entry->key);
+		dsFree(&map->allocator, new_entry, sizeof(*new_entry));
+		return HASH_MAP_MEM_ERROR;
+	}
+	if (map->bloom_filter)
+	{
+		bloomFilterAdd(map->bloom_filter, hash);
+	}
+	++map->num_elements;
+	updateLoadFactor(map);
+	TRACE_DETAIL(TRACE_HASH_MAP_INSERT, map->num_elements, 1);
+
+	if (map->load_factor > DEFAULT_LOAD_FACTOR)
+	{
+		// the entry is in place either way. if growing fails, the
+		// map keeps working with longer chains, and the resize is
+		// retried on the next insertion
+		resizeHashMap(map);
+	}
+	return HASH_MAP_SUCCESS;
+}
+
+
+HashMapStatus hashMapInsert(HashMap* map, const void* key, const void* value)
+{
+	void* new_value = map->handlers.value_copy(value);
+	if (!new_value) return HASH_MAP_MEM_ERROR;
+
+	HashMapStatus status = map->cuckoo ? cuckooInsert(map, key, new_value, NULL)
+					   : chainInsert(map, key, new_value, NULL);
+	if (HASH_MAP_SUCCESS != status)
+	{
+		map->handlers.value_free(new_value);
+	}
+	return status;
+}
+
+HashMapStatus hashMapInsertOwned(HashMap* map, void* key, void* value)
+{
+	return map->cuckoo ? cuckooInsert(map, key, value, key)
+			   : chainInsert(map, key, value, key);
+}
+
+HashMapStatus hashMapEnableBloomFilter(HashMap* map, double false_positive_rate)
+{
+	assert (false_positive_rate > 0 && false_positive_rate < 1);
+
+	double previous_rate = map->bloom_false_positive_rate;
+	map->bloom_false_positive_rate = false_positive_rate;
+	BloomFilter* filter = buildBloomFilter(map);
+	if (!filter)
+	{
+		map->bloom_false_positive_rate = previous_rate;
+		return HASH_MAP_MEM_ERROR;
+	}
+
+	bloomFilterDestroy(map->bloom_filter);
+	map->bloom_filter = filter;
+	return HASH_MAP_SUCCESS;
+}
+
+int hashMapContains(const HashMap* map, const void* key)
+{
+	if (isSmall(map)) return SIZE_MAX != smallFind(map, key);
+
+	uint64_t hash = fullHash(map, key);
+	if (!mayContain(map, hash)) return 0;
+	if (map->cuckoo)
+	{
+		return CUCKOO_NOT_FOUND != cuckooFind(map, key, hash);
+	}
+
+	return NULL != findEntry(map, map->buckets[bucketIndex(map, hash)], key, hash);
+}
+
+void* hashMapGet(HashMap* map, const void* key)
+{
+	if (isSmall(map))
+	{
+		size_t index = smallFind(map, key);
+		return SIZE_MAX != index ? map->small[index].value : NULL;
+	}
+
+	uint64_t hash = fullHash(map, key);
+	if (!mayContain(map, hash)) return NULL;
+	if (map->cuckoo)
+	{
+		size_t index = cuckooFind(map, key, hash);
+		return CUCKOO_NOT_FOUND != index ? *cuckooValueAt(map, index) : NULL;
+	}
+
+	Entry* entry = findEntry(map, map->buckets[bucketIndex(map, hash)], key, hash);
+	return entry ? entry->value : NULL;
+}
+
+/**
+ * Looks up a group of keys of a chained map in stages, one dependent load
+ * per stage: every key's load is issued (prefetched) before any of them is
+ * used, so that their cache misses overlap.
+ **/
+static void chainGetGroup(HashMap* map, const void* const* keys, size_t count,
+			  void** values)
+{
+	uint64_t hashes[GET_MANY_GROUP];
+	Bucket* const* slots[GET_MANY_GROUP];
+	Bucket* buckets[GET_MANY_GROUP];
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		hashes[i] = fullHash(map, keys[i]);
+		if (map->bloom_filter)
+		{
+			bloomFilterPrefetch(map->bloom_filter, hashes[i]);
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		// keys the filter rejects drop out of the pipeline
+		slots[i] = mayContain(map, hashes[i]) ?
+			&map->buckets[bucketIndex(map, hashes[i])] : NULL;
+		if (slots[i]) __builtin_prefetch(slots[i]);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		buckets[i] = slots[i] ? *slots[i] : NULL;
+		if (buckets[i]) __builtin_prefetch(buckets[i]);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!buckets[i]) continue;
+		__builtin_prefetch(buckets[i]->root ? (void*)buckets[i]->root
+						    : (void*)buckets[i]->dummy);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (buckets[i] && !buckets[i]->root && buckets[i]->dummy->next)
+		{
+			__builtin_prefetch(buckets[i]->dummy->next);
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (buckets[i] && !buckets[i]->root && buckets[i]->dummy->next)
+		{
+			__builtin_prefetch(buckets[i]->dummy->next->key);
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		Entry* entry = buckets[i] ? findEntry(map, buckets[i], keys[i], hashes[i]) : NULL;
+		values[i] = entry ? entry->value : NULL;
+	}
+}
+
+/**
+ * cuckoo counterpart of chainGetGroup: both buckets of every key are
+ * prefetched, then searched, then their values are read.
+ **/
+static void cuckooGetGroup(HashMap* map, const void* const* keys, size_t count,
+			   void** values)
+{
+	uint64_t hashes[GET_MANY_GROUP];
+	size_t indices[GET_MANY_GROUP];
+	const CuckooTable* table = &map->cuckoo_table;
+	size_t table_slots = table->num_buckets * CUCKOO_SLOTS;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		hashes[i] = fullHash(map, keys[i]);
+		if (map->bloom_filter)
+		{
+			bloomFilterPrefetch(map->bloom_filter, hashes[i]);
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		indices[i] = mayContain(map, hashes[i]) ? 0 : CUCKOO_NOT_FOUND;
+		if (CUCKOO_NOT_FOUND == indices[i]) continue;
+
+		size_t first = cuckooFirstBucket(hashes[i], table->num_buckets);
+		__builtin_prefetch(&table->buckets[first]);
+		__builtin_prefetch(&table->buckets[cuckooAltBucket(first, cuckooTag(hashes[i]),
+								   table->num_buckets)]);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (CUCKOO_NOT_FOUND == indices[i]) continue;
+
+		indices[i] = cuckooFind(map, keys[i], hashes[i]);
+		if (indices[i] < table_slots)
+		{
+			__builtin_prefetch(&table->values[indices[i]]);
+		}
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		values[i] = CUCKOO_NOT_FOUND != indices[i] ? *cuckooValueAt(map, indices[i]) : NULL;
+	}
+}
+
+void hashMapGetMany(HashMap* map, const void* const* keys, size_t n, void** values)
+{
+	for (size_t start = 0; start < n; start += GET_MANY_GROUP)
+	{
+		size_t count = n - start < GET_MANY_GROUP ? n - start : GET_MANY_GROUP;
+		if (map->cuckoo)
+		{
+			cuckooGetGroup(map, keys + start, count, values + start);
+		}
+		else if (isSmall(map))
+		{
+			// a few compares, with nothing to fetch from memory
+			for (size_t i = start; i < start + count; ++i)
+			{
+				values[i] = hashMapGet(map, keys[i]);
+			}
+		}
+		else
+		{
+			chainGetGroup(map, keys + start, count, values + start);
+		}
+	}
+}
+
+size_t hashMapSize(const HashMap* map)
+{
+	return map->num_elements;
+}
+
+void hashMapRemove(HashMap* map, const void* key)
+{
+	if (map->cuckoo)
+	{
+		cuckooRemove(map, key);
+		return;
+	}
+	if (isSmall(map))
+	{
+		smallRemove(map, key);
+		return;
+	}
+
+	uint64_t hash = fullHash(map, key);
+	Bucket* bucket = map->buckets[bucketIndex(map, hash)];
+	Entry* target = findEntry(map, bucket, key, hash);
+	if (target)
+	{
+		unlinkEntry(map, bucket, target, hash);
+		map->handlers.key_free(target->key);
+		map->handlers.value_free(target->value);
+		dsFree(&map->allocator, target, sizeof(*target));
+		--map->num_elements;
+		updateLoadFactor(map);
+	}
+}
+
+typedef struct
+{
+	for_each_func_t func;
+	void* params;
+} ForEachValue;
+
+static void applyToValue(const void* key, void* value, void* params)
+{
+	ForEachValue* for_each = params;
+	(void)key;
+	for_each->func(value, for_each->params);
+}
+
+void hashMapForEach(HashMap* map, for_each_func_t func, void* params)
+{
+	if (map->cuckoo || isSmall(map))
+	{
+		ForEachValue for_each = {func, params};
+		forEachEntry(map, applyToValue, &for_each);
+		return;
+	}
+
+	for (size_t bucket_itr = 0; bucket_itr < map->num_buckets; ++bucket_itr)
+	{
+		Bucket* bucket = map->buckets[bucket_itr];
+		if (!bucket) continue;
+		
+		Entry* entry_itr = bucket->dummy->next;
+
+		while (entry_itr)
+		{
+			func(entry_itr->value, params);
+			entry_itr = entry_itr->next;
+		}
+	}
+}
+
+void hashMapForEachEntry(HashMap* map, for_each_entry_func_t func, void* params)
+{
+	forEachEntry(map, func, params);
+}
+
+
+static int sameAllocator(const DsAllocator* first, const DsAllocator* second)
+{
+	return first->alloc == second->alloc && first->realloc == second->realloc &&
+	       first->free == second->free && first->context == second->context;
+}
+
+/**
+ * Hands a pair taken out of a merged map over to dst: its value is combined
+ * with the value of the same key in dst, or the pair is added. On success,
+ * dst owns key and value. *entry is the chain entry holding the pair in the
+ * source map, if any; it is set to NULL if dst took the entry itself, and is
+ * left to the caller otherwise.
+ **/
+static HashMapStatus mergePair(HashMap* dst, void* key, void* value, Entry** entry,
+			       value_combine_func_t combine)
+{
+	uint64_t hash = fullHash(dst, key);
+	Bucket* bucket = NULL;
+	void** slot = NULL;
+	if (dst->cuckoo)
+	{
+		size_t index = cuckooFind(dst, key, hash);
+		if (CUCKOO_NOT_FOUND != index) slot = cuckooValueAt(dst, index);
+	}
+	else if (isSmall(dst))
+	{
+		size_t index = smallFind(dst, key);
+		if (SIZE_MAX != index) slot = &dst->small[index].value;
+	}
+	else
+	{
+		bucket = dst->buckets[bucketIndex(dst, hash)];
+		Entry* existing = findEntry(dst, bucket, key, hash);
+		if (existing) slot = &existing->value;
+	}
+
+	if (slot)
+	{
+		void* kept = combine ? combine(*slot, value) : value;
+		if (kept != *slot) dst->handlers.value_free(*slot);
+		if (kept != value) dst->handlers.value_free(value);
+		*slot = kept;
+		dst->handlers.key_free(key);
+		return HASH_MAP_SUCCESS;
+	}
+
+	if (!bucket || !*entry)
+	{
+		return dst->cuckoo ? cuckooInsert(dst, key, value, key)
+				   : chainInsert(dst, key, value, key);
+	}
+
+	// relink the entry instead of allocating another one
+	if (HASH_MAP_SUCCESS != linkEntry(dst, bucket, *entry, hash)) return HASH_MAP_MEM_ERROR;
+	*entry = NULL;
+	if (dst->bloom_filter)
+	{
+		bloomFilterAdd(dst->bloom_filter, hash);
+	}
+	++dst->num_elements;
+	updateLoadFactor(dst);
+	if (dst->load_factor > DEFAULT_LOAD_FACTOR)
+	{
+		resizeHashMap(dst);
+	}
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Merges the chains of src one by one: each chain is detached from its
+ * bucket and its entries are handed over. If that fails, the rest of the
+ * chain goes back to the bucket.
+ **/
+static HashMapStatus chainMergeInto(HashMap* dst, HashMap* src, value_combine_func_t combine)
+{
+	// entries are only relinked if both maps take them from the same place
+	int relink = !dst->cuckoo && sameAllocator(&dst->allocator, &src->allocator);
+	while (isSmall(src) && src->num_elements)
+	{
+		SmallEntry* last = &src->small[src->num_elements - 1];
+		Entry* entry = NULL;
+		if (HASH_MAP_SUCCESS != mergePair(dst, last->key, last->value, &entry, combine))
+		{
+			return HASH_MAP_MEM_ERROR;
+		}
+		--src->num_elements;
+	}
+	for (size_t i = 0; i < src->num_buckets; ++i)
+	{
+		Bucket* bucket = src->buckets[i];
+		treeDestroy(bucket->root, &src->allocator);
+		bucket->root = NULL;
+		Entry* itr = bucket->dummy->next;
+		bucket->dummy->next = NULL;
+
+		while (itr)
+		{
+			Entry* next = itr->next;
+			Entry* entry = relink ? itr : NULL;
+			itr->next = NULL;
+			if (HASH_MAP_SUCCESS != mergePair(dst, itr->key, itr->value, &entry, combine))
+			{
+				itr->next = next;
+				bucket->dummy->next = itr;
+				for (bucket->length = 0; itr; itr = itr->next) ++bucket->length;
+				if (bucket->length > TREEIFY_THRESHOLD)
+				{
+					treeify(src, bucket);
+				}
+				return HASH_MAP_MEM_ERROR;
+			}
+			if (!relink || entry)
+			{
+				dsFree(&src->allocator, itr, sizeof(*itr));
+			}
+			--src->num_elements;
+			itr = next;
+		}
+		bucket->length = 0;
+	}
+	return HASH_MAP_SUCCESS;
+}
+
+static HashMapStatus cuckooMergeInto(HashMap* dst, HashMap* src, value_combine_func_t combine)
+{
+	CuckooTable* table = &src->cuckoo_table;
+	for (size_t i = 0; i < table->num_buckets; ++i)
+	{
+		CuckooBucket* bucket = &table->buckets[i];
+		for (size_t slot = 0; slot < CUCKOO_SLOTS; ++slot)
+		{
+			if (!bucket->tags[slot]) continue;
+
+			Entry* entry = NULL;
+			if (HASH_MAP_SUCCESS != mergePair(dst, bucket->keys[slot],
+							  table->values[i * CUCKOO_SLOTS + slot],
+							  &entry, combine))
+			{
+				return HASH_MAP_MEM_ERROR;
+			}
+			bucket->tags[slot] = 0;
+			--src->num_elements;
+		}
+	}
+
+	CuckooOverflow* overflow = &src->cuckoo_overflow;
+	while (overflow->count)
+	{
+		CuckooOverflowEntry* last = &overflow->entries[overflow->count - 1];
+		Entry* entry = NULL;
+		if (HASH_MAP_SUCCESS != mergePair(dst, last->key, last->value, &entry, combine))
+		{
+			return HASH_MAP_MEM_ERROR;
+		}
+		--overflow->count;
+		--src->num_elements;
+	}
+	return HASH_MAP_SUCCESS;
+}
+
+HashMapStatus hashMapMerge(HashMap* dst, HashMap* src, value_combine_func_t combine)
+{
+	if (dst == src) return HASH_MAP_SUCCESS;
+
+	// grow once for the union, rather than once per doubling along the way
+	// (a small dst leaves small mode first, if the union doesn't fit in it)
+	size_t total = dst->num_elements + src->num_elements;
+	while (!dst->cuckoo &&
+	       total > (isSmall(dst) ? SMALL_MAP_CAPACITY : dst->num_buckets * DEFAULT_LOAD_FACTOR) &&
+	       HASH_MAP_SUCCESS == resizeHashMap(dst));
+
+	HashMapStatus status = src->cuckoo ? cuckooMergeInto(dst, src, combine)
+					   : chainMergeInto(dst, src, combine);
+	updateLoadFactor(src);
+	if (HASH_MAP_SUCCESS == status && src->bloom_filter)
+	{
+		bloomFilterClear(src->bloom_filter);
+	}
+	return status;
+}
+
+
+size_t hashMapPartition(const HashMap* map, const void* key, size_t partitions)
+{
+	// unseeded, so that every map puts a key in the same partition. the
+	// maps still place the keys of a partition by their own seeded hashes
+	uint64_t hash = hashSeedMix(map->key_hash_func(key, SIZE_MAX));
+	return (size_t)(((unsigned __int128)hash * partitions) >> 64);
+}
+
+typedef struct
+{
+	HashMap** shards;
+	size_t workers;
+	size_t partitions;
+	size_t partition;
+	value_combine_func_t combine;
+	HashMapStatus status;
+} PartitionMerge;
+
+static void mergePartition(void* arg)
+{
+	PartitionMerge* merge = arg;
+	HashMap* dst = merge->shards[merge->partition];
+	merge->status = HASH_MAP_SUCCESS;
+	for (size_t worker = 1; worker < merge->workers && HASH_MAP_SUCCESS == merge->status; ++worker)
+	{
+		HashMap* src = merge->shards[worker * merge->partitions + merge->partition];
+		merge->status = hashMapMerge(dst, src, merge->combine);
+	}
+}
+
+HashMapStatus hashMapMergePartitions(Executor* executor, HashMap** shards, size_t workers,
+				     size_t partitions, value_combine_func_t combine)
+{
+	if (!partitions) return HASH_MAP_SUCCESS;
+	if (partitions > SIZE_MAX / sizeof(PartitionMerge)) return HASH_MAP_MEM_ERROR;
+
+	PartitionMerge* merges = malloc(partitions * sizeof(*merges));
+	if (!merges) return HASH_MAP_MEM_ERROR;
+
+	ExecutorTaskGroup group;
+	executorTaskGroupInit(&group);
+	for (size_t i = 0; i < partitions; ++i)
+	{
+		PartitionMerge merge = {shards, workers, partitions, i, combine, HASH_MAP_SUCCESS};
+		merges[i] = merge;
+		if (EXECUTOR_SUCCESS != executorSpawn(executor, &group, mergePartition, &merges[i]))
+		{
+			mergePartition(&merges[i]);
+		}
+	}
+	executorJoin(executor, &group);
+
+	HashMapStatus status = HASH_MAP_SUCCESS;
+	for (size_t i = 0; i < partitions; ++i)
+	{
+		if (HASH_MAP_SUCCESS != merges[i].status) status = merges[i].status;
+	}
+	free(merges);
+	return status;
+}
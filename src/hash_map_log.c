@@ -0,0 +1,984 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hash_map_log.h"
+
+#define LOG_MAGIC "DSMAPLOG"
+#define SNAPSHOT_MAGIC "DSMAPSNP"
+#define SNAPSHOT_NAME "snapshot"
+#define SNAPSHOT_TEMP_NAME "snapshot.tmp"
+#define LOG_NAME_DIGITS 20
+#define LOG_NAME_SUFFIX ".log"
+
+#define RECORD_INSERT 1
+#define RECORD_REMOVE 2
+
+// a type byte and the key size precede the key and value bytes
+#define PAYLOAD_PREFIX (1 + sizeof(uint32_t))
+
+#define DEFAULT_SYNC_INTERVAL_MS 100
+#define DEFAULT_BUFFER_SIZE (64 * 1024)
+#define DEFAULT_COMPACT_SIZE (64 * 1024 * 1024)
+
+/**
+ * Starts both log files and snapshots. A log file's sequence number is the
+ * one in its name; a snapshot's is the one of the last log file folded in.
+ **/
+typedef struct
+{
+	char magic[8];
+	uint64_t sequence;
+} LogFileHeader;
+
+/**
+ * Starts a record, and covers its payload: the type, the key size, the key,
+ * and the value (removals have none).
+ **/
+typedef struct
+{
+	uint32_t size;		// of the payload
+	uint32_t checksum;	// of the payload
+} RecordHeader;
+
+typedef struct
+{
+	int type;
+	const char* key;
+	size_t key_size;
+	const char* value;
+	size_t value_size;
+	const char* bytes;	// the whole record, header included
+	size_t size;
+} Record;
+
+typedef struct
+{
+	char* data;
+	size_t size;
+	size_t capacity;
+} LogBuffer;
+
+struct hash_map_log
+{
+	HashMap* map;
+	HashMapEntryHandlers handlers;
+	HashMapSerializers serializers;
+	HashMapLogOptions options;
+	char* directory;
+	size_t file_size;	// of the current log file, buffered records included
+
+	pthread_mutex_t lock;	// guards the fields up to the writer
+	pthread_cond_t changed;	// a batch was handed over or written, or stop is set
+	LogBuffer active;	// records appended by updates
+	LogBuffer pending;	// the batch being written; empty while the writer idles
+	int writing;		// the writer is using fd, with the lock dropped
+	int fd;			// the current log file
+	uint64_t sequence;	// its sequence number
+	atomic_int failed;	// writing the log failed
+	int stop;
+	pthread_t writer;
+
+	pthread_t compactor;
+	int compacting;		// compactor is yet to be joined
+	uint64_t compact_sequence;	// the last log file to compact
+	atomic_int compacted;	// compactor is done
+};
+
+typedef int (*record_func_t)(const Record* record, void* params);
+
+typedef enum
+{
+	READ_OK,
+	READ_MISSING,	// the file doesn't exist
+	READ_TRUNCATED,	// the records end with a partial or corrupt one
+	READ_FAILED
+} ReadResult;
+
+
+HashMapLogOptions hashMapLogDefaultOptions(void)
+{
+	HashMapLogOptions options = {HASH_MAP_LOG_SYNC_PERIODIC,
+				     DEFAULT_SYNC_INTERVAL_MS,
+				     DEFAULT_BUFFER_SIZE,
+				     DEFAULT_COMPACT_SIZE};
+	return options;
+}
+
+
+/**
+ * FNV-1a. Records are checked for torn writes, not for tampering.
+ **/
+static uint32_t checksum(const unsigned char* data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Returns directory/name in a new string, or NULL.
+ **/
+static char* joinPath(const char* directory, const char* name)
+{
+	size_t size = strlen(directory) + strlen(name) + 2;
+	char* path = malloc(size);
+	if (path)
+	{
+		snprintf(path, size, "%s/%s", directory, name);
+	}
+	return path;
+}
+
+static char* logFilePath(const char* directory, uint64_t sequence)
+{
+	char name[LOG_NAME_DIGITS + sizeof(LOG_NAME_SUFFIX)];
+	snprintf(name, sizeof(name), "%0*llu" LOG_NAME_SUFFIX, LOG_NAME_DIGITS,
+		 (unsigned long long)sequence);
+	return joinPath(directory, name);
+}
+
+static int syncDirectory(const char* directory)
+{
+	int fd = open(directory, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return 0;
+	int ok = 0 == fsync(fd);
+	close(fd);
+	return ok;
+}
+
+static int writeAll(int fd, const char* data, size_t size)
+{
+	while (size)
+	{
+		ssize_t written = write(fd, data, size);
+		if (written < 0)
+		{
+			if (EINTR == errno) continue;
+			return 0;
+		}
+		data += written;
+		size -= written;
+	}
+	return 1;
+}
+
+static int compareSequences(const void* a, const void* b)
+{
+	uint64_t first = *(const uint64_t*)a;
+	uint64_t second = *(const uint64_t*)b;
+	return (first > second) - (first < second);
+}
+
+/**
+ * Collects the sequence numbers of the log files in directory, in ascending
+ * order, into a new array. Returns 0 on failure.
+ **/
+static int listLogFiles(const char* directory, uint64_t** sequences, size_t* count)
+{
+	DIR* dir = opendir(directory);
+	if (!dir) return 0;
+
+	size_t capacity = 16;
+	*count = 0;
+	*sequences = malloc(capacity * sizeof(**sequences));
+	int ok = NULL != *sequences;
+
+	struct dirent* entry;
+	while (ok && (entry = readdir(dir)))
+	{
+		const char* name = entry->d_name;
+		size_t digits = strspn(name, "0123456789");
+		if (LOG_NAME_DIGITS != digits || strcmp(name + digits, LOG_NAME_SUFFIX))
+		{
+			continue;
+		}
+
+		if (*count == capacity)
+		{
+			uint64_t* grown = realloc(*sequences, 2 * capacity * sizeof(**sequences));
+			if (!grown)
+			{
+				ok = 0;
+				break;
+			}
+			*sequences = grown;
+			capacity *= 2;
+		}
+		(*sequences)[(*count)++] = strtoull(name, NULL, 10);
+	}
+	closedir(dir);
+
+	if (!ok)
+	{
+		free(*sequences);
+		return 0;
+	}
+	qsort(*sequences, *count, sizeof(**sequences), compareSequences);
+	return 1;
+}
+
+/**
+ * Calls func on the records of the file at path, in order, and stores the
+ * file's sequence number in sequence, and in valid_size the size up to the
+ * last record that was read whole. Stops with READ_FAILED when func returns
+ * 0. A file with a partial or foreign header has no valid size.
+ **/
+static ReadResult readRecords(const char* path, const char* magic, uint64_t* sequence,
+			      record_func_t func, void* params, size_t* valid_size)
+{
+	*valid_size = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return ENOENT == errno ? READ_MISSING : READ_FAILED;
+
+	struct stat st;
+	if (fstat(fd, &st))
+	{
+		close(fd);
+		return READ_FAILED;
+	}
+	size_t size = st.st_size;
+	if (size < sizeof(LogFileHeader))
+	{
+		close(fd);
+		return READ_TRUNCATED;
+	}
+
+	// one mapping instead of a read per record: replay is bound by the
+	// map, not by copying the file around
+	const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (MAP_FAILED == data) return READ_FAILED;
+	madvise((void*)data, size, MADV_SEQUENTIAL);
+
+	LogFileHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, magic, sizeof(header.magic)))
+	{
+		munmap((void*)data, size);
+		return READ_TRUNCATED;
+	}
+	*sequence = header.sequence;
+
+	ReadResult result = READ_OK;
+	size_t offset = sizeof(header);
+	while (offset < size)
+	{
+		RecordHeader record_header;
+		if (size - offset < sizeof(record_header))
+		{
+			result = READ_TRUNCATED;
+			break;
+		}
+		memcpy(&record_header, data + offset, sizeof(record_header));
+		const unsigned char* payload = (const unsigned char*)data + offset
+					       + sizeof(record_header);
+		if (record_header.size < PAYLOAD_PREFIX ||
+		    record_header.size > size - offset - sizeof(record_header) ||
+		    record_header.checksum != checksum(payload, record_header.size))
+		{
+			result = READ_TRUNCATED;
+			break;
+		}
+
+		uint32_t key_size;
+		memcpy(&key_size, payload + 1, sizeof(key_size));
+		Record record;
+		record.type = payload[0];
+		record.key = (const char*)payload + PAYLOAD_PREFIX;
+		record.key_size = key_size;
+		record.value = record.key + key_size;
+		record.value_size = record_header.size - PAYLOAD_PREFIX - key_size;
+		record.bytes = data + offset;
+		record.size = sizeof(record_header) + record_header.size;
+		if (key_size > record_header.size - PAYLOAD_PREFIX ||
+		    (RECORD_INSERT != record.type && RECORD_REMOVE != record.type))
+		{
+			result = READ_TRUNCATED;
+			break;
+		}
+
+		if (!func(&record, params))
+		{
+			result = READ_FAILED;
+			break;
+		}
+		offset += record.size;
+		*valid_size = offset;
+	}
+	if (sizeof(header) == offset)
+	{
+		*valid_size = offset;
+	}
+
+	munmap((void*)data, size);
+	return result;
+}
+
+/**
+ * Creates the log file with the given sequence number, durably, and returns
+ * its descriptor, or -1.
+ **/
+static int createLogFile(const char* directory, uint64_t sequence)
+{
+	char* path = logFilePath(directory, sequence);
+	if (!path) return -1;
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+	free(path);
+	if (fd < 0) return -1;
+
+	LogFileHeader header;
+	memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+	header.sequence = sequence;
+	if (!writeAll(fd, (const char*)&header, sizeof(header)) || fsync(fd) ||
+	    !syncDirectory(directory))
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+typedef struct
+{
+	HashMap* map;
+	HashMapEntryHandlers handlers;
+	HashMapSerializers serializers;
+} Replay;
+
+/**
+ * A record as bytes, for compaction, which only deserializes keys.
+ * The bytes follow the struct.
+ **/
+typedef struct
+{
+	size_t size;
+	const char* bytes;
+} Blob;
+
+static Blob* blobCreate(const char* bytes, size_t size)
+{
+	Blob* blob = malloc(sizeof(Blob) + size);
+	if (blob)
+	{
+		char* copy = (char*)(blob + 1);
+		memcpy(copy, bytes, size);
+		blob->size = size;
+		blob->bytes = copy;
+	}
+	return blob;
+}
+
+static void freeBlob(void* blob)
+{
+	free(blob);
+}
+
+/**
+ * Keeps the last record of every key: its key maps to the whole record.
+ * Keys are matched the way the map matches them, since keys it takes as
+ * equal may serialize to different bytes.
+ **/
+static int foldRecord(const Record* record, void* params)
+{
+	Replay* fold = params;
+	void* key = fold->serializers.key_deserialize(record->key, record->key_size);
+	if (!key) return 0;
+
+	if (RECORD_REMOVE == record->type)
+	{
+		hashMapRemove(fold->map, key);
+		fold->handlers.key_free(key);
+		return 1;
+	}
+
+	Blob* bytes = blobCreate(record->bytes, record->size);
+	if (!bytes || HASH_MAP_SUCCESS != hashMapInsertOwned(fold->map, key, bytes))
+	{
+		fold->handlers.key_free(key);
+		free(bytes);
+		return 0;
+	}
+	return 1;
+}
+
+typedef struct
+{
+	FILE* file;
+	int ok;
+} SnapshotWriter;
+
+static void writeRecord(void* value, void* params)
+{
+	const Blob* record = value;
+	SnapshotWriter* writer = params;
+	writer->ok &= 1 == fwrite(record->bytes, record->size, 1, writer->file);
+}
+
+/**
+ * Writes the live pairs to a new snapshot, which replaces the old one once
+ * it is on disk.
+ **/
+static int writeSnapshot(const char* directory, HashMap* live, uint64_t sequence)
+{
+	char* temp_path = joinPath(directory, SNAPSHOT_TEMP_NAME);
+	char* path = joinPath(directory, SNAPSHOT_NAME);
+	FILE* file = temp_path && path ? fopen(temp_path, "wb") : NULL;
+	int ok = NULL != file;
+	if (file)
+	{
+		setvbuf(file, NULL, _IOFBF, DEFAULT_BUFFER_SIZE);
+		LogFileHeader header;
+		memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+		header.sequence = sequence;
+		SnapshotWriter writer = {file, 1 == fwrite(&header, sizeof(header), 1, file)};
+		hashMapForEach(live, writeRecord, &writer);
+
+		ok = writer.ok && 0 == fflush(file) && 0 == fsync(fileno(file));
+		ok &= 0 == fclose(file);
+		ok = ok && 0 == rename(temp_path, path) && syncDirectory(directory);
+		if (!ok)
+		{
+			unlink(temp_path);
+		}
+	}
+	free(temp_path);
+	free(path);
+	return ok;
+}
+
+/**
+ * Folds the snapshot and the log files up to sequence into a new snapshot,
+ * and deletes those log files. Nothing is deleted unless the new snapshot
+ * made it to the disk, so a failure leaves the directory as it was.
+ * Only the immutable fields of log are read, and of its map, the key
+ * functions.
+ **/
+static void compactFiles(const HashMapLog* log, uint64_t sequence)
+{
+	const char* directory = log->directory;
+	HashMapEntryHandlers handlers = {NULL, log->handlers.key_free, NULL, freeBlob};
+	HashMap* live = hashMapInitLike(log->map, handlers);
+	Replay fold = {live, log->handlers, log->serializers};
+	uint64_t* sequences = NULL;
+	size_t count = 0;
+	int ok = live && listLogFiles(directory, &sequences, &count);
+
+	// log files that the snapshot covers, but that weren't deleted, would
+	// bring back older values
+	uint64_t covered = 0;
+	size_t valid_size;
+	char* path = ok ? joinPath(directory, SNAPSHOT_NAME) : NULL;
+	if (path)
+	{
+		ReadResult result = readRecords(path, SNAPSHOT_MAGIC, &covered, foldRecord,
+						&fold, &valid_size);
+		ok = READ_OK == result || READ_MISSING == result;
+	}
+	ok = ok && path;
+	free(path);
+
+	for (size_t i = 0; ok && i < count && sequences[i] <= sequence; ++i)
+	{
+		if (sequences[i] <= covered) continue;
+
+		uint64_t file_sequence;
+		path = logFilePath(directory, sequences[i]);
+		ok = path && READ_FAILED != readRecords(path, LOG_MAGIC, &file_sequence,
+							foldRecord, &fold, &valid_size);
+		free(path);
+	}
+
+	if (ok && writeSnapshot(directory, live, sequence))
+	{
+		for (size_t i = 0; i < count && sequences[i] <= sequence; ++i)
+		{
+			path = logFilePath(directory, sequences[i]);
+			if (path)
+			{
+				unlink(path);
+			}
+			free(path);
+		}
+	}
+	free(sequences);
+	hashMapDestroy(live);
+}
+
+static void* compactorMain(void* arg)
+{
+	HashMapLog* log = arg;
+	compactFiles(log, log->compact_sequence);
+	atomic_store(&log->compacted, 1);
+	return NULL;
+}
+
+
+static struct timespec deadlineAfter(unsigned ms)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += (long)(ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000;
+	}
+	return deadline;
+}
+
+/**
+ * Hands the active buffer to the writer. Called with the lock held, and
+ * pending empty.
+ **/
+static void swapBuffers(HashMapLog* log)
+{
+	LogBuffer empty = log->pending;
+	log->pending = log->active;
+	log->active = empty;
+	pthread_cond_broadcast(&log->changed);
+}
+
+/**
+ * Writes out the batches handed over by updates, and under the periodic
+ * policy, whatever was buffered every sync interval, followed by a sync.
+ * The lock is dropped while writing, so that updates keep appending.
+ **/
+static void* writerMain(void* arg)
+{
+	HashMapLog* log = arg;
+	int periodic = HASH_MAP_LOG_SYNC_PERIODIC == log->options.sync_policy;
+	int unsynced = 0;
+	struct timespec deadline = deadlineAfter(log->options.sync_interval_ms);
+
+	pthread_mutex_lock(&log->lock);
+	while (!log->stop)
+	{
+		int sync = 0;
+		if (!log->pending.size)
+		{
+			if (!periodic)
+			{
+				pthread_cond_wait(&log->changed, &log->lock);
+				continue;
+			}
+			if (ETIMEDOUT != pthread_cond_timedwait(&log->changed, &log->lock,
+								&deadline))
+			{
+				continue;
+			}
+			deadline = deadlineAfter(log->options.sync_interval_ms);
+			if (!log->active.size && !unsynced) continue;
+			swapBuffers(log);
+			sync = 1;
+		}
+
+		// a periodic sync may have no batch at all, so fd is held by
+		// writing rather than by pending.size
+		LogBuffer batch = log->pending;
+		int fd = log->fd;
+		log->writing = 1;
+		pthread_mutex_unlock(&log->lock);
+		int ok = writeAll(fd, batch.data, batch.size) && (!sync || 0 == fdatasync(fd));
+		pthread_mutex_lock(&log->lock);
+
+		log->writing = 0;
+		unsynced = !sync;
+		if (!ok)
+		{
+			atomic_store(&log->failed, 1);
+		}
+		log->pending.size = 0;
+		pthread_cond_broadcast(&log->changed);
+	}
+	pthread_mutex_unlock(&log->lock);
+	return NULL;
+}
+
+/**
+ * Writes out and syncs everything appended so far, once the writer is done
+ * with its batch and the log file. Called with the lock held; until it is
+ * dropped, the log file can be replaced.
+ **/
+static void flushLocked(HashMapLog* log)
+{
+	while (log->pending.size || log->writing)
+	{
+		pthread_cond_wait(&log->changed, &log->lock);
+	}
+	if (!writeAll(log->fd, log->active.data, log->active.size) || fdatasync(log->fd))
+	{
+		atomic_store(&log->failed, 1);
+	}
+	log->active.size = 0;
+}
+
+/**
+ * Makes room for size bytes at the end of the active buffer, handing a full
+ * one to the writer (waiting for it if it is still busy). Records larger
+ * than the buffers get a larger buffer. Called with the lock held.
+ **/
+static int reserve(HashMapLog* log, size_t size)
+{
+	if (log->active.capacity - log->active.size >= size) return 1;
+
+	if (log->active.size)
+	{
+		while (log->pending.size)
+		{
+			pthread_cond_wait(&log->changed, &log->lock);
+		}
+		swapBuffers(log);
+	}
+	if (log->active.capacity >= size) return 1;
+
+	char* data = realloc(log->active.data, size);
+	if (!data) return 0;
+	log->active.data = data;
+	log->active.capacity = size;
+	return 1;
+}
+
+/**
+ * Encodes a record past the end of the active buffer, where the next
+ * commitRecord adds it to the buffer. Keys and values are serialized right
+ * into the buffer, and only serialized again if they didn't fit.
+ * Returns the size of the record, or 0 if it doesn't fit in memory.
+ * Called with the lock held.
+ **/
+static size_t encodeRecord(HashMapLog* log, int type, const void* key, const void* value)
+{
+	const size_t prefix = sizeof(RecordHeader) + PAYLOAD_PREFIX;
+	for (;;)
+	{
+		char* start = log->active.data + log->active.size;
+		size_t room = log->active.capacity - log->active.size;
+
+		size_t key_size = log->serializers.key_serialize(key,
+				room >= prefix ? start + prefix : NULL,
+				room >= prefix ? room - prefix : 0);
+		size_t size = prefix + key_size;
+		if (value)
+		{
+			size += log->serializers.value_serialize(value,
+					room >= size ? start + size : NULL,
+					room >= size ? room - size : 0);
+		}
+		if (key_size > UINT32_MAX || size - sizeof(RecordHeader) > UINT32_MAX) return 0;
+
+		if (size <= room)
+		{
+			RecordHeader header;
+			unsigned char* payload = (unsigned char*)start + sizeof(header);
+			uint32_t key_size32 = key_size;
+			payload[0] = type;
+			memcpy(payload + 1, &key_size32, sizeof(key_size32));
+			header.size = size - sizeof(header);
+			header.checksum = checksum(payload, header.size);
+			memcpy(start, &header, sizeof(header));
+			return size;
+		}
+		if (!reserve(log, size)) return 0;
+	}
+}
+
+/**
+ * Adds the record encoded last to the buffer, and syncs it if the policy
+ * says so. Called with the lock held.
+ **/
+static HashMapLogStatus commitRecord(HashMapLog* log, size_t size)
+{
+	log->active.size += size;
+	log->file_size += size;
+	if (HASH_MAP_LOG_SYNC_ALWAYS == log->options.sync_policy)
+	{
+		flushLocked(log);
+	}
+	return atomic_load(&log->failed) ? HASH_MAP_LOG_IO_ERROR : HASH_MAP_LOG_SUCCESS;
+}
+
+/**
+ * Starts a compaction once the log file outgrew the limit, unless the last
+ * one is still running, or the log can't be written anyway.
+ **/
+static void compactIfLarge(HashMapLog* log)
+{
+	if (log->options.compact_size && log->file_size >= log->options.compact_size &&
+	    !atomic_load(&log->failed) && (!log->compacting || atomic_load(&log->compacted)))
+	{
+		hashMapLogCompact(log);
+	}
+}
+
+
+static int replayRecord(const Record* record, void* params)
+{
+	Replay* replay = params;
+	void* key = replay->serializers.key_deserialize(record->key, record->key_size);
+	if (!key) return 0;
+
+	if (RECORD_REMOVE == record->type)
+	{
+		hashMapRemove(replay->map, key);
+		replay->handlers.key_free(key);
+		return 1;
+	}
+
+	void* value = replay->serializers.value_deserialize(record->value, record->value_size);
+	if (!value || HASH_MAP_SUCCESS != hashMapInsertOwned(replay->map, key, value))
+	{
+		replay->handlers.key_free(key);
+		if (value)
+		{
+			replay->handlers.value_free(value);
+		}
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Replays the snapshot and the log files after it into the map, and picks
+ * the sequence number of the next log file. Log files that the snapshot
+ * covers (left behind by a crash during compaction) are deleted, and
+ * partial records at the end of log files are cut off.
+ **/
+static int replayDirectory(HashMapLog* log)
+{
+	Replay replay = {log->map, log->handlers, log->serializers};
+	uint64_t covered = 0;
+	size_t valid_size;
+
+	char* path = joinPath(log->directory, SNAPSHOT_TEMP_NAME);
+	if (!path) return 0;
+	unlink(path);
+	free(path);
+
+	path = joinPath(log->directory, SNAPSHOT_NAME);
+	if (!path) return 0;
+	ReadResult result = readRecords(path, SNAPSHOT_MAGIC, &covered, replayRecord, &replay,
+					&valid_size);
+	free(path);
+	// snapshots are synced before they replace the last one
+	if (READ_OK != result && READ_MISSING != result) return 0;
+
+	uint64_t* sequences;
+	size_t count;
+	if (!listLogFiles(log->directory, &sequences, &count)) return 0;
+
+	int ok = 1;
+	log->sequence = covered + 1;
+	for (size_t i = 0; ok && i < count; ++i)
+	{
+		path = logFilePath(log->directory, sequences[i]);
+		if (!path)
+		{
+			ok = 0;
+			break;
+		}
+
+		uint64_t sequence;
+		result = sequences[i] <= covered ? READ_OK
+			 : readRecords(path, LOG_MAGIC, &sequence, replayRecord, &replay,
+				       &valid_size);
+		if (sequences[i] <= covered || (READ_TRUNCATED == result && !valid_size))
+		{
+			unlink(path);
+		}
+		else if (READ_TRUNCATED == result)
+		{
+			ok = 0 == truncate(path, valid_size);
+		}
+		ok &= READ_FAILED != result;
+		free(path);
+
+		if (sequences[i] >= log->sequence)
+		{
+			log->sequence = sequences[i] + 1;
+		}
+	}
+	free(sequences);
+	return ok;
+}
+
+HashMapLog* hashMapLogOpen(HashMap* map, const char* directory,
+			   HashMapEntryHandlers handlers,
+			   HashMapSerializers serializers,
+			   const HashMapLogOptions* options)
+{
+	HashMapLog* log = calloc(1, sizeof(HashMapLog));
+	if (!log) return NULL;
+
+	log->map = map;
+	log->handlers = handlers;
+	log->serializers = serializers;
+	log->options = options ? *options : hashMapLogDefaultOptions();
+	if (!log->options.buffer_size)
+	{
+		log->options.buffer_size = DEFAULT_BUFFER_SIZE;
+	}
+	log->fd = -1;
+	log->directory = strdup(directory);
+	log->active.data = malloc(log->options.buffer_size);
+	log->pending.data = malloc(log->options.buffer_size);
+	log->active.capacity = log->pending.capacity = log->options.buffer_size;
+
+	if (!log->directory || !log->active.data || !log->pending.data ||
+	    (mkdir(directory, 0777) && EEXIST != errno) ||
+	    !replayDirectory(log) ||
+	    (log->fd = createLogFile(directory, log->sequence)) < 0)
+	{
+		goto fail;
+	}
+	log->file_size = sizeof(LogFileHeader);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&log->changed, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_mutex_init(&log->lock, NULL);
+	if (pthread_create(&log->writer, NULL, writerMain, log))
+	{
+		pthread_cond_destroy(&log->changed);
+		pthread_mutex_destroy(&log->lock);
+		goto fail;
+	}
+	return log;
+
+fail:
+	if (log->fd >= 0)
+	{
+		close(log->fd);
+	}
+	free(log->active.data);
+	free(log->pending.data);
+	free(log->directory);
+	free(log);
+	return NULL;
+}
+
+HashMapLogStatus hashMapLogClose(HashMapLog* log)
+{
+	if (!log) return HASH_MAP_LOG_SUCCESS;
+
+	pthread_mutex_lock(&log->lock);
+	flushLocked(log);
+	log->stop = 1;
+	pthread_cond_broadcast(&log->changed);
+	pthread_mutex_unlock(&log->lock);
+	pthread_join(log->writer, NULL);
+	if (log->compacting)
+	{
+		pthread_join(log->compactor, NULL);
+	}
+
+	HashMapLogStatus status = atomic_load(&log->failed) ? HASH_MAP_LOG_IO_ERROR : HASH_MAP_LOG_SUCCESS;
+	if (close(log->fd))
+	{
+		status = HASH_MAP_LOG_IO_ERROR;
+	}
+	pthread_cond_destroy(&log->changed);
+	pthread_mutex_destroy(&log->lock);
+	free(log->active.data);
+	free(log->pending.data);
+	free(log->directory);
+	free(log);
+	return status;
+}
+
+HashMapLogStatus hashMapLogInsert(HashMapLog* log, const void* key, const void* value)
+{
+	// the record is encoded before the map is touched, so that running out
+	// of memory leaves both as they were
+	pthread_mutex_lock(&log->lock);
+	HashMapLogStatus status = HASH_MAP_LOG_MEM_ERROR;
+	size_t size = encodeRecord(log, RECORD_INSERT, key, value);
+	if (size && HASH_MAP_SUCCESS == hashMapInsert(log->map, key, value))
+	{
+		status = commitRecord(log, size);
+	}
+	pthread_mutex_unlock(&log->lock);
+
+	compactIfLarge(log);
+	return status;
+}
+
+HashMapLogStatus hashMapLogRemove(HashMapLog* log, const void* key)
+{
+	if (!hashMapContains(log->map, key))
+	{
+		return atomic_load(&log->failed) ? HASH_MAP_LOG_IO_ERROR : HASH_MAP_LOG_SUCCESS;
+	}
+
+	pthread_mutex_lock(&log->lock);
+	HashMapLogStatus status = HASH_MAP_LOG_MEM_ERROR;
+	size_t size = encodeRecord(log, RECORD_REMOVE, key, NULL);
+	if (size)
+	{
+		hashMapRemove(log->map, key);
+		status = commitRecord(log, size);
+	}
+	pthread_mutex_unlock(&log->lock);
+
+	compactIfLarge(log);
+	return status;
+}
+
+HashMapLogStatus hashMapLogSync(HashMapLog* log)
+{
+	pthread_mutex_lock(&log->lock);
+	flushLocked(log);
+	HashMapLogStatus status = atomic_load(&log->failed) ? HASH_MAP_LOG_IO_ERROR : HASH_MAP_LOG_SUCCESS;
+	pthread_mutex_unlock(&log->lock);
+	return status;
+}
+
+HashMapLogStatus hashMapLogCompact(HashMapLog* log)
+{
+	if (log->compacting)
+	{
+		if (!atomic_load(&log->compacted)) return HASH_MAP_LOG_SUCCESS;
+		pthread_join(log->compactor, NULL);
+		log->compacting = 0;
+	}
+
+	// move on to a new log file, which the compaction leaves alone
+	pthread_mutex_lock(&log->lock);
+	flushLocked(log);
+	int fd = atomic_load(&log->failed) ? -1 : createLogFile(log->directory, log->sequence + 1);
+	if (fd >= 0)
+	{
+		close(log->fd);
+		log->fd = fd;
+		++log->sequence;
+		log->file_size = sizeof(LogFileHeader);
+	}
+	pthread_mutex_unlock(&log->lock);
+	if (fd < 0) return HASH_MAP_LOG_IO_ERROR;
+
+	log->compact_sequence = log->sequence - 1;
+	atomic_store(&log->compacted, 0);
+	if (pthread_create(&log->compactor, NULL, compactorMain, log))
+	{
+		return HASH_MAP_LOG_MEM_ERROR;
+	}
+	log->compacting = 1;
+	return HASH_MAP_LOG_SUCCESS;
+}
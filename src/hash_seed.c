@@ -0,0 +1,33 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/random.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "hash_seed.h"
+
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+static uint64_t process_seed;
+static atomic_uint_least64_t seed_counter;
+
+static void initProcessSeed(void)
+{
+	if ((ssize_t)sizeof(process_seed) !=
+	    getrandom(&process_seed, sizeof(process_seed), GRND_NONBLOCK))
+	{
+		// no entropy yet (early boot): the clock and ASLR are better
+		// than nothing
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		process_seed = ((uint64_t)now.tv_sec << 32) ^ (uint64_t)now.tv_nsec ^
+			(uint64_t)(uintptr_t)&process_seed;
+	}
+}
+
+uint64_t hashSeedCreate(void)
+{
+	pthread_once(&seed_once, initProcessSeed);
+	return hashSeedMix(process_seed +
+			   atomic_fetch_add(&seed_counter, 0x9e3779b97f4a7c15ULL));
+}
@@ -0,0 +1,46 @@
+#ifndef __HASH_SEED_H__
+#define __HASH_SEED_H__
+
+#include <stdint.h>	// uint64_t, SIZE_MAX
+
+#include "hash_map.h"	// key_hash_func_t
+
+/**
+ * The seeded hashing shared by hash maps and hash sets, internal to the
+ * library: every container gets a seed of its own, and places keys by their
+ * seeded full hash (see hashMapInit).
+ **/
+
+/**
+ * The splitmix64 finalizer.
+ **/
+static inline uint64_t hashSeedMix(uint64_t hash)
+{
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111ebULL;
+	hash ^= hash >> 31;
+	return hash;
+}
+
+/**
+ * Returns a new container seed: a random value per process, told apart per
+ * container. Thread-safe.
+ **/
+uint64_t hashSeedCreate(void);
+
+/**
+ * Returns the full (unreduced) hash of key under the given seed.
+ * key_hash_func is asked to reduce into SIZE_MAX buckets, and the result is
+ * combined with the seed and mixed, since all 64 bits need to be well mixed
+ * (and a simple hash, like the identity on integers, isn't).
+ **/
+static inline uint64_t hashSeedFullHash(key_hash_func_t key_hash_func, const void* key,
+					uint64_t seed)
+{
+	return hashSeedMix(key_hash_func(key, SIZE_MAX) ^ seed);
+}
+
+
+#endif // __HASH_SEED_H__
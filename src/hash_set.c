@@ -0,0 +1,332 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hash_seed.h"
+#include "hash_set.h"
+
+#define SET_EMPTY 0
+#define SET_DELETED 1
+#define SET_MIN_CAPACITY 16	// a power of two
+
+struct hash_set
+{
+	uint8_t* tags;		// SET_EMPTY, SET_DELETED, or the tag of the slot's key
+	void** keys;
+	size_t capacity;	// a power of two
+	size_t size;
+	size_t deleted;		// slots marked SET_DELETED
+	key_hash_func_t key_hash_func;
+	key_cmp_func_t key_cmp_func;
+	key_copy_func_t key_copy;
+	key_free_func_t key_free;
+	DsAllocator allocator;	// the set and its arrays
+	uint64_t seed;
+};
+
+/**
+ * The seeded full hash of key, as maps compute it.
+ **/
+static uint64_t setHash(const HashSet* set, const void* key)
+{
+	return hashSeedFullHash(set->key_hash_func, key, set->seed);
+}
+
+/**
+ * The top 7 bits of the hash (the low ones pick the slot), with the high bit
+ * set so that tags never look like an empty or deleted slot.
+ **/
+static uint8_t setTag(uint64_t hash)
+{
+	return (uint8_t)(hash >> 57) | 0x80;
+}
+
+/**
+ * Returns 1 if used slots (keys and deleted slots) leave capacity slots
+ * at most 7/8 full, which keeps probe sequences short and ensures they end.
+ **/
+static int setFits(size_t capacity, size_t used)
+{
+	return used <= capacity - capacity / 8;
+}
+
+static void setFreeArrays(const DsAllocator* allocator, uint8_t* tags, void** keys,
+			  size_t capacity)
+{
+	dsFree(allocator, tags, capacity);
+	dsFree(allocator, keys, capacity * sizeof(void*));
+}
+
+/**
+ * Returns the slot of key, or SIZE_MAX if key isn't in the set.
+ **/
+static size_t setFind(const HashSet* set, const void* key, uint64_t hash)
+{
+	size_t mask = set->capacity - 1;
+	uint8_t tag = setTag(hash);
+	for (size_t i = hash & mask; ; i = (i + 1) & mask)
+	{
+		if (SET_EMPTY == set->tags[i]) return SIZE_MAX;
+		if (tag == set->tags[i] && 0 == set->key_cmp_func(key, set->keys[i])) return i;
+	}
+}
+
+/**
+ * Puts a key that isn't in the set in the first free slot of its probe
+ * sequence. There must be room for it (see setReserve).
+ **/
+static void setPlace(HashSet* set, void* key, uint64_t hash)
+{
+	size_t mask = set->capacity - 1;
+	size_t i = hash & mask;
+	while (set->tags[i] & 0x80)
+	{
+		i = (i + 1) & mask;
+	}
+	if (SET_DELETED == set->tags[i]) --set->deleted;
+	set->tags[i] = setTag(hash);
+	set->keys[i] = key;
+	++set->size;
+}
+
+/**
+ * Moves the keys into new arrays of the given capacity, which drops the
+ * deleted slots. On failure, the set is left as it was.
+ **/
+static HashMapStatus setRehash(HashSet* set, size_t capacity)
+{
+	uint8_t* tags = dsAlloc(&set->allocator, capacity);
+	void** keys = dsAlloc(&set->allocator, capacity * sizeof(void*));
+	if (!tags || !keys)
+	{
+		setFreeArrays(&set->allocator, tags, keys, capacity);
+		return HASH_MAP_MEM_ERROR;
+	}
+	memset(tags, SET_EMPTY, capacity);
+
+	uint8_t* old_tags = set->tags;
+	void** old_keys = set->keys;
+	size_t old_capacity = set->capacity;
+	set->tags = tags;
+	set->keys = keys;
+	set->capacity = capacity;
+	set->size = 0;
+	set->deleted = 0;
+	for (size_t i = 0; i < old_capacity; ++i)
+	{
+		if (old_tags[i] & 0x80)
+		{
+			setPlace(set, old_keys[i], setHash(set, old_keys[i]));
+		}
+	}
+	setFreeArrays(&set->allocator, old_tags, old_keys, old_capacity);
+	return HASH_MAP_SUCCESS;
+}
+
+/**
+ * Makes room for count more keys. If deleted slots take most of the room,
+ * the set is rehashed at the same capacity; otherwise it grows.
+ **/
+static HashMapStatus setReserve(HashSet* set, size_t count)
+{
+	if (setFits(set->capacity, set->size + set->deleted + count)) return HASH_MAP_SUCCESS;
+
+	// leave half of the room free, so that rehashes stay amortized however
+	// keys come and go
+	size_t capacity = set->capacity;
+	while (!setFits(capacity, 2 * (set->size + count)))
+	{
+		capacity *= 2;
+	}
+	return setRehash(set, capacity);
+}
+
+/**
+ * Frees the key in slot i and frees the slot. The slot only needs to stay
+ * marked deleted if a probe sequence may go on past it.
+ **/
+static void setRemoveAt(HashSet* set, size_t i)
+{
+	set->key_free(set->keys[i]);
+	if (SET_EMPTY == set->tags[(i + 1) & (set->capacity - 1)])
+	{
+		set->tags[i] = SET_EMPTY;
+	}
+	else
+	{
+		set->tags[i] = SET_DELETED;
+		++set->deleted;
+	}
+	--set->size;
+}
+
+HashSet* hashSetInit(key_hash_func_t key_hash_func,
+		     key_cmp_func_t key_cmp_func,
+		     key_copy_func_t key_copy,
+		     key_free_func_t key_free)
+{
+	return hashSetInitWithAllocator(key_hash_func, key_cmp_func, key_copy, key_free, NULL);
+}
+
+HashSet* hashSetInitWithAllocator(key_hash_func_t key_hash_func,
+				  key_cmp_func_t key_cmp_func,
+				  key_copy_func_t key_copy,
+				  key_free_func_t key_free,
+				  const DsAllocator* allocator)
+{
+	assert (key_hash_func);
+	assert (key_cmp_func);
+
+	if (!allocator) allocator = dsDefaultAllocator();
+
+	HashSet* set = dsAlloc(allocator, sizeof(*set));
+	if (!set) return NULL;
+
+	memset(set, 0, sizeof(*set));
+	set->allocator = *allocator;
+	set->key_hash_func = key_hash_func;
+	set->key_cmp_func = key_cmp_func;
+	set->key_copy = key_copy;
+	set->key_free = key_free;
+	set->seed = hashSeedCreate();
+	set->capacity = SET_MIN_CAPACITY;
+	set->tags = dsAlloc(&set->allocator, set->capacity);
+	set->keys = dsAlloc(&set->allocator, set->capacity * sizeof(void*));
+	if (!set->tags || !set->keys)
+	{
+		hashSetDestroy(set);
+		return NULL;
+	}
+	memset(set->tags, SET_EMPTY, set->capacity);
+	return set;
+}
+
+void hashSetClear(HashSet* set)
+{
+	for (size_t i = 0; i < set->capacity; ++i)
+	{
+		if (set->tags[i] & 0x80)
+		{
+			set->key_free(set->keys[i]);
+		}
+	}
+	memset(set->tags, SET_EMPTY, set->capacity);
+	set->size = 0;
+	set->deleted = 0;
+}
+
+void hashSetDestroy(HashSet* set)
+{
+	if (!set) return;
+	if (set->tags && set->keys)
+	{
+		hashSetClear(set);
+	}
+	setFreeArrays(&set->allocator, set->tags, set->keys, set->capacity);
+
+	DsAllocator allocator = set->allocator;
+	dsFree(&allocator, set, sizeof(*set));
+}
+
+HashMapStatus hashSetAdd(HashSet* set, const void* key)
+{
+	uint64_t hash = setHash(set, key);
+	if (SIZE_MAX != setFind(set, key, hash)) return HASH_MAP_SUCCESS;
+
+	// make room first: a failed growth leaves nothing to undo
+	if (HASH_MAP_SUCCESS != setReserve(set, 1)) return HASH_MAP_MEM_ERROR;
+	void* new_key = set->key_copy(key);
+	if (!new_key) return HASH_MAP_MEM_ERROR;
+	setPlace(set, new_key, hash);
+	return HASH_MAP_SUCCESS;
+}
+
+int hashSetContains(const HashSet* set, const void* key)
+{
+	return SIZE_MAX != setFind(set, key, setHash(set, key));
+}
+
+void hashSetRemove(HashSet* set, const void* key)
+{
+	size_t i = setFind(set, key, setHash(set, key));
+	if (SIZE_MAX != i)
+	{
+		setRemoveAt(set, i);
+	}
+}
+
+size_t hashSetSize(const HashSet* set)
+{
+	return set->size;
+}
+
+void hashSetForEach(const HashSet* set, set_for_each_func_t func, void* params)
+{
+	for (size_t i = 0; i < set->capacity; ++i)
+	{
+		if (set->tags[i] & 0x80)
+		{
+			func(set->keys[i], params);
+		}
+	}
+}
+
+HashMapStatus hashSetUnion(HashSet* dst, const HashSet* src)
+{
+	if (dst == src) return HASH_MAP_SUCCESS;
+
+	// grow once for the union, rather than once per doubling along the way.
+	// if that fails, the keys are still added one by one
+	setReserve(dst, src->size);
+	for (size_t i = 0; i < src->capacity; ++i)
+	{
+		if (!(src->tags[i] & 0x80)) continue;
+
+		// the sets are seeded apart, so the key is hashed again
+		HashMapStatus status = hashSetAdd(dst, src->keys[i]);
+		if (HASH_MAP_SUCCESS != status) return status;
+	}
+	return HASH_MAP_SUCCESS;
+}
+
+void hashSetIntersection(HashSet* dst, const HashSet* other)
+{
+	if (dst == other) return;
+
+	for (size_t i = 0; i < dst->capacity; ++i)
+	{
+		if ((dst->tags[i] & 0x80) && !hashSetContains(other, dst->keys[i]))
+		{
+			setRemoveAt(dst, i);
+		}
+	}
+}
+
+void hashSetDifference(HashSet* dst, const HashSet* other)
+{
+	if (dst == other)
+	{
+		hashSetClear(dst);
+		return;
+	}
+
+	// walk the smaller set
+	if (other->size < dst->size)
+	{
+		for (size_t i = 0; i < other->capacity; ++i)
+		{
+			if (other->tags[i] & 0x80)
+			{
+				hashSetRemove(dst, other->keys[i]);
+			}
+		}
+		return;
+	}
+	for (size_t i = 0; i < dst->capacity; ++i)
+	{
+		if ((dst->tags[i] & 0x80) && hashSetContains(other, dst->keys[i]))
+		{
+			setRemoveAt(dst, i);
+		}
+	}
+}
@@ -1,31 +1,81 @@
 #include <assert.h>
 #include <malloc.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "linked_list.h"
 
-typedef struct node { 
+// maximal number of index levels above the base list (indexed mode only).
+// nodes are promoted with probability 1/4 per level, so 32 levels are
+// enough for any list that fits in memory
+#define INDEX_MAX_LEVELS 32
+
+struct node;
+
+typedef struct {
+    struct node* next;
+    size_t span; // number of base list steps from the owning node to `next`
+} IndexLink;
+
+typedef struct node {
     void* data;
 
     struct node* next;
     struct node* prev;
 
+    // number of index levels the node takes part in (always 0 for lists
+    // that are not indexed)
+    unsigned height;
+
+    // distance to the header of the NodeBlock the node was carved out of,
+    // or 0 if the node was allocated on its own
+    uint32_t block_offset;
+
+    // forward link on each index level
+    IndexLink links[];
+
 } LinkedListNode;
 
-static LinkedListNode* nodeCreate(void* data) {
-    LinkedListNode* new_node = malloc(sizeof(*new_node));
+// bulk clones carve their nodes out of a single allocation, which is
+// released once the last of its nodes is destroyed. nodes may outlive
+// the list that created them (splice, split), hence the atomic counter
+typedef struct {
+    atomic_size_t live_nodes;
+    size_t bytes;
+} NodeBlock;
+
+// largest block a node can point back to through `block_offset`
+#define NODE_BLOCK_MAX_BYTES ((size_t) UINT32_MAX)
+
+static size_t nodeBytes(unsigned height) {
+    return sizeof(LinkedListNode) + height * sizeof(IndexLink);
+}
+
+static LinkedListNode* nodeCreate(const DsAllocator* allocator, void* data, unsigned height) {
+    LinkedListNode* new_node = dsAlloc(allocator, nodeBytes(height));
     if (new_node) {
         new_node->data = data;
         new_node->next = new_node->prev = NULL;
+        new_node->height = height;
+        new_node->block_offset = 0;
     }
 
     return new_node;
 }
 
-static void nodeDestroy(LinkedListNode* node, free_func_t free_func) {
+static void nodeDestroy(const DsAllocator* allocator, LinkedListNode* node, free_func_t free_func) {
     if (node) {
         if (free_func) free_func(node->data);
-        free(node);
+
+        if (node->block_offset) {
+            NodeBlock* block = (NodeBlock*) ((char*) node - node->block_offset);
+            if (1 == atomic_fetch_sub_explicit(&block->live_nodes, 1, memory_order_acq_rel)) {
+                dsFree(allocator, block, block->bytes);
+            }
+        } else {
+            dsFree(allocator, node, nodeBytes(node->height));
+        }
     }
 }
 
@@ -38,45 +88,315 @@ static void unlink(LinkedListNode* node) {
     node->prev = node->next = NULL;
 }
 
-static void* delete_node(LinkedListNode* node) {
-    void* data = node->data;
+// links the chain [first, last] in front of `position`
+static void link_before(LinkedListNode* position, LinkedListNode* first, LinkedListNode* last) {
+    LinkedListNode* before = position->prev;
 
-    unlink(node); 
-    nodeDestroy(node, NULL);
+    before->next = first;
+    first->prev = before;
 
-    return data;
+    last->next = position;
+    position->prev = last;
 }
 
+// shared clones point to the same nodes (and sentinels). the record counts
+// the lists holding them; a list makes a private copy before its first
+// modification, and the last holder owns the nodes again
+typedef struct {
+    atomic_size_t holders;
+} LinkedListShare;
+
 struct __linked_list {
     LinkedListNode* head;
     LinkedListNode* tail;
+    size_t size;
+
+    // NULL unless the nodes are shared with other lists
+    LinkedListShare* share;
+
+    // indexed mode: the head sentinel owns INDEX_MAX_LEVELS links, of which
+    // the lowest `levels` are in use. `rng` drives the node heights
+    int indexed;
+    unsigned levels;
+    uint64_t rng;
 
     copy_func_t copy;
     cmp_func_t compare;
     free_func_t free;
+
+    // nodes moved between lists keep coming from (and going back to) the
+    // same allocator, so lists exchanging nodes must share it
+    DsAllocator allocator;
 };
 
+// detaches all of the list's nodes from the sentinels.
+// the caller is responsible for the size
+static void reset_sentinels(LinkedList* list) {
+    list->head->next = list->tail;
+    list->tail->prev = list->head;
+    list->levels = 0;
+}
 
-LinkedList* linkedListCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func) {
-    assert(copy_func); assert(free_func); assert(compare_func);
+// draws the number of index levels of a new node (xorshift64)
+static unsigned random_height(LinkedList* list) {
+    uint64_t bits = list->rng;
+    bits ^= bits << 13;
+    bits ^= bits >> 7;
+    bits ^= bits << 17;
+    list->rng = bits;
+
+    unsigned height = 0;
+    while (height < INDEX_MAX_LEVELS && (bits & 3) == 0) {
+        ++height;
+        bits >>= 2;
+    }
+
+    return height;
+}
+
+// the rank of a node is its 1-based position. the head sentinel has rank 0,
+// and the tail sentinel has rank size + 1
+
+// returns the node of the given rank in an indexed list
+static LinkedListNode* index_seek(const LinkedList* list, size_t rank) {
+    LinkedListNode* node_itr = list->head;
+    size_t rank_itr = 0;
 
-    LinkedList* new_list = malloc(sizeof(*new_list));
+    for (unsigned level = list->levels; level-- > 0;) {
+        while (rank_itr + node_itr->links[level].span <= rank) {
+            rank_itr += node_itr->links[level].span;
+            node_itr = node_itr->links[level].next;
+        }
+    }
+
+    for (; rank_itr < rank; ++rank_itr) {
+        node_itr = node_itr->next;
+    }
+
+    return node_itr;
+}
+
+// fills update[level] with the last node of each index level that has a
+// rank of at most `rank`, and ranks[level] with that node's rank
+static void index_find(const LinkedList* list, size_t rank, LinkedListNode** update, size_t* ranks) {
+    LinkedListNode* node_itr = list->head;
+    size_t rank_itr = 0;
+
+    for (unsigned level = list->levels; level-- > 0;) {
+        while (rank_itr + node_itr->links[level].span <= rank) {
+            rank_itr += node_itr->links[level].span;
+            node_itr = node_itr->links[level].next;
+        }
+
+        update[level] = node_itr;
+        ranks[level] = rank_itr;
+    }
+}
+
+// links `node` into an indexed list so that it ends up at `index`
+static void index_link(LinkedList* list, size_t index, LinkedListNode* node) {
+    LinkedListNode* update[INDEX_MAX_LEVELS];
+    size_t ranks[INDEX_MAX_LEVELS];
+    index_find(list, index, update, ranks);
+
+    LinkedListNode* before = list->head;
+    size_t rank_itr = 0;
+    if (list->levels > 0) {
+        before = update[0];
+        rank_itr = ranks[0];
+    }
+
+    for (; rank_itr < index; ++rank_itr) {
+        before = before->next;
+    }
+
+    // open the levels that the new node is the first to reach
+    while (list->levels < node->height) {
+        list->head->links[list->levels].next = list->tail;
+        list->head->links[list->levels].span = list->size + 1;
+        update[list->levels] = list->head;
+        ranks[list->levels] = 0;
+        ++list->levels;
+    }
+
+    for (unsigned level = 0; level < list->levels; ++level) {
+        IndexLink* link = &update[level]->links[level];
+        if (level < node->height) {
+            size_t offset = index - ranks[level];
+
+            node->links[level].next = link->next;
+            node->links[level].span = link->span - offset;
+            link->next = node;
+            link->span = offset + 1;
+        } else {
+            ++link->span;
+        }
+    }
+
+    link_before(before->next, node, node);
+}
+
+// unlinks and returns the node located at `index` in an indexed list
+static LinkedListNode* index_unlink(LinkedList* list, size_t index) {
+    LinkedListNode* update[INDEX_MAX_LEVELS];
+    size_t ranks[INDEX_MAX_LEVELS];
+    index_find(list, index, update, ranks);
+
+    LinkedListNode* node = list->head;
+    size_t rank_itr = 0;
+    if (list->levels > 0) {
+        node = update[0];
+        rank_itr = ranks[0];
+    }
+
+    for (; rank_itr <= index; ++rank_itr) {
+        node = node->next;
+    }
+
+    for (unsigned level = 0; level < list->levels; ++level) {
+        IndexLink* link = &update[level]->links[level];
+        if (link->next == node) {
+            link->span += node->links[level].span - 1;
+            link->next = node->links[level].next;
+        } else {
+            --link->span;
+        }
+    }
+
+    while (list->levels > 0 && list->head->links[list->levels - 1].next == list->tail) {
+        --list->levels;
+    }
+
+    unlink(node);
+
+    return node;
+}
+
+// relinks the index levels of an indexed list from its base list.
+// used after bulk operations that relink whole chains of nodes
+static void rebuild_index(LinkedList* list) {
+    if (!list->indexed) {
+        return;
+    }
+
+    LinkedListNode* last[INDEX_MAX_LEVELS];
+    size_t last_ranks[INDEX_MAX_LEVELS];
+    for (unsigned level = 0; level < INDEX_MAX_LEVELS; ++level) {
+        last[level] = list->head;
+        last_ranks[level] = 0;
+    }
+
+    unsigned levels = 0;
+    size_t rank = 0;
+    LinkedListNode* node_itr = list->head->next;
+    while (node_itr != list->tail) {
+        ++rank;
+        for (unsigned level = 0; level < node_itr->height; ++level) {
+            last[level]->links[level].next = node_itr;
+            last[level]->links[level].span = rank - last_ranks[level];
+            last[level] = node_itr;
+            last_ranks[level] = rank;
+        }
+
+        if (node_itr->height > levels) levels = node_itr->height;
+        node_itr = node_itr->next;
+    }
+
+    for (unsigned level = 0; level < levels; ++level) {
+        last[level]->links[level].next = list->tail;
+        last[level]->links[level].span = list->size + 1 - last_ranks[level];
+    }
+
+    list->levels = levels;
+}
+
+// returns the node located at `index`, or the tail sentinel if `index`
+// is past the last element
+static LinkedListNode* node_at(const LinkedList* list, size_t index) {
+    if (index >= list->size) {
+        return list->tail;
+    }
+
+    if (list->indexed) {
+        return index_seek(list, index + 1);
+    }
+
+    // walk from whichever end is closer
+    LinkedListNode* node_itr;
+    if (index < list->size / 2) {
+        node_itr = list->head->next;
+        for (; index > 0; --index) {
+            node_itr = node_itr->next;
+        }
+    } else {
+        node_itr = list->tail->prev;
+        for (index = list->size - 1 - index; index > 0; --index) {
+            node_itr = node_itr->prev;
+        }
+    }
+
+    return node_itr;
+}
+
+// links `node` into the list so that it ends up at `index` (index <= size)
+static void insert_node(LinkedList* list, size_t index, LinkedListNode* node) {
+    if (list->indexed) {
+        index_link(list, index, node);
+    } else {
+        link_before(node_at(list, index), node, node);
+    }
+
+    ++list->size;
+}
+
+// unlinks the node located at `index` (index < size), and returns its element
+static void* remove_node(LinkedList* list, size_t index) {
+    LinkedListNode* node;
+    if (list->indexed) {
+        node = index_unlink(list, index);
+    } else {
+        node = node_at(list, index);
+        unlink(node);
+    }
+
+    --list->size;
+
+    void* data = node->data;
+    nodeDestroy(&list->allocator, node, NULL);
+
+    return data;
+}
+
+
+static LinkedList* list_create(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func,
+                               int indexed, const DsAllocator* allocator) {
+    if (!allocator) {
+        allocator = dsDefaultAllocator();
+    }
+
+    LinkedList* new_list = dsAlloc(allocator, sizeof(*new_list));
     if (new_list) {
-        new_list->head = nodeCreate(NULL);
+        new_list->allocator = *allocator;
+        new_list->share = NULL;
+        new_list->tail = NULL;
+        new_list->head = nodeCreate(allocator, NULL, indexed ? INDEX_MAX_LEVELS : 0);
         if (NULL == new_list->head) {
             linkedListDestroy(new_list);
             return NULL;
         }
 
-        new_list->tail = nodeCreate(NULL);
+        new_list->tail = nodeCreate(allocator, NULL, 0);
         if (NULL == new_list->tail) {
             linkedListDestroy(new_list);
             return NULL;
         }
 
         // both allocations succeeded
-        new_list->head->next = new_list->tail;
-        new_list->tail->prev = new_list->head;
+        reset_sentinels(new_list);
+        new_list->size = 0;
+
+        new_list->indexed = indexed;
+        new_list->rng = (uint64_t)(uintptr_t) new_list | 1;
 
         new_list->copy = copy_func;
         new_list->free = free_func;
@@ -86,43 +406,198 @@ LinkedList* linkedListCreate(copy_func_t copy_func, free_func_t free_func, cmp_f
     return new_list;
 }
 
-void linkedListDestroy(LinkedList* list) {
-    if (list) {
+LinkedList* linkedListCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func) {
+    return list_create(copy_func, free_func, compare_func, 0, NULL);
+}
+
+LinkedList* linkedListCreateIndexed(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func) {
+    return list_create(copy_func, free_func, compare_func, 1, NULL);
+}
+
+LinkedList* linkedListCreateWithAllocator(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func,
+                                          const DsAllocator* allocator) {
+    return list_create(copy_func, free_func, compare_func, 0, allocator);
+}
+
+LinkedList* linkedListCreateIndexedWithAllocator(copy_func_t copy_func, free_func_t free_func,
+                                                 cmp_func_t compare_func, const DsAllocator* allocator) {
+    return list_create(copy_func, free_func, compare_func, 1, allocator);
+}
+
+// frees the list's nodes (including elements) and sentinels
+static void destroy_nodes(LinkedList* list) {
+    if (list->head && list->tail) {
         LinkedListNode* node_itr = list->head->next;
         while (node_itr != list->tail) {
             LinkedListNode* current = node_itr;
             node_itr = node_itr->next;
 
-            nodeDestroy(current, list->free);
+            nodeDestroy(&list->allocator, current, list->free);
+        }
+    }
+
+    nodeDestroy(&list->allocator, list->head, NULL);
+    nodeDestroy(&list->allocator, list->tail, NULL);
+}
+
+// drops the list's hold on its shared nodes.
+// returns 1 if the list was the last holder, and therefore owns the nodes
+static int release_share(LinkedList* list) {
+    LinkedListShare* share = list->share;
+    list->share = NULL;
+
+    if (1 == atomic_fetch_sub_explicit(&share->holders, 1, memory_order_acq_rel)) {
+        dsFree(&list->allocator, share, sizeof(*share));
+        return 1;
+    }
+
+    return 0;
+}
+
+void linkedListDestroy(LinkedList* list) {
+    if (list) {
+        if (!list->share || release_share(list)) {
+            destroy_nodes(list);
         }
-        
-        nodeDestroy(list->head, NULL);
-        nodeDestroy(list->tail, NULL);
 
-        free(list);
+        DsAllocator allocator = list->allocator;
+        dsFree(&allocator, list, sizeof(*list));
     }
 }
 
+// appends copies of all of `src`'s nodes to the empty list `dst`.
+// the nodes are carved out of as few NodeBlocks as possible (usually one),
+// and keep their index heights
+static LinkedListStatus bulk_copy_nodes(LinkedList* dst, const LinkedList* src) {
+    size_t remaining_bytes = 0;
+    LinkedListNode* src_node_itr = src->head->next;
+    for (; src_node_itr != src->tail; src_node_itr = src_node_itr->next) {
+        remaining_bytes += nodeBytes(src_node_itr->height);
+    }
+
+    NodeBlock* block = NULL;
+    char* cursor = NULL;
+    char* block_end = NULL;
+
+    src_node_itr = src->head->next;
+    for (; src_node_itr != src->tail; src_node_itr = src_node_itr->next) {
+        size_t bytes = nodeBytes(src_node_itr->height);
+        if (!block || (size_t) (block_end - cursor) < bytes) {
+            size_t block_bytes = sizeof(NodeBlock) + remaining_bytes;
+            if (block_bytes > NODE_BLOCK_MAX_BYTES) block_bytes = NODE_BLOCK_MAX_BYTES;
+
+            block = dsAlloc(&dst->allocator, block_bytes);
+            if (!block) {
+                return LINKED_LIST_MEM_ERROR;
+            }
+
+            atomic_init(&block->live_nodes, 0);
+            block->bytes = block_bytes;
+            cursor = (char*) (block + 1);
+            block_end = (char*) block + block_bytes;
+        }
+
+        // lists without a copy function don't own their elements,
+        // so the pointers themselves are copied
+        void* new_element = dst->copy ? dst->copy(src_node_itr->data) : src_node_itr->data;
+        // (NULL is a valid element of such lists, and only a failed copy otherwise)
+        if (!new_element && dst->copy) {
+            if (0 == atomic_load_explicit(&block->live_nodes, memory_order_relaxed)) {
+                dsFree(&dst->allocator, block, block->bytes);
+            }
+            return LINKED_LIST_MEM_ERROR;
+        }
+
+        LinkedListNode* new_node = (LinkedListNode*) cursor;
+        cursor += bytes;
+        remaining_bytes -= bytes;
+
+        new_node->data = new_element;
+        new_node->height = src_node_itr->height;
+        new_node->block_offset = (uint32_t) ((char*) new_node - (char*) block);
+        atomic_fetch_add_explicit(&block->live_nodes, 1, memory_order_relaxed);
+
+        link_before(dst->tail, new_node, new_node);
+        ++dst->size;
+    }
+
+    return LINKED_LIST_SUCCESS;
+}
+
 LinkedList* linkedListClone(const LinkedList* list) {
     assert(list);
+    assert(list->copy || !list->free);
 
-    LinkedList* new_list = linkedListCreate(list->copy, list->free, list->compare);
+    LinkedList* new_list = list_create(list->copy, list->free, list->compare, list->indexed, &list->allocator);
     if (new_list) {
-        LinkedListNode* src_node_itr = list->head->next;
-        while (src_node_itr != list->tail) {
-            if (LINKED_LIST_SUCCESS != linkedListPush(new_list, src_node_itr->data)) {
-                linkedListDestroy(new_list);
-                new_list = NULL;
-                break;
-            }
+        if (LINKED_LIST_SUCCESS != bulk_copy_nodes(new_list, list)) {
+            linkedListDestroy(new_list);
+            return NULL;
+        }
+
+        rebuild_index(new_list);
+    }
+
+    return new_list;
+}
+
+LinkedList* linkedListCloneShared(LinkedList* list) {
+    assert(list);
+    assert(list->copy || !list->free);
 
-            src_node_itr = src_node_itr->next;
+    LinkedList* new_list = dsAlloc(&list->allocator, sizeof(*new_list));
+    if (!new_list) {
+        return NULL;
+    }
+
+    if (!list->share) {
+        list->share = dsAlloc(&list->allocator, sizeof(*list->share));
+        if (!list->share) {
+            dsFree(&list->allocator, new_list, sizeof(*new_list));
+            return NULL;
         }
+
+        atomic_init(&list->share->holders, 1);
     }
 
+    atomic_fetch_add_explicit(&list->share->holders, 1, memory_order_relaxed);
+    *new_list = *list;
+
     return new_list;
 }
 
+// makes sure the list exclusively owns its nodes before it is modified,
+// copying them if they are still shared with other lists
+static LinkedListStatus unshare(LinkedList* list) {
+    if (!list->share) {
+        return LINKED_LIST_SUCCESS;
+    }
+
+    if (1 == atomic_load_explicit(&list->share->holders, memory_order_acquire)) {
+        // every other holder is gone
+        release_share(list);
+        return LINKED_LIST_SUCCESS;
+    }
+
+    LinkedList* copy = linkedListClone(list);
+    if (!copy) {
+        return LINKED_LIST_MEM_ERROR;
+    }
+
+    if (release_share(list)) {
+        // the other holders let go while copying, keep the original nodes
+        linkedListDestroy(copy);
+        return LINKED_LIST_SUCCESS;
+    }
+
+    list->head = copy->head;
+    list->tail = copy->tail;
+    list->levels = copy->levels;
+    dsFree(&list->allocator, copy, sizeof(*copy));
+
+    return LINKED_LIST_SUCCESS;
+}
+
 
 typedef int (*op_func_t)(void* element, void* params);
 
@@ -141,21 +616,10 @@ static int for_each(LinkedList* list, op_func_t op, void* params) {
     return 0;
 }
 
-static int element_counter(void* ignored, void* params) {
-    size_t* counter = params;
-
-    ++(*counter);
-
-    return 0;
-}
-
 size_t linkedListSize(const LinkedList* list) {
     assert(list);
 
-    size_t count = 0;
-    for_each((LinkedList*) list, element_counter, &count);
-
-    return count;
+    return list->size;
 }
 
 
@@ -173,17 +637,17 @@ static int element_finder(void* element, void* params) {
     if (0 == param_pack->compare(element, param_pack->target_value)) {
         return 1;
     }
-    
+
     ++(param_pack->index);
 
     return 0;
 }
 
 ssize_t linkedListIndexOf(const LinkedList* list, const void* element) {
-    assert(list); assert(element);
+    assert(list); assert(element); assert(list->compare);
 
     ElementFinderParams params = {0, element, list->compare};
-    
+
     int result = for_each((LinkedList*) list, element_finder, &params);
     if (result != 0) {
         return params.index;
@@ -192,131 +656,309 @@ ssize_t linkedListIndexOf(const LinkedList* list, const void* element) {
     return -1;
 }
 
-typedef struct {
-    void* target;
-    size_t target_idx;
-    size_t current_idx;
-} ElementFetcherParams;
-
-static int element_fetcher(void* element, void* p) {
-    ElementFetcherParams* params = p;
+void* linkedListGetAt(const LinkedList* list, size_t index) {
+    assert(list);
 
-    if (params->current_idx == params->target_idx) {
-        params->target = element;
-        return 1;
+    LinkedListNode* node = node_at(list, index);
+    if (node == list->tail) {
+        return NULL;
     }
 
-    ++params->current_idx;
-    return 0;
+    return node->data;
 }
 
-void* linkedListGetAt(const LinkedList* list, size_t index) {
-    ElementFetcherParams params = {NULL, index, 0};
+void* linkedListRemoveAt(LinkedList* list, size_t index) {
+    assert(list);
 
-    for_each((LinkedList*) list, element_fetcher, &params);
+    if (index >= list->size || LINKED_LIST_SUCCESS != unshare(list)) {
+        return NULL;
+    }
 
-    return params.target;
+    // delete node and return the pointer to the contained element
+    return remove_node(list, index);
 }
 
-void* linkedListRemoveAt(LinkedList* list, size_t index) {
-    void* element = NULL;
-    LinkedListNode* node_itr = list->head->next;
-    size_t index_itr = 0;
-    while (node_itr != list->tail) {
-        if (index == index_itr) {
-            // delete node and return the pointer to the contained element
-            unlink(node_itr);
-            element = node_itr->data;
-            nodeDestroy(node_itr, NULL);
-
-            break;
-        }
+// links `element` itself at `index`. on failure, the caller keeps ownership
+static LinkedListStatus insert_owned(LinkedList* list, size_t index, void* element) {
+    if (LINKED_LIST_SUCCESS != unshare(list)) {
+        return LINKED_LIST_MEM_ERROR;
+    }
 
-        node_itr = node_itr->next;
-        ++index_itr;
+    unsigned height = list->indexed ? random_height(list) : 0;
+    LinkedListNode* new_node = nodeCreate(&list->allocator, element, height);
+    if (!new_node) {
+        return LINKED_LIST_MEM_ERROR;
     }
 
-    return element;
+    insert_node(list, index, new_node);
+
+    return LINKED_LIST_SUCCESS;
 }
 
-LinkedListStatus linkedListPush(LinkedList* list, const void* element) {
-    assert(list);
+// copies `element` into a new node and links it at `index`
+static LinkedListStatus insert_copy(LinkedList* list, size_t index, const void* element) {
+    assert(list->copy);
 
     void* new_element = list->copy(element);
     if (!new_element) {
         return LINKED_LIST_MEM_ERROR;
     }
 
-    LinkedListNode* new_node = nodeCreate(new_element);
-    if (!new_node) {
+    LinkedListStatus status = insert_owned(list, index, new_element);
+    if (LINKED_LIST_SUCCESS != status && list->free) {
         list->free(new_element);
-        return LINKED_LIST_MEM_ERROR;
     }
 
-    LinkedListNode* before_tail = list->tail->prev;
+    return status;
+}
 
-    before_tail->next = new_node;
-    new_node->prev = before_tail;
+LinkedListStatus linkedListInsertAt(LinkedList* list, size_t index, const void* element) {
+    assert(list);
 
-    list->tail->prev = new_node;
-    new_node->next = list->tail;
+    if (index > list->size) {
+        index = list->size;
+    }
 
-    return LINKED_LIST_SUCCESS;
+    return insert_copy(list, index, element);
+}
+
+LinkedListStatus linkedListPush(LinkedList* list, const void* element) {
+    assert(list);
+
+    return insert_copy(list, list->size, element);
+}
+
+LinkedListStatus linkedListPushOwned(LinkedList* list, void* element) {
+    assert(list);
+
+    return insert_owned(list, list->size, element);
 }
 
 
 void* linkedListPop(LinkedList* list) {
     assert(list);
 
-    if (list->head->next == list->tail) {
+    if (0 == list->size || LINKED_LIST_SUCCESS != unshare(list)) {
         // list is empty
         return NULL;
     }
 
-    LinkedListNode* to_delete = list->tail->prev;
-    void* data = delete_node(to_delete);
+    return remove_node(list, list->size - 1);
+}
+
+LinkedListStatus linkedListPushFront(LinkedList* list, const void* element) {
+    assert(list);
 
-   return data; 
+    return insert_copy(list, 0, element);
 }
 
-LinkedListStatus linkedListPushFront(LinkedList* list, void* element) {
+LinkedListStatus linkedListPushFrontOwned(LinkedList* list, void* element) {
     assert(list);
 
-    void* new_element = list->copy(element);
-    if (!new_element) {
-        return LINKED_LIST_MEM_ERROR;
+    return insert_owned(list, 0, element);
+}
+
+void* linkedListPopFront(LinkedList* list) {
+    assert(list);
+
+    if (0 == list->size || LINKED_LIST_SUCCESS != unshare(list)) {
+        // list is empty
+        return NULL;
     }
 
-    LinkedListNode* new_node = nodeCreate(new_element);
-    if (!new_node) {
-        list->free(new_element);
+    return remove_node(list, 0);
+}
+
+LinkedListStatus linkedListSplice(LinkedList* dst, size_t pos, LinkedList* src) {
+    assert(dst); assert(src); assert(dst != src);
+    assert(dst->free == src->free);
+
+    if (0 == src->size) {
+        // nothing to move
+        return LINKED_LIST_SUCCESS;
+    }
+
+    if (LINKED_LIST_SUCCESS != unshare(dst) || LINKED_LIST_SUCCESS != unshare(src)) {
         return LINKED_LIST_MEM_ERROR;
     }
 
-    LinkedListNode* after_head = list->head->next;
+    LinkedListNode* first = src->head->next;
+    LinkedListNode* last = src->tail->prev;
+    reset_sentinels(src);
 
-    list->head->next = new_node;
-    new_node->prev = list->head;
+    link_before(node_at(dst, pos), first, last);
 
-    after_head->prev = new_node;
-    new_node->next = after_head;
+    dst->size += src->size;
+    src->size = 0;
+    rebuild_index(dst);
 
     return LINKED_LIST_SUCCESS;
+}
 
+LinkedListStatus linkedListAppendList(LinkedList* dst, LinkedList* src) {
+    return linkedListSplice(dst, SIZE_MAX, src);
 }
 
-void* linkedListPopFront(LinkedList* list) {
+LinkedList* linkedListSplitAt(LinkedList* list, size_t index) {
     assert(list);
 
+    if (LINKED_LIST_SUCCESS != unshare(list)) {
+        return NULL;
+    }
+
+    LinkedList* new_list = list_create(list->copy, list->free, list->compare, list->indexed, &list->allocator);
+    if (!new_list) {
+        return NULL;
+    }
+
+    LinkedListNode* first = node_at(list, index);
+    if (first == list->tail) {
+        // split point is past the last element
+        return new_list;
+    }
+
+    LinkedListNode* last = list->tail->prev;
+
+    // close the original list right before the split point
+    first->prev->next = list->tail;
+    list->tail->prev = first->prev;
+
+    link_before(new_list->tail, first, last);
+
+    new_list->size = list->size - index;
+    list->size = index;
+    rebuild_index(list);
+    rebuild_index(new_list);
+
+    return new_list;
+}
+
+// merges two NULL terminated, sorted chains linked through `next` only.
+// on equal elements, nodes of `first` come before nodes of `second`,
+// which keeps the merge stable
+static LinkedListNode* merge_chains(LinkedListNode* first, LinkedListNode* second, cmp_func_t compare) {
+    LinkedListNode merged;
+    LinkedListNode* last = &merged;
+
+    while (first && second) {
+        if (compare(second->data, first->data) < 0) {
+            last->next = second;
+            second = second->next;
+        } else {
+            last->next = first;
+            first = first->next;
+        }
+
+        last = last->next;
+    }
+
+    last->next = first ? first : second;
+
+    return merged.next;
+}
+
+// detaches the list's nodes as a NULL terminated chain (linked through
+// `next` only). returns NULL if the list is empty.
+// the caller is responsible for the size
+static LinkedListNode* detach_chain(LinkedList* list) {
     if (list->head->next == list->tail) {
-        // list is empty
         return NULL;
     }
 
-    LinkedListNode* to_delete = list->head->next;
-    void* data = delete_node(to_delete);
+    LinkedListNode* first = list->head->next;
+    list->tail->prev->next = NULL;
+    reset_sentinels(list);
+
+    return first;
+}
+
+// links a NULL terminated chain back into an empty list, restoring the
+// `prev` pointers on the way
+static void attach_chain(LinkedList* list, LinkedListNode* first) {
+    LinkedListNode* prev = list->head;
+    while (first) {
+        prev->next = first;
+        first->prev = prev;
+
+        prev = first;
+        first = first->next;
+    }
+
+    prev->next = list->tail;
+    list->tail->prev = prev;
+}
+
+// number of pending runs kept by the sort. run `i` holds 2^i nodes,
+// so this covers any list that fits in memory
+#define SORT_MAX_RUNS (sizeof(size_t) * 8)
+
+LinkedListStatus linkedListSort(LinkedList* list, cmp_func_t compare) {
+    assert(list);
+
+    if (!compare) compare = list->compare;
+    assert(compare);
+
+    if (LINKED_LIST_SUCCESS != unshare(list)) {
+        return LINKED_LIST_MEM_ERROR;
+    }
+
+    // bottom-up merge sort: runs[i] is either empty or a sorted run of
+    // 2^i nodes. every node is merged into the runs like a binary counter
+    // increment, so no allocation or recursion is needed
+    LinkedListNode* runs[SORT_MAX_RUNS] = {NULL};
+    size_t max_run = 0;
 
-   return data; 
+    LinkedListNode* node_itr = detach_chain(list);
+    while (node_itr) {
+        LinkedListNode* carry = node_itr;
+        node_itr = node_itr->next;
+        carry->next = NULL;
+
+        size_t i = 0;
+        for (; runs[i]; ++i) {
+            // runs[i] holds older nodes, so it goes first to stay stable
+            carry = merge_chains(runs[i], carry, compare);
+            runs[i] = NULL;
+        }
+
+        runs[i] = carry;
+        if (i > max_run) max_run = i;
+    }
+
+    LinkedListNode* sorted = NULL;
+    for (size_t i = 0; i <= max_run; ++i) {
+        if (runs[i]) {
+            sorted = merge_chains(runs[i], sorted, compare);
+        }
+    }
+
+    attach_chain(list, sorted);
+    rebuild_index(list);
+
+    return LINKED_LIST_SUCCESS;
+}
+
+LinkedListStatus linkedListMergeSorted(LinkedList* dst, LinkedList* src, cmp_func_t compare) {
+    assert(dst); assert(src); assert(dst != src);
+    assert(dst->free == src->free);
+
+    if (!compare) compare = dst->compare;
+    assert(compare);
+
+    if (LINKED_LIST_SUCCESS != unshare(dst) || LINKED_LIST_SUCCESS != unshare(src)) {
+        return LINKED_LIST_MEM_ERROR;
+    }
+
+    LinkedListNode* first = detach_chain(dst);
+    LinkedListNode* second = detach_chain(src);
+
+    attach_chain(dst, merge_chains(first, second, compare));
+
+    dst->size += src->size;
+    src->size = 0;
+    rebuild_index(dst);
+
+    return LINKED_LIST_SUCCESS;
 }
 
 void linkedListPrint(const LinkedList* list, print_func_t print_element) {
@@ -0,0 +1,684 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ordered_map.h"
+
+/**
+ * Nodes are 256 bytes (four cache lines) and cache line aligned:
+ * a leaf holds 15 keys and 15 values, an inner node 15 separator keys and
+ * 16 children. Binary search over the key array touches at most two lines.
+ **/
+#define CACHE_LINE_SIZE 64
+#define NODE_KEYS 15
+#define NODE_MIN_KEYS (NODE_KEYS / 2)
+
+/**
+ * Inner nodes have a fanout of at least NODE_MIN_KEYS + 1 = 8, so this
+ * bounds the depth of any tree that fits in memory.
+ **/
+#define MAX_DEPTH 32
+
+typedef struct
+{
+	uint32_t is_leaf;
+	uint32_t num_keys;
+} NodeHeader;
+
+typedef struct leaf_node
+{
+	NodeHeader header;
+	void* keys[NODE_KEYS];
+	void* values[NODE_KEYS];
+	struct leaf_node* next;
+} LeafNode;
+
+/**
+ * Keys of inner nodes are separators: every key of children[i] is less than
+ * keys[i], which is not greater than any key of children[i + 1].
+ * Separators are private copies of leaf keys made with key_copy, so they
+ * stay valid after the leaf key is removed.
+ **/
+typedef struct inner_node
+{
+	NodeHeader header;
+	void* keys[NODE_KEYS];
+	NodeHeader* children[NODE_KEYS + 1];
+} InnerNode;
+
+
+#define NODE_SIZE (sizeof(LeafNode) > sizeof(InnerNode) ? sizeof(LeafNode) : sizeof(InnerNode))
+
+/**
+ * Allocators only promise max_align_t, so nodes are aligned by hand: each
+ * block has room for a cache line of slack, and for the block's address,
+ * which is kept right before the node.
+ **/
+#define NODE_MEMORY_SIZE (NODE_SIZE + CACHE_LINE_SIZE + sizeof(void*))
+
+
+struct ordered_map
+{
+	NodeHeader* root;	// NULL while the map is empty
+	size_t num_elements;
+	HashMapEntryHandlers handlers;
+	key_cmp_func_t key_cmp_func;
+	DsAllocator allocator;	// the map and its nodes
+};
+
+static void* nodeAlloc(OrderedMap* map)
+{
+	void* memory = dsAlloc(&map->allocator, NODE_MEMORY_SIZE);
+	if (!memory) return NULL;
+
+	uintptr_t aligned = ((uintptr_t)memory + sizeof(void*) + CACHE_LINE_SIZE - 1) &
+		~(uintptr_t)(CACHE_LINE_SIZE - 1);
+	((void**)aligned)[-1] = memory;
+	return (void*)aligned;
+}
+
+static void nodeFree(OrderedMap* map, void* node)
+{
+	dsFree(&map->allocator, ((void**)node)[-1], NODE_MEMORY_SIZE);
+}
+
+static LeafNode* leafInit(LeafNode* leaf)
+{
+	leaf->header.is_leaf = 1;
+	leaf->header.num_keys = 0;
+	leaf->next = NULL;
+	return leaf;
+}
+
+static InnerNode* innerInit(InnerNode* inner)
+{
+	inner->header.is_leaf = 0;
+	inner->header.num_keys = 0;
+	return inner;
+}
+
+typedef struct
+{
+	InnerNode* node;
+	size_t child;
+} PathEntry;
+
+
+/**
+ * Returns the number of keys in keys[0, count) that are less than key
+ * (or not greater than key, if upper is set).
+ **/
+static size_t searchKeys(const OrderedMap* map, void* const* keys, size_t count,
+			 const void* key, int upper)
+{
+	size_t low = 0;
+	size_t high = count;
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		int cmp = map->key_cmp_func(keys[middle], key);
+		if (cmp < 0 || (upper && cmp == 0))
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/**
+ * Descends to the leaf that may contain key.
+ * If path is not NULL, the inner nodes on the way are recorded in it.
+ **/
+static LeafNode* findLeaf(const OrderedMap* map, const void* key,
+			  PathEntry* path, size_t* depth)
+{
+	NodeHeader* node = map->root;
+	size_t level = 0;
+	while (!node->is_leaf)
+	{
+		InnerNode* inner = (InnerNode*)node;
+		size_t child = searchKeys(map, inner->keys, inner->header.num_keys, key, 1);
+		if (path)
+		{
+			path[level].node = inner;
+			path[level].child = child;
+		}
+		++level;
+		node = inner->children[child];
+	}
+	if (depth) *depth = level;
+	return (LeafNode*)node;
+}
+
+static void destroyNode(OrderedMap* map, NodeHeader* node)
+{
+	if (node->is_leaf)
+	{
+		LeafNode* leaf = (LeafNode*)node;
+		for (size_t i = 0; i < leaf->header.num_keys; ++i)
+		{
+			map->handlers.key_free(leaf->keys[i]);
+			map->handlers.value_free(leaf->values[i]);
+		}
+	}
+	else
+	{
+		InnerNode* inner = (InnerNode*)node;
+		for (size_t i = 0; i < inner->header.num_keys; ++i)
+		{
+			map->handlers.key_free(inner->keys[i]);
+		}
+		for (size_t i = 0; i <= inner->header.num_keys; ++i)
+		{
+			destroyNode(map, inner->children[i]);
+		}
+	}
+	nodeFree(map, node);
+}
+
+
+OrderedMap* orderedMapInit(key_cmp_func_t key_cmp_func,
+			   HashMapEntryHandlers handlers)
+{
+	return orderedMapInitWithAllocator(key_cmp_func, handlers, NULL);
+}
+
+OrderedMap* orderedMapInitWithAllocator(key_cmp_func_t key_cmp_func,
+					HashMapEntryHandlers handlers,
+					const DsAllocator* allocator)
+{
+	assert (key_cmp_func);
+
+	if (!allocator) allocator = dsDefaultAllocator();
+
+	OrderedMap* map = dsAlloc(allocator, sizeof(*map));
+	if (map)
+	{
+		map->allocator = *allocator;
+		// the root leaf is allocated on the first insertion
+		map->root = NULL;
+		map->num_elements = 0;
+		map->handlers = handlers;
+		map->key_cmp_func = key_cmp_func;
+	}
+	return map;
+}
+
+void orderedMapClear(OrderedMap* map)
+{
+	if (map->root)
+	{
+		destroyNode(map, map->root);
+		map->root = NULL;
+	}
+	map->num_elements = 0;
+}
+
+void orderedMapDestroy(OrderedMap* map)
+{
+	if (!map) return;
+	orderedMapClear(map);
+	DsAllocator allocator = map->allocator;
+	dsFree(&allocator, map, sizeof(*map));
+}
+
+
+static void leafInsertAt(LeafNode* leaf, size_t index, void* key, void* value)
+{
+	size_t count = leaf->header.num_keys - index;
+	memmove(&leaf->keys[index + 1], &leaf->keys[index], count * sizeof(void*));
+	memmove(&leaf->values[index + 1], &leaf->values[index], count * sizeof(void*));
+	leaf->keys[index] = key;
+	leaf->values[index] = value;
+	++leaf->header.num_keys;
+}
+
+static void innerInsertAt(InnerNode* inner, size_t index, void* key, NodeHeader* right)
+{
+	size_t count = inner->header.num_keys - index;
+	memmove(&inner->keys[index + 1], &inner->keys[index], count * sizeof(void*));
+	memmove(&inner->children[index + 2], &inner->children[index + 1], count * sizeof(NodeHeader*));
+	inner->keys[index] = key;
+	inner->children[index + 1] = right;
+	++inner->header.num_keys;
+}
+
+/**
+ * Splits a full leaf while inserting key/value at index.
+ * The upper half moves to right, which is linked after leaf.
+ **/
+static void splitLeaf(LeafNode* leaf, LeafNode* right, size_t index,
+		      void* key, void* value)
+{
+	void* keys[NODE_KEYS + 1];
+	void* values[NODE_KEYS + 1];
+	memcpy(keys, leaf->keys, index * sizeof(void*));
+	memcpy(values, leaf->values, index * sizeof(void*));
+	keys[index] = key;
+	values[index] = value;
+	memcpy(&keys[index + 1], &leaf->keys[index], (NODE_KEYS - index) * sizeof(void*));
+	memcpy(&values[index + 1], &leaf->values[index], (NODE_KEYS - index) * sizeof(void*));
+
+	const size_t left_count = (NODE_KEYS + 1) / 2;
+	const size_t right_count = NODE_KEYS + 1 - left_count;
+
+	memcpy(leaf->keys, keys, left_count * sizeof(void*));
+	memcpy(leaf->values, values, left_count * sizeof(void*));
+	leaf->header.num_keys = left_count;
+
+	memcpy(right->keys, &keys[left_count], right_count * sizeof(void*));
+	memcpy(right->values, &values[left_count], right_count * sizeof(void*));
+	right->header.num_keys = right_count;
+
+	right->next = leaf->next;
+	leaf->next = right;
+}
+
+/**
+ * Splits a full inner node while inserting key/child at index.
+ * The upper half moves to right, and the middle key is returned (it moves
+ * up to the parent).
+ **/
+static void* splitInner(InnerNode* inner, InnerNode* right, size_t index,
+			void* key, NodeHeader* child)
+{
+	void* keys[NODE_KEYS + 1];
+	NodeHeader* children[NODE_KEYS + 2];
+	memcpy(keys, inner->keys, index * sizeof(void*));
+	keys[index] = key;
+	memcpy(&keys[index + 1], &inner->keys[index], (NODE_KEYS - index) * sizeof(void*));
+	memcpy(children, inner->children, (index + 1) * sizeof(NodeHeader*));
+	children[index + 1] = child;
+	memcpy(&children[index + 2], &inner->children[index + 1], (NODE_KEYS - index) * sizeof(NodeHeader*));
+
+	const size_t left_count = (NODE_KEYS + 1) / 2;
+	const size_t right_count = NODE_KEYS - left_count;
+
+	memcpy(inner->keys, keys, left_count * sizeof(void*));
+	memcpy(inner->children, children, (left_count + 1) * sizeof(NodeHeader*));
+	inner->header.num_keys = left_count;
+
+	memcpy(right->keys, &keys[left_count + 1], right_count * sizeof(void*));
+	memcpy(right->children, &children[left_count + 1], (right_count + 1) * sizeof(NodeHeader*));
+	right->header.num_keys = right_count;
+
+	return keys[left_count];
+}
+
+
+OrderedMapStatus orderedMapInsert(OrderedMap* map, const void* key, const void* value)
+{
+	if (!map->root)
+	{
+		LeafNode* root = nodeAlloc(map);
+		if (!root) return ORDERED_MAP_MEM_ERROR;
+		map->root = &leafInit(root)->header;
+	}
+
+	PathEntry path[MAX_DEPTH];
+	size_t depth = 0;
+	LeafNode* leaf = findLeaf(map, key, path, &depth);
+	size_t index = searchKeys(map, leaf->keys, leaf->header.num_keys, key, 0);
+
+	void* new_value = map->handlers.value_copy(value);
+	if (!new_value) return ORDERED_MAP_MEM_ERROR;
+
+	if (index < leaf->header.num_keys && 0 == map->key_cmp_func(leaf->keys[index], key))
+	{
+		map->handlers.value_free(leaf->values[index]);
+		leaf->values[index] = new_value;
+		return ORDERED_MAP_SUCCESS;
+	}
+
+	void* new_key = map->handlers.key_copy(key);
+	if (!new_key)
+	{
+		map->handlers.value_free(new_value);
+		return ORDERED_MAP_MEM_ERROR;
+	}
+
+	if (leaf->header.num_keys < NODE_KEYS)
+	{
+		leafInsertAt(leaf, index, new_key, new_value);
+		++map->num_elements;
+		return ORDERED_MAP_SUCCESS;
+	}
+
+	// the leaf splits, and so does every full ancestor. reserve all the
+	// nodes (and the leaf separator) up front, so that a failure leaves
+	// the tree untouched
+	size_t splits = 1;
+	while (splits <= depth && path[depth - splits].node->header.num_keys == NODE_KEYS)
+	{
+		++splits;
+	}
+	size_t new_nodes = splits + (splits > depth ? 1 : 0);
+
+	void* nodes[MAX_DEPTH + 1];
+	size_t allocated = 0;
+	for (; allocated < new_nodes; ++allocated)
+	{
+		nodes[allocated] = nodeAlloc(map);
+		if (!nodes[allocated]) break;
+	}
+
+	// the separator is the first key of the new right leaf
+	const size_t left_count = (NODE_KEYS + 1) / 2;
+	const void* first_right_key = (index == left_count) ? key :
+		leaf->keys[index < left_count ? left_count - 1 : left_count];
+	void* separator = allocated == new_nodes ? map->handlers.key_copy(first_right_key) : NULL;
+
+	if (!separator)
+	{
+		for (size_t i = 0; i < allocated; ++i) nodeFree(map, nodes[i]);
+		map->handlers.key_free(new_key);
+		map->handlers.value_free(new_value);
+		return ORDERED_MAP_MEM_ERROR;
+	}
+
+	size_t next_node = 0;
+	LeafNode* right_leaf = leafInit(nodes[next_node++]);
+	splitLeaf(leaf, right_leaf, index, new_key, new_value);
+
+	NodeHeader* right = &right_leaf->header;
+	NodeHeader* left = &leaf->header;
+	for (size_t level = depth; level-- > 0;)
+	{
+		InnerNode* parent = path[level].node;
+		size_t child = path[level].child;
+		if (parent->header.num_keys < NODE_KEYS)
+		{
+			innerInsertAt(parent, child, separator, right);
+			right = NULL;
+			break;
+		}
+
+		InnerNode* right_inner = innerInit(nodes[next_node++]);
+		separator = splitInner(parent, right_inner, child, separator, right);
+		right = &right_inner->header;
+		left = &parent->header;
+	}
+
+	if (right)
+	{
+		// the root itself split
+		InnerNode* root = innerInit(nodes[next_node++]);
+		root->keys[0] = separator;
+		root->children[0] = left;
+		root->children[1] = right;
+		root->header.num_keys = 1;
+		map->root = &root->header;
+	}
+
+	++map->num_elements;
+	return ORDERED_MAP_SUCCESS;
+}
+
+void* orderedMapGet(const OrderedMap* map, const void* key)
+{
+	if (!map->root) return NULL;
+
+	LeafNode* leaf = findLeaf(map, key, NULL, NULL);
+	size_t index = searchKeys(map, leaf->keys, leaf->header.num_keys, key, 0);
+	if (index < leaf->header.num_keys && 0 == map->key_cmp_func(leaf->keys[index], key))
+	{
+		return leaf->values[index];
+	}
+	return NULL;
+}
+
+int orderedMapContains(const OrderedMap* map, const void* key)
+{
+	if (!map->root) return 0;
+
+	LeafNode* leaf = findLeaf(map, key, NULL, NULL);
+	size_t index = searchKeys(map, leaf->keys, leaf->header.num_keys, key, 0);
+	return index < leaf->header.num_keys &&
+		0 == map->key_cmp_func(leaf->keys[index], key);
+}
+
+size_t orderedMapSize(const OrderedMap* map)
+{
+	return map->num_elements;
+}
+
+
+static void removeFromInner(InnerNode* inner, size_t key_index)
+{
+	size_t count = inner->header.num_keys - key_index - 1;
+	memmove(&inner->keys[key_index], &inner->keys[key_index + 1], count * sizeof(void*));
+	memmove(&inner->children[key_index + 1], &inner->children[key_index + 2], count * sizeof(NodeHeader*));
+	--inner->header.num_keys;
+}
+
+/**
+ * Merges right into left, which are adjacent children of parent separated
+ * by parent->keys[key_index], and frees right.
+ **/
+static void mergeNodes(OrderedMap* map, InnerNode* parent, size_t key_index,
+		       NodeHeader* left, NodeHeader* right)
+{
+	if (left->is_leaf)
+	{
+		LeafNode* l = (LeafNode*)left;
+		LeafNode* r = (LeafNode*)right;
+		memcpy(&l->keys[l->header.num_keys], r->keys, r->header.num_keys * sizeof(void*));
+		memcpy(&l->values[l->header.num_keys], r->values, r->header.num_keys * sizeof(void*));
+		l->header.num_keys += r->header.num_keys;
+		l->next = r->next;
+		map->handlers.key_free(parent->keys[key_index]);
+	}
+	else
+	{
+		// the separator moves down between the two halves
+		InnerNode* l = (InnerNode*)left;
+		InnerNode* r = (InnerNode*)right;
+		l->keys[l->header.num_keys] = parent->keys[key_index];
+		memcpy(&l->keys[l->header.num_keys + 1], r->keys, r->header.num_keys * sizeof(void*));
+		memcpy(&l->children[l->header.num_keys + 1], r->children,
+		       (r->header.num_keys + 1) * sizeof(NodeHeader*));
+		l->header.num_keys += r->header.num_keys + 1;
+	}
+
+	removeFromInner(parent, key_index);
+	nodeFree(map, right);
+}
+
+/**
+ * Moves one key from a sibling into the underfull child of parent.
+ * Returns 0 if this wasn't possible (no sibling has a key to spare, or the
+ * new leaf separator couldn't be allocated).
+ **/
+static int borrowKey(OrderedMap* map, InnerNode* parent, size_t child)
+{
+	NodeHeader* node = parent->children[child];
+	NodeHeader* left = child > 0 ? parent->children[child - 1] : NULL;
+	NodeHeader* right = child < parent->header.num_keys ? parent->children[child + 1] : NULL;
+
+	if (left && left->num_keys > NODE_MIN_KEYS)
+	{
+		if (node->is_leaf)
+		{
+			LeafNode* l = (LeafNode*)left;
+			void* separator = map->handlers.key_copy(l->keys[l->header.num_keys - 1]);
+			if (!separator) return 0;
+
+			--l->header.num_keys;
+			leafInsertAt((LeafNode*)node, 0, l->keys[l->header.num_keys], l->values[l->header.num_keys]);
+			map->handlers.key_free(parent->keys[child - 1]);
+			parent->keys[child - 1] = separator;
+		}
+		else
+		{
+			// rotate through the parent
+			InnerNode* l = (InnerNode*)left;
+			InnerNode* n = (InnerNode*)node;
+			memmove(&n->keys[1], n->keys, n->header.num_keys * sizeof(void*));
+			memmove(&n->children[1], n->children, (n->header.num_keys + 1) * sizeof(NodeHeader*));
+			n->keys[0] = parent->keys[child - 1];
+			n->children[0] = l->children[l->header.num_keys];
+			++n->header.num_keys;
+			parent->keys[child - 1] = l->keys[l->header.num_keys - 1];
+			--l->header.num_keys;
+		}
+		return 1;
+	}
+
+	if (right && right->num_keys > NODE_MIN_KEYS)
+	{
+		if (node->is_leaf)
+		{
+			LeafNode* r = (LeafNode*)right;
+			void* separator = map->handlers.key_copy(r->keys[1]);
+			if (!separator) return 0;
+
+			LeafNode* n = (LeafNode*)node;
+			leafInsertAt(n, n->header.num_keys, r->keys[0], r->values[0]);
+			--r->header.num_keys;
+			memmove(r->keys, &r->keys[1], r->header.num_keys * sizeof(void*));
+			memmove(r->values, &r->values[1], r->header.num_keys * sizeof(void*));
+			map->handlers.key_free(parent->keys[child]);
+			parent->keys[child] = separator;
+		}
+		else
+		{
+			InnerNode* r = (InnerNode*)right;
+			InnerNode* n = (InnerNode*)node;
+			n->keys[n->header.num_keys] = parent->keys[child];
+			n->children[n->header.num_keys + 1] = r->children[0];
+			++n->header.num_keys;
+			parent->keys[child] = r->keys[0];
+			--r->header.num_keys;
+			memmove(r->keys, &r->keys[1], r->header.num_keys * sizeof(void*));
+			memmove(r->children, &r->children[1], (r->header.num_keys + 1) * sizeof(NodeHeader*));
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+void orderedMapRemove(OrderedMap* map, const void* key)
+{
+	if (!map->root) return;
+
+	PathEntry path[MAX_DEPTH];
+	size_t depth = 0;
+	LeafNode* leaf = findLeaf(map, key, path, &depth);
+	size_t index = searchKeys(map, leaf->keys, leaf->header.num_keys, key, 0);
+	if (index == leaf->header.num_keys || 0 != map->key_cmp_func(leaf->keys[index], key))
+	{
+		return;
+	}
+
+	map->handlers.key_free(leaf->keys[index]);
+	map->handlers.value_free(leaf->values[index]);
+	--leaf->header.num_keys;
+	memmove(&leaf->keys[index], &leaf->keys[index + 1], (leaf->header.num_keys - index) * sizeof(void*));
+	memmove(&leaf->values[index], &leaf->values[index + 1], (leaf->header.num_keys - index) * sizeof(void*));
+	--map->num_elements;
+
+	// rebalance bottom up. if a leaf separator can't be allocated, the node
+	// is left underfull, which is still a valid tree
+	NodeHeader* node = &leaf->header;
+	for (size_t level = depth; level-- > 0 && node->num_keys < NODE_MIN_KEYS;)
+	{
+		InnerNode* parent = path[level].node;
+		size_t child = path[level].child;
+
+		if (borrowKey(map, parent, child)) break;
+
+		if (child > 0 &&
+		    parent->children[child - 1]->num_keys + node->num_keys < NODE_KEYS)
+		{
+			mergeNodes(map, parent, child - 1, parent->children[child - 1], node);
+		}
+		else if (child < parent->header.num_keys &&
+			 node->num_keys + parent->children[child + 1]->num_keys < NODE_KEYS)
+		{
+			mergeNodes(map, parent, child, node, parent->children[child + 1]);
+		}
+		else
+		{
+			break;
+		}
+
+		node = &parent->header;
+	}
+
+	if (!map->root->is_leaf && 0 == map->root->num_keys)
+	{
+		// the root lost its last separator
+		NodeHeader* old_root = map->root;
+		map->root = ((InnerNode*)old_root)->children[0];
+		nodeFree(map, old_root);
+	}
+}
+
+
+/**
+ * Moves the iterator forward until it points to a key, skipping exhausted
+ * (or empty) leaves.
+ **/
+static OrderedMapIterator normalize(OrderedMapIterator itr)
+{
+	LeafNode* leaf = itr.leaf;
+	while (leaf && itr.index >= leaf->header.num_keys)
+	{
+		leaf = leaf->next;
+		itr.index = 0;
+	}
+	itr.leaf = leaf;
+	return itr;
+}
+
+OrderedMapIterator orderedMapBegin(const OrderedMap* map)
+{
+	OrderedMapIterator itr = {NULL, 0};
+	NodeHeader* node = map->root;
+	while (node && !node->is_leaf)
+	{
+		node = ((InnerNode*)node)->children[0];
+	}
+	itr.leaf = node;
+	return normalize(itr);
+}
+
+OrderedMapIterator orderedMapLowerBound(const OrderedMap* map, const void* key)
+{
+	OrderedMapIterator itr = {NULL, 0};
+	if (!map->root) return itr;
+
+	LeafNode* leaf = findLeaf(map, key, NULL, NULL);
+	itr.leaf = leaf;
+	itr.index = searchKeys(map, leaf->keys, leaf->header.num_keys, key, 0);
+	return normalize(itr);
+}
+
+int orderedMapIteratorValid(OrderedMapIterator itr)
+{
+	return itr.leaf != NULL;
+}
+
+void orderedMapIteratorNext(OrderedMapIterator* itr)
+{
+	assert (itr->leaf);
+	++itr->index;
+	*itr = normalize(*itr);
+}
+
+const void* orderedMapIteratorKey(OrderedMapIterator itr)
+{
+	assert (itr.leaf);
+	return ((LeafNode*)itr.leaf)->keys[itr.index];
+}
+
+void* orderedMapIteratorValue(OrderedMapIterator itr)
+{
+	assert (itr.leaf);
+	return ((LeafNode*)itr.leaf)->values[itr.index];
+}
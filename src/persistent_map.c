@@ -0,0 +1,532 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "persistent_map.h"
+
+#define BITS_PER_LEVEL 5
+#define LEVEL_MASK ((1u << BITS_PER_LEVEL) - 1)
+#define HASH_BITS 64
+#define NO_INDEX SIZE_MAX
+
+/**
+ * Starts every shared object: entries, nodes and versions.
+ **/
+typedef struct
+{
+	atomic_size_t refs;
+} Shared;
+
+typedef struct
+{
+	Shared shared;
+	uint64_t hash;
+	void* key;
+	void* value;
+} Entry;
+
+/**
+ * A node indexes up to 32 slots with five bits of the hash: a slot holds an
+ * entry (its bit is set in data_map) or a node for the next five bits (its
+ * bit is set in node_map). Only the occupied slots are stored, so a node
+ * takes a word per child.
+ * Below the last bits of the hash, a collision node holds the entries whose
+ * hashes are equal, and doesn't use its maps.
+ *
+ * Nodes are never modified once they are reachable from a version, and hold
+ * a reference to each of their children.
+ **/
+typedef struct
+{
+	Shared shared;
+	uint32_t data_map;
+	uint32_t node_map;
+	uint32_t count;		// of children
+	int collision;
+	void* children[];	// entries in slot order, then nodes in slot order
+} Node;
+
+struct persistent_map
+{
+	Shared shared;
+	Node* root;	// NULL when the version is empty
+	size_t size;
+	key_hash_func_t key_hash_func;
+	key_cmp_func_t key_cmp_func;
+	HashMapEntryHandlers handlers;
+};
+
+typedef enum
+{
+	REMOVE_MISSING,
+	REMOVE_DONE,
+	REMOVE_FAILED
+} RemoveResult;
+
+
+static void retain(void* object)
+{
+	atomic_fetch_add_explicit(&((Shared*)object)->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * Drops a reference, and returns 1 if it was the last one. The release and
+ * acquire make the last owner see every write of the others.
+ **/
+static int dropReference(void* object)
+{
+	return 1 == atomic_fetch_sub_explicit(&((Shared*)object)->refs, 1,
+					      memory_order_acq_rel);
+}
+
+static void releaseEntry(const PersistentMap* map, Entry* entry)
+{
+	if (dropReference(entry))
+	{
+		map->handlers.key_free(entry->key);
+		map->handlers.value_free(entry->value);
+		free(entry);
+	}
+}
+
+static size_t entryCount(const Node* node)
+{
+	return node->collision ? node->count : (size_t)__builtin_popcount(node->data_map);
+}
+
+static void releaseNode(const PersistentMap* map, Node* node)
+{
+	if (!dropReference(node)) return;
+
+	size_t entries = entryCount(node);
+	for (size_t i = 0; i < node->count; ++i)
+	{
+		if (i < entries)
+		{
+			releaseEntry(map, node->children[i]);
+		}
+		else
+		{
+			releaseNode(map, node->children[i]);
+		}
+	}
+	free(node);
+}
+
+/**
+ * splitmix64's finalizer: key_hash_func results needn't be mixed well, and
+ * every five of the bits pick a slot.
+ **/
+static uint64_t fullHash(const PersistentMap* map, const void* key)
+{
+	uint64_t hash = map->key_hash_func(key, SIZE_MAX);
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+	return hash ^ (hash >> 31);
+}
+
+static uint32_t slotBit(uint64_t hash, unsigned shift)
+{
+	return 1u << ((hash >> shift) & LEVEL_MASK);
+}
+
+static size_t dataIndex(uint32_t data_map, uint32_t bit)
+{
+	return __builtin_popcount(data_map & (bit - 1));
+}
+
+static size_t nodeIndex(uint32_t data_map, uint32_t node_map, uint32_t bit)
+{
+	return __builtin_popcount(data_map) + __builtin_popcount(node_map & (bit - 1));
+}
+
+static Node* nodeCreate(uint32_t data_map, uint32_t node_map, size_t count, int collision)
+{
+	Node* node = malloc(sizeof(Node) + count * sizeof(void*));
+	if (node)
+	{
+		atomic_init(&node->shared.refs, 1);
+		node->data_map = data_map;
+		node->node_map = node_map;
+		node->count = count;
+		node->collision = collision;
+	}
+	return node;
+}
+
+/**
+ * Returns a copy of node (which may be NULL, for no children) with the given
+ * maps, without the child at remove_index, and with child inserted at
+ * insert_index of the copy (unless either is NO_INDEX). The copy holds new
+ * references to its children.
+ **/
+static Node* nodeSplice(const Node* node, uint32_t data_map, uint32_t node_map,
+			size_t remove_index, void* child, size_t insert_index)
+{
+	size_t old_count = node ? node->count : 0;
+	size_t count = old_count - (NO_INDEX != remove_index) + (NO_INDEX != insert_index);
+	Node* copy = nodeCreate(data_map, node_map, count, node && node->collision);
+	if (!copy) return NULL;
+
+	size_t j = 0;
+	for (size_t i = 0; i < old_count; ++i)
+	{
+		if (i == remove_index) continue;
+		if (j == insert_index) ++j;
+		copy->children[j++] = node->children[i];
+		retain(node->children[i]);
+	}
+	if (NO_INDEX != insert_index)
+	{
+		copy->children[insert_index] = child;
+		retain(child);
+	}
+	return copy;
+}
+
+/**
+ * Returns a node for two entries whose hashes agree below shift.
+ **/
+static Node* nodeMerge(const PersistentMap* map, Entry* first, Entry* second, unsigned shift)
+{
+	if (shift >= HASH_BITS)
+	{
+		Node* node = nodeCreate(0, 0, 2, 1);
+		if (!node) return NULL;
+		node->children[0] = first;
+		node->children[1] = second;
+		retain(first);
+		retain(second);
+		return node;
+	}
+
+	uint32_t first_bit = slotBit(first->hash, shift);
+	uint32_t second_bit = slotBit(second->hash, shift);
+	if (first_bit == second_bit)
+	{
+		Node* child = nodeMerge(map, first, second, shift + BITS_PER_LEVEL);
+		if (!child) return NULL;
+		Node* node = nodeCreate(0, first_bit, 1, 0);
+		if (!node)
+		{
+			releaseNode(map, child);
+			return NULL;
+		}
+		node->children[0] = child;
+		return node;
+	}
+
+	Node* node = nodeCreate(first_bit | second_bit, 0, 2, 0);
+	if (!node) return NULL;
+	node->children[first_bit < second_bit ? 0 : 1] = first;
+	node->children[first_bit < second_bit ? 1 : 0] = second;
+	retain(first);
+	retain(second);
+	return node;
+}
+
+static int sameKey(const PersistentMap* map, const Entry* entry, uint64_t hash, const void* key)
+{
+	return entry->hash == hash && 0 == map->key_cmp_func(entry->key, key);
+}
+
+/**
+ * Returns a copy of node with entry added (or replacing the entry with the
+ * same key), and sets *added if the key is new. Only the nodes on the path
+ * to the entry are copied. Returns NULL if memory runs out.
+ **/
+static Node* nodeInsert(const PersistentMap* map, const Node* node, Entry* entry,
+			unsigned shift, int* added)
+{
+	if (node->collision)
+	{
+		for (size_t i = 0; i < node->count; ++i)
+		{
+			if (sameKey(map, node->children[i], entry->hash, entry->key))
+			{
+				return nodeSplice(node, 0, 0, i, entry, i);
+			}
+		}
+		*added = 1;
+		return nodeSplice(node, 0, 0, NO_INDEX, entry, node->count);
+	}
+
+	uint32_t bit = slotBit(entry->hash, shift);
+	if (node->data_map & bit)
+	{
+		size_t index = dataIndex(node->data_map, bit);
+		Entry* existing = node->children[index];
+		if (sameKey(map, existing, entry->hash, entry->key))
+		{
+			return nodeSplice(node, node->data_map, node->node_map, index, entry, index);
+		}
+
+		// the slot's entry and the new one move down to a new node
+		Node* child = nodeMerge(map, existing, entry, shift + BITS_PER_LEVEL);
+		if (!child) return NULL;
+		uint32_t data_map = node->data_map & ~bit;
+		uint32_t node_map = node->node_map | bit;
+		Node* copy = nodeSplice(node, data_map, node_map, index, child,
+					nodeIndex(data_map, node_map, bit));
+		releaseNode(map, child);
+		*added = 1;
+		return copy;
+	}
+
+	if (node->node_map & bit)
+	{
+		size_t index = nodeIndex(node->data_map, node->node_map, bit);
+		Node* child = nodeInsert(map, node->children[index], entry,
+					 shift + BITS_PER_LEVEL, added);
+		if (!child) return NULL;
+		Node* copy = nodeSplice(node, node->data_map, node->node_map, index, child, index);
+		releaseNode(map, child);
+		return copy;
+	}
+
+	*added = 1;
+	return nodeSplice(node, node->data_map | bit, node->node_map, NO_INDEX, entry,
+			  dataIndex(node->data_map, bit));
+}
+
+/**
+ * Returns a copy of node without key, which is NULL if no children are left.
+ * A child node that is left with a single entry is replaced by the entry, so
+ * that removals undo the nodes that insertions created.
+ * *result tells whether key was missing (and nothing was copied), or memory
+ * ran out.
+ **/
+static Node* nodeRemove(const PersistentMap* map, const Node* node, const void* key,
+			uint64_t hash, unsigned shift, RemoveResult* result)
+{
+	*result = REMOVE_MISSING;
+	if (node->collision)
+	{
+		for (size_t i = 0; i < node->count; ++i)
+		{
+			if (sameKey(map, node->children[i], hash, key))
+			{
+				Node* copy = nodeSplice(node, 0, 0, i, NULL, NO_INDEX);
+				*result = copy ? REMOVE_DONE : REMOVE_FAILED;
+				return copy;
+			}
+		}
+		return NULL;
+	}
+
+	uint32_t bit = slotBit(hash, shift);
+	if (node->data_map & bit)
+	{
+		size_t index = dataIndex(node->data_map, bit);
+		if (!sameKey(map, node->children[index], hash, key)) return NULL;
+
+		*result = REMOVE_DONE;
+		if (1 == node->count) return NULL;
+		Node* copy = nodeSplice(node, node->data_map & ~bit, node->node_map, index,
+					NULL, NO_INDEX);
+		*result = copy ? REMOVE_DONE : REMOVE_FAILED;
+		return copy;
+	}
+
+	if (!(node->node_map & bit)) return NULL;
+
+	size_t index = nodeIndex(node->data_map, node->node_map, bit);
+	Node* child = nodeRemove(map, node->children[index], key, hash,
+				 shift + BITS_PER_LEVEL, result);
+	if (REMOVE_DONE != *result) return NULL;
+
+	// child nodes hold two entries or more, so the child is still there
+	Node* copy;
+	if (1 == child->count && !child->node_map)
+	{
+		uint32_t data_map = node->data_map | bit;
+		uint32_t node_map = node->node_map & ~bit;
+		copy = nodeSplice(node, data_map, node_map, index, child->children[0],
+				  dataIndex(data_map, bit));
+	}
+	else
+	{
+		copy = nodeSplice(node, node->data_map, node->node_map, index, child, index);
+	}
+	releaseNode(map, child);
+	*result = copy ? REMOVE_DONE : REMOVE_FAILED;
+	return copy;
+}
+
+/**
+ * Returns a new version of map with the given root, which it takes over.
+ **/
+static PersistentMap* versionCreate(const PersistentMap* map, Node* root, size_t size)
+{
+	PersistentMap* version = malloc(sizeof(PersistentMap));
+	if (!version)
+	{
+		if (root)
+		{
+			releaseNode(map, root);
+		}
+		return NULL;
+	}
+	// field by field: other threads may be counting references to map
+	atomic_init(&version->shared.refs, 1);
+	version->root = root;
+	version->size = size;
+	version->key_hash_func = map->key_hash_func;
+	version->key_cmp_func = map->key_cmp_func;
+	version->handlers = map->handlers;
+	return version;
+}
+
+
+PersistentMap* persistentMapInit(key_hash_func_t key_hash_func,
+				 key_cmp_func_t key_cmp_func,
+				 HashMapEntryHandlers handlers)
+{
+	PersistentMap config;
+	config.key_hash_func = key_hash_func;
+	config.key_cmp_func = key_cmp_func;
+	config.handlers = handlers;
+	return versionCreate(&config, NULL, 0);
+}
+
+PersistentMap* persistentMapRetain(PersistentMap* map)
+{
+	retain(map);
+	return map;
+}
+
+void persistentMapRelease(PersistentMap* map)
+{
+	if (!map || !dropReference(map)) return;
+
+	if (map->root)
+	{
+		releaseNode(map, map->root);
+	}
+	free(map);
+}
+
+
+PersistentMap* persistentMapInsert(PersistentMap* map, const void* key, const void* value)
+{
+	Entry* entry = malloc(sizeof(Entry));
+	if (!entry) return NULL;
+	atomic_init(&entry->shared.refs, 1);
+	entry->hash = fullHash(map, key);
+	entry->key = map->handlers.key_copy(key);
+	entry->value = entry->key ? map->handlers.value_copy(value) : NULL;
+	if (!entry->value)
+	{
+		if (entry->key)
+		{
+			map->handlers.key_free(entry->key);
+		}
+		free(entry);
+		return NULL;
+	}
+
+	int added = 0;
+	Node* root;
+	if (map->root)
+	{
+		root = nodeInsert(map, map->root, entry, 0, &added);
+	}
+	else
+	{
+		added = 1;
+		root = nodeSplice(NULL, slotBit(entry->hash, 0), 0, NO_INDEX, entry, 0);
+	}
+	releaseEntry(map, entry);
+
+	return root ? versionCreate(map, root, map->size + added) : NULL;
+}
+
+PersistentMap* persistentMapRemove(PersistentMap* map, const void* key)
+{
+	if (!map->root) return persistentMapRetain(map);
+
+	RemoveResult result;
+	Node* root = nodeRemove(map, map->root, key, fullHash(map, key), 0, &result);
+	switch (result)
+	{
+	case REMOVE_MISSING:
+		return persistentMapRetain(map);
+	case REMOVE_DONE:
+		return versionCreate(map, root, map->size - 1);
+	default:
+		return NULL;
+	}
+}
+
+static const Entry* findEntry(const PersistentMap* map, const void* key)
+{
+	uint64_t hash = fullHash(map, key);
+	const Node* node = map->root;
+	unsigned shift = 0;
+	while (node)
+	{
+		if (node->collision)
+		{
+			for (size_t i = 0; i < node->count; ++i)
+			{
+				if (sameKey(map, node->children[i], hash, key))
+				{
+					return node->children[i];
+				}
+			}
+			return NULL;
+		}
+
+		uint32_t bit = slotBit(hash, shift);
+		if (node->data_map & bit)
+		{
+			const Entry* entry = node->children[dataIndex(node->data_map, bit)];
+			return sameKey(map, entry, hash, key) ? entry : NULL;
+		}
+		if (!(node->node_map & bit)) return NULL;
+
+		node = node->children[nodeIndex(node->data_map, node->node_map, bit)];
+		shift += BITS_PER_LEVEL;
+	}
+	return NULL;
+}
+
+int persistentMapContains(const PersistentMap* map, const void* key)
+{
+	return NULL != findEntry(map, key);
+}
+
+void* persistentMapGet(const PersistentMap* map, const void* key)
+{
+	const Entry* entry = findEntry(map, key);
+	return entry ? entry->value : NULL;
+}
+
+size_t persistentMapSize(const PersistentMap* map)
+{
+	return map->size;
+}
+
+static void forEachInNode(const Node* node, for_each_func_t func, void* params)
+{
+	size_t entries = entryCount(node);
+	for (size_t i = 0; i < node->count; ++i)
+	{
+		if (i < entries)
+		{
+			func(((Entry*)node->children[i])->value, params);
+		}
+		else
+		{
+			forEachInNode(node->children[i], func, params);
+		}
+	}
+}
+
+void persistentMapForEach(const PersistentMap* map, for_each_func_t func, void* params)
+{
+	if (map->root)
+	{
+		forEachInNode(map->root, func, params);
+	}
+}
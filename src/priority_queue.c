@@ -0,0 +1,343 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "priority_queue.h"
+
+// capacity of the first allocation
+#define PRIORITY_QUEUE_MIN_CAPACITY 16
+
+// marks the end of the free handle list
+#define NO_HANDLE SIZE_MAX
+
+typedef struct {
+    void* element;
+    PriorityQueueHandle handle;
+} HeapSlot;
+
+struct __priority_queue {
+    HeapSlot* heap;
+    size_t size;
+    size_t capacity;
+
+    // heap index of every live handle. the entries of released handles
+    // form a free list starting at `free_handle`
+    size_t* positions;
+    size_t handles_used;
+    size_t free_handle;
+
+    size_t arity;
+    copy_func_t copy;
+    cmp_func_t compare;
+    free_func_t free;
+
+    DsAllocator allocator; // the queue, its heap and its handle table
+};
+
+static void free_storage(PriorityQueue* queue) {
+    dsFree(&queue->allocator, queue->heap, queue->capacity * sizeof(HeapSlot));
+    dsFree(&queue->allocator, queue->positions, queue->capacity * sizeof(size_t));
+}
+
+// grows the heap (and the handle table, which never needs more entries
+// than the heap's capacity) to hold at least `needed` elements
+static PriorityQueueStatus ensure_capacity(PriorityQueue* queue, size_t needed) {
+    if (needed <= queue->capacity) {
+        return PRIORITY_QUEUE_SUCCESS;
+    }
+
+    size_t new_capacity = queue->capacity ? 2 * queue->capacity : PRIORITY_QUEUE_MIN_CAPACITY;
+    if (new_capacity < needed) new_capacity = needed;
+
+    if (new_capacity > SIZE_MAX / sizeof(HeapSlot)) {
+        return PRIORITY_QUEUE_MEM_ERROR;
+    }
+
+    // both arrays are replaced or neither is, since the allocator is told
+    // the size of each block it frees
+    HeapSlot* new_heap = dsAlloc(&queue->allocator, new_capacity * sizeof(HeapSlot));
+    size_t* new_positions = dsAlloc(&queue->allocator, new_capacity * sizeof(size_t));
+    if (!new_heap || !new_positions) {
+        dsFree(&queue->allocator, new_heap, new_capacity * sizeof(HeapSlot));
+        dsFree(&queue->allocator, new_positions, new_capacity * sizeof(size_t));
+        return PRIORITY_QUEUE_MEM_ERROR;
+    }
+
+    if (queue->capacity) {
+        memcpy(new_heap, queue->heap, queue->size * sizeof(HeapSlot));
+        memcpy(new_positions, queue->positions, queue->handles_used * sizeof(size_t));
+    }
+    free_storage(queue);
+    queue->heap = new_heap;
+    queue->positions = new_positions;
+    queue->capacity = new_capacity;
+
+    return PRIORITY_QUEUE_SUCCESS;
+}
+
+static PriorityQueueHandle allocate_handle(PriorityQueue* queue) {
+    if (queue->free_handle != NO_HANDLE) {
+        PriorityQueueHandle handle = queue->free_handle;
+        queue->free_handle = queue->positions[handle];
+        return handle;
+    }
+
+    return queue->handles_used++;
+}
+
+static void release_handle(PriorityQueue* queue, PriorityQueueHandle handle) {
+    queue->positions[handle] = queue->free_handle;
+    queue->free_handle = handle;
+}
+
+static void place(PriorityQueue* queue, size_t index, HeapSlot slot) {
+    queue->heap[index] = slot;
+    queue->positions[slot.handle] = index;
+}
+
+// moves the slot at `index` up until its parent isn't greater.
+// returns the slot's final index
+static size_t sift_up(PriorityQueue* queue, size_t index) {
+    HeapSlot slot = queue->heap[index];
+
+    while (index > 0) {
+        size_t parent = (index - 1) / queue->arity;
+        if (queue->compare(slot.element, queue->heap[parent].element) >= 0) {
+            break;
+        }
+
+        place(queue, index, queue->heap[parent]);
+        index = parent;
+    }
+
+    place(queue, index, slot);
+
+    return index;
+}
+
+// moves the slot at `index` down until none of its children is smaller
+static void sift_down(PriorityQueue* queue, size_t index) {
+    HeapSlot slot = queue->heap[index];
+
+    for (;;) {
+        size_t first_child = queue->arity * index + 1;
+        if (first_child >= queue->size) {
+            break;
+        }
+
+        size_t last_child = first_child + queue->arity;
+        if (last_child > queue->size) last_child = queue->size;
+
+        size_t smallest = first_child;
+        for (size_t child = first_child + 1; child < last_child; ++child) {
+            if (queue->compare(queue->heap[child].element, queue->heap[smallest].element) < 0) {
+                smallest = child;
+            }
+        }
+
+        if (queue->compare(queue->heap[smallest].element, slot.element) >= 0) {
+            break;
+        }
+
+        place(queue, index, queue->heap[smallest]);
+        index = smallest;
+    }
+
+    place(queue, index, slot);
+}
+
+// unlinks the slot at `index` from the heap, and returns its element
+static void* remove_at(PriorityQueue* queue, size_t index) {
+    void* element = queue->heap[index].element;
+    release_handle(queue, queue->heap[index].handle);
+
+    --queue->size;
+    if (index < queue->size) {
+        // fill the hole with the last slot, which may belong above or below it
+        place(queue, index, queue->heap[queue->size]);
+        if (sift_up(queue, index) == index) {
+            sift_down(queue, index);
+        }
+    }
+
+    return element;
+}
+
+
+PriorityQueue* priorityQueueCreate(size_t arity, copy_func_t copy_func, free_func_t free_func,
+                                   cmp_func_t compare_func) {
+    return priorityQueueCreateWithAllocator(arity, copy_func, free_func, compare_func, NULL);
+}
+
+PriorityQueue* priorityQueueCreateWithAllocator(size_t arity, copy_func_t copy_func, free_func_t free_func,
+                                                cmp_func_t compare_func, const DsAllocator* allocator) {
+    assert(arity >= 2); assert(compare_func);
+
+    if (!allocator) {
+        allocator = dsDefaultAllocator();
+    }
+
+    PriorityQueue* new_queue = dsAlloc(allocator, sizeof(*new_queue));
+    if (new_queue) {
+        new_queue->allocator = *allocator;
+
+        // storage is allocated on the first insertion
+        new_queue->heap = NULL;
+        new_queue->size = 0;
+        new_queue->capacity = 0;
+
+        new_queue->positions = NULL;
+        new_queue->handles_used = 0;
+        new_queue->free_handle = NO_HANDLE;
+
+        new_queue->arity = arity;
+        new_queue->copy = copy_func;
+        new_queue->free = free_func;
+        new_queue->compare = compare_func;
+    }
+
+    return new_queue;
+}
+
+void priorityQueueDestroy(PriorityQueue* queue) {
+    if (queue) {
+        if (queue->free) {
+            for (size_t i = 0; i < queue->size; ++i) {
+                queue->free(queue->heap[i].element);
+            }
+        }
+
+        free_storage(queue);
+        DsAllocator allocator = queue->allocator;
+        dsFree(&allocator, queue, sizeof(*queue));
+    }
+}
+
+size_t priorityQueueSize(const PriorityQueue* queue) {
+    assert(queue);
+
+    return queue->size;
+}
+
+PriorityQueueStatus priorityQueuePushOwned(PriorityQueue* queue, void* element, PriorityQueueHandle* handle) {
+    assert(queue);
+
+    if (PRIORITY_QUEUE_SUCCESS != ensure_capacity(queue, queue->size + 1)) {
+        return PRIORITY_QUEUE_MEM_ERROR;
+    }
+
+    HeapSlot slot = {element, allocate_handle(queue)};
+    place(queue, queue->size, slot);
+    ++queue->size;
+
+    sift_up(queue, queue->size - 1);
+
+    if (handle) {
+        *handle = slot.handle;
+    }
+
+    return PRIORITY_QUEUE_SUCCESS;
+}
+
+PriorityQueueStatus priorityQueuePush(PriorityQueue* queue, const void* element, PriorityQueueHandle* handle) {
+    assert(queue); assert(queue->copy);
+
+    void* new_element = queue->copy(element);
+    if (!new_element) {
+        return PRIORITY_QUEUE_MEM_ERROR;
+    }
+
+    PriorityQueueStatus status = priorityQueuePushOwned(queue, new_element, handle);
+    if (PRIORITY_QUEUE_SUCCESS != status && queue->free) {
+        queue->free(new_element);
+    }
+
+    return status;
+}
+
+PriorityQueueStatus priorityQueueHeapify(PriorityQueue* queue, const void* const* elements, size_t count,
+                                         PriorityQueueHandle* handles) {
+    assert(queue); assert(queue->copy);
+
+    if (0 == count) {
+        return PRIORITY_QUEUE_SUCCESS;
+    }
+
+    assert(elements);
+    if (count > SIZE_MAX - queue->size ||
+        PRIORITY_QUEUE_SUCCESS != ensure_capacity(queue, queue->size + count)) {
+        return PRIORITY_QUEUE_MEM_ERROR;
+    }
+
+    // copy everything first, so that a failure leaves the heap untouched
+    HeapSlot* appended = queue->heap + queue->size;
+    for (size_t i = 0; i < count; ++i) {
+        appended[i].element = queue->copy(elements[i]);
+        if (!appended[i].element) {
+            for (size_t j = 0; j < i && queue->free; ++j) {
+                queue->free(appended[j].element);
+            }
+
+            return PRIORITY_QUEUE_MEM_ERROR;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        appended[i].handle = allocate_handle(queue);
+        queue->positions[appended[i].handle] = queue->size + i;
+
+        if (handles) {
+            handles[i] = appended[i].handle;
+        }
+    }
+
+    queue->size += count;
+
+    // Floyd's heap construction: sift down every inner node, bottom up
+    if (queue->size > 1) {
+        for (size_t index = (queue->size - 2) / queue->arity + 1; index-- > 0;) {
+            sift_down(queue, index);
+        }
+    }
+
+    return PRIORITY_QUEUE_SUCCESS;
+}
+
+void* priorityQueuePeek(const PriorityQueue* queue) {
+    assert(queue);
+
+    if (0 == queue->size) {
+        return NULL;
+    }
+
+    return queue->heap[0].element;
+}
+
+void* priorityQueuePop(PriorityQueue* queue) {
+    assert(queue);
+
+    if (0 == queue->size) {
+        // queue is empty
+        return NULL;
+    }
+
+    return remove_at(queue, 0);
+}
+
+void* priorityQueueGet(const PriorityQueue* queue, PriorityQueueHandle handle) {
+    assert(queue); assert(handle < queue->handles_used);
+
+    return queue->heap[queue->positions[handle]].element;
+}
+
+void priorityQueueDecreaseKey(PriorityQueue* queue, PriorityQueueHandle handle) {
+    assert(queue); assert(handle < queue->handles_used);
+
+    sift_up(queue, queue->positions[handle]);
+}
+
+void* priorityQueueRemove(PriorityQueue* queue, PriorityQueueHandle handle) {
+    assert(queue); assert(handle < queue->handles_used);
+
+    return remove_at(queue, queue->positions[handle]);
+}
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <malloc.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring_buffer.h"
+
+#define CACHE_LINE_SIZE 64
+
+// the indices grow without bound (wrapping at SIZE_MAX), and are masked to find
+// the slot. `tail - head` is the number of queued elements.
+// each side keeps a cached copy of the other side's index, and only reloads it
+// (pulling the other thread's cache line) when the cached value says the buffer
+// is full / empty. the three groups live on separate cache lines so the two
+// threads don't falsely share
+struct __ring_buffer {
+    // written by the producer
+    alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+    size_t cached_head;
+
+    // written by the consumer
+    alignas(CACHE_LINE_SIZE) atomic_size_t head;
+    size_t cached_tail;
+
+    // read only
+    alignas(CACHE_LINE_SIZE) char* slots;
+    size_t mask;
+    size_t element_size;
+    int pointer_mode;
+    free_func_t free;
+};
+
+static void* slot(const RingBuffer* buffer, size_t index) {
+    return buffer->slots + (index & buffer->mask) * buffer->element_size;
+}
+
+// copies `count` elements starting at `index` into/out of the slots, in at most
+// two memcpy calls (the range may wrap around the end of the array)
+static void copy_in(RingBuffer* buffer, size_t index, const char* elements, size_t count) {
+    size_t first = buffer->mask + 1 - (index & buffer->mask);
+    if (first > count) first = count;
+
+    memcpy(slot(buffer, index), elements, first * buffer->element_size);
+    memcpy(buffer->slots, elements + first * buffer->element_size, (count - first) * buffer->element_size);
+}
+
+static void copy_out(const RingBuffer* buffer, size_t index, char* elements, size_t count) {
+    size_t first = buffer->mask + 1 - (index & buffer->mask);
+    if (first > count) first = count;
+
+    memcpy(elements, slot(buffer, index), first * buffer->element_size);
+    memcpy(elements + first * buffer->element_size, buffer->slots, (count - first) * buffer->element_size);
+}
+
+static RingBuffer* ring_buffer_create(size_t capacity, size_t element_size, int pointer_mode,
+                                      free_func_t free_func) {
+    assert(capacity > 0); assert(element_size > 0);
+
+    size_t slots = 1;
+    while (slots < capacity) {
+        if (slots > SIZE_MAX / 2) return NULL;
+        slots *= 2;
+    }
+
+    if (slots > SIZE_MAX / element_size) {
+        return NULL;
+    }
+
+    RingBuffer* new_buffer = aligned_alloc(CACHE_LINE_SIZE, sizeof(*new_buffer));
+    if (new_buffer) {
+        new_buffer->slots = malloc(slots * element_size);
+        if (!new_buffer->slots) {
+            free(new_buffer);
+            return NULL;
+        }
+
+        atomic_init(&new_buffer->tail, 0);
+        atomic_init(&new_buffer->head, 0);
+        new_buffer->cached_head = 0;
+        new_buffer->cached_tail = 0;
+
+        new_buffer->mask = slots - 1;
+        new_buffer->element_size = element_size;
+        new_buffer->pointer_mode = pointer_mode;
+        new_buffer->free = free_func;
+    }
+
+    return new_buffer;
+}
+
+
+RingBuffer* ringBufferCreate(size_t capacity, free_func_t free_func) {
+    return ring_buffer_create(capacity, sizeof(void*), 1, free_func);
+}
+
+RingBuffer* ringBufferCreateInline(size_t capacity, size_t element_size) {
+    return ring_buffer_create(capacity, element_size, 0, NULL);
+}
+
+void ringBufferDestroy(RingBuffer* buffer) {
+    if (buffer) {
+        if (buffer->pointer_mode && buffer->free) {
+            size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+            for (size_t index = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+                 index != tail; ++index) {
+                buffer->free(*(void**) slot(buffer, index));
+            }
+        }
+
+        free(buffer->slots);
+        free(buffer);
+    }
+}
+
+size_t ringBufferCapacity(const RingBuffer* buffer) {
+    assert(buffer);
+
+    return buffer->mask + 1;
+}
+
+size_t ringBufferSize(const RingBuffer* buffer) {
+    assert(buffer);
+
+    // load head first: tail only grows, so the result never exceeds the capacity
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+
+    return tail - head;
+}
+
+size_t ringBufferWriteBatch(RingBuffer* buffer, const void* elements, size_t count) {
+    assert(buffer); assert(elements || 0 == count);
+
+    size_t capacity = buffer->mask + 1;
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+
+    size_t available = capacity - (tail - buffer->cached_head);
+    if (available < count) {
+        // pairs with the consumer's release store: the slots it freed may be reused
+        buffer->cached_head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        available = capacity - (tail - buffer->cached_head);
+    }
+
+    if (count > available) count = available;
+    if (0 == count) {
+        return 0;
+    }
+
+    copy_in(buffer, tail, elements, count);
+
+    // publish the slots: the consumer's acquire load makes their contents visible
+    atomic_store_explicit(&buffer->tail, tail + count, memory_order_release);
+
+    return count;
+}
+
+size_t ringBufferReadBatch(RingBuffer* buffer, void* elements, size_t count) {
+    assert(buffer); assert(elements || 0 == count);
+
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+
+    size_t available = buffer->cached_tail - head;
+    if (available < count) {
+        buffer->cached_tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+        available = buffer->cached_tail - head;
+    }
+
+    if (count > available) count = available;
+    if (0 == count) {
+        return 0;
+    }
+
+    copy_out(buffer, head, elements, count);
+
+    // hand the slots back to the producer, after we're done reading them
+    atomic_store_explicit(&buffer->head, head + count, memory_order_release);
+
+    return count;
+}
+
+RingBufferStatus ringBufferWrite(RingBuffer* buffer, const void* element) {
+    return ringBufferWriteBatch(buffer, element, 1) ? RING_BUFFER_SUCCESS : RING_BUFFER_FULL;
+}
+
+RingBufferStatus ringBufferRead(RingBuffer* buffer, void* element) {
+    return ringBufferReadBatch(buffer, element, 1) ? RING_BUFFER_SUCCESS : RING_BUFFER_EMPTY;
+}
+
+RingBufferStatus ringBufferPush(RingBuffer* buffer, void* element) {
+    assert(buffer); assert(buffer->pointer_mode);
+
+    return ringBufferWrite(buffer, &element);
+}
+
+void* ringBufferPop(RingBuffer* buffer) {
+    assert(buffer); assert(buffer->pointer_mode);
+
+    void* element = NULL;
+    ringBufferRead(buffer, &element);
+
+    return element;
+}
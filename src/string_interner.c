@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds_allocator.h"
+#include "hash_map.h"
+#include "string_interner.h"
+#include "vector.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/**
+ * Every canonical string is stored right after its id, so that the id of a
+ * canonical pointer is found without a lookup.
+ **/
+typedef struct
+{
+	size_t id;
+	char string[];
+} Record;
+
+static const Record* recordOf(const char* canonical)
+{
+	return (const Record*)(canonical - offsetof(Record, string));
+}
+
+
+/**
+ * The records are bump-allocated from an arena, and are only freed all at
+ * once, when the interner is destroyed. Freeing the most recent record
+ * through the arena's allocator gives its memory back, which undoes an
+ * interning that failed halfway.
+ **/
+struct string_interner
+{
+	DsArena* arena;
+	DsAllocator records;	// allocates from arena
+	HashMap* strings;	// content -> canonical string
+	Vector* ids;		// id -> canonical string
+};
+
+
+/**
+ * Handlers of the content map. Both the keys and the values are canonical
+ * strings, which are owned by the arena, so the map neither copies nor
+ * frees them.
+ **/
+static size_t hashString(const void* key, size_t size)
+{
+	// 64 bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const unsigned char* itr = key; *itr; ++itr)
+	{
+		hash ^= *itr;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash % size;
+}
+
+static int compareStrings(const void* a, const void* b)
+{
+	return strcmp(a, b);
+}
+
+void* internedKeyCopy(const void* key)
+{
+	return (void*)key;
+}
+
+void internedKeyFree(void* key)
+{
+	(void)key;
+}
+
+
+StringInterner* stringInternerCreate(void)
+{
+	StringInterner* interner = malloc(sizeof(*interner));
+	if (interner)
+	{
+		HashMapEntryHandlers handlers = {internedKeyCopy, internedKeyFree,
+						 internedKeyCopy, internedKeyFree};
+		interner->arena = dsArenaCreate(ARENA_BLOCK_SIZE, NULL);
+		if (interner->arena)
+		{
+			interner->records = dsArenaAllocator(interner->arena);
+		}
+		interner->strings = hashMapInit(hashString, compareStrings, handlers);
+		interner->ids = vectorCreate(NULL, NULL, NULL);
+		if (!interner->arena || !interner->strings || !interner->ids)
+		{
+			stringInternerDestroy(interner);
+			interner = NULL;
+		}
+	}
+	return interner;
+}
+
+void stringInternerDestroy(StringInterner* interner)
+{
+	if (!interner) return;
+	hashMapDestroy(interner->strings);
+	vectorDestroy(interner->ids);
+	dsArenaDestroy(interner->arena);
+	free(interner);
+}
+
+const char* stringInternerFind(const StringInterner* interner, const char* string)
+{
+	return hashMapGet(interner->strings, string);
+}
+
+const char* stringInternerIntern(StringInterner* interner, const char* string)
+{
+	const char* canonical = stringInternerFind(interner, string);
+	if (canonical) return canonical;
+
+	size_t length = strlen(string);
+	size_t size = sizeof(Record) + length + 1;
+	Record* record = dsAlloc(&interner->records, size);
+	if (!record) return NULL;
+
+	record->id = vectorSize(interner->ids);
+	memcpy(record->string, string, length + 1);
+
+	if (VECTOR_SUCCESS != vectorPushOwned(interner->ids, record->string))
+	{
+		dsFree(&interner->records, record, size);
+		return NULL;
+	}
+
+	if (HASH_MAP_SUCCESS != hashMapInsert(interner->strings, record->string, record->string))
+	{
+		vectorPop(interner->ids);
+		dsFree(&interner->records, record, size);
+		return NULL;
+	}
+
+	return record->string;
+}
+
+size_t stringInternerId(const StringInterner* interner, const char* canonical)
+{
+	assert (canonical == stringInternerString(interner, recordOf(canonical)->id));
+	(void)interner;
+	return recordOf(canonical)->id;
+}
+
+const char* stringInternerString(const StringInterner* interner, size_t id)
+{
+	return vectorGetAt(interner->ids, id);
+}
+
+size_t stringInternerSize(const StringInterner* interner)
+{
+	return vectorSize(interner->ids);
+}
+
+
+size_t internedKeyHash(const void* key, size_t size)
+{
+	// ids are dense, so they spread evenly over the buckets
+	return recordOf(key)->id % size;
+}
+
+int internedKeyCompare(const void* a, const void* b)
+{
+	// ordered by id, as hash maps require (equal ids are equal pointers)
+	size_t id_a = recordOf(a)->id;
+	size_t id_b = recordOf(b)->id;
+	return (id_a > id_b) - (id_a < id_b);
+}
@@ -0,0 +1,267 @@
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_USE_TSC 1
+#endif
+
+#include "trace.h"
+
+// events per thread. a power of two
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 4096
+#endif
+
+#define TRACE_FILE_VERSION 1
+
+/**
+ * A recorded event. The words are atomic so that traceDump may read them
+ * while the owner overwrites them (relaxed accesses compile to plain moves);
+ * torn events are detected and dropped through head.
+ **/
+typedef struct
+{
+	atomic_uint_least64_t timestamp;
+	atomic_uint_least64_t type;	// thread id << 32 | type
+	atomic_uint_least64_t arg0;
+	atomic_uint_least64_t arg1;
+} TraceSlot;
+
+/**
+ * A thread's ring buffer. Event i lives in slot i % TRACE_BUFFER_EVENTS, and
+ * events [head - TRACE_BUFFER_EVENTS, head) are readable.
+ * Buffers are never freed: when a thread exits, its buffer (and its events)
+ * stays around for dumping, and is handed over to the next new thread.
+ **/
+typedef struct trace_buffer
+{
+	struct trace_buffer* next;	// all buffers, newest first
+	atomic_int in_use;
+	atomic_uint_least64_t head;	// index of the next event
+	TraceSlot slots[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+static _Atomic(TraceBuffer*) buffers = NULL;
+static atomic_uint_least32_t next_thread_id = 1;
+static _Thread_local TraceBuffer* local_buffer = NULL;
+static _Thread_local uint64_t local_thread_id;	// shifted into place
+
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static int trace_key_created;	// buffers can be released on thread exit
+static uint64_t start_timestamp;
+static struct timespec start_time;
+static char* exit_dump_path;
+
+
+uint64_t traceTimestamp(void)
+{
+#ifdef TRACE_USE_TSC
+	return __rdtsc();
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static void releaseBuffer(void* buffer)
+{
+	atomic_store_explicit(&((TraceBuffer*)buffer)->in_use, 0, memory_order_release);
+}
+
+static void dumpAtExit(void)
+{
+	if (0 != traceDump(exit_dump_path))
+	{
+		fprintf(stderr, "trace: failed to write %s\n", exit_dump_path);
+	}
+}
+
+static void traceInit(void)
+{
+	trace_key_created = 0 == pthread_key_create(&trace_key, releaseBuffer);
+	start_timestamp = traceTimestamp();
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	const char* path = getenv("DS_TRACE_FILE");
+	if (path && *path)
+	{
+		exit_dump_path = strdup(path);
+		if (exit_dump_path) atexit(dumpAtExit);
+	}
+}
+
+/**
+ * Gives the calling thread a buffer: a released one if there is any, or a
+ * new one otherwise. Returns NULL if allocation fails, or if the buffer
+ * couldn't be released when the thread exits (no thread-specific key).
+ **/
+static TraceBuffer* claimBuffer(void)
+{
+	pthread_once(&trace_once, traceInit);
+	if (!trace_key_created) return NULL;
+
+	TraceBuffer* buffer = atomic_load_explicit(&buffers, memory_order_acquire);
+	for (; buffer; buffer = buffer->next)
+	{
+		int released = 0;
+		if (atomic_compare_exchange_strong(&buffer->in_use, &released, 1)) break;
+	}
+
+	if (!buffer)
+	{
+		buffer = calloc(1, sizeof(*buffer));
+		if (!buffer) return NULL;
+
+		atomic_init(&buffer->in_use, 1);
+		TraceBuffer* head = atomic_load_explicit(&buffers, memory_order_relaxed);
+		do
+		{
+			buffer->next = head;
+		} while (!atomic_compare_exchange_weak_explicit(&buffers, &head, buffer,
+								memory_order_release,
+								memory_order_relaxed));
+	}
+
+	local_thread_id = (uint64_t)atomic_fetch_add(&next_thread_id, 1) << 32;
+	pthread_setspecific(trace_key, buffer);
+	local_buffer = buffer;
+	return buffer;
+}
+
+void traceRecord(uint32_t type, uint64_t arg0, uint64_t arg1)
+{
+	TraceBuffer* buffer = local_buffer;
+	if (!buffer)
+	{
+		buffer = claimBuffer();
+		if (!buffer) return;
+	}
+
+	uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	TraceSlot* slot = &buffer->slots[head & (TRACE_BUFFER_EVENTS - 1)];
+	// orders the last head store before the slot is reused. pairs with the
+	// acquire fence of snapshotBuffer: a reader that sees any of the stores
+	// below also sees head past the event that the slot held
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&slot->timestamp, traceTimestamp(), memory_order_relaxed);
+	atomic_store_explicit(&slot->type, local_thread_id | type, memory_order_relaxed);
+	atomic_store_explicit(&slot->arg0, arg0, memory_order_relaxed);
+	atomic_store_explicit(&slot->arg1, arg1, memory_order_relaxed);
+
+	atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+
+static double ticksPerSecond(void)
+{
+#ifdef TRACE_USE_TSC
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t ticks = traceTimestamp() - start_timestamp;
+	double seconds = (double)(now.tv_sec - start_time.tv_sec) +
+		(double)(now.tv_nsec - start_time.tv_nsec) / 1e9;
+	if (seconds > 0 && ticks > 0) return (double)ticks / seconds;
+#endif
+	return 1e9;
+}
+
+/**
+ * Copies the readable events of buffer to events (which has room for a full
+ * buffer), oldest first, and fills in header.
+ **/
+static void snapshotBuffer(TraceBuffer* buffer, TraceEvent* events, TraceBufferHeader* header)
+{
+	uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+	uint64_t begin = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+
+	for (uint64_t index = begin; index < head; ++index)
+	{
+		TraceSlot* slot = &buffer->slots[index & (TRACE_BUFFER_EVENTS - 1)];
+		TraceEvent* event = &events[index - begin];
+		event->timestamp = atomic_load_explicit(&slot->timestamp, memory_order_relaxed);
+		uint64_t type = atomic_load_explicit(&slot->type, memory_order_relaxed);
+		event->type = (uint32_t)type;
+		event->thread_id = (uint32_t)(type >> 32);
+		event->arg0 = atomic_load_explicit(&slot->arg0, memory_order_relaxed);
+		event->arg1 = atomic_load_explicit(&slot->arg1, memory_order_relaxed);
+	}
+
+	// events the owner started overwriting while they were copied are torn.
+	// the owner may be writing event `head`, which reuses the slot of event
+	// head - TRACE_BUFFER_EVENTS
+	atomic_thread_fence(memory_order_acquire);
+	uint64_t new_head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	uint64_t valid = new_head + 1 > TRACE_BUFFER_EVENTS ? new_head + 1 - TRACE_BUFFER_EVENTS : 0;
+	uint64_t skip = valid > begin ? valid - begin : 0;
+	if (skip > head - begin) skip = head - begin;
+	if (skip)
+	{
+		memmove(events, events + skip, (head - begin - skip) * sizeof(*events));
+	}
+
+	header->event_count = head - begin - skip;
+	header->lost_count = begin + skip;
+}
+
+int traceDump(const char* path)
+{
+	pthread_once(&trace_once, traceInit);
+
+	FILE* file = fopen(path, "wb");
+	if (!file) return -1;
+
+	TraceEvent* events = malloc(TRACE_BUFFER_EVENTS * sizeof(*events));
+	if (!events)
+	{
+		fclose(file);
+		return -1;
+	}
+
+	// buffers are only ever added in front, so the list from this snapshot
+	// on stays the same
+	TraceBuffer* first_buffer = atomic_load_explicit(&buffers, memory_order_acquire);
+
+	TraceFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_FILE_VERSION;
+	header.ticks_per_second = ticksPerSecond();
+	for (TraceBuffer* buffer = first_buffer; buffer; buffer = buffer->next)
+	{
+		++header.buffer_count;
+	}
+
+	int ok = 1 == fwrite(&header, sizeof(header), 1, file);
+	for (TraceBuffer* buffer = first_buffer; ok && buffer; buffer = buffer->next)
+	{
+		TraceBufferHeader buffer_header;
+		snapshotBuffer(buffer, events, &buffer_header);
+		ok = 1 == fwrite(&buffer_header, sizeof(buffer_header), 1, file) &&
+			buffer_header.event_count ==
+			fwrite(events, sizeof(*events), buffer_header.event_count, file);
+	}
+
+	free(events);
+	if (0 != fclose(file)) ok = 0;
+	return ok ? 0 : -1;
+}
+
+const char* traceEventName(uint32_t type)
+{
+	switch (type)
+	{
+	case TRACE_HASH_MAP_INSERT: return "hash_map.insert";
+	case TRACE_HASH_MAP_LOOKUP: return "hash_map.lookup";
+	case TRACE_HASH_MAP_RESIZE_BEGIN: return "hash_map.resize_begin";
+	case TRACE_HASH_MAP_RESIZE_END: return "hash_map.resize_end";
+	default: return NULL;
+	}
+}
@@ -0,0 +1,440 @@
+#include <assert.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vector.h"
+
+// capacity of the first allocation
+#define VECTOR_MIN_CAPACITY 8
+
+struct __vector {
+    // `capacity` + 1 slots of `element_size` bytes. in inline mode, the extra
+    // slot holds the last element removed by vectorRemoveAt
+    char* data;
+    size_t size;
+    size_t capacity;
+    size_t element_size;
+
+    int inline_mode;
+    copy_func_t copy;
+    cmp_func_t compare;
+    free_func_t free;
+
+    DsAllocator allocator; // the vector and its storage
+};
+
+static char* slot(const Vector* vector, size_t index) {
+    return vector->data + index * vector->element_size;
+}
+
+// the element as seen by the user: the stored pointer in pointer mode,
+// the address of the slot in inline mode
+static void* element_at(const Vector* vector, size_t index) {
+    if (vector->inline_mode) {
+        return slot(vector, index);
+    }
+
+    return *(void**) slot(vector, index);
+}
+
+static void free_range(Vector* vector, size_t begin, size_t end) {
+    if (vector->inline_mode || !vector->free) {
+        return;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+        vector->free(element_at(vector, i));
+    }
+}
+
+// grows the storage to hold at least `needed` elements
+static VectorStatus ensure_capacity(Vector* vector, size_t needed) {
+    if (needed <= vector->capacity) {
+        return VECTOR_SUCCESS;
+    }
+
+    size_t new_capacity = vector->capacity ? 2 * vector->capacity : VECTOR_MIN_CAPACITY;
+    if (new_capacity < needed) new_capacity = needed;
+
+    if (new_capacity >= SIZE_MAX / vector->element_size) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    size_t old_bytes = vector->data ? (vector->capacity + 1) * vector->element_size : 0;
+    char* new_data = dsRealloc(&vector->allocator, vector->data, old_bytes,
+                               (new_capacity + 1) * vector->element_size);
+    if (!new_data) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    vector->data = new_data;
+    vector->capacity = new_capacity;
+
+    return VECTOR_SUCCESS;
+}
+
+// whether `p` points into the storage, spare slot included
+static int in_storage(const Vector* vector, const void* p) {
+    uintptr_t begin = (uintptr_t) vector->data;
+    uintptr_t end = (uintptr_t) slot(vector, vector->capacity + 1);
+
+    return vector->data && (uintptr_t) p >= begin && (uintptr_t) p < end;
+}
+
+// makes room for one more element. in inline mode, `*element` may be an element
+// returned by the vector, which growing the storage or shifting elements would
+// overwrite: it is parked in the spare slot first, and `*element` is pointed at
+// the spare slot (carried over to the new storage if it grows)
+static VectorStatus reserve_one(Vector* vector, const void** element) {
+    int parked = vector->inline_mode && in_storage(vector, *element);
+    if (parked) {
+        // may already be in the spare slot (returned by vectorRemoveAt)
+        memmove(slot(vector, vector->capacity), *element, vector->element_size);
+    }
+
+    size_t old_capacity = vector->capacity;
+    if (VECTOR_SUCCESS != ensure_capacity(vector, vector->size + 1)) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    if (parked) {
+        if (vector->capacity != old_capacity) {
+            memcpy(slot(vector, vector->capacity), slot(vector, old_capacity), vector->element_size);
+        }
+        *element = slot(vector, vector->capacity);
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+static Vector* vector_create(size_t element_size, int inline_mode,
+                             copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func,
+                             const DsAllocator* allocator) {
+    if (!allocator) {
+        allocator = dsDefaultAllocator();
+    }
+
+    Vector* new_vector = dsAlloc(allocator, sizeof(*new_vector));
+    if (new_vector) {
+        new_vector->allocator = *allocator;
+
+        // storage is allocated on the first insertion
+        new_vector->data = NULL;
+        new_vector->size = 0;
+        new_vector->capacity = 0;
+        new_vector->element_size = element_size;
+
+        new_vector->inline_mode = inline_mode;
+        new_vector->copy = copy_func;
+        new_vector->free = free_func;
+        new_vector->compare = compare_func;
+    }
+
+    return new_vector;
+}
+
+Vector* vectorCreate(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func) {
+    return vector_create(sizeof(void*), 0, copy_func, free_func, compare_func, NULL);
+}
+
+Vector* vectorCreateInline(size_t element_size, cmp_func_t compare_func) {
+    assert(element_size > 0);
+
+    return vector_create(element_size, 1, NULL, NULL, compare_func, NULL);
+}
+
+Vector* vectorCreateWithAllocator(copy_func_t copy_func, free_func_t free_func, cmp_func_t compare_func,
+                                  const DsAllocator* allocator) {
+    return vector_create(sizeof(void*), 0, copy_func, free_func, compare_func, allocator);
+}
+
+Vector* vectorCreateInlineWithAllocator(size_t element_size, cmp_func_t compare_func,
+                                        const DsAllocator* allocator) {
+    assert(element_size > 0);
+
+    return vector_create(element_size, 1, NULL, NULL, compare_func, allocator);
+}
+
+void vectorDestroy(Vector* vector) {
+    if (vector) {
+        free_range(vector, 0, vector->size);
+
+        DsAllocator allocator = vector->allocator;
+        if (vector->data) {
+            dsFree(&allocator, vector->data, (vector->capacity + 1) * vector->element_size);
+        }
+        dsFree(&allocator, vector, sizeof(*vector));
+    }
+}
+
+Vector* vectorClone(const Vector* vector) {
+    assert(vector);
+    assert(vector->inline_mode || vector->copy || !vector->free);
+
+    Vector* new_vector = vector_create(vector->element_size, vector->inline_mode,
+                                       vector->copy, vector->free, vector->compare, &vector->allocator);
+    if (!new_vector) {
+        return NULL;
+    }
+
+    if (VECTOR_SUCCESS != ensure_capacity(new_vector, vector->size)) {
+        vectorDestroy(new_vector);
+        return NULL;
+    }
+
+    if (vector->inline_mode || !vector->copy) {
+        // plain data, or pointers the vector doesn't own
+        if (vector->size > 0) {
+            memcpy(new_vector->data, vector->data, vector->size * vector->element_size);
+        }
+        new_vector->size = vector->size;
+
+        return new_vector;
+    }
+
+    for (size_t i = 0; i < vector->size; ++i) {
+        void* new_element = vector->copy(element_at(vector, i));
+        if (!new_element) {
+            vectorDestroy(new_vector);
+            return NULL;
+        }
+
+        *(void**) slot(new_vector, i) = new_element;
+        ++new_vector->size;
+    }
+
+    return new_vector;
+}
+
+size_t vectorSize(const Vector* vector) {
+    assert(vector);
+
+    return vector->size;
+}
+
+size_t vectorCapacity(const Vector* vector) {
+    assert(vector);
+
+    return vector->capacity;
+}
+
+VectorStatus vectorReserve(Vector* vector, size_t capacity) {
+    assert(vector);
+
+    return ensure_capacity(vector, capacity);
+}
+
+void vectorClear(Vector* vector) {
+    assert(vector);
+
+    free_range(vector, 0, vector->size);
+    vector->size = 0;
+}
+
+ssize_t vectorIndexOf(const Vector* vector, const void* element) {
+    assert(vector); assert(element); assert(vector->compare);
+
+    for (size_t i = 0; i < vector->size; ++i) {
+        if (0 == vector->compare(element_at(vector, i), element)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void* vectorGetAt(const Vector* vector, size_t index) {
+    assert(vector);
+
+    if (index >= vector->size) {
+        return NULL;
+    }
+
+    return element_at(vector, index);
+}
+
+VectorStatus vectorInsertAt(Vector* vector, size_t index, const void* element) {
+    assert(vector);
+    assert(vector->inline_mode || vector->copy);
+
+    if (index > vector->size) {
+        index = vector->size;
+    }
+
+    if (VECTOR_SUCCESS != reserve_one(vector, &element)) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    void* new_element = NULL;
+    if (!vector->inline_mode) {
+        new_element = vector->copy(element);
+        if (!new_element) {
+            return VECTOR_MEM_ERROR;
+        }
+    }
+
+    memmove(slot(vector, index + 1), slot(vector, index), (vector->size - index) * vector->element_size);
+
+    if (vector->inline_mode) {
+        memcpy(slot(vector, index), element, vector->element_size);
+    } else {
+        *(void**) slot(vector, index) = new_element;
+    }
+
+    ++vector->size;
+
+    return VECTOR_SUCCESS;
+}
+
+void* vectorRemoveAt(Vector* vector, size_t index) {
+    assert(vector);
+
+    if (index >= vector->size) {
+        return NULL;
+    }
+
+    // in inline mode, park the element in the spare slot before closing the gap
+    void* element = element_at(vector, index);
+    if (vector->inline_mode) {
+        element = memcpy(slot(vector, vector->capacity), element, vector->element_size);
+    }
+
+    memmove(slot(vector, index), slot(vector, index + 1), (vector->size - index - 1) * vector->element_size);
+    --vector->size;
+
+    return element;
+}
+
+VectorStatus vectorPush(Vector* vector, const void* element) {
+    assert(vector);
+    assert(vector->inline_mode || vector->copy);
+
+    if (VECTOR_SUCCESS != reserve_one(vector, &element)) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    if (vector->inline_mode) {
+        memcpy(slot(vector, vector->size), element, vector->element_size);
+    } else {
+        void* new_element = vector->copy(element);
+        if (!new_element) {
+            return VECTOR_MEM_ERROR;
+        }
+
+        *(void**) slot(vector, vector->size) = new_element;
+    }
+
+    ++vector->size;
+
+    return VECTOR_SUCCESS;
+}
+
+VectorStatus vectorPushOwned(Vector* vector, void* element) {
+    assert(vector); assert(!vector->inline_mode);
+
+    if (VECTOR_SUCCESS != ensure_capacity(vector, vector->size + 1)) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    *(void**) slot(vector, vector->size) = element;
+    ++vector->size;
+
+    return VECTOR_SUCCESS;
+}
+
+void* vectorPop(Vector* vector) {
+    assert(vector);
+
+    if (0 == vector->size) {
+        // vector is empty
+        return NULL;
+    }
+
+    // the slot stays untouched until the next insertion
+    --vector->size;
+
+    return element_at(vector, vector->size);
+}
+
+VectorStatus vectorAppend(Vector* vector, const void* elements, size_t count) {
+    assert(vector);
+    assert(vector->inline_mode || vector->copy);
+
+    if (0 == count) {
+        return VECTOR_SUCCESS;
+    }
+
+    assert(elements);
+    assert(!vector->inline_mode || !in_storage(vector, elements));
+    if (count > SIZE_MAX - vector->size ||
+        VECTOR_SUCCESS != ensure_capacity(vector, vector->size + count)) {
+        return VECTOR_MEM_ERROR;
+    }
+
+    if (vector->inline_mode) {
+        memcpy(slot(vector, vector->size), elements, count * vector->element_size);
+        vector->size += count;
+
+        return VECTOR_SUCCESS;
+    }
+
+    const void* const* sources = elements;
+    for (size_t i = 0; i < count; ++i) {
+        void* new_element = vector->copy(sources[i]);
+        if (!new_element) {
+            // roll back the copies made so far
+            for (size_t j = 0; j < i; ++j) {
+                if (vector->free) vector->free(element_at(vector, vector->size + j));
+            }
+
+            return VECTOR_MEM_ERROR;
+        }
+
+        *(void**) slot(vector, vector->size + i) = new_element;
+    }
+
+    vector->size += count;
+
+    return VECTOR_SUCCESS;
+}
+
+size_t vectorLowerBound(const Vector* vector, const void* element) {
+    assert(vector); assert(vector->compare);
+
+    size_t low = 0;
+    size_t high = vector->size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (vector->compare(element_at(vector, middle), element) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+ssize_t vectorBinarySearch(const Vector* vector, const void* element) {
+    size_t index = vectorLowerBound(vector, element);
+    if (index < vector->size && 0 == vector->compare(element_at(vector, index), element)) {
+        return index;
+    }
+
+    return -1;
+}
+
+void vectorPrint(const Vector* vector, print_func_t print_element) {
+    printf("[");
+
+    for (size_t i = 0; i < vector->size; ++i) {
+        print_element(element_at(vector, i));
+        if (i + 1 < vector->size) {
+            printf(", ");
+        }
+    }
+
+    printf("]\n");
+}
@@ -0,0 +1,202 @@
+#include <assert.h>
+#include <malloc.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "work_stealing_deque.h"
+
+#define CACHE_LINE_SIZE 64
+#define MIN_CAPACITY 16
+
+// a circular array of slots. slots are atomic because a thief may read a slot while
+// the owner overwrites it; the thief's CAS on `top` then fails, and the value it
+// read is dropped
+typedef struct __slot_array {
+    size_t mask;
+    struct __slot_array* retired; // older arrays, see grow()
+    _Atomic(void*) slots[];
+} SlotArray;
+
+// follows "Correct and Efficient Work-Stealing for Weak Memory Models"
+// (Lê, Pop, Cohen, Zappa Nardelli, PPoPP 2013).
+// `top` and `bottom` only grow; [top, bottom) are the queued elements. the owner
+// and the thieves contend on `top`, so it lives on its own cache line
+struct __work_stealing_deque {
+    alignas(CACHE_LINE_SIZE) atomic_ptrdiff_t top;
+
+    alignas(CACHE_LINE_SIZE) atomic_ptrdiff_t bottom;
+    _Atomic(SlotArray*) array;
+};
+
+static SlotArray* array_create(size_t capacity) {
+    if (capacity > (SIZE_MAX - sizeof(SlotArray)) / sizeof(void*)) {
+        return NULL;
+    }
+
+    SlotArray* array = malloc(sizeof(SlotArray) + capacity * sizeof(void*));
+    if (array) {
+        array->mask = capacity - 1;
+        array->retired = NULL;
+    }
+
+    return array;
+}
+
+static void* array_get(SlotArray* array, ptrdiff_t index) {
+    return atomic_load_explicit(&array->slots[(size_t) index & array->mask], memory_order_relaxed);
+}
+
+static void array_put(SlotArray* array, ptrdiff_t index, void* element) {
+    atomic_store_explicit(&array->slots[(size_t) index & array->mask], element, memory_order_relaxed);
+}
+
+// owner only: move the elements [top, bottom) to an array twice as large.
+// thieves may still be reading the old array, so it can't be freed yet: it's
+// chained to the new one and freed with the deque. the arrays double in size, so
+// the retired ones take less memory than the live one
+static SlotArray* grow(WorkStealingDeque* deque, SlotArray* array, ptrdiff_t top, ptrdiff_t bottom) {
+    if (array->mask + 1 > SIZE_MAX / 2) {
+        return NULL;
+    }
+
+    SlotArray* new_array = array_create(2 * (array->mask + 1));
+    if (!new_array) {
+        return NULL;
+    }
+
+    for (ptrdiff_t index = top; index < bottom; ++index) {
+        array_put(new_array, index, array_get(array, index));
+    }
+
+    new_array->retired = array;
+    atomic_store_explicit(&deque->array, new_array, memory_order_release);
+
+    return new_array;
+}
+
+
+WorkStealingDeque* workStealingDequeCreate(size_t capacity) {
+    size_t slots = MIN_CAPACITY;
+    while (slots < capacity) {
+        if (slots > SIZE_MAX / 2) return NULL;
+        slots *= 2;
+    }
+
+    WorkStealingDeque* new_deque = aligned_alloc(CACHE_LINE_SIZE, sizeof(*new_deque));
+    if (new_deque) {
+        SlotArray* array = array_create(slots);
+        if (!array) {
+            free(new_deque);
+            return NULL;
+        }
+
+        atomic_init(&new_deque->top, 0);
+        atomic_init(&new_deque->bottom, 0);
+        atomic_init(&new_deque->array, array);
+    }
+
+    return new_deque;
+}
+
+void workStealingDequeDestroy(WorkStealingDeque* deque) {
+    if (deque) {
+        SlotArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+        while (array) {
+            SlotArray* retired = array->retired;
+            free(array);
+            array = retired;
+        }
+
+        free(deque);
+    }
+}
+
+size_t workStealingDequeSize(const WorkStealingDeque* deque) {
+    assert(deque);
+
+    ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    // a pop in progress briefly moves bottom below top
+    return bottom > top ? (size_t) (bottom - top) : 0;
+}
+
+WorkStealingDequeStatus workStealingDequePush(WorkStealingDeque* deque, void* element) {
+    assert(deque); assert(element);
+
+    ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    SlotArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+    if ((size_t) (bottom - top) > array->mask) {
+        array = grow(deque, array, top, bottom);
+        if (!array) {
+            return WORK_STEALING_DEQUE_MEM_ERROR;
+        }
+    }
+
+    array_put(array, bottom, element);
+
+    // the element must be visible before a thief can see the new bottom.
+    // (the paper uses a release fence and a relaxed store; a release store is
+    // equivalent here, and is understood by ThreadSanitizer)
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+
+    return WORK_STEALING_DEQUE_SUCCESS;
+}
+
+void* workStealingDequePop(WorkStealingDeque* deque) {
+    assert(deque);
+
+    ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    SlotArray* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+    // claim the bottom slot before looking at top. the full fence orders this store
+    // against the thieves' loads of bottom
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        // the deque was empty
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    void* element = array_get(array, bottom);
+    if (top == bottom) {
+        // the last element: race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            element = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return element;
+}
+
+void* workStealingDequeSteal(WorkStealingDeque* deque) {
+    assert(deque);
+
+    ptrdiff_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    ptrdiff_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    SlotArray* array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    void* element = array_get(array, top);
+
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        // lost the race to the owner or another thief
+        return NULL;
+    }
+
+    return element;
+}
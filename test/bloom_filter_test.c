@@ -0,0 +1,129 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bloom_filter.h"
+
+static uint64_t mix(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+
+START_TEST(test_filter_no_false_negatives)
+{
+	BloomFilter* filter = bloomFilterCreate(10000, 0.01);
+	ck_assert_ptr_nonnull(filter);
+	ck_assert_uint_eq(bloomFilterSizeBytes(filter) % 64, 0);
+
+	for (uint64_t i = 0; i < 10000; ++i)
+	{
+		bloomFilterAdd(filter, mix(i));
+	}
+
+	for (uint64_t i = 0; i < 10000; ++i)
+	{
+		ck_assert(bloomFilterMayContain(filter, mix(i)));
+	}
+
+	bloomFilterDestroy(filter);
+}
+END_TEST
+
+START_TEST(test_filter_false_positive_rate)
+{
+	const double rates[] = {0.1, 0.01, 0.001};
+	for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r)
+	{
+		BloomFilter* filter = bloomFilterCreate(100000, rates[r]);
+		for (uint64_t i = 0; i < 100000; ++i)
+		{
+			bloomFilterAdd(filter, mix(i));
+		}
+
+		size_t false_positives = 0;
+		const size_t probes = 1000000;
+		for (uint64_t i = 0; i < probes; ++i)
+		{
+			false_positives += bloomFilterMayContain(filter, mix(i + (1ULL << 40)));
+		}
+
+		// the sizing should come close to the requested rate
+		ck_assert((double)false_positives / probes < 1.5 * rates[r]);
+
+		bloomFilterDestroy(filter);
+	}
+}
+END_TEST
+
+START_TEST(test_filter_clear)
+{
+	BloomFilter* filter = bloomFilterCreate(0, 0.01);
+
+	bloomFilterAdd(filter, mix(1));
+	ck_assert(bloomFilterMayContain(filter, mix(1)));
+
+	bloomFilterClear(filter);
+	ck_assert(!bloomFilterMayContain(filter, mix(1)));
+
+	bloomFilterDestroy(filter);
+	bloomFilterDestroy(NULL);
+}
+END_TEST
+
+START_TEST(test_filter_allocator)
+{
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	BloomFilter* filter = bloomFilterCreateWithAllocator(10000, 0.01, &allocator);
+	ck_assert_ptr_nonnull(filter);
+	ck_assert_uint_eq(dsTrackerStats(tracker).allocations, 2);
+	ck_assert_uint_ge(dsTrackerStats(tracker).bytes_in_use, bloomFilterSizeBytes(filter));
+
+	for (uint64_t i = 0; i < 10000; ++i)
+	{
+		bloomFilterAdd(filter, mix(i));
+	}
+	for (uint64_t i = 0; i < 10000; ++i)
+	{
+		ck_assert(bloomFilterMayContain(filter, mix(i)));
+	}
+
+	bloomFilterDestroy(filter);
+	ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+}
+END_TEST
+
+Suite* bloom_filter_tests_suite(void)
+{
+	Suite* s = suite_create("Bloom Filter Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_filter_no_false_negatives);
+	tcase_add_test(tc_core, test_filter_false_positive_rate);
+	tcase_add_test(tc_core, test_filter_clear);
+	tcase_add_test(tc_core, test_filter_allocator);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = bloom_filter_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
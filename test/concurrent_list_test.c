@@ -0,0 +1,284 @@
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "concurrent_list.h"
+
+// elements are ints carrying a "freed" flag, so readers can detect use after free
+// without relying on the allocator
+typedef struct {
+    int value;
+    atomic_int freed;
+} Element;
+
+static atomic_long freed_count;
+
+static void* element_copy(const void* src) {
+    Element* dest = malloc(sizeof(*dest));
+    if (dest) {
+        dest->value = *(const int*) src;
+        atomic_init(&dest->freed, 0);
+    }
+
+    return dest;
+}
+
+// the element is leaked on purpose: readers still check its flag afterwards
+static void element_free(void* element) {
+    atomic_store(&((Element*) element)->freed, 1);
+    atomic_fetch_add(&freed_count, 1);
+}
+
+static int element_cmp(const void* first, const void* second) {
+    return ((const Element*) first)->value - *(const int*) second;
+}
+
+static void* int_copy(const void* src) {
+    int* dest = malloc(sizeof(*dest));
+    if (dest) {
+        *dest = *(const int*) src;
+    }
+
+    return dest;
+}
+
+static int int_cmp(const void* first, const void* second) {
+    return *(const int*) first - *(const int*) second;
+}
+
+static void sum_visit(const void* element, void* params) {
+    *(long*) params += *(const int*) element;
+}
+
+
+START_TEST(test_concurrent_list_basic) {
+    ConcurrentList* list = concurrentListCreate(int_copy, free, int_cmp);
+    ck_assert_uint_eq(concurrentListSize(list), 0);
+
+    for (int i = 1; i <= 5; ++i) {
+        ck_assert_int_eq(concurrentListPush(list, &i), CONCURRENT_LIST_SUCCESS);
+    }
+    int zero = 0, ten = 10, missing = 42;
+    ck_assert_int_eq(concurrentListPushFront(list, &zero), CONCURRENT_LIST_SUCCESS);
+    ck_assert_int_eq(concurrentListInsertAt(list, 100, &ten), CONCURRENT_LIST_SUCCESS);
+    ck_assert_uint_eq(concurrentListSize(list), 7);
+
+    // 0 1 2 3 4 5 10
+    ck_assert_int_eq(concurrentListIndexOf(list, &zero), 0);
+    ck_assert_int_eq(concurrentListIndexOf(list, &ten), 6);
+    ck_assert_int_eq(concurrentListIndexOf(list, &missing), -1);
+
+    concurrentListReadBegin(list);
+    ck_assert_int_eq(*(const int*) concurrentListGetAt(list, 3), 3);
+    ck_assert_ptr_eq(concurrentListGetAt(list, 7), NULL);
+    concurrentListReadEnd(list);
+
+    // 0 1 3 4 10
+    ck_assert_int_eq(concurrentListRemoveAt(list, 2), CONCURRENT_LIST_SUCCESS);
+    int five = 5;
+    ck_assert_int_eq(concurrentListRemove(list, &five), CONCURRENT_LIST_SUCCESS);
+    ck_assert_int_eq(concurrentListRemove(list, &missing), CONCURRENT_LIST_NOT_FOUND);
+    ck_assert_int_eq(concurrentListRemoveAt(list, 5), CONCURRENT_LIST_NOT_FOUND);
+    ck_assert_uint_eq(concurrentListSize(list), 5);
+
+    long sum = 0;
+    concurrentListForEach(list, sum_visit, &sum);
+    ck_assert_int_eq(sum, 18);
+
+    // removing the last element moves the tail back
+    ck_assert_int_eq(concurrentListRemoveAt(list, 4), CONCURRENT_LIST_SUCCESS);
+    int six = 6;
+    concurrentListPush(list, &six);
+    ck_assert_int_eq(concurrentListIndexOf(list, &six), 4);
+
+    while (concurrentListSize(list) > 0) {
+        ck_assert_int_eq(concurrentListRemoveAt(list, 0), CONCURRENT_LIST_SUCCESS);
+    }
+    concurrentListPush(list, &six);
+    ck_assert_int_eq(concurrentListIndexOf(list, &six), 0);
+
+    concurrentListSynchronize(list);
+    concurrentListDestroy(list);
+    concurrentListDestroy(NULL);
+}
+END_TEST
+
+START_TEST(test_concurrent_list_deferred_free) {
+    atomic_store(&freed_count, 0);
+    ConcurrentList* list = concurrentListCreate(element_copy, element_free, element_cmp);
+
+    for (int i = 0; i < 3; ++i) {
+        concurrentListPush(list, &i);
+    }
+
+    // removed while a read section holds it: not freed until the section ends
+    concurrentListReadBegin(list);
+    concurrentListReadBegin(list);
+    Element* held = (Element*) concurrentListGetAt(list, 1);
+    Element* last = (Element*) concurrentListGetAt(list, 2);
+    concurrentListReadEnd(list);
+
+    ck_assert_int_eq(concurrentListRemoveAt(list, 1), CONCURRENT_LIST_SUCCESS);
+    ck_assert_int_eq(atomic_load(&held->freed), 0);
+    ck_assert_int_eq(held->value, 1);
+
+    // the nested section ended, but the outer one still protects the element
+    int two = 2;
+    ck_assert_int_eq(concurrentListRemove(list, &two), CONCURRENT_LIST_SUCCESS);
+    ck_assert_int_eq(atomic_load(&held->freed), 0);
+    concurrentListReadEnd(list);
+
+    concurrentListSynchronize(list);
+    ck_assert_int_eq(atomic_load(&held->freed), 1);
+    ck_assert_int_eq(atomic_load(&freed_count), 2);
+    free(held);
+    free(last);
+
+    // without readers, removal frees right away
+    int zero = 0;
+    Element* first;
+    concurrentListReadBegin(list);
+    first = (Element*) concurrentListGetAt(list, 0);
+    concurrentListReadEnd(list);
+    concurrentListRemove(list, &zero);
+    ck_assert_int_eq(atomic_load(&first->freed), 1);
+    free(first);
+
+    concurrentListDestroy(list);
+}
+END_TEST
+
+#define READERS 3
+#define ROUNDS 2000
+#define LIVE 16
+
+typedef struct {
+    ConcurrentList* list;
+    atomic_int* done;
+    long walks;
+} ReaderArgs;
+
+static void* reader_thread(void* arg) {
+    ReaderArgs* args = arg;
+
+    while (!atomic_load(args->done)) {
+        concurrentListReadBegin(args->list);
+        int last = -1;
+        for (size_t i = 0;; ++i) {
+            const Element* element = concurrentListGetAt(args->list, i);
+            if (!element) {
+                break;
+            }
+
+            // a reachable element is never freed while we're inside the section,
+            // and the writer keeps the list sorted
+            ck_assert_int_eq(atomic_load(&((Element*) element)->freed), 0);
+            ck_assert_int_gt(element->value, last);
+            last = element->value;
+        }
+        concurrentListReadEnd(args->list);
+
+        ++args->walks;
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+START_TEST(test_concurrent_list_readers_and_writer) {
+    atomic_store(&freed_count, 0);
+    ConcurrentList* list = concurrentListCreate(element_copy, element_free, element_cmp);
+
+    atomic_int done;
+    atomic_init(&done, 0);
+
+    pthread_t threads[READERS];
+    ReaderArgs args[READERS];
+    for (int i = 0; i < READERS; ++i) {
+        args[i] = (ReaderArgs) {list, &done, 0};
+        pthread_create(&threads[i], NULL, reader_thread, &args[i]);
+    }
+
+    // a sliding window: append the next value, drop the oldest. freed elements are
+    // collected here, and released once every reader is done
+    Element** removed = malloc(ROUNDS * sizeof(*removed));
+    size_t removed_count = 0;
+    for (int value = 0; value < ROUNDS; ++value) {
+        concurrentListPush(list, &value);
+
+        if (concurrentListSize(list) > LIVE) {
+            concurrentListReadBegin(list);
+            removed[removed_count++] = (Element*) concurrentListGetAt(list, 0);
+            concurrentListReadEnd(list);
+
+            ck_assert_int_eq(concurrentListRemoveAt(list, 0), CONCURRENT_LIST_SUCCESS);
+        }
+
+        if (value % 64 == 0) {
+            sched_yield();
+        }
+    }
+
+    atomic_store(&done, 1);
+    for (int i = 0; i < READERS; ++i) {
+        pthread_join(threads[i], NULL);
+        ck_assert_int_gt(args[i].walks, 0);
+    }
+
+    concurrentListSynchronize(list);
+    ck_assert_int_eq(atomic_load(&freed_count), ROUNDS - LIVE);
+    ck_assert_uint_eq(concurrentListSize(list), LIVE);
+
+    int first_live = ROUNDS - LIVE;
+    ck_assert_int_eq(concurrentListIndexOf(list, &first_live), 0);
+
+    for (size_t i = 0; i < removed_count; ++i) {
+        free(removed[i]);
+    }
+    free(removed);
+
+    // the remaining elements are freed by the list, but their memory is ours
+    Element* live[LIVE];
+    concurrentListReadBegin(list);
+    for (size_t i = 0; i < LIVE; ++i) {
+        live[i] = (Element*) concurrentListGetAt(list, i);
+    }
+    concurrentListReadEnd(list);
+
+    concurrentListDestroy(list);
+    for (size_t i = 0; i < LIVE; ++i) {
+        ck_assert_int_eq(atomic_load(&live[i]->freed), 1);
+        free(live[i]);
+    }
+}
+END_TEST
+
+Suite* concurrent_list_tests_suite(void) {
+    Suite* s = suite_create("Concurrent List Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_concurrent_list_basic);
+    tcase_add_test(tc_core, test_concurrent_list_deferred_free);
+    tcase_add_test(tc_core, test_concurrent_list_readers_and_writer);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = concurrent_list_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
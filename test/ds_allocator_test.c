@@ -0,0 +1,245 @@
+#include <check.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds_allocator.h"
+#include "hash_map.h"
+#include "linked_list.h"
+#include "vector.h"
+
+static void* int_copy(const void* src) {
+    int* dest = malloc(sizeof(*dest));
+    if (dest) {
+        *dest = *(const int*) src;
+    }
+
+    return dest;
+}
+
+static int int_cmp(const void* first, const void* second) {
+    int a = *(const int*) first;
+    int b = *(const int*) second;
+
+    return (a > b) - (a < b);
+}
+
+static size_t int_hash(const void* key, size_t size) {
+    return (size_t) *(const int*) key % size;
+}
+
+static int is_aligned(const void* ptr) {
+    return 0 == (uintptr_t) ptr % alignof(max_align_t);
+}
+
+
+START_TEST(test_arena) {
+    DsArena* arena = dsArenaCreate(1024, NULL);
+    DsAllocator allocator = dsArenaAllocator(arena);
+
+    char* first = dsAlloc(&allocator, 10);
+    char* second = dsAlloc(&allocator, 10);
+    ck_assert(is_aligned(first) && is_aligned(second));
+    ck_assert_ptr_eq(second, first + alignof(max_align_t));
+    ck_assert_uint_eq(dsArenaBytesUsed(arena), 2 * alignof(max_align_t));
+
+    // the most recent allocation grows in place, and freeing it gives it back
+    memset(second, 'x', 10);
+    ck_assert_ptr_eq(dsRealloc(&allocator, second, 10, 100), second);
+    ck_assert_int_eq(second[9], 'x');
+    dsFree(&allocator, second, 100);
+    ck_assert_ptr_eq(dsAlloc(&allocator, 10), second);
+
+    // anything else moves, and freeing it is a no-op
+    strcpy(first, "arena");
+    char* moved = dsRealloc(&allocator, first, 10, 20);
+    ck_assert_ptr_ne(moved, first);
+    ck_assert_str_eq(moved, "arena");
+    size_t used = dsArenaBytesUsed(arena);
+    dsFree(&allocator, first, 10);
+    ck_assert_uint_eq(dsArenaBytesUsed(arena), used);
+
+    // oversized requests get their own block, and the current one keeps filling up
+    char* before = dsAlloc(&allocator, 16);
+    char* large = dsAlloc(&allocator, 4096);
+    ck_assert_ptr_nonnull(large);
+    memset(large, 0, 4096);
+    ck_assert_ptr_eq(dsAlloc(&allocator, 16), before + 16);
+
+    // fill several blocks, then start over
+    for (int i = 0; i < 100; ++i) {
+        ck_assert_ptr_nonnull(dsAlloc(&allocator, 100));
+    }
+    dsArenaReset(arena);
+    ck_assert_uint_eq(dsArenaBytesUsed(arena), 0);
+    ck_assert_ptr_nonnull(dsAlloc(&allocator, 100));
+
+    dsArenaDestroy(arena);
+    dsArenaDestroy(NULL);
+}
+END_TEST
+
+START_TEST(test_pool) {
+    DsTracker* tracker = dsTrackerCreate(NULL);
+    DsAllocator parent = dsTrackerAllocator(tracker);
+
+    DsPool* pool = dsPoolCreate(24, 4, &parent);
+    DsAllocator allocator = dsPoolAllocator(pool);
+
+    // objects are handed out in address order, a chunk at a time
+    char* objects[5];
+    for (int i = 0; i < 5; ++i) {
+        objects[i] = dsAlloc(&allocator, 24);
+        ck_assert_ptr_nonnull(objects[i]);
+        memset(objects[i], i, 24);
+    }
+    ck_assert_ptr_eq(objects[1], objects[0] + 24);
+    ck_assert_uint_eq(dsTrackerStats(tracker).allocations, 3); // pool + 2 chunks
+
+    // freed objects are reused first
+    dsFree(&allocator, objects[2], 24);
+    ck_assert_ptr_eq(dsAlloc(&allocator, 16), objects[2]);
+
+    // larger requests go to the parent, also when reallocating
+    size_t parent_allocations = dsTrackerStats(tracker).allocations;
+    char* large = dsAlloc(&allocator, 100);
+    ck_assert_uint_eq(dsTrackerStats(tracker).allocations, parent_allocations + 1);
+    char* grown = dsRealloc(&allocator, objects[4], 24, 48);
+    ck_assert_int_eq(grown[23], 4);
+    char* shrunk = dsRealloc(&allocator, grown, 48, 8);
+    ck_assert_int_eq(shrunk[7], 4);
+    dsFree(&allocator, large, 100);
+    dsFree(&allocator, shrunk, 8);
+
+    dsPoolDestroy(pool);
+    ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+    dsTrackerDestroy(tracker);
+}
+END_TEST
+
+START_TEST(test_tracker) {
+    DsTracker* tracker = dsTrackerCreate(NULL);
+    DsAllocator allocator = dsTrackerAllocator(tracker);
+
+    void* first = dsAlloc(&allocator, 100);
+    void* second = dsRealloc(&allocator, NULL, 0, 50);
+    second = dsRealloc(&allocator, second, 50, 150);
+    dsFree(&allocator, first, 100);
+    second = dsRealloc(&allocator, second, 150, 10);
+    dsFree(&allocator, NULL, 0);
+
+    DsAllocatorStats stats = dsTrackerStats(tracker);
+    ck_assert_uint_eq(stats.allocations, 2);
+    ck_assert_uint_eq(stats.frees, 1);
+    ck_assert_uint_eq(stats.bytes_in_use, 10);
+    ck_assert_uint_eq(stats.peak_bytes, 250);
+    ck_assert_uint_eq(stats.total_bytes, 250);
+
+    dsFree(&allocator, second, 10);
+    ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+
+    dsTrackerDestroy(tracker);
+}
+END_TEST
+
+START_TEST(test_containers_tracked) {
+    DsTracker* tracker = dsTrackerCreate(NULL);
+    DsAllocator allocator = dsTrackerAllocator(tracker);
+
+    HashMapEntryHandlers handlers = {int_copy, free, int_copy, free};
+    HashMap* map = hashMapInitWithAllocator(int_hash, int_cmp, handlers, &allocator);
+    for (int i = 0; i < 1000; ++i) {
+        ck_assert_int_eq(hashMapInsert(map, &i, &i), HASH_MAP_SUCCESS);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        hashMapRemove(map, &i);
+    }
+    ck_assert(dsTrackerStats(tracker).bytes_in_use > 500 * sizeof(void*));
+    hashMapDestroy(map);
+    ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+
+    LinkedList* list = linkedListCreateIndexedWithAllocator(int_copy, free, int_cmp, &allocator);
+    for (int i = 0; i < 100; ++i) {
+        linkedListPush(list, &i);
+    }
+    LinkedList* clone = linkedListClone(list);
+    LinkedList* shared = linkedListCloneShared(clone);
+    LinkedList* tail = linkedListSplitAt(shared, 50);
+    linkedListSplice(list, 10, tail);
+    free(linkedListRemoveAt(list, 0));
+    linkedListDestroy(tail);
+    linkedListDestroy(shared);
+    linkedListDestroy(clone);
+    linkedListDestroy(list);
+    ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+
+    Vector* vector = vectorCreateInlineWithAllocator(sizeof(int), int_cmp, &allocator);
+    for (int i = 0; i < 1000; ++i) {
+        vectorPush(vector, &i);
+    }
+    Vector* vector_clone = vectorClone(vector);
+    vectorDestroy(vector);
+    vectorDestroy(vector_clone);
+    ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+
+    dsTrackerDestroy(tracker);
+}
+END_TEST
+
+START_TEST(test_containers_in_arena) {
+    // a per-request arena: containers are built, then dropped with the arena
+    DsArena* arena = dsArenaCreate(4096, NULL);
+    DsAllocator allocator = dsArenaAllocator(arena);
+
+    for (int round = 0; round < 3; ++round) {
+        HashMapEntryHandlers handlers = {int_copy, free, int_copy, free};
+        HashMap* map = hashMapInitWithAllocator(int_hash, int_cmp, handlers, &allocator);
+        Vector* vector = vectorCreateWithAllocator(int_copy, free, int_cmp, &allocator);
+        for (int i = 0; i < 200; ++i) {
+            ck_assert_int_eq(hashMapInsert(map, &i, &i), HASH_MAP_SUCCESS);
+            ck_assert_int_eq(vectorPush(vector, &i), VECTOR_SUCCESS);
+        }
+
+        int key = 123;
+        ck_assert_int_eq(*(int*) hashMapGet(map, &key), 123);
+        ck_assert_int_eq(vectorIndexOf(vector, &key), 123);
+
+        // the elements are the user's: free them, but leave the rest to the arena
+        hashMapDestroy(map);
+        vectorDestroy(vector);
+        dsArenaReset(arena);
+    }
+
+    dsArenaDestroy(arena);
+}
+END_TEST
+
+Suite* ds_allocator_tests_suite(void) {
+    Suite* s = suite_create("Allocator Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_arena);
+    tcase_add_test(tc_core, test_pool);
+    tcase_add_test(tc_core, test_tracker);
+    tcase_add_test(tc_core, test_containers_tracked);
+    tcase_add_test(tc_core, test_containers_in_arena);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = ds_allocator_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
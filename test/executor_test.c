@@ -0,0 +1,116 @@
+#include <check.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "executor.h"
+
+typedef struct {
+    Executor* executor;
+    int n;
+    long result;
+} FibTask;
+
+// fork/join fibonacci: each call spawns one half and runs the other itself
+static void fib(void* arg) {
+    FibTask* task = arg;
+    if (task->n < 2) {
+        task->result = task->n;
+        return;
+    }
+
+    FibTask left = {task->executor, task->n - 1, 0};
+    FibTask right = {task->executor, task->n - 2, 0};
+
+    ExecutorTaskGroup group;
+    executorTaskGroupInit(&group);
+    ck_assert_int_eq(executorSpawn(task->executor, &group, fib, &left), EXECUTOR_SUCCESS);
+    fib(&right);
+    executorJoin(task->executor, &group);
+
+    task->result = left.result + right.result;
+}
+
+static void increment(void* arg) {
+    atomic_fetch_add((atomic_long*) arg, 1);
+}
+
+
+START_TEST(test_executor_create) {
+    Executor* executor = executorCreate(3);
+    ck_assert_uint_eq(executorThreads(executor), 3);
+
+    // an empty group joins immediately
+    ExecutorTaskGroup group;
+    executorTaskGroupInit(&group);
+    executorJoin(executor, &group);
+
+    executorDestroy(executor);
+    executorDestroy(NULL);
+}
+END_TEST
+
+START_TEST(test_executor_external_spawn) {
+    Executor* executor = executorCreate(4);
+
+    atomic_long counter;
+    atomic_init(&counter, 0);
+
+    ExecutorTaskGroup group;
+    executorTaskGroupInit(&group);
+    for (int i = 0; i < 10000; ++i) {
+        ck_assert_int_eq(executorSpawn(executor, &group, increment, &counter), EXECUTOR_SUCCESS);
+    }
+    executorJoin(executor, &group);
+    ck_assert_int_eq(atomic_load(&counter), 10000);
+
+    // tasks without a group still finish before the executor is destroyed
+    for (int i = 0; i < 1000; ++i) {
+        executorSpawn(executor, NULL, increment, &counter);
+    }
+    executorDestroy(executor);
+    ck_assert_int_eq(atomic_load(&counter), 11000);
+}
+END_TEST
+
+START_TEST(test_executor_fork_join) {
+    for (size_t threads = 1; threads <= 4; threads *= 2) {
+        Executor* executor = executorCreate(threads);
+
+        FibTask root = {executor, 20, 0};
+        ExecutorTaskGroup group;
+        executorTaskGroupInit(&group);
+        executorSpawn(executor, &group, fib, &root);
+        executorJoin(executor, &group);
+
+        ck_assert_int_eq(root.result, 6765);
+        executorDestroy(executor);
+    }
+}
+END_TEST
+
+Suite* executor_tests_suite(void) {
+    Suite* s = suite_create("Executor Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_executor_create);
+    tcase_add_test(tc_core, test_executor_external_spawn);
+    tcase_add_test(tc_core, test_executor_fork_join);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = executor_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,457 @@
+#include <check.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hash_map.h"
+#include "hash_map_log.h"
+
+// int keys, string values
+
+static void* copy_int(const void* n)
+{
+	int* copy = malloc(sizeof(int));
+	*copy = *(const int*)n;
+	return copy;
+}
+
+static int compare_int(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+static size_t hash_int(const void* n, size_t size)
+{
+	return (size_t)*(const int*)n % size;
+}
+
+static void* copy_string(const void* s)
+{
+	return strdup(s);
+}
+
+static size_t serialize_int(const void* n, void* buffer, size_t capacity)
+{
+	if (capacity >= sizeof(int))
+	{
+		memcpy(buffer, n, sizeof(int));
+	}
+	return sizeof(int);
+}
+
+static void* deserialize_int(const void* buffer, size_t size)
+{
+	if (sizeof(int) != size) return NULL;
+	int* n = malloc(sizeof(int));
+	memcpy(n, buffer, sizeof(int));
+	return n;
+}
+
+static size_t serialize_string(const void* s, void* buffer, size_t capacity)
+{
+	size_t size = strlen(s);
+	if (capacity >= size)
+	{
+		memcpy(buffer, s, size);
+	}
+	return size;
+}
+
+static void* deserialize_string(const void* buffer, size_t size)
+{
+	char* s = malloc(size + 1);
+	memcpy(s, buffer, size);
+	s[size] = '\0';
+	return s;
+}
+
+static HashMapEntryHandlers handlers = {copy_int, free, copy_string, free};
+static HashMapSerializers serializers = {serialize_int, deserialize_int,
+					 serialize_string, deserialize_string};
+
+static HashMap* createMap(void)
+{
+	return hashMapInit((key_hash_func_t)hash_int, (key_cmp_func_t)compare_int, handlers);
+}
+
+static char* makeDirectory(void)
+{
+	char* path = strdup("/tmp/hash_map_log_test_XXXXXX");
+	ck_assert_ptr_nonnull(mkdtemp(path));
+	return path;
+}
+
+static void removeDirectory(char* path)
+{
+	DIR* dir = opendir(path);
+	struct dirent* entry;
+	while ((entry = readdir(dir)))
+	{
+		char file[512];
+		snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+		unlink(file);
+	}
+	closedir(dir);
+	rmdir(path);
+	free(path);
+}
+
+/**
+ * Returns the number of log files in the directory, and their total size.
+ **/
+static size_t logFiles(const char* path, off_t* total_size, char* last, size_t last_size)
+{
+	DIR* dir = opendir(path);
+	struct dirent* entry;
+	size_t count = 0;
+	*total_size = 0;
+	while ((entry = readdir(dir)))
+	{
+		size_t length = strlen(entry->d_name);
+		if (length < 4 || strcmp(entry->d_name + length - 4, ".log")) continue;
+
+		char file[512];
+		snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+		struct stat st;
+		ck_assert_int_eq(stat(file, &st), 0);
+		*total_size += st.st_size;
+		if (last && strcmp(file, last) > 0)
+		{
+			snprintf(last, last_size, "%s", file);
+		}
+		++count;
+	}
+	closedir(dir);
+	return count;
+}
+
+static const char* valueOf(int key, int round)
+{
+	static char value[64];
+	snprintf(value, sizeof(value), "value %d of round %d", key, round);
+	return value;
+}
+
+/**
+ * Fills the map through the log: every key gets an insertion, every other one
+ * an update, and every third one is removed.
+ **/
+static void update(HashMapLog* log, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		ck_assert_int_eq(hashMapLogInsert(log, &i, valueOf(i, 0)), HASH_MAP_LOG_SUCCESS);
+	}
+	for (int i = 0; i < count; i += 2)
+	{
+		ck_assert_int_eq(hashMapLogInsert(log, &i, valueOf(i, 1)), HASH_MAP_LOG_SUCCESS);
+	}
+	for (int i = 0; i < count; i += 3)
+	{
+		ck_assert_int_eq(hashMapLogRemove(log, &i), HASH_MAP_LOG_SUCCESS);
+	}
+}
+
+static void checkUpdated(HashMap* map, int count)
+{
+	ck_assert_uint_eq(hashMapSize(map), count - (count + 2) / 3);
+	for (int i = 0; i < count; ++i)
+	{
+		const char* value = hashMapGet(map, &i);
+		if (0 == i % 3)
+		{
+			ck_assert_ptr_null(value);
+		}
+		else
+		{
+			ck_assert_str_eq(value, valueOf(i, i % 2 ? 0 : 1));
+		}
+	}
+}
+
+START_TEST(test_log_replay)
+{
+	char* path = makeDirectory();
+	HashMap* map = createMap();
+	HashMapLog* log = hashMapLogOpen(map, path, handlers, serializers, NULL);
+	ck_assert_ptr_nonnull(log);
+	update(log, 3000);
+	checkUpdated(map, 3000);
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	// replaying adds a log file per opening, and keeps every update
+	for (int i = 0; i < 2; ++i)
+	{
+		map = createMap();
+		log = hashMapLogOpen(map, path, handlers, serializers, NULL);
+		ck_assert_ptr_nonnull(log);
+		checkUpdated(map, 3000);
+		ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+		hashMapDestroy(map);
+	}
+
+	off_t size;
+	ck_assert_uint_eq(logFiles(path, &size, NULL, 0), 3);
+	removeDirectory(path);
+}
+END_TEST
+
+START_TEST(test_log_torn_tail)
+{
+	char* path = makeDirectory();
+	HashMap* map = createMap();
+	HashMapLog* log = hashMapLogOpen(map, path, handlers, serializers, NULL);
+	update(log, 100);
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	// a record cut short by a crash: its header promises more than is there
+	char last[512] = "";
+	off_t size;
+	logFiles(path, &size, last, sizeof(last));
+	FILE* file = fopen(last, "ab");
+	uint32_t torn[3] = {100, 0, 0};
+	ck_assert_int_eq(fwrite(torn, sizeof(torn), 1, file), 1);
+	fclose(file);
+
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, NULL);
+	ck_assert_ptr_nonnull(log);
+	checkUpdated(map, 100);
+
+	// the torn record is gone, so updates after it are replayed
+	int key = 1000;
+	ck_assert_int_eq(hashMapLogInsert(log, &key, "after the crash"), HASH_MAP_LOG_SUCCESS);
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, NULL);
+	ck_assert_ptr_nonnull(log);
+	ck_assert_str_eq(hashMapGet(map, &key), "after the crash");
+	hashMapDestroy(map);
+	hashMapLogClose(log);
+	removeDirectory(path);
+}
+END_TEST
+
+START_TEST(test_log_compaction)
+{
+	char* path = makeDirectory();
+	HashMapLogOptions options = hashMapLogDefaultOptions();
+	options.sync_policy = HASH_MAP_LOG_SYNC_NEVER;
+	options.buffer_size = 1024;
+	options.compact_size = 16 * 1024;
+
+	HashMap* map = createMap();
+	HashMapLog* log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	ck_assert_ptr_nonnull(log);
+	for (int round = 0; round < 10; ++round)
+	{
+		update(log, 1000);
+	}
+	checkUpdated(map, 1000);
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	// the compactions left the snapshot and the newest log files; with
+	// every record kept, the log files would take over 600 KiB
+	off_t size;
+	ck_assert_uint_le(logFiles(path, &size, NULL, 0), 2);
+	ck_assert_int_lt(size, 300 * 1024);
+	char snapshot[512];
+	snprintf(snapshot, sizeof(snapshot), "%s/snapshot", path);
+	ck_assert_int_eq(access(snapshot, F_OK), 0);
+
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	ck_assert_ptr_nonnull(log);
+	checkUpdated(map, 1000);
+
+	// an explicit compaction of what was just replayed
+	ck_assert_int_eq(hashMapLogCompact(log), HASH_MAP_LOG_SUCCESS);
+	int key = 0;
+	ck_assert_int_eq(hashMapLogInsert(log, &key, "after compaction"), HASH_MAP_LOG_SUCCESS);
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	ck_assert_str_eq(hashMapGet(map, &key), "after compaction");
+	ck_assert_uint_eq(hashMapSize(map), 1000 - (1000 + 2) / 3 + 1);
+	hashMapLogClose(log);
+	hashMapDestroy(map);
+	removeDirectory(path);
+}
+END_TEST
+
+START_TEST(test_log_sync_policies)
+{
+	char* path = makeDirectory();
+	HashMapLogOptions options = hashMapLogDefaultOptions();
+	options.sync_policy = HASH_MAP_LOG_SYNC_ALWAYS;
+
+	// synced updates are in the file when they return
+	HashMap* map = createMap();
+	HashMapLog* log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	off_t empty_size;
+	off_t size;
+	logFiles(path, &empty_size, NULL, 0);
+	int key = 1;
+	hashMapLogInsert(log, &key, "synced");
+	logFiles(path, &size, NULL, 0);
+	ck_assert_int_gt(size, empty_size);
+	hashMapLogClose(log);
+	hashMapDestroy(map);
+
+	// periodic syncs write what was buffered in the background
+	options.sync_policy = HASH_MAP_LOG_SYNC_PERIODIC;
+	options.sync_interval_ms = 10;
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	logFiles(path, &empty_size, NULL, 0);
+	hashMapLogInsert(log, &key, "buffered");
+	size = empty_size;
+	for (int i = 0; i < 500 && size <= empty_size; ++i)
+	{
+		usleep(1000);
+		logFiles(path, &size, NULL, 0);
+	}
+	ck_assert_int_gt(size, empty_size);
+	hashMapLogClose(log);
+	hashMapDestroy(map);
+
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	ck_assert_str_eq(hashMapGet(map, &key), "buffered");
+	hashMapLogClose(log);
+	hashMapDestroy(map);
+	removeDirectory(path);
+}
+END_TEST
+
+START_TEST(test_log_compaction_during_sync)
+{
+	// periodic syncs of an idle log keep the writer on the log file, which
+	// compactions replace under it
+	char* path = makeDirectory();
+	HashMapLogOptions options = hashMapLogDefaultOptions();
+	options.sync_interval_ms = 1;
+	HashMap* map = createMap();
+	HashMapLog* log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	ck_assert_ptr_nonnull(log);
+	for (int i = 0; i < 200; ++i)
+	{
+		ck_assert_int_eq(hashMapLogInsert(log, &i, valueOf(i, 0)), HASH_MAP_LOG_SUCCESS);
+		usleep(500);
+		ck_assert_int_eq(hashMapLogCompact(log), HASH_MAP_LOG_SUCCESS);
+	}
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	map = createMap();
+	log = hashMapLogOpen(map, path, handlers, serializers, &options);
+	ck_assert_uint_eq(hashMapSize(map), 200);
+	hashMapLogClose(log);
+	hashMapDestroy(map);
+	removeDirectory(path);
+}
+END_TEST
+
+// case-insensitive string keys, which keep their case when serialized
+
+static size_t hash_caseless(const void* s, size_t size)
+{
+	size_t hash = 5381;
+	for (const char* c = s; *c; ++c)
+	{
+		hash = 33 * hash + tolower((unsigned char)*c);
+	}
+	return hash % size;
+}
+
+static int compare_caseless(const void* a, const void* b)
+{
+	return strcasecmp(a, b);
+}
+
+START_TEST(test_log_compaction_equal_keys)
+{
+	// keys that are equal to the map but serialize differently must still
+	// fold into one record each
+	HashMapEntryHandlers string_handlers = {copy_string, free, copy_string, free};
+	HashMapSerializers string_serializers = {serialize_string, deserialize_string,
+						 serialize_string, deserialize_string};
+	char* path = makeDirectory();
+	HashMap* map = hashMapInit(hash_caseless, compare_caseless, string_handlers);
+	HashMapLog* log = hashMapLogOpen(map, path, string_handlers, string_serializers, NULL);
+	ck_assert_ptr_nonnull(log);
+	for (int i = 0; i < 100; ++i)
+	{
+		char key[16];
+		snprintf(key, sizeof(key), "key %d", i);
+		ck_assert_int_eq(hashMapLogInsert(log, key, "old"), HASH_MAP_LOG_SUCCESS);
+		snprintf(key, sizeof(key), "KEY %d", i);
+		ck_assert_int_eq(hashMapLogInsert(log, key, "new"), HASH_MAP_LOG_SUCCESS);
+	}
+	ck_assert_int_eq(hashMapLogInsert(log, "removed", "old"), HASH_MAP_LOG_SUCCESS);
+	ck_assert_int_eq(hashMapLogRemove(log, "REMOVED"), HASH_MAP_LOG_SUCCESS);
+	ck_assert_int_eq(hashMapLogCompact(log), HASH_MAP_LOG_SUCCESS);
+	ck_assert_int_eq(hashMapLogClose(log), HASH_MAP_LOG_SUCCESS);
+	hashMapDestroy(map);
+
+	map = hashMapInit(hash_caseless, compare_caseless, string_handlers);
+	log = hashMapLogOpen(map, path, string_handlers, string_serializers, NULL);
+	ck_assert_ptr_nonnull(log);
+	ck_assert_uint_eq(hashMapSize(map), 100);
+	for (int i = 0; i < 100; ++i)
+	{
+		char key[16];
+		snprintf(key, sizeof(key), "Key %d", i);
+		ck_assert_str_eq(hashMapGet(map, key), "new");
+	}
+	ck_assert_int_eq(hashMapContains(map, "removed"), 0);
+	hashMapLogClose(log);
+	hashMapDestroy(map);
+	removeDirectory(path);
+}
+END_TEST
+
+Suite* hash_map_log_tests_suite(void)
+{
+	Suite* s = suite_create("Hash Map Log Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_log_replay);
+	tcase_add_test(tc_core, test_log_torn_tail);
+	tcase_add_test(tc_core, test_log_compaction);
+	tcase_add_test(tc_core, test_log_sync_policies);
+	tcase_add_test(tc_core, test_log_compaction_during_sync);
+	tcase_add_test(tc_core, test_log_compaction_equal_keys);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = hash_map_log_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
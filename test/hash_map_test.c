@@ -1,6 +1,7 @@
 #include <malloc.h>
 #include <stdio.h>
 
+#include "executor.h"
 #include "hash_map.h"
 #include "test_utils.h"
 
@@ -139,6 +140,585 @@ int test_size()
 }
 
 
+int test_contains()
+{
+	HashMap* map = hashMapInit(hash_int,
+				   compare_int,
+				   handlers);
+	for (int i = 0; i < 34; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+
+	for (int i = 0; i < 68; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), i < 34);
+	}
+
+	hashMapClear(map);
+	assert_int_eq(hashMapSize(map), 0);
+	for (int i = 0; i < 34; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), 0);
+	}
+
+	hashMapDestroy(map);
+	return 1;
+}
+
+
+int test_bloom_filter()
+{
+	HashMap* map = hashMapInit(hash_int,
+				   compare_int,
+				   handlers);
+	for (int i = 0; i < 10; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+
+	// enabling the filter picks up the existing keys, and it is kept in
+	// sync across insertions and resizes
+	assert_int_eq(hashMapEnableBloomFilter(map, 0.01), HASH_MAP_SUCCESS);
+	for (int i = 10; i < 1000; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), 1);
+		assert_int_eq(*(int*)hashMapGet(map, &i), i);
+	}
+
+	for (int i = 1000; i < 2000; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), 0);
+		assert_null(hashMapGet(map, &i));
+	}
+
+	for (int i = 0; i < 1000; i += 2)
+	{
+		hashMapRemove(map, &i);
+	}
+	for (int i = 0; i < 1000; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), i % 2);
+	}
+
+	hashMapClear(map);
+	int k = 1;
+	assert_int_eq(hashMapContains(map, &k), 0);
+	hashMapInsert(map, &k, &k);
+	assert_int_eq(hashMapContains(map, &k), 1);
+
+	hashMapDestroy(map);
+	return 1;
+}
+
+
+size_t hash_constant(void* value, size_t size)
+{
+	(void)value;
+	return 7 % size;
+}
+
+
+int test_colliding_keys()
+{
+	// every key has the same full hash: the chain is turned into a tree,
+	// and back into a chain as it shrinks
+	HashMap* map = hashMapInit(hash_constant,
+				   compare_int,
+				   handlers);
+	const int count = 3000;
+	for (int i = 0; i < count; ++i)
+	{
+		int key = (i * 7919) % count;
+		assert_int_eq(hashMapInsert(map, &key, &i), HASH_MAP_SUCCESS);
+	}
+	assert_int_eq(hashMapSize(map), count);
+	for (int i = 0; i < count; ++i)
+	{
+		int key = (i * 7919) % count;
+		assert_int_eq(*(int*)hashMapGet(map, &key), i);
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (i % 10) hashMapRemove(map, &i);
+	}
+	assert_int_eq(hashMapSize(map), count / 10);
+	for (int i = 0; i < count + 10; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), i < count && 0 == i % 10);
+	}
+
+	for (int i = 0; i < count; i += 10)
+	{
+		hashMapRemove(map, &i);
+		int k = count - 1 - i;
+		hashMapInsert(map, &k, &k);
+	}
+	assert_int_eq(hashMapSize(map), count / 10);
+	for (int i = 0; i < count; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), 0 == (count - 1 - i) % 10);
+	}
+
+	hashMapClear(map);
+	assert_int_eq(hashMapSize(map), 0);
+	for (int i = 0; i < 100; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+	assert_int_eq(*(int*)hashMapGet(map, &(int){42}), 42);
+
+	hashMapDestroy(map);
+	return 1;
+}
+
+
+void record_order(void* value, void* order)
+{
+	int** itr = order;
+	*(*itr)++ = *(int*)value;
+}
+
+int test_seeded_placement()
+{
+	// maps are seeded separately, so the same keys land in different buckets
+	HashMap* first = hashMapInit(hash_int, compare_int, handlers);
+	HashMap* second = hashMapInit(hash_int, compare_int, handlers);
+	for (int i = 0; i < 100; ++i)
+	{
+		hashMapInsert(first, &i, &i);
+		hashMapInsert(second, &i, &i);
+	}
+
+	int first_order[100];
+	int second_order[100];
+	int* itr = first_order;
+	hashMapForEach(first, record_order, &itr);
+	itr = second_order;
+	hashMapForEach(second, record_order, &itr);
+	assert_int_eq(0 != memcmp(first_order, second_order, sizeof(first_order)), 1);
+
+	hashMapDestroy(first);
+	hashMapDestroy(second);
+	return 1;
+}
+
+
+int test_cuckoo()
+{
+	HashMap* map = hashMapInitCuckoo(hash_int,
+					 compare_int,
+					 handlers);
+	const int count = 20000;
+	for (int i = 0; i < count; ++i)
+	{
+		assert_int_eq(hashMapInsert(map, &i, &i), HASH_MAP_SUCCESS);
+	}
+	assert_int_eq(hashMapSize(map), count);
+
+	for (int i = 0; i < count; i += 2)
+	{
+		int new_value = -i;
+		assert_int_eq(hashMapInsert(map, &i, &new_value), HASH_MAP_SUCCESS);
+	}
+	assert_int_eq(hashMapSize(map), count);
+	for (int i = 0; i < count; ++i)
+	{
+		assert_int_eq(*(int*)hashMapGet(map, &i), i % 2 ? i : -i);
+	}
+
+	for (int i = 0; i < count; i += 3)
+	{
+		hashMapRemove(map, &i);
+	}
+	for (int i = 0; i < 2 * count; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), i < count && i % 3);
+	}
+	assert_int_eq(hashMapSize(map), count - (count + 2) / 3);
+
+	hashMapClear(map);
+	assert_int_eq(hashMapSize(map), 0);
+	int k = 5;
+	assert_null(hashMapGet(map, &k));
+	hashMapInsert(map, &k, &k);
+	assert_int_eq(*(int*)hashMapGet(map, &k), 5);
+
+	hashMapDestroy(map);
+	return 1;
+}
+
+
+int test_cuckoo_colliding_keys()
+{
+	// every key has the same two buckets: the ones that don't fit go
+	// to the overflow list
+	HashMap* map = hashMapInitCuckoo(hash_constant,
+					 compare_int,
+					 handlers);
+	for (int i = 0; i < 50; ++i)
+	{
+		assert_int_eq(hashMapInsert(map, &i, &i), HASH_MAP_SUCCESS);
+	}
+	assert_int_eq(hashMapSize(map), 50);
+	for (int i = 0; i < 50; ++i)
+	{
+		assert_int_eq(*(int*)hashMapGet(map, &i), i);
+	}
+
+	for (int i = 0; i < 50; i += 2)
+	{
+		hashMapRemove(map, &i);
+	}
+	for (int i = 0; i < 60; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), i < 50 && i % 2);
+	}
+
+	hashMapDestroy(map);
+	return 1;
+}
+
+
+void add_int(void* value, void* sum)
+{
+	*(long*)sum += *(int*)value;
+}
+
+int test_cuckoo_for_each()
+{
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	HashMap* map = hashMapInitCuckooWithAllocator(hash_int,
+						      compare_int,
+						      handlers,
+						      &allocator);
+	assert_int_eq(hashMapEnableBloomFilter(map, 0.01), HASH_MAP_SUCCESS);
+
+	long expected = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+		expected += i;
+	}
+	for (int i = 1000; i < 2000; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), 0);
+	}
+
+	long sum = 0;
+	hashMapForEach(map, add_int, &sum);
+	assert_int_eq(sum == expected, 1);
+
+	hashMapDestroy(map);
+	assert_int_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+	return 1;
+}
+
+
+// keys [0, GET_MANY_COUNT) are in the maps that check_get_many looks into
+#define GET_MANY_COUNT 1000
+
+int check_get_many(HashMap* map)
+{
+	// hits and misses, more than a group, and a partial group at the end
+	enum { count = GET_MANY_COUNT, n = 2 * count + 5 };
+	const void* keys[n];
+	void* values[n];
+	int numbers[n];
+	for (int i = 0; i < n; ++i)
+	{
+		numbers[i] = (i * 7) % n;
+		keys[i] = &numbers[i];
+	}
+
+	hashMapGetMany(map, keys, n, values);
+	for (int i = 0; i < n; ++i)
+	{
+		if (numbers[i] < count)
+		{
+			assert_int_eq(*(int*)values[i], numbers[i]);
+		}
+		else
+		{
+			assert_null(values[i]);
+		}
+	}
+	hashMapGetMany(map, keys, 0, values);
+	return 1;
+}
+
+int test_get_many()
+{
+	HashMap* maps[] = {
+		hashMapInit(hash_int, compare_int, handlers),
+		hashMapInit(hash_constant, compare_int, handlers),
+		hashMapInitCuckoo(hash_int, compare_int, handlers),
+	};
+	for (size_t m = 0; m < sizeof(maps) / sizeof(*maps); ++m)
+	{
+		for (int i = 0; i < GET_MANY_COUNT; ++i)
+		{
+			hashMapInsert(maps[m], &i, &i);
+		}
+		assert_int_eq(check_get_many(maps[m]), 1);
+		assert_int_eq(hashMapEnableBloomFilter(maps[m], 0.01), HASH_MAP_SUCCESS);
+		assert_int_eq(check_get_many(maps[m]), 1);
+		hashMapDestroy(maps[m]);
+	}
+	return 1;
+}
+
+
+void* add_values(void* dst_value, void* src_value)
+{
+	*(int*)dst_value += *(int*)src_value;
+	return dst_value;
+}
+
+void* keep_dst(void* dst_value, void* src_value)
+{
+	(void)src_value;
+	return dst_value;
+}
+
+void check_entry(const void* key, void* value, void* params)
+{
+	// values are twice their keys
+	int* mismatches = params;
+	*mismatches += *(int*)value != 2 * *(const int*)key;
+}
+
+int test_merge()
+{
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	HashMap* chained = hashMapInit(hash_int, compare_int, handlers);
+	HashMap* other = hashMapInit(hash_int, compare_int, handlers);
+	HashMap* cuckoo = hashMapInitCuckoo(hash_int, compare_int, handlers);
+	HashMap* tracked = hashMapInitWithAllocator(hash_int, compare_int, handlers, &allocator);
+
+	// [0, 1000) in chained, [500, 1500) in other: the overlap adds up
+	for (int i = 0; i < 1000; ++i)
+	{
+		hashMapInsert(chained, &i, &i);
+		int key = i + 500;
+		hashMapInsert(other, &key, &key);
+	}
+	assert_int_eq(hashMapEnableBloomFilter(other, 0.01), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapMerge(chained, other, add_values), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(chained), 1500);
+	assert_int_eq(hashMapSize(other), 0);
+	for (int i = 0; i < 1500; ++i)
+	{
+		assert_int_eq(*(int*)hashMapGet(chained, &i), i < 500 || i >= 1000 ? i : 2 * i);
+		assert_int_eq(hashMapContains(other, &i), 0);
+	}
+	// only the overlap, and key 0, have values twice their keys
+	int mismatches = 0;
+	hashMapForEachEntry(chained, check_entry, &mismatches);
+	assert_int_eq(mismatches, 999);
+
+	// the emptied map is reusable
+	int k = 7;
+	hashMapInsert(other, &k, &k);
+	assert_int_eq(*(int*)hashMapGet(other, &k), 7);
+
+	// chained into cuckoo and back, and across allocators
+	assert_int_eq(hashMapMerge(cuckoo, chained, NULL), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(cuckoo), 1500);
+	assert_int_eq(hashMapMerge(tracked, cuckoo, NULL), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(cuckoo), 0);
+	assert_int_eq(hashMapMerge(tracked, other, keep_dst), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(tracked), 1500);
+	assert_int_eq(*(int*)hashMapGet(tracked, &k), 7);
+	assert_int_eq(*(int*)hashMapGet(tracked, &(int){600}), 1200);
+	assert_int_eq(hashMapMerge(chained, tracked, NULL), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(chained), 1500);
+	assert_int_eq(dsTrackerStats(tracker).bytes_in_use > 0, 1);
+
+	hashMapDestroy(chained);
+	hashMapDestroy(other);
+	hashMapDestroy(cuckoo);
+	hashMapDestroy(tracked);
+	assert_int_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+	return 1;
+}
+
+
+#define MERGE_WORKERS 4
+#define MERGE_PARTITIONS 8
+
+void* add_counts(void* dst_value, void* src_value)
+{
+	return add_values(dst_value, src_value);
+}
+
+int test_merge_partitions()
+{
+	// every worker counts keys into its own shards, and the shards of a
+	// partition are merged into the first worker's
+	HashMap* shards[MERGE_WORKERS * MERGE_PARTITIONS];
+	for (int i = 0; i < MERGE_WORKERS * MERGE_PARTITIONS; ++i)
+	{
+		shards[i] = hashMapInit(hash_int, compare_int, handlers);
+	}
+	for (int worker = 0; worker < MERGE_WORKERS; ++worker)
+	{
+		for (int i = 0; i < 5000; ++i)
+		{
+			int key = (i * 31 + worker) % 1000;
+			HashMap** row = &shards[worker * MERGE_PARTITIONS];
+			HashMap* shard = row[hashMapPartition(row[0], &key, MERGE_PARTITIONS)];
+			int* count = hashMapGet(shard, &key);
+			int one = 1;
+			if (count)
+			{
+				++*count;
+			}
+			else
+			{
+				hashMapInsert(shard, &key, &one);
+			}
+		}
+	}
+
+	Executor* executor = executorCreate(4);
+	assert_int_eq(hashMapMergePartitions(executor, shards, MERGE_WORKERS, MERGE_PARTITIONS,
+					     add_counts), HASH_MAP_SUCCESS);
+	// no partitions, nothing to merge
+	assert_int_eq(hashMapMergePartitions(executor, shards, MERGE_WORKERS, 0, add_counts),
+		      HASH_MAP_SUCCESS);
+	executorDestroy(executor);
+
+	size_t total_keys = 0;
+	for (int p = 0; p < MERGE_PARTITIONS; ++p)
+	{
+		total_keys += hashMapSize(shards[p]);
+	}
+	assert_int_eq(total_keys, 1000);
+	for (int key = 0; key < 1000; ++key)
+	{
+		size_t p = hashMapPartition(shards[0], &key, MERGE_PARTITIONS);
+		assert_int_eq(*(int*)hashMapGet(shards[p], &key), MERGE_WORKERS * 5);
+	}
+	for (int i = MERGE_PARTITIONS; i < MERGE_WORKERS * MERGE_PARTITIONS; ++i)
+	{
+		assert_int_eq(hashMapSize(shards[i]), 0);
+	}
+
+	for (int i = 0; i < MERGE_WORKERS * MERGE_PARTITIONS; ++i)
+	{
+		hashMapDestroy(shards[i]);
+	}
+	return 1;
+}
+
+
+int test_bloom_filter_allocator()
+{
+	// the filter, and the ones rebuilt on resizes, come from the map's allocator
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	HashMap* map = hashMapInitWithAllocator(hash_int, compare_int, handlers, &allocator);
+	for (int i = 0; i < 1000; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+	size_t bytes = dsTrackerStats(tracker).bytes_in_use;
+	assert_int_eq(hashMapEnableBloomFilter(map, 0.01), HASH_MAP_SUCCESS);
+	assert_int_eq(dsTrackerStats(tracker).bytes_in_use > bytes + 1000, 1);
+
+	for (int i = 1000; i < 20000; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+	for (int i = 0; i < 20000; ++i)
+	{
+		assert_int_eq(hashMapContains(map, &i), 1);
+	}
+
+	hashMapDestroy(map);
+	assert_int_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+	return 1;
+}
+
+int test_small_map()
+{
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	HashMap* map = hashMapInitWithAllocator(hash_int, compare_int, handlers, &allocator);
+
+	// an empty map, and one of up to eight keys, is the map object alone
+	assert_int_eq(dsTrackerStats(tracker).allocations, 1);
+	int missing = 100;
+	assert_null(hashMapGet(map, &missing));
+	assert_int_eq(hashMapContains(map, &missing), 0);
+	hashMapRemove(map, &missing);
+	for (int i = 0; i < 8; ++i)
+	{
+		assert_int_eq(hashMapInsert(map, &i, &i), HASH_MAP_SUCCESS);
+	}
+	int key = 3;
+	int value = 30;
+	assert_int_eq(hashMapInsert(map, &key, &value), HASH_MAP_SUCCESS);
+	hashMapRemove(map, &(int){5});
+	assert_int_eq(hashMapInsert(map, &(int){5}, &(int){5}), HASH_MAP_SUCCESS);
+	assert_int_eq(dsTrackerStats(tracker).allocations, 1);
+	assert_int_eq(hashMapSize(map), 8);
+	assert_int_eq(*(int*)hashMapGet(map, &key), 30);
+
+	// the ninth key moves the pairs to a table
+	assert_int_eq(hashMapEnableBloomFilter(map, 0.01), HASH_MAP_SUCCESS);
+	for (int i = 8; i < 100; ++i)
+	{
+		assert_int_eq(hashMapInsert(map, &i, &i), HASH_MAP_SUCCESS);
+	}
+	assert_int_eq(dsTrackerStats(tracker).allocations > 1, 1);
+	assert_int_eq(hashMapSize(map), 100);
+	for (int i = 0; i < 100; ++i)
+	{
+		assert_int_eq(*(int*)hashMapGet(map, &i), i == 3 ? 30 : i);
+	}
+
+	// merging small maps, into a small map and into a grown one
+	HashMap* small = hashMapInit(hash_int, compare_int, handlers);
+	HashMap* other = hashMapInit(hash_int, compare_int, handlers);
+	for (int i = 0; i < 4; ++i)
+	{
+		int shifted = i + 2;
+		hashMapInsert(small, &i, &i);
+		hashMapInsert(other, &shifted, &shifted);
+	}
+	assert_int_eq(hashMapMerge(small, other, add_values), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(small), 6);
+	assert_int_eq(*(int*)hashMapGet(small, &(int){3}), 6);
+	assert_int_eq(hashMapMerge(map, small, NULL), HASH_MAP_SUCCESS);
+	assert_int_eq(hashMapSize(small), 0);
+	assert_int_eq(*(int*)hashMapGet(map, &key), 6);
+	const void* keys[] = {&key, &missing};
+	void* values[2];
+	hashMapGetMany(other, keys, 2, values);
+	assert_null(values[0]);
+
+	hashMapDestroy(small);
+	hashMapDestroy(other);
+	hashMapDestroy(map);
+	assert_int_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+	return 1;
+}
+
+
 int main()
 {
 	RUN_TEST(test_sanity);
@@ -146,5 +726,17 @@ int main()
 	RUN_TEST(test_insert_resize);
 	RUN_TEST(test_get);
 	RUN_TEST(test_size);
+	RUN_TEST(test_contains);
+	RUN_TEST(test_bloom_filter);
+	RUN_TEST(test_colliding_keys);
+	RUN_TEST(test_seeded_placement);
+	RUN_TEST(test_cuckoo);
+	RUN_TEST(test_cuckoo_colliding_keys);
+	RUN_TEST(test_cuckoo_for_each);
+	RUN_TEST(test_get_many);
+	RUN_TEST(test_merge);
+	RUN_TEST(test_merge_partitions);
+	RUN_TEST(test_bloom_filter_allocator);
+	RUN_TEST(test_small_map);
 	return 0;
 }
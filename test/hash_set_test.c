@@ -0,0 +1,259 @@
+#include <check.h>
+#include <stdlib.h>
+
+#include "ds_allocator.h"
+#include "hash_map.h"
+#include "hash_set.h"
+
+static void* copy_int(const void* n)
+{
+	int* copy = malloc(sizeof(int));
+	*copy = *(const int*)n;
+	return copy;
+}
+
+static int compare_int(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+static size_t hash_int(const void* n, size_t size)
+{
+	return (size_t)*(const int*)n % size;
+}
+
+static size_t hash_constant(const void* n, size_t size)
+{
+	(void)n;
+	return 7 % size;
+}
+
+static HashSet* createSet(void)
+{
+	return hashSetInit(hash_int, compare_int, copy_int, free);
+}
+
+/**
+ * Returns a set of the keys in [begin, end) that are multiples of step.
+ **/
+static HashSet* rangeSet(int begin, int end, int step)
+{
+	HashSet* set = createSet();
+	for (int i = begin; i < end; i += step)
+	{
+		ck_assert_int_eq(hashSetAdd(set, &i), HASH_MAP_SUCCESS);
+	}
+	return set;
+}
+
+static void add_int(const void* key, void* sum)
+{
+	*(long*)sum += *(const int*)key;
+}
+
+START_TEST(test_hash_set_updates)
+{
+	HashSet* set = createSet();
+	ck_assert_uint_eq(hashSetSize(set), 0);
+	int key = 3;
+	ck_assert_int_eq(hashSetContains(set, &key), 0);
+	hashSetRemove(set, &key);
+
+	const int count = 20000;
+	for (int i = 0; i < count; ++i)
+	{
+		ck_assert_int_eq(hashSetAdd(set, &i), HASH_MAP_SUCCESS);
+	}
+	// adding a key twice keeps one copy
+	for (int i = 0; i < count; i += 2)
+	{
+		ck_assert_int_eq(hashSetAdd(set, &i), HASH_MAP_SUCCESS);
+	}
+	ck_assert_uint_eq(hashSetSize(set), count);
+
+	for (int i = 0; i < count; i += 3)
+	{
+		hashSetRemove(set, &i);
+	}
+	ck_assert_uint_eq(hashSetSize(set), count - (count + 2) / 3);
+	for (int i = 0; i < 2 * count; ++i)
+	{
+		ck_assert_int_eq(hashSetContains(set, &i), i < count && i % 3);
+	}
+
+	long sum = 0;
+	hashSetForEach(set, add_int, &sum);
+	long expected = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		if (i % 3) expected += i;
+	}
+	ck_assert_int_eq(sum, expected);
+
+	hashSetClear(set);
+	ck_assert_uint_eq(hashSetSize(set), 0);
+	ck_assert_int_eq(hashSetContains(set, &key), 0);
+	ck_assert_int_eq(hashSetAdd(set, &key), HASH_MAP_SUCCESS);
+	ck_assert_int_eq(hashSetContains(set, &key), 1);
+	hashSetDestroy(set);
+}
+END_TEST
+
+START_TEST(test_hash_set_churn)
+{
+	// a sliding window of keys leaves deleted slots behind, which must
+	// neither break lookups nor grow the set
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	HashSet* set = hashSetInitWithAllocator(hash_int, compare_int, copy_int, free,
+						&allocator);
+	const int window = 1000;
+	for (int i = 0; i < window; ++i)
+	{
+		hashSetAdd(set, &i);
+	}
+	size_t bytes = dsTrackerStats(tracker).bytes_in_use;
+
+	for (int i = window; i < 100 * window; ++i)
+	{
+		int old = i - window;
+		hashSetRemove(set, &old);
+		ck_assert_int_eq(hashSetAdd(set, &i), HASH_MAP_SUCCESS);
+		ck_assert_int_eq(hashSetContains(set, &old), 0);
+	}
+	ck_assert_uint_eq(hashSetSize(set), window);
+	for (int i = 99 * window; i < 100 * window; ++i)
+	{
+		ck_assert_int_eq(hashSetContains(set, &i), 1);
+	}
+	ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, bytes);
+
+	hashSetDestroy(set);
+	ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+}
+END_TEST
+
+START_TEST(test_hash_set_colliding_keys)
+{
+	HashSet* set = hashSetInit(hash_constant, compare_int, copy_int, free);
+	for (int i = 0; i < 100; ++i)
+	{
+		hashSetAdd(set, &i);
+	}
+	for (int i = 0; i < 100; i += 2)
+	{
+		hashSetRemove(set, &i);
+	}
+	ck_assert_uint_eq(hashSetSize(set), 50);
+	for (int i = 0; i < 100; ++i)
+	{
+		ck_assert_int_eq(hashSetContains(set, &i), i % 2);
+	}
+	hashSetDestroy(set);
+}
+END_TEST
+
+START_TEST(test_hash_set_bulk_operations)
+{
+	// multiples of 2 and of 3 below 3000
+	HashSet* twos = rangeSet(0, 3000, 2);
+	HashSet* threes = rangeSet(0, 3000, 3);
+
+	HashSet* both = rangeSet(0, 3000, 2);
+	hashSetIntersection(both, threes);
+	HashSet* either = rangeSet(0, 3000, 2);
+	ck_assert_int_eq(hashSetUnion(either, threes), HASH_MAP_SUCCESS);
+	HashSet* only_twos = rangeSet(0, 3000, 2);
+	hashSetDifference(only_twos, threes);
+	// the other way around, with the smaller set subtracted from the larger
+	HashSet* only_threes = rangeSet(0, 3000, 3);
+	hashSetDifference(only_threes, twos);
+
+	for (int i = 0; i < 3000; ++i)
+	{
+		int two = 0 == i % 2;
+		int three = 0 == i % 3;
+		ck_assert_int_eq(hashSetContains(both, &i), two && three);
+		ck_assert_int_eq(hashSetContains(either, &i), two || three);
+		ck_assert_int_eq(hashSetContains(only_twos, &i), two && !three);
+		ck_assert_int_eq(hashSetContains(only_threes, &i), three && !two);
+	}
+	ck_assert_uint_eq(hashSetSize(both), 500);
+	ck_assert_uint_eq(hashSetSize(either), 2000);
+	ck_assert_uint_eq(hashSetSize(only_twos), 1000);
+	ck_assert_uint_eq(hashSetSize(only_threes), 500);
+
+	// a set against itself
+	ck_assert_int_eq(hashSetUnion(twos, twos), HASH_MAP_SUCCESS);
+	hashSetIntersection(twos, twos);
+	ck_assert_uint_eq(hashSetSize(twos), 1500);
+	hashSetDifference(twos, twos);
+	ck_assert_uint_eq(hashSetSize(twos), 0);
+
+	hashSetDestroy(twos);
+	hashSetDestroy(threes);
+	hashSetDestroy(both);
+	hashSetDestroy(either);
+	hashSetDestroy(only_twos);
+	hashSetDestroy(only_threes);
+}
+END_TEST
+
+START_TEST(test_hash_set_memory)
+{
+	// the same keys, as a set and as a map with dummy values (which come
+	// from the value handlers, and aren't even counted here)
+	DsTracker* set_tracker = dsTrackerCreate(NULL);
+	DsTracker* map_tracker = dsTrackerCreate(NULL);
+	DsAllocator set_allocator = dsTrackerAllocator(set_tracker);
+	DsAllocator map_allocator = dsTrackerAllocator(map_tracker);
+	HashSet* set = hashSetInitWithAllocator(hash_int, compare_int, copy_int, free,
+						&set_allocator);
+	HashMapEntryHandlers handlers = {copy_int, free, copy_int, free};
+	HashMap* map = hashMapInitWithAllocator(hash_int, compare_int, handlers, &map_allocator);
+	for (int i = 0; i < 100000; ++i)
+	{
+		hashSetAdd(set, &i);
+		hashMapInsert(map, &i, &i);
+	}
+	ck_assert_uint_lt(3 * dsTrackerStats(set_tracker).bytes_in_use,
+			  dsTrackerStats(map_tracker).bytes_in_use);
+
+	hashSetDestroy(set);
+	hashMapDestroy(map);
+	dsTrackerDestroy(set_tracker);
+	dsTrackerDestroy(map_tracker);
+}
+END_TEST
+
+Suite* hash_set_tests_suite(void)
+{
+	Suite* s = suite_create("Hash Set Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_hash_set_updates);
+	tcase_add_test(tc_core, test_hash_set_churn);
+	tcase_add_test(tc_core, test_hash_set_colliding_keys);
+	tcase_add_test(tc_core, test_hash_set_bulk_operations);
+	tcase_add_test(tc_core, test_hash_set_memory);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = hash_set_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
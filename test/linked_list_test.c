@@ -222,6 +222,428 @@ START_TEST(test_list_pop_front) {
 }
 END_TEST
 
+static LinkedList* list_of(const char** elements, size_t count) {
+    LinkedList* list = linkedListCreate(str_copy, str_free, str_cmp);
+    for (size_t i = 0; i < count; ++i) {
+        linkedListPush(list, elements[i]);
+    }
+
+    return list;
+}
+
+START_TEST(test_list_splice) {
+    const char* dst_elements[] = {"AAA", "DDD"};
+    const char* src_elements[] = {"BBB", "CCC"};
+    LinkedList* dst = list_of(dst_elements, 2);
+    LinkedList* src = list_of(src_elements, 2);
+
+    linkedListSplice(dst, 1, src);
+    ck_assert_uint_eq(linkedListSize(src), 0);
+    ck_assert_uint_eq(linkedListSize(dst), 4);
+    ck_assert_str_eq(linkedListGetAt(dst, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(dst, 1), "BBB");
+    ck_assert_str_eq(linkedListGetAt(dst, 2), "CCC");
+    ck_assert_str_eq(linkedListGetAt(dst, 3), "DDD");
+
+    // splicing an empty list is a no-op
+    linkedListSplice(dst, 0, src);
+    ck_assert_uint_eq(linkedListSize(dst), 4);
+
+    // positions past the end append
+    linkedListPush(src, "EEE");
+    linkedListSplice(dst, 100, src);
+    ck_assert_uint_eq(linkedListSize(dst), 5);
+    ck_assert_str_eq(linkedListGetAt(dst, 4), "EEE");
+
+    linkedListPush(src, "ZZZ");
+    linkedListSplice(dst, 0, src);
+    ck_assert_str_eq(linkedListGetAt(dst, 0), "ZZZ");
+    ck_assert_str_eq(linkedListGetAt(dst, 1), "AAA");
+
+    // the emptied list stays usable
+    linkedListPush(src, "FFF");
+    ck_assert_str_eq(linkedListGetAt(src, 0), "FFF");
+
+    linkedListDestroy(src);
+    linkedListDestroy(dst);
+}
+END_TEST
+
+START_TEST(test_list_append_list) {
+    const char* dst_elements[] = {"AAA"};
+    const char* src_elements[] = {"BBB", "CCC"};
+    LinkedList* dst = list_of(dst_elements, 1);
+    LinkedList* src = list_of(src_elements, 2);
+
+    linkedListAppendList(dst, src);
+    ck_assert_uint_eq(linkedListSize(src), 0);
+    ck_assert_uint_eq(linkedListSize(dst), 3);
+    ck_assert_str_eq(linkedListGetAt(dst, 2), "CCC");
+
+    char* s = linkedListPop(dst);
+    ck_assert_str_eq(s, "CCC");
+    free(s);
+
+    // appending into an empty list
+    linkedListAppendList(src, dst);
+    ck_assert_uint_eq(linkedListSize(dst), 0);
+    ck_assert_uint_eq(linkedListSize(src), 2);
+    ck_assert_str_eq(linkedListGetAt(src, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(src, 1), "BBB");
+
+    linkedListDestroy(src);
+    linkedListDestroy(dst);
+}
+END_TEST
+
+START_TEST(test_list_split_at) {
+    const char* elements[] = {"AAA", "BBB", "CCC", "DDD"};
+    LinkedList* list = list_of(elements, 4);
+
+    LinkedList* back = linkedListSplitAt(list, 1);
+    ck_assert_ptr_nonnull(back);
+    ck_assert_uint_eq(linkedListSize(list), 1);
+    ck_assert_uint_eq(linkedListSize(back), 3);
+    ck_assert_str_eq(linkedListGetAt(list, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(back, 0), "BBB");
+    ck_assert_str_eq(linkedListGetAt(back, 2), "DDD");
+
+    LinkedList* empty = linkedListSplitAt(back, 3);
+    ck_assert_uint_eq(linkedListSize(empty), 0);
+    ck_assert_uint_eq(linkedListSize(back), 3);
+
+    LinkedList* all = linkedListSplitAt(back, 0);
+    ck_assert_uint_eq(linkedListSize(back), 0);
+    ck_assert_uint_eq(linkedListSize(all), 3);
+
+    linkedListDestroy(all);
+    linkedListDestroy(empty);
+    linkedListDestroy(back);
+    linkedListDestroy(list);
+}
+END_TEST
+
+// orders strings by their first character only, so that strings sharing
+// a first character are equal and stability can be observed
+static int first_char_cmp(const void* first, const void* second) {
+    return *(const char*) first - *(const char*) second;
+}
+
+START_TEST(test_list_sort) {
+    LinkedList* list = linkedListCreate(str_copy, str_free, str_cmp);
+
+    // sorting an empty list is a no-op
+    linkedListSort(list, NULL);
+    ck_assert_uint_eq(linkedListSize(list), 0);
+
+    const char* elements[] = {"DDD", "AAA", "CCC", "EEE", "BBB"};
+    for (size_t i = 0; i < 5; ++i) {
+        linkedListPush(list, elements[i]);
+    }
+
+    linkedListSort(list, NULL);
+    ck_assert_uint_eq(linkedListSize(list), 5);
+    ck_assert_str_eq(linkedListGetAt(list, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(list, 1), "BBB");
+    ck_assert_str_eq(linkedListGetAt(list, 2), "CCC");
+    ck_assert_str_eq(linkedListGetAt(list, 3), "DDD");
+    ck_assert_str_eq(linkedListGetAt(list, 4), "EEE");
+
+    // prev links must be intact after the sort
+    char* s = linkedListPop(list);
+    ck_assert_str_eq(s, "EEE");
+    free(s);
+    s = linkedListPop(list);
+    ck_assert_str_eq(s, "DDD");
+    free(s);
+
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_sort_stable) {
+    const char* elements[] = {"B1", "A1", "B2", "A2", "C1", "A3", "B3"};
+    const char* expected[] = {"A1", "A2", "A3", "B1", "B2", "B3", "C1"};
+    LinkedList* list = list_of(elements, 7);
+
+    linkedListSort(list, first_char_cmp);
+    for (size_t i = 0; i < 7; ++i) {
+        ck_assert_str_eq(linkedListGetAt(list, i), expected[i]);
+    }
+
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_sort_large) {
+    LinkedList* list = linkedListCreate(str_copy, str_free, str_cmp);
+
+    char buffer[16];
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(buffer, sizeof(buffer), "%04d", (i * 7919) % 1000);
+        linkedListPush(list, buffer);
+    }
+
+    linkedListSort(list, NULL);
+    ck_assert_uint_eq(linkedListSize(list), 1000);
+    for (int i = 0; i < 1000; ++i) {
+        char* s = linkedListPopFront(list);
+        snprintf(buffer, sizeof(buffer), "%04d", i);
+        ck_assert_str_eq(s, buffer);
+        free(s);
+    }
+
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_merge_sorted) {
+    const char* dst_elements[] = {"A1", "B1", "D1"};
+    const char* src_elements[] = {"A2", "C2", "D2", "E2"};
+    const char* expected[] = {"A1", "A2", "B1", "C2", "D1", "D2", "E2"};
+    LinkedList* dst = list_of(dst_elements, 3);
+    LinkedList* src = list_of(src_elements, 4);
+
+    linkedListMergeSorted(dst, src, first_char_cmp);
+    ck_assert_uint_eq(linkedListSize(src), 0);
+    ck_assert_uint_eq(linkedListSize(dst), 7);
+    for (size_t i = 0; i < 7; ++i) {
+        ck_assert_str_eq(linkedListGetAt(dst, i), expected[i]);
+    }
+
+    // merging into an empty list
+    linkedListMergeSorted(src, dst, NULL);
+    ck_assert_uint_eq(linkedListSize(dst), 0);
+    ck_assert_uint_eq(linkedListSize(src), 7);
+    ck_assert_str_eq(linkedListGetAt(src, 6), "E2");
+
+    linkedListDestroy(src);
+    linkedListDestroy(dst);
+}
+END_TEST
+
+START_TEST(test_list_insert_at) {
+    LinkedList* list = linkedListCreate(str_copy, str_free, str_cmp);
+
+    ck_assert_int_eq(linkedListInsertAt(list, 0, "BBB"), LINKED_LIST_SUCCESS);
+    linkedListInsertAt(list, 0, "AAA");
+    linkedListInsertAt(list, 2, "DDD");
+    linkedListInsertAt(list, 2, "CCC");
+    linkedListInsertAt(list, 42, "EEE");
+
+    ck_assert_uint_eq(linkedListSize(list), 5);
+    ck_assert_str_eq(linkedListGetAt(list, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(list, 1), "BBB");
+    ck_assert_str_eq(linkedListGetAt(list, 2), "CCC");
+    ck_assert_str_eq(linkedListGetAt(list, 3), "DDD");
+    ck_assert_str_eq(linkedListGetAt(list, 4), "EEE");
+
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_indexed) {
+    LinkedList* list = linkedListCreateIndexed(str_copy, str_free, str_cmp);
+
+    ck_assert_ptr_null(linkedListGetAt(list, 0));
+    ck_assert_ptr_null(linkedListRemoveAt(list, 0));
+
+    // mirror every operation on a plain array of expected values
+    enum { COUNT = 2000 };
+    static int expected[COUNT];
+    size_t size = 0;
+    char buffer[16];
+
+    for (int i = 0; i < COUNT; ++i) {
+        size_t index = ((size_t) i * 7919) % (size + 1);
+        snprintf(buffer, sizeof(buffer), "%d", i);
+        ck_assert_int_eq(linkedListInsertAt(list, index, buffer), LINKED_LIST_SUCCESS);
+
+        memmove(&expected[index + 1], &expected[index], (size - index) * sizeof(int));
+        expected[index] = i;
+        ++size;
+    }
+
+    ck_assert_uint_eq(linkedListSize(list), COUNT);
+    for (size_t i = 0; i < size; ++i) {
+        snprintf(buffer, sizeof(buffer), "%d", expected[i]);
+        ck_assert_str_eq(linkedListGetAt(list, i), buffer);
+    }
+
+    for (int i = 0; i < COUNT / 2; ++i) {
+        size_t index = ((size_t) i * 104729) % size;
+        char* s = linkedListRemoveAt(list, index);
+        snprintf(buffer, sizeof(buffer), "%d", expected[index]);
+        ck_assert_str_eq(s, buffer);
+        free(s);
+
+        memmove(&expected[index], &expected[index + 1], (size - index - 1) * sizeof(int));
+        --size;
+    }
+
+    ck_assert_uint_eq(linkedListSize(list), size);
+    for (size_t i = 0; i < size; ++i) {
+        snprintf(buffer, sizeof(buffer), "%d", expected[i]);
+        ck_assert_str_eq(linkedListGetAt(list, i), buffer);
+    }
+    ck_assert_ptr_null(linkedListGetAt(list, size));
+
+    // bulk operations keep the index usable
+    LinkedList* back = linkedListSplitAt(list, size / 2);
+    ck_assert_uint_eq(linkedListSize(back), size - size / 2);
+    snprintf(buffer, sizeof(buffer), "%d", expected[size / 2 + 1]);
+    ck_assert_str_eq(linkedListGetAt(back, 1), buffer);
+
+    linkedListAppendList(list, back);
+    linkedListSort(list, NULL);
+    for (size_t i = 1; i < size; ++i) {
+        ck_assert_int_lt(strcmp(linkedListGetAt(list, i - 1), linkedListGetAt(list, i)), 0);
+    }
+
+    snprintf(buffer, sizeof(buffer), "%s", (char*) linkedListGetAt(list, size - 1));
+    char* s = linkedListPop(list);
+    ck_assert_str_eq(s, buffer);
+    free(s);
+    snprintf(buffer, sizeof(buffer), "%s", (char*) linkedListGetAt(list, 0));
+    s = linkedListPopFront(list);
+    ck_assert_str_eq(s, buffer);
+    free(s);
+    ck_assert_uint_eq(linkedListSize(list), size - 2);
+
+    linkedListDestroy(back);
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_clone) {
+    const char* elements[] = {"AAA", "BBB", "CCC"};
+    LinkedList* list = list_of(elements, 3);
+
+    LinkedList* clone = linkedListClone(list);
+    ck_assert_ptr_nonnull(clone);
+    ck_assert_uint_eq(linkedListSize(clone), 3);
+    for (size_t i = 0; i < 3; ++i) {
+        ck_assert_str_eq(linkedListGetAt(clone, i), elements[i]);
+        ck_assert_ptr_ne(linkedListGetAt(clone, i), linkedListGetAt(list, i));
+    }
+
+    // cloned nodes can be removed one by one, and moved to other lists
+    char* s = linkedListRemoveAt(clone, 1);
+    ck_assert_str_eq(s, "BBB");
+    free(s);
+
+    LinkedList* back = linkedListSplitAt(clone, 1);
+    linkedListDestroy(clone);
+    ck_assert_str_eq(linkedListGetAt(back, 0), "CCC");
+    linkedListPush(back, "DDD");
+    linkedListAppendList(list, back);
+    ck_assert_uint_eq(linkedListSize(list), 5);
+    linkedListDestroy(back);
+
+    LinkedList* empty = linkedListCreate(str_copy, str_free, str_cmp);
+    clone = linkedListClone(empty);
+    ck_assert_uint_eq(linkedListSize(clone), 0);
+    linkedListDestroy(clone);
+    linkedListDestroy(empty);
+
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_clone_shared) {
+    const char* elements[] = {"AAA", "BBB", "CCC"};
+    LinkedList* list = list_of(elements, 3);
+
+    LinkedList* snapshot = linkedListCloneShared(list);
+    ck_assert_ptr_nonnull(snapshot);
+    ck_assert_uint_eq(linkedListSize(snapshot), 3);
+    ck_assert_ptr_eq(linkedListGetAt(snapshot, 1), linkedListGetAt(list, 1));
+
+    // modifying the source leaves the snapshot untouched
+    char* s = linkedListPopFront(list);
+    ck_assert_str_eq(s, "AAA");
+    free(s);
+    linkedListPush(list, "DDD");
+
+    ck_assert_uint_eq(linkedListSize(list), 3);
+    ck_assert_str_eq(linkedListGetAt(list, 0), "BBB");
+    ck_assert_uint_eq(linkedListSize(snapshot), 3);
+    ck_assert_str_eq(linkedListGetAt(snapshot, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(snapshot, 2), "CCC");
+
+    // snapshots of snapshots, released in any order
+    LinkedList* second = linkedListCloneShared(snapshot);
+    linkedListDestroy(snapshot);
+    ck_assert_str_eq(linkedListGetAt(second, 0), "AAA");
+
+    // the last holder modifies the nodes in place
+    linkedListSort(second, NULL);
+    linkedListPush(second, "EEE");
+    ck_assert_uint_eq(linkedListSize(second), 4);
+    linkedListDestroy(second);
+
+    snapshot = linkedListCloneShared(list);
+    linkedListDestroy(list);
+    ck_assert_str_eq(linkedListGetAt(snapshot, 2), "DDD");
+    linkedListDestroy(snapshot);
+}
+END_TEST
+
+START_TEST(test_list_push_owned) {
+    LinkedList* list = linkedListCreate(str_copy, str_free, str_cmp);
+
+    char* element = str_copy("BBB");
+    ck_assert_int_eq(linkedListPushOwned(list, element), LINKED_LIST_SUCCESS);
+    ck_assert_int_eq(linkedListPushFrontOwned(list, str_copy("AAA")), LINKED_LIST_SUCCESS);
+    linkedListPush(list, "CCC");
+
+    ck_assert_uint_eq(linkedListSize(list), 3);
+    ck_assert_ptr_eq(linkedListGetAt(list, 1), element);
+    ck_assert_str_eq(linkedListGetAt(list, 0), "AAA");
+    ck_assert_str_eq(linkedListGetAt(list, 2), "CCC");
+
+    char* s = linkedListPopFront(list);
+    ck_assert_str_eq(s, "AAA");
+    free(s);
+
+    linkedListDestroy(list);
+}
+END_TEST
+
+START_TEST(test_list_handler_less) {
+    // a list of borrowed pointers: nothing is copied or freed
+    char elements[][4] = {"CCC", "AAA", "BBB"};
+    LinkedList* list = linkedListCreate(NULL, NULL, NULL);
+
+    for (size_t i = 0; i < 3; ++i) {
+        ck_assert_int_eq(linkedListPushOwned(list, elements[i]), LINKED_LIST_SUCCESS);
+    }
+
+    linkedListSort(list, str_cmp);
+    ck_assert_ptr_eq(linkedListGetAt(list, 0), elements[1]);
+    ck_assert_ptr_eq(linkedListGetAt(list, 2), elements[0]);
+
+    LinkedList* clone = linkedListClone(list);
+    ck_assert_uint_eq(linkedListSize(clone), 3);
+    ck_assert_ptr_eq(linkedListGetAt(clone, 1), elements[2]);
+
+    ck_assert_ptr_eq(linkedListPop(list), elements[0]);
+
+    linkedListDestroy(clone);
+
+    // NULL is an element like any other, and is cloned as such
+    ck_assert_int_eq(linkedListPushOwned(list, NULL), LINKED_LIST_SUCCESS);
+    clone = linkedListClone(list);
+    ck_assert_ptr_nonnull(clone);
+    ck_assert_uint_eq(linkedListSize(clone), 3);
+    ck_assert_ptr_eq(linkedListGetAt(clone, 1), elements[2]);
+    ck_assert_ptr_null(linkedListGetAt(clone, 2));
+
+    linkedListDestroy(clone);
+    linkedListDestroy(list);
+}
+END_TEST
+
 static void str_print(const void* element) {
     printf("%s", element);
 }
@@ -253,6 +675,19 @@ Suite* list_tests_suite(void) {
     tcase_add_test(tc_core, test_list_pop);
     tcase_add_test(tc_core, test_list_push_front);
     tcase_add_test(tc_core, test_list_pop_front);
+    tcase_add_test(tc_core, test_list_splice);
+    tcase_add_test(tc_core, test_list_append_list);
+    tcase_add_test(tc_core, test_list_split_at);
+    tcase_add_test(tc_core, test_list_sort);
+    tcase_add_test(tc_core, test_list_sort_stable);
+    tcase_add_test(tc_core, test_list_sort_large);
+    tcase_add_test(tc_core, test_list_merge_sorted);
+    tcase_add_test(tc_core, test_list_insert_at);
+    tcase_add_test(tc_core, test_list_indexed);
+    tcase_add_test(tc_core, test_list_clone);
+    tcase_add_test(tc_core, test_list_clone_shared);
+    tcase_add_test(tc_core, test_list_push_owned);
+    tcase_add_test(tc_core, test_list_handler_less);
     suite_add_tcase(s, tc_core);
 
     return s;
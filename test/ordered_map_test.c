@@ -0,0 +1,286 @@
+#include <check.h>
+#include <stdlib.h>
+
+#include "ordered_map.h"
+
+static void* copy_int(const void* n)
+{
+	int* value = malloc(sizeof(int));
+	if (value)
+	{
+		*value = *(const int*)n;
+	}
+	return value;
+}
+
+static int compare_int(const void* a, const void* b)
+{
+	int val_a = *(const int*)a;
+	int val_b = *(const int*)b;
+	return (val_a > val_b) - (val_a < val_b);
+}
+
+static void free_int(void* value)
+{
+	free(value);
+}
+
+static HashMapEntryHandlers handlers = {copy_int, free_int, copy_int, free_int};
+
+// checks that an in-order scan yields exactly the keys marked in `present`
+static void assert_scan_matches(const OrderedMap* map, const char* present, int range)
+{
+	OrderedMapIterator itr = orderedMapBegin(map);
+	for (int key = 0; key < range; ++key)
+	{
+		if (!present[key]) continue;
+
+		ck_assert(orderedMapIteratorValid(itr));
+		ck_assert_int_eq(*(const int*)orderedMapIteratorKey(itr), key);
+		ck_assert_int_eq(*(int*)orderedMapIteratorValue(itr), -key);
+		orderedMapIteratorNext(&itr);
+	}
+	ck_assert(!orderedMapIteratorValid(itr));
+}
+
+
+START_TEST(test_map_empty)
+{
+	OrderedMap* map = orderedMapInit(compare_int, handlers);
+
+	int k = 5;
+	ck_assert_uint_eq(orderedMapSize(map), 0);
+	ck_assert_ptr_null(orderedMapGet(map, &k));
+	ck_assert(!orderedMapContains(map, &k));
+	ck_assert(!orderedMapIteratorValid(orderedMapBegin(map)));
+	ck_assert(!orderedMapIteratorValid(orderedMapLowerBound(map, &k)));
+
+	orderedMapRemove(map, &k);
+	orderedMapDestroy(map);
+}
+END_TEST
+
+START_TEST(test_map_insert_update)
+{
+	OrderedMap* map = orderedMapInit(compare_int, handlers);
+
+	int k = 1;
+	int v = 100;
+	ck_assert_int_eq(orderedMapInsert(map, &k, &v), ORDERED_MAP_SUCCESS);
+	ck_assert_int_eq(*(int*)orderedMapGet(map, &k), 100);
+
+	v = 200;
+	ck_assert_int_eq(orderedMapInsert(map, &k, &v), ORDERED_MAP_SUCCESS);
+	ck_assert_uint_eq(orderedMapSize(map), 1);
+	ck_assert_int_eq(*(int*)orderedMapGet(map, &k), 200);
+
+	orderedMapDestroy(map);
+}
+END_TEST
+
+START_TEST(test_map_ordered_iteration)
+{
+	OrderedMap* map = orderedMapInit(compare_int, handlers);
+
+	const int range = 20000;
+	char* present = calloc(range, 1);
+
+	// insert in a scrambled order, so that splits happen all over the tree
+	for (int i = 0; i < range; ++i)
+	{
+		int k = (int)(((long)i * 7919) % range);
+		int v = -k;
+		ck_assert_int_eq(orderedMapInsert(map, &k, &v), ORDERED_MAP_SUCCESS);
+		present[k] = 1;
+	}
+
+	ck_assert_uint_eq(orderedMapSize(map), range);
+	assert_scan_matches(map, present, range);
+
+	free(present);
+	orderedMapDestroy(map);
+}
+END_TEST
+
+START_TEST(test_map_lower_bound)
+{
+	OrderedMap* map = orderedMapInit(compare_int, handlers);
+
+	// even keys only
+	for (int k = 0; k < 2000; k += 2)
+	{
+		int v = -k;
+		orderedMapInsert(map, &k, &v);
+	}
+
+	int k = 701;
+	OrderedMapIterator itr = orderedMapLowerBound(map, &k);
+	ck_assert_int_eq(*(const int*)orderedMapIteratorKey(itr), 702);
+
+	k = 702;
+	itr = orderedMapLowerBound(map, &k);
+	ck_assert_int_eq(*(const int*)orderedMapIteratorKey(itr), 702);
+
+	// range scan of [100, 200)
+	k = 100;
+	int count = 0;
+	for (itr = orderedMapLowerBound(map, &k);
+	     orderedMapIteratorValid(itr) && *(const int*)orderedMapIteratorKey(itr) < 200;
+	     orderedMapIteratorNext(&itr))
+	{
+		ck_assert_int_eq(*(const int*)orderedMapIteratorKey(itr), 100 + 2 * count);
+		++count;
+	}
+	ck_assert_int_eq(count, 50);
+
+	k = -10;
+	ck_assert_int_eq(*(const int*)orderedMapIteratorKey(orderedMapLowerBound(map, &k)), 0);
+
+	k = 1999;
+	ck_assert(!orderedMapIteratorValid(orderedMapLowerBound(map, &k)));
+
+	orderedMapDestroy(map);
+}
+END_TEST
+
+START_TEST(test_map_remove)
+{
+	OrderedMap* map = orderedMapInit(compare_int, handlers);
+
+	const int range = 5000;
+	char* present = calloc(range, 1);
+	size_t size = 0;
+
+	// random inserts and removals, checked against a reference bitmap
+	srand(42);
+	for (int i = 0; i < 100000; ++i)
+	{
+		int k = rand() % range;
+		if (rand() % 3)
+		{
+			int v = -k;
+			ck_assert_int_eq(orderedMapInsert(map, &k, &v), ORDERED_MAP_SUCCESS);
+			size += !present[k];
+			present[k] = 1;
+		}
+		else
+		{
+			orderedMapRemove(map, &k);
+			size -= present[k];
+			present[k] = 0;
+		}
+	}
+
+	ck_assert_uint_eq(orderedMapSize(map), size);
+	for (int k = 0; k < range; ++k)
+	{
+		ck_assert_int_eq(orderedMapContains(map, &k), present[k]);
+	}
+	assert_scan_matches(map, present, range);
+
+	// drain the map completely
+	for (int k = 0; k < range; ++k)
+	{
+		orderedMapRemove(map, &k);
+		present[k] = 0;
+	}
+	ck_assert_uint_eq(orderedMapSize(map), 0);
+	assert_scan_matches(map, present, range);
+
+	// and reuse it
+	int k = 3;
+	int v = -3;
+	orderedMapInsert(map, &k, &v);
+	ck_assert_int_eq(*(int*)orderedMapGet(map, &k), -3);
+
+	free(present);
+	orderedMapDestroy(map);
+}
+END_TEST
+
+START_TEST(test_map_clear)
+{
+	OrderedMap* map = orderedMapInit(compare_int, handlers);
+
+	for (int k = 0; k < 1000; ++k)
+	{
+		orderedMapInsert(map, &k, &k);
+	}
+
+	orderedMapClear(map);
+	ck_assert_uint_eq(orderedMapSize(map), 0);
+	ck_assert(!orderedMapIteratorValid(orderedMapBegin(map)));
+
+	int k = 10;
+	orderedMapInsert(map, &k, &k);
+	ck_assert_uint_eq(orderedMapSize(map), 1);
+
+	orderedMapDestroy(map);
+}
+END_TEST
+
+START_TEST(test_map_allocator)
+{
+	DsTracker* tracker = dsTrackerCreate(NULL);
+	DsAllocator allocator = dsTrackerAllocator(tracker);
+	OrderedMap* map = orderedMapInitWithAllocator(compare_int, handlers, &allocator);
+	ck_assert_ptr_nonnull(map);
+
+	// enough keys for a few levels of nodes, then removals that merge them
+	for (int k = 0; k < 5000; ++k)
+	{
+		int value = -k;
+		ck_assert_int_eq(orderedMapInsert(map, &k, &value), ORDERED_MAP_SUCCESS);
+	}
+	ck_assert_uint_gt(dsTrackerStats(tracker).allocations, 300);
+	for (int k = 0; k < 5000; k += 2)
+	{
+		orderedMapRemove(map, &k);
+	}
+	ck_assert_uint_eq(orderedMapSize(map), 2500);
+	char* present = calloc(5000, 1);
+	for (int k = 1; k < 5000; k += 2)
+	{
+		present[k] = 1;
+	}
+	assert_scan_matches(map, present, 5000);
+	free(present);
+
+	orderedMapDestroy(map);
+	ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+	dsTrackerDestroy(tracker);
+}
+END_TEST
+
+Suite* ordered_map_tests_suite(void)
+{
+	Suite* s = suite_create("Ordered Map Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_map_empty);
+	tcase_add_test(tc_core, test_map_insert_update);
+	tcase_add_test(tc_core, test_map_ordered_iteration);
+	tcase_add_test(tc_core, test_map_lower_bound);
+	tcase_add_test(tc_core, test_map_remove);
+	tcase_add_test(tc_core, test_map_clear);
+	tcase_add_test(tc_core, test_map_allocator);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = ordered_map_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
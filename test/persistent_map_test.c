@@ -0,0 +1,295 @@
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "persistent_map.h"
+
+static void* copy_int(const void* n)
+{
+	int* copy = malloc(sizeof(int));
+	*copy = *(const int*)n;
+	return copy;
+}
+
+static int compare_int(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+static size_t hash_int(const void* n, size_t size)
+{
+	return (size_t)*(const int*)n % size;
+}
+
+static size_t hash_constant(const void* n, size_t size)
+{
+	(void)n;
+	return 7 % size;
+}
+
+static HashMapEntryHandlers handlers = {copy_int, free, copy_int, free};
+
+/**
+ * Replaces *map with a version that has key mapped to value.
+ **/
+static void insert(PersistentMap** map, int key, int value)
+{
+	PersistentMap* next = persistentMapInsert(*map, &key, &value);
+	ck_assert_ptr_nonnull(next);
+	persistentMapRelease(*map);
+	*map = next;
+}
+
+static void removeKey(PersistentMap** map, int key)
+{
+	PersistentMap* next = persistentMapRemove(*map, &key);
+	ck_assert_ptr_nonnull(next);
+	persistentMapRelease(*map);
+	*map = next;
+}
+
+static void add_int(void* value, void* sum)
+{
+	*(long*)sum += *(int*)value;
+}
+
+START_TEST(test_persistent_map_updates)
+{
+	PersistentMap* map = persistentMapInit(hash_int, compare_int, handlers);
+	ck_assert_uint_eq(persistentMapSize(map), 0);
+	int key = 3;
+	ck_assert_ptr_null(persistentMapGet(map, &key));
+
+	const int count = 20000;
+	for (int i = 0; i < count; ++i)
+	{
+		insert(&map, i, i);
+	}
+	ck_assert_uint_eq(persistentMapSize(map), count);
+	for (int i = 0; i < count; i += 2)
+	{
+		insert(&map, i, -i);
+	}
+	ck_assert_uint_eq(persistentMapSize(map), count);
+	for (int i = 0; i < count; ++i)
+	{
+		ck_assert_int_eq(*(int*)persistentMapGet(map, &i), i % 2 ? i : -i);
+	}
+
+	for (int i = 0; i < count; i += 3)
+	{
+		removeKey(&map, i);
+	}
+	// removing a missing key changes nothing
+	key = count;
+	PersistentMap* same = persistentMapRemove(map, &key);
+	ck_assert_ptr_eq(same, map);
+	persistentMapRelease(same);
+
+	ck_assert_uint_eq(persistentMapSize(map), count - (count + 2) / 3);
+	for (int i = 0; i < 2 * count; ++i)
+	{
+		ck_assert_int_eq(persistentMapContains(map, &i), i < count && i % 3);
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		removeKey(&map, i);
+	}
+	ck_assert_uint_eq(persistentMapSize(map), 0);
+	persistentMapRelease(map);
+}
+END_TEST
+
+START_TEST(test_persistent_map_versions)
+{
+	PersistentMap* map = persistentMapInit(hash_int, compare_int, handlers);
+	for (int i = 0; i < 1000; ++i)
+	{
+		insert(&map, i, i);
+	}
+
+	// a snapshot keeps its contents while the map moves on
+	PersistentMap* snapshot = persistentMapRetain(map);
+	for (int i = 0; i < 1000; i += 2)
+	{
+		insert(&map, i, 0);
+		removeKey(&map, i + 1);
+	}
+	insert(&map, 5000, 5000);
+
+	long sum = 0;
+	persistentMapForEach(snapshot, add_int, &sum);
+	ck_assert_int_eq(sum, 999 * 1000 / 2);
+	ck_assert_uint_eq(persistentMapSize(snapshot), 1000);
+	ck_assert_int_eq(*(int*)persistentMapGet(snapshot, &(int){2}), 2);
+	ck_assert_int_eq(persistentMapContains(snapshot, &(int){5000}), 0);
+
+	sum = 0;
+	persistentMapForEach(map, add_int, &sum);
+	ck_assert_int_eq(sum, 5000);
+	ck_assert_uint_eq(persistentMapSize(map), 501);
+	ck_assert_int_eq(*(int*)persistentMapGet(map, &(int){2}), 0);
+	ck_assert_int_eq(persistentMapContains(map, &(int){3}), 0);
+
+	// the versions outlive each other in either order
+	persistentMapRelease(map);
+	ck_assert_int_eq(*(int*)persistentMapGet(snapshot, &(int){999}), 999);
+	persistentMapRelease(snapshot);
+}
+END_TEST
+
+START_TEST(test_persistent_map_colliding_keys)
+{
+	// every key has the same hash, and ends up in one collision node
+	PersistentMap* map = persistentMapInit(hash_constant, compare_int, handlers);
+	for (int i = 0; i < 100; ++i)
+	{
+		insert(&map, i, i);
+	}
+	PersistentMap* snapshot = persistentMapRetain(map);
+	for (int i = 0; i < 100; i += 2)
+	{
+		removeKey(&map, i);
+	}
+	insert(&map, 1, 100);
+
+	ck_assert_uint_eq(persistentMapSize(map), 50);
+	for (int i = 0; i < 100; ++i)
+	{
+		ck_assert_int_eq(persistentMapContains(map, &i), i % 2);
+		ck_assert_int_eq(*(int*)persistentMapGet(snapshot, &i), i);
+	}
+	ck_assert_int_eq(*(int*)persistentMapGet(map, &(int){1}), 100);
+
+	for (int i = 1; i < 100; i += 2)
+	{
+		removeKey(&map, i);
+	}
+	ck_assert_uint_eq(persistentMapSize(map), 0);
+	persistentMapRelease(map);
+	persistentMapRelease(snapshot);
+}
+END_TEST
+
+#define ACCOUNTS 100
+#define TRANSFERS 20000
+#define READERS 3
+
+typedef struct
+{
+	pthread_mutex_t lock;
+	PersistentMap* current;
+	int done;
+} Published;
+
+/**
+ * Moves amounts between accounts, publishing a version after each transfer,
+ * so that every version has the same total.
+ **/
+static void* writer(void* arg)
+{
+	Published* published = arg;
+	pthread_mutex_lock(&published->lock);
+	PersistentMap* map = persistentMapRetain(published->current);
+	pthread_mutex_unlock(&published->lock);
+
+	unsigned seed = 1;
+	for (int i = 0; i < TRANSFERS; ++i)
+	{
+		int from = rand_r(&seed) % ACCOUNTS;
+		int to = rand_r(&seed) % ACCOUNTS;
+		int amount = rand_r(&seed) % 10;
+		insert(&map, from, *(int*)persistentMapGet(map, &from) - amount);
+		insert(&map, to, *(int*)persistentMapGet(map, &to) + amount);
+
+		pthread_mutex_lock(&published->lock);
+		PersistentMap* old = published->current;
+		published->current = persistentMapRetain(map);
+		pthread_mutex_unlock(&published->lock);
+		persistentMapRelease(old);
+	}
+	persistentMapRelease(map);
+
+	pthread_mutex_lock(&published->lock);
+	published->done = 1;
+	pthread_mutex_unlock(&published->lock);
+	return NULL;
+}
+
+static void* reader(void* arg)
+{
+	Published* published = arg;
+	for (;;)
+	{
+		pthread_mutex_lock(&published->lock);
+		PersistentMap* snapshot = persistentMapRetain(published->current);
+		int done = published->done;
+		pthread_mutex_unlock(&published->lock);
+
+		long sum = 0;
+		persistentMapForEach(snapshot, add_int, &sum);
+		ck_assert_int_eq(sum, ACCOUNTS * 1000);
+		ck_assert_uint_eq(persistentMapSize(snapshot), ACCOUNTS);
+		persistentMapRelease(snapshot);
+		if (done) break;
+	}
+	return NULL;
+}
+
+START_TEST(test_persistent_map_threads)
+{
+	Published published = {PTHREAD_MUTEX_INITIALIZER, NULL, 0};
+	published.current = persistentMapInit(hash_int, compare_int, handlers);
+	for (int i = 0; i < ACCOUNTS; ++i)
+	{
+		insert(&published.current, i, 1000);
+	}
+
+	pthread_t threads[READERS + 1];
+	pthread_create(&threads[0], NULL, writer, &published);
+	for (int i = 1; i <= READERS; ++i)
+	{
+		pthread_create(&threads[i], NULL, reader, &published);
+	}
+	for (int i = 0; i <= READERS; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	long sum = 0;
+	persistentMapForEach(published.current, add_int, &sum);
+	ck_assert_int_eq(sum, ACCOUNTS * 1000);
+	persistentMapRelease(published.current);
+}
+END_TEST
+
+Suite* persistent_map_tests_suite(void)
+{
+	Suite* s = suite_create("Persistent Map Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_persistent_map_updates);
+	tcase_add_test(tc_core, test_persistent_map_versions);
+	tcase_add_test(tc_core, test_persistent_map_colliding_keys);
+	tcase_add_test(tc_core, test_persistent_map_threads);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = persistent_map_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,249 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "priority_queue.h"
+
+static void* int_copy(const void* src) {
+    int* dest = malloc(sizeof(int));
+    if (dest) {
+        *dest = *(const int*) src;
+    }
+
+    return dest;
+}
+
+static void int_free(void* n) {
+    free(n);
+}
+
+static int int_cmp(const void* first, const void* second) {
+    int a = *(const int*) first;
+    int b = *(const int*) second;
+
+    return (a > b) - (a < b);
+}
+
+// pops every element, checking that they come out in non-decreasing order
+static void assert_pops_sorted(PriorityQueue* queue, size_t expected_count) {
+    size_t count = 0;
+    int previous = -1;
+
+    int* n;
+    while ((n = priorityQueuePop(queue))) {
+        ck_assert_int_ge(*n, previous);
+        previous = *n;
+        free(n);
+        ++count;
+    }
+
+    ck_assert_uint_eq(count, expected_count);
+    ck_assert_uint_eq(priorityQueueSize(queue), 0);
+}
+
+
+START_TEST(test_queue_create) {
+    PriorityQueue* queue = priorityQueueCreate(2, int_copy, int_free, int_cmp);
+
+    ck_assert_uint_eq(priorityQueueSize(queue), 0);
+    ck_assert_ptr_null(priorityQueuePeek(queue));
+    ck_assert_ptr_null(priorityQueuePop(queue));
+
+    priorityQueueDestroy(queue);
+}
+END_TEST
+
+START_TEST(test_queue_push_pop) {
+    for (size_t arity = 2; arity <= 8; arity += 2) {
+        PriorityQueue* queue = priorityQueueCreate(arity, int_copy, int_free, int_cmp);
+
+        for (int i = 0; i < 1000; ++i) {
+            int value = (i * 7919) % 1000;
+            ck_assert_int_eq(priorityQueuePush(queue, &value, NULL), PRIORITY_QUEUE_SUCCESS);
+        }
+
+        ck_assert_uint_eq(priorityQueueSize(queue), 1000);
+        ck_assert_int_eq(*(int*) priorityQueuePeek(queue), 0);
+
+        assert_pops_sorted(queue, 1000);
+        priorityQueueDestroy(queue);
+    }
+}
+END_TEST
+
+START_TEST(test_queue_heapify) {
+    PriorityQueue* queue = priorityQueueCreate(4, int_copy, int_free, int_cmp);
+
+    int values[500];
+    const void* elements[500];
+    PriorityQueueHandle handles[500];
+    for (int i = 0; i < 500; ++i) {
+        values[i] = (i * 7919) % 500;
+        elements[i] = &values[i];
+    }
+
+    int value = 250;
+    priorityQueuePush(queue, &value, NULL);
+
+    ck_assert_int_eq(priorityQueueHeapify(queue, elements, 500, handles), PRIORITY_QUEUE_SUCCESS);
+    ck_assert_uint_eq(priorityQueueSize(queue), 501);
+    for (int i = 0; i < 500; ++i) {
+        ck_assert_int_eq(*(int*) priorityQueueGet(queue, handles[i]), values[i]);
+    }
+
+    assert_pops_sorted(queue, 501);
+
+    // heapify into an empty queue, with a single element
+    ck_assert_int_eq(priorityQueueHeapify(queue, elements, 1, NULL), PRIORITY_QUEUE_SUCCESS);
+    ck_assert_int_eq(*(int*) priorityQueuePeek(queue), values[0]);
+
+    priorityQueueDestroy(queue);
+}
+END_TEST
+
+START_TEST(test_queue_decrease_key) {
+    PriorityQueue* queue = priorityQueueCreate(2, int_copy, int_free, int_cmp);
+
+    PriorityQueueHandle handles[100];
+    for (int i = 0; i < 100; ++i) {
+        int value = 1000 + i;
+        priorityQueuePush(queue, &value, &handles[i]);
+    }
+
+    int* element = priorityQueueGet(queue, handles[57]);
+    ck_assert_int_eq(*element, 1057);
+
+    *element = 5;
+    priorityQueueDecreaseKey(queue, handles[57]);
+    ck_assert_ptr_eq(priorityQueuePeek(queue), element);
+
+    *(int*) priorityQueueGet(queue, handles[99]) = 500;
+    priorityQueueDecreaseKey(queue, handles[99]);
+
+    int* n = priorityQueuePop(queue);
+    ck_assert_int_eq(*n, 5);
+    free(n);
+
+    n = priorityQueuePop(queue);
+    ck_assert_int_eq(*n, 500);
+    free(n);
+
+    n = priorityQueuePeek(queue);
+    ck_assert_int_eq(*n, 1000);
+
+    assert_pops_sorted(queue, 98);
+    priorityQueueDestroy(queue);
+}
+END_TEST
+
+START_TEST(test_queue_remove) {
+    PriorityQueue* queue = priorityQueueCreate(3, int_copy, int_free, int_cmp);
+
+    PriorityQueueHandle handles[100];
+    for (int i = 0; i < 100; ++i) {
+        int value = (i * 37) % 100;
+        priorityQueuePush(queue, &value, &handles[i]);
+    }
+
+    // remove every even element through its handle
+    for (int i = 0; i < 100; i += 2) {
+        int* n = priorityQueueRemove(queue, handles[i]);
+        ck_assert_int_eq(*n, (i * 37) % 100);
+        free(n);
+    }
+
+    ck_assert_uint_eq(priorityQueueSize(queue), 50);
+
+    // the remaining handles still refer to their elements
+    for (int i = 1; i < 100; i += 2) {
+        ck_assert_int_eq(*(int*) priorityQueueGet(queue, handles[i]), (i * 37) % 100);
+    }
+
+    // released handles are reused
+    PriorityQueueHandle handle;
+    int value = -1;
+    priorityQueuePush(queue, &value, &handle);
+    ck_assert_uint_lt(handle, 100);
+    ck_assert_int_eq(*(int*) priorityQueuePeek(queue), -1);
+
+    int* n = priorityQueuePop(queue);
+    ck_assert_int_eq(*n, -1);
+    free(n);
+
+    assert_pops_sorted(queue, 50);
+    priorityQueueDestroy(queue);
+}
+END_TEST
+
+START_TEST(test_queue_push_owned) {
+    PriorityQueue* queue = priorityQueueCreate(2, NULL, int_free, int_cmp);
+
+    for (int i = 10; i > 0; --i) {
+        int* value = malloc(sizeof(int));
+        *value = i;
+        ck_assert_int_eq(priorityQueuePushOwned(queue, value, NULL), PRIORITY_QUEUE_SUCCESS);
+    }
+
+    int* n = priorityQueuePop(queue);
+    ck_assert_int_eq(*n, 1);
+    free(n);
+
+    // the remaining elements are freed with the queue
+    priorityQueueDestroy(queue);
+}
+END_TEST
+
+START_TEST(test_queue_allocator) {
+    DsTracker* tracker = dsTrackerCreate(NULL);
+    DsAllocator allocator = dsTrackerAllocator(tracker);
+    PriorityQueue* queue = priorityQueueCreateWithAllocator(4, int_copy, int_free, int_cmp, &allocator);
+    ck_assert_ptr_nonnull(queue);
+
+    // the heap grows a few times along the way
+    for (int i = 1000; i > 0; --i) {
+        ck_assert_int_eq(priorityQueuePush(queue, &i, NULL), PRIORITY_QUEUE_SUCCESS);
+    }
+    ck_assert_uint_gt(dsTrackerStats(tracker).allocations, 3);
+
+    int* n = priorityQueuePop(queue);
+    ck_assert_int_eq(*n, 1);
+    free(n);
+    assert_pops_sorted(queue, 999);
+
+    priorityQueueDestroy(queue);
+    ck_assert_uint_eq(dsTrackerStats(tracker).bytes_in_use, 0);
+    dsTrackerDestroy(tracker);
+}
+END_TEST
+
+Suite* priority_queue_tests_suite(void) {
+    Suite* s = suite_create("Priority Queue Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_queue_create);
+    tcase_add_test(tc_core, test_queue_push_pop);
+    tcase_add_test(tc_core, test_queue_heapify);
+    tcase_add_test(tc_core, test_queue_decrease_key);
+    tcase_add_test(tc_core, test_queue_remove);
+    tcase_add_test(tc_core, test_queue_push_owned);
+    tcase_add_test(tc_core, test_queue_allocator);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = priority_queue_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
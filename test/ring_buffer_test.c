@@ -0,0 +1,181 @@
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ring_buffer.h"
+
+typedef struct {
+    uint64_t sequence;
+    uint32_t payload[3];
+} Message;
+
+#define STRESS_MESSAGES 1000000
+
+static void* produce(void* arg) {
+    RingBuffer* buffer = arg;
+
+    Message batch[7];
+    uint64_t sequence = 0;
+    while (sequence < STRESS_MESSAGES) {
+        size_t count = 0;
+        for (; count < 7 && sequence + count < STRESS_MESSAGES; ++count) {
+            batch[count].sequence = sequence + count;
+            batch[count].payload[0] = (uint32_t) (sequence + count) * 3;
+        }
+
+        size_t written = 0;
+        while (written < count) {
+            size_t n = ringBufferWriteBatch(buffer, batch + written, count - written);
+            if (0 == n) sched_yield();
+            written += n;
+        }
+        sequence += count;
+    }
+
+    return NULL;
+}
+
+
+START_TEST(test_buffer_create) {
+    RingBuffer* buffer = ringBufferCreate(5, free);
+
+    ck_assert_uint_eq(ringBufferCapacity(buffer), 8);
+    ck_assert_uint_eq(ringBufferSize(buffer), 0);
+    ck_assert_ptr_null(ringBufferPop(buffer));
+
+    ringBufferDestroy(buffer);
+}
+END_TEST
+
+START_TEST(test_buffer_push_pop) {
+    RingBuffer* buffer = ringBufferCreate(4, free);
+
+    // three elements per round, so the rounds wrap around the slot array
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            int* n = malloc(sizeof(int));
+            *n = round * 3 + i;
+            ck_assert_int_eq(ringBufferPush(buffer, n), RING_BUFFER_SUCCESS);
+        }
+
+        ck_assert_uint_eq(ringBufferSize(buffer), 3);
+
+        for (int i = 0; i < 3; ++i) {
+            int* n = ringBufferPop(buffer);
+            ck_assert_int_eq(*n, round * 3 + i);
+            free(n);
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        ck_assert_int_eq(ringBufferPush(buffer, malloc(sizeof(int))), RING_BUFFER_SUCCESS);
+    }
+
+    int overflow = 0;
+    ck_assert_int_eq(ringBufferPush(buffer, &overflow), RING_BUFFER_FULL);
+
+    // queued elements are freed with the buffer
+    ringBufferDestroy(buffer);
+}
+END_TEST
+
+START_TEST(test_buffer_inline_batch) {
+    RingBuffer* buffer = ringBufferCreateInline(16, sizeof(Message));
+
+    Message in[10];
+    for (int i = 0; i < 10; ++i) {
+        in[i].sequence = i;
+    }
+
+    Message out[16];
+    uint64_t next = 0;
+    uint64_t expected = 0;
+    for (int round = 0; round < 20; ++round) {
+        // batches straddle the end of the slot array
+        next += ringBufferWriteBatch(buffer, in, 10);
+        for (int i = 0; i < 10; ++i) {
+            in[i].sequence = next + i;
+        }
+
+        size_t read = ringBufferReadBatch(buffer, out, 7);
+        for (size_t i = 0; i < read; ++i) {
+            ck_assert_uint_eq(out[i].sequence, expected++);
+        }
+    }
+
+    // reads are slower than writes, so the buffer fills up and batches are cut short
+    ck_assert_uint_eq(ringBufferSize(buffer), 9);
+    ck_assert_uint_eq(ringBufferWriteBatch(buffer, in, 10), 7);
+    ck_assert_uint_eq(ringBufferSize(buffer), 16);
+    ck_assert_uint_eq(ringBufferWriteBatch(buffer, in, 10), 0);
+
+    ck_assert_uint_eq(ringBufferReadBatch(buffer, out, 16), 16);
+    for (size_t i = 0; i < 16; ++i) {
+        ck_assert_uint_eq(out[i].sequence, expected++);
+    }
+
+    Message message;
+    ck_assert_int_eq(ringBufferRead(buffer, &message), RING_BUFFER_EMPTY);
+    ck_assert_int_eq(ringBufferWrite(buffer, &in[0]), RING_BUFFER_SUCCESS);
+    ck_assert_int_eq(ringBufferRead(buffer, &message), RING_BUFFER_SUCCESS);
+    ck_assert_uint_eq(message.sequence, in[0].sequence);
+
+    ringBufferDestroy(buffer);
+}
+END_TEST
+
+START_TEST(test_buffer_threads) {
+    RingBuffer* buffer = ringBufferCreateInline(64, sizeof(Message));
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, produce, buffer);
+
+    // every message arrives exactly once, in order, with its contents intact
+    Message batch[5];
+    uint64_t expected = 0;
+    while (expected < STRESS_MESSAGES) {
+        size_t read = ringBufferReadBatch(buffer, batch, 5);
+        if (0 == read) sched_yield();
+        for (size_t i = 0; i < read; ++i) {
+            ck_assert_uint_eq(batch[i].sequence, expected);
+            ck_assert_uint_eq(batch[i].payload[0], (uint32_t) expected * 3);
+            ++expected;
+        }
+    }
+
+    pthread_join(producer, NULL);
+    ck_assert_uint_eq(ringBufferSize(buffer), 0);
+
+    ringBufferDestroy(buffer);
+}
+END_TEST
+
+Suite* ring_buffer_tests_suite(void) {
+    Suite* s = suite_create("Ring Buffer Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_buffer_create);
+    tcase_add_test(tc_core, test_buffer_push_pop);
+    tcase_add_test(tc_core, test_buffer_inline_batch);
+    tcase_add_test(tc_core, test_buffer_threads);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = ring_buffer_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
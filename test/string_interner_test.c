@@ -0,0 +1,162 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_map.h"
+#include "string_interner.h"
+
+static void* copy_int(const void* n)
+{
+	int* value = malloc(sizeof(int));
+	if (value)
+	{
+		*value = *(const int*)n;
+	}
+	return value;
+}
+
+static void free_int(void* value)
+{
+	free(value);
+}
+
+
+START_TEST(test_interner_canonical)
+{
+	StringInterner* interner = stringInternerCreate();
+	ck_assert_uint_eq(stringInternerSize(interner), 0);
+	ck_assert_ptr_null(stringInternerFind(interner, "hello"));
+
+	char buffer[16];
+	strcpy(buffer, "hello");
+
+	const char* first = stringInternerIntern(interner, "hello");
+	const char* second = stringInternerIntern(interner, buffer);
+	ck_assert_ptr_eq(first, second);
+	ck_assert_ptr_ne(first, buffer);
+	ck_assert_str_eq(first, "hello");
+
+	ck_assert_ptr_eq(stringInternerFind(interner, "hello"), first);
+	ck_assert_ptr_ne(stringInternerIntern(interner, "world"), first);
+	ck_assert_uint_eq(stringInternerSize(interner), 2);
+
+	const char* empty = stringInternerIntern(interner, "");
+	ck_assert_str_eq(empty, "");
+	ck_assert_ptr_eq(stringInternerIntern(interner, ""), empty);
+
+	stringInternerDestroy(interner);
+	stringInternerDestroy(NULL);
+}
+END_TEST
+
+START_TEST(test_interner_ids)
+{
+	StringInterner* interner = stringInternerCreate();
+
+	// enough strings to span several arena blocks, plus an oversized one
+	const char* canonical[20000];
+	char buffer[32];
+	for (int i = 0; i < 20000; ++i)
+	{
+		sprintf(buffer, "string-%d", i);
+		canonical[i] = stringInternerIntern(interner, buffer);
+		ck_assert_uint_eq(stringInternerId(interner, canonical[i]), i);
+	}
+
+	char* large = malloc(200000);
+	memset(large, 'x', 199999);
+	large[199999] = '\0';
+	const char* large_canonical = stringInternerIntern(interner, large);
+	ck_assert_str_eq(large_canonical, large);
+	free(large);
+
+	// the strings didn't move, and ids map back to them
+	for (int i = 0; i < 20000; ++i)
+	{
+		sprintf(buffer, "string-%d", i);
+		ck_assert_str_eq(canonical[i], buffer);
+		ck_assert_ptr_eq(stringInternerString(interner, i), canonical[i]);
+		ck_assert_ptr_eq(stringInternerIntern(interner, buffer), canonical[i]);
+	}
+
+	ck_assert_uint_eq(stringInternerId(interner, large_canonical), 20000);
+	ck_assert_ptr_null(stringInternerString(interner, 20001));
+	ck_assert_uint_eq(stringInternerSize(interner), 20001);
+
+	stringInternerDestroy(interner);
+}
+END_TEST
+
+START_TEST(test_interner_map_keys)
+{
+	StringInterner* interner = stringInternerCreate();
+
+	HashMapEntryHandlers handlers = {internedKeyCopy, internedKeyFree, copy_int, free_int};
+	HashMap* first = hashMapInit(internedKeyHash, internedKeyCompare, handlers);
+	HashMap* second = hashMapInit(internedKeyHash, internedKeyCompare, handlers);
+
+	char buffer[32];
+	for (int i = 0; i < 1000; ++i)
+	{
+		sprintf(buffer, "key-%d", i);
+		const char* key = stringInternerIntern(interner, buffer);
+		hashMapInsert(first, key, &i);
+
+		int negated = -i;
+		hashMapInsert(second, key, &negated);
+	}
+
+	// both maps share the interner's key memory
+	for (int i = 0; i < 1000; ++i)
+	{
+		sprintf(buffer, "key-%d", i);
+		const char* key = stringInternerFind(interner, buffer);
+		ck_assert_int_eq(*(int*)hashMapGet(first, key), i);
+		ck_assert_int_eq(*(int*)hashMapGet(second, key), -i);
+	}
+
+	const char* missing = stringInternerIntern(interner, "missing");
+	ck_assert(!hashMapContains(first, missing));
+
+	// keys are ordered (by id), as hash maps require of key_cmp_func
+	const char* low = stringInternerFind(interner, "key-1");
+	const char* high = stringInternerFind(interner, "key-2");
+	ck_assert_int_lt(internedKeyCompare(low, high), 0);
+	ck_assert_int_gt(internedKeyCompare(high, low), 0);
+	ck_assert_int_eq(internedKeyCompare(low, low), 0);
+
+	hashMapDestroy(first);
+	hashMapDestroy(second);
+	stringInternerDestroy(interner);
+}
+END_TEST
+
+Suite* string_interner_tests_suite(void)
+{
+	Suite* s = suite_create("String Interner Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_interner_canonical);
+	tcase_add_test(tc_core, test_interner_ids);
+	tcase_add_test(tc_core, test_interner_map_keys);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = string_interner_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
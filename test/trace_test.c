@@ -0,0 +1,265 @@
+#include <check.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hash_map.h"
+#include "trace.h"
+
+#define EVENT_BASIC (TRACE_USER + 1)
+#define EVENT_WRAP (TRACE_USER + 2)
+#define EVENT_THREAD (TRACE_USER + 3)
+
+typedef struct
+{
+	TraceEvent* events;	// every buffer's events, one buffer after the other
+	size_t count;
+	uint64_t lost;
+} Trace;
+
+/**
+ * Dumps the trace to a temporary file, and reads it back.
+ **/
+static Trace dumpAndRead(void)
+{
+	char path[] = "/tmp/trace_test_XXXXXX";
+	int fd = mkstemp(path);
+	ck_assert_int_ne(fd, -1);
+	close(fd);
+	ck_assert_int_eq(traceDump(path), 0);
+
+	FILE* file = fopen(path, "rb");
+	ck_assert_ptr_nonnull(file);
+
+	TraceFileHeader header;
+	ck_assert_int_eq(fread(&header, sizeof(header), 1, file), 1);
+	ck_assert_int_eq(memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)), 0);
+	ck_assert(header.ticks_per_second > 0);
+
+	Trace trace = {NULL, 0, 0};
+	for (uint32_t i = 0; i < header.buffer_count; ++i)
+	{
+		TraceBufferHeader buffer;
+		ck_assert_int_eq(fread(&buffer, sizeof(buffer), 1, file), 1);
+
+		trace.events = realloc(trace.events,
+				       (trace.count + buffer.event_count + 1) * sizeof(TraceEvent));
+		ck_assert_uint_eq(fread(trace.events + trace.count, sizeof(TraceEvent),
+					buffer.event_count, file), buffer.event_count);
+		trace.count += buffer.event_count;
+		trace.lost += buffer.lost_count;
+	}
+
+	fclose(file);
+	unlink(path);
+	return trace;
+}
+
+
+START_TEST(test_trace_record_and_dump)
+{
+	for (uint64_t i = 0; i < 10; ++i)
+	{
+		traceRecord(EVENT_BASIC, i, 2 * i);
+	}
+
+	Trace trace = dumpAndRead();
+	uint64_t next = 0;
+	const TraceEvent* previous = NULL;
+	for (size_t i = 0; i < trace.count; ++i)
+	{
+		const TraceEvent* event = &trace.events[i];
+		if (EVENT_BASIC != event->type) continue;
+
+		ck_assert_uint_eq(event->arg0, next);
+		ck_assert_uint_eq(event->arg1, 2 * next);
+		if (previous)
+		{
+			ck_assert_uint_eq(event->thread_id, previous->thread_id);
+			ck_assert_uint_ge(event->timestamp, previous->timestamp);
+		}
+		previous = event;
+		++next;
+	}
+	ck_assert_uint_eq(next, 10);
+
+	free(trace.events);
+}
+END_TEST
+
+START_TEST(test_trace_overwrite)
+{
+	const uint64_t recorded = 10000;
+	for (uint64_t i = 0; i < recorded; ++i)
+	{
+		traceRecord(EVENT_WRAP, i, 0);
+	}
+
+	// the buffer keeps the latest events, in order
+	Trace trace = dumpAndRead();
+	size_t kept = 0;
+	uint64_t last = 0;
+	for (size_t i = 0; i < trace.count; ++i)
+	{
+		if (EVENT_WRAP != trace.events[i].type) continue;
+
+		if (kept) ck_assert_uint_eq(trace.events[i].arg0, last + 1);
+		last = trace.events[i].arg0;
+		++kept;
+	}
+	ck_assert_uint_eq(last, recorded - 1);
+	ck_assert(kept > 0 && kept < recorded);
+	ck_assert_uint_ge(trace.lost, recorded - kept);
+
+	free(trace.events);
+}
+END_TEST
+
+#define THREADS 4
+#define THREAD_EVENTS 100
+
+static void* recordEvents(void* arg)
+{
+	uint64_t index = (uint64_t)(uintptr_t)arg;
+	for (uint64_t i = 0; i < THREAD_EVENTS; ++i)
+	{
+		traceRecord(EVENT_THREAD, index, i);
+	}
+	return NULL;
+}
+
+START_TEST(test_trace_threads)
+{
+	pthread_t threads[THREADS];
+	for (uintptr_t i = 0; i < THREADS; ++i)
+	{
+		pthread_create(&threads[i], NULL, recordEvents, (void*)i);
+	}
+	for (size_t i = 0; i < THREADS; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	// the buffers of exited threads are dumped too, and every thread got
+	// its own id
+	Trace trace = dumpAndRead();
+	uint64_t next[THREADS] = {0};
+	uint32_t thread_ids[THREADS] = {0};
+	for (size_t i = 0; i < trace.count; ++i)
+	{
+		const TraceEvent* event = &trace.events[i];
+		if (EVENT_THREAD != event->type) continue;
+
+		ck_assert_uint_lt(event->arg0, THREADS);
+		ck_assert_uint_eq(event->arg1, next[event->arg0]++);
+		if (!thread_ids[event->arg0]) thread_ids[event->arg0] = event->thread_id;
+		ck_assert_uint_eq(event->thread_id, thread_ids[event->arg0]);
+	}
+
+	for (size_t i = 0; i < THREADS; ++i)
+	{
+		ck_assert_uint_eq(next[i], THREAD_EVENTS);
+		for (size_t j = 0; j < i; ++j)
+		{
+			ck_assert_uint_ne(thread_ids[i], thread_ids[j]);
+		}
+	}
+
+	free(trace.events);
+}
+END_TEST
+
+static size_t hashInt(const void* key, size_t size)
+{
+	return (size_t)*(const int*)key % size;
+}
+
+static int compareInts(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+static void* copyInt(const void* value)
+{
+	int* copy = malloc(sizeof(*copy));
+	if (copy) *copy = *(const int*)value;
+	return copy;
+}
+
+START_TEST(test_trace_levels)
+{
+	// disabled trace points don't evaluate their arguments
+	int evaluated = 0;
+	TRACE_EVENT(EVENT_BASIC, ++evaluated, 0);
+	TRACE_DETAIL(EVENT_BASIC, ++evaluated, 0);
+	ck_assert_int_eq(evaluated, (TRACE_LEVEL >= TRACE_LEVEL_EVENTS) +
+			 (TRACE_LEVEL >= TRACE_LEVEL_DETAIL));
+
+	// the library is built with the same level
+	HashMapEntryHandlers handlers = {copyInt, free, copyInt, free};
+	HashMap* map = hashMapInit(hashInt, compareInts, handlers);
+	for (int i = 0; i < 100; ++i)
+	{
+		hashMapInsert(map, &i, &i);
+	}
+	hashMapDestroy(map);
+
+	Trace trace = dumpAndRead();
+	size_t counts[TRACE_HASH_MAP_RESIZE_END + 1] = {0};
+	for (size_t i = 0; i < trace.count; ++i)
+	{
+		if (trace.events[i].type <= TRACE_HASH_MAP_RESIZE_END)
+		{
+			++counts[trace.events[i].type];
+		}
+	}
+
+	// 100 elements take the map from 32 to 256 buckets
+	ck_assert_uint_eq(counts[TRACE_HASH_MAP_RESIZE_BEGIN],
+			  TRACE_LEVEL >= TRACE_LEVEL_EVENTS ? 3 : 0);
+	ck_assert_uint_eq(counts[TRACE_HASH_MAP_RESIZE_END],
+			  counts[TRACE_HASH_MAP_RESIZE_BEGIN]);
+	ck_assert_uint_eq(counts[TRACE_HASH_MAP_INSERT],
+			  TRACE_LEVEL >= TRACE_LEVEL_DETAIL ? 100 : 0);
+	ck_assert_uint_eq(counts[TRACE_HASH_MAP_LOOKUP],
+			  counts[TRACE_HASH_MAP_INSERT]);
+
+	ck_assert_str_eq(traceEventName(TRACE_HASH_MAP_INSERT), "hash_map.insert");
+	ck_assert_ptr_null(traceEventName(EVENT_BASIC));
+
+	free(trace.events);
+}
+END_TEST
+
+Suite* trace_tests_suite(void)
+{
+	Suite* s = suite_create("Trace Tests");
+
+	/* Core test case */
+	TCase* tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_trace_record_and_dump);
+	tcase_add_test(tc_core, test_trace_overwrite);
+	tcase_add_test(tc_core, test_trace_threads);
+	tcase_add_test(tc_core, test_trace_levels);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	Suite* s = trace_tests_suite();
+	SRunner* sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+
+	int num_failures = srunner_ntests_failed(sr);
+
+	srunner_free(sr);
+
+	return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
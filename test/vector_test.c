@@ -0,0 +1,296 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+
+static void* str_copy(const void* src) {
+    size_t length = strlen(src);
+
+    char* dest = malloc(length + 1);
+    if (dest) {
+        strcpy(dest, src);
+    }
+
+    return dest;
+}
+
+static void str_free(void* s) {
+    free(s);
+}
+
+static int str_cmp(const void* first, const void* second) {
+    return strcmp(first, second);
+}
+
+static int int_cmp(const void* first, const void* second) {
+    int a = *(const int*) first;
+    int b = *(const int*) second;
+
+    return (a > b) - (a < b);
+}
+
+
+START_TEST(test_vector_create) {
+    Vector* vector = vectorCreate(str_copy, str_free, str_cmp);
+
+    ck_assert_uint_eq(vectorSize(vector), 0);
+    ck_assert_uint_eq(vectorCapacity(vector), 0);
+    ck_assert_ptr_null(vectorGetAt(vector, 0));
+    ck_assert_ptr_null(vectorPop(vector));
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_push_pop) {
+    Vector* vector = vectorCreate(str_copy, str_free, str_cmp);
+
+    ck_assert_int_eq(vectorPush(vector, "AAA"), VECTOR_SUCCESS);
+    vectorPush(vector, "BBB");
+    vectorPush(vector, "CCC");
+
+    ck_assert_uint_eq(vectorSize(vector), 3);
+    ck_assert_str_eq(vectorGetAt(vector, 0), "AAA");
+    ck_assert_str_eq(vectorGetAt(vector, 2), "CCC");
+    ck_assert_ptr_null(vectorGetAt(vector, 3));
+
+    char* s = vectorPop(vector);
+    ck_assert_str_eq(s, "CCC");
+    free(s);
+    ck_assert_uint_eq(vectorSize(vector), 2);
+
+    char* owned = str_copy("DDD");
+    ck_assert_int_eq(vectorPushOwned(vector, owned), VECTOR_SUCCESS);
+    ck_assert_ptr_eq(vectorGetAt(vector, 2), owned);
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_insert_remove) {
+    Vector* vector = vectorCreate(str_copy, str_free, str_cmp);
+
+    vectorInsertAt(vector, 0, "CCC");
+    vectorInsertAt(vector, 0, "AAA");
+    vectorInsertAt(vector, 1, "BBB");
+    vectorInsertAt(vector, 99, "DDD");
+
+    ck_assert_uint_eq(vectorSize(vector), 4);
+    ck_assert_str_eq(vectorGetAt(vector, 0), "AAA");
+    ck_assert_str_eq(vectorGetAt(vector, 1), "BBB");
+    ck_assert_str_eq(vectorGetAt(vector, 2), "CCC");
+    ck_assert_str_eq(vectorGetAt(vector, 3), "DDD");
+
+    ck_assert_int_eq(vectorIndexOf(vector, "CCC"), 2);
+    ck_assert_int_eq(vectorIndexOf(vector, "Non-existent"), -1);
+
+    char* s = vectorRemoveAt(vector, 1);
+    ck_assert_str_eq(s, "BBB");
+    free(s);
+    ck_assert_ptr_null(vectorRemoveAt(vector, 3));
+
+    ck_assert_uint_eq(vectorSize(vector), 3);
+    ck_assert_str_eq(vectorGetAt(vector, 1), "CCC");
+
+    vectorClear(vector);
+    ck_assert_uint_eq(vectorSize(vector), 0);
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_reserve) {
+    Vector* vector = vectorCreateInline(sizeof(int), int_cmp);
+
+    ck_assert_int_eq(vectorReserve(vector, 100), VECTOR_SUCCESS);
+    ck_assert_uint_ge(vectorCapacity(vector), 100);
+
+    void* storage = vectorGetAt(vector, 0);
+    for (int i = 0; i < 100; ++i) {
+        vectorPush(vector, &i);
+        if (0 == i) storage = vectorGetAt(vector, 0);
+    }
+
+    // no reallocation happened
+    ck_assert_ptr_eq(vectorGetAt(vector, 0), storage);
+
+    for (int i = 100; i < 1000; ++i) {
+        vectorPush(vector, &i);
+    }
+
+    ck_assert_uint_eq(vectorSize(vector), 1000);
+    for (int i = 0; i < 1000; ++i) {
+        ck_assert_int_eq(*(int*) vectorGetAt(vector, i), i);
+    }
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_inline) {
+    Vector* vector = vectorCreateInline(sizeof(int), int_cmp);
+
+    int values[] = {10, 20, 30, 40};
+    ck_assert_int_eq(vectorAppend(vector, values, 4), VECTOR_SUCCESS);
+    ck_assert_uint_eq(vectorSize(vector), 4);
+
+    int value = 25;
+    vectorInsertAt(vector, 2, &value);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 2), 25);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 3), 30);
+
+    int* removed = vectorRemoveAt(vector, 0);
+    ck_assert_int_eq(*removed, 10);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 0), 20);
+
+    int* popped = vectorPop(vector);
+    ck_assert_int_eq(*popped, 40);
+    ck_assert_uint_eq(vectorSize(vector), 3);
+
+    Vector* clone = vectorClone(vector);
+    ck_assert_uint_eq(vectorSize(clone), 3);
+    ck_assert_int_eq(*(int*) vectorGetAt(clone, 1), 25);
+    vectorDestroy(clone);
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_inline_aliasing) {
+    // elements of the vector itself, inserted while it grows or shifts
+    Vector* vector = vectorCreateInline(sizeof(int), int_cmp);
+
+    for (int i = 0; i < 8; ++i) {
+        vectorPush(vector, &i);
+    }
+    ck_assert_uint_eq(vectorSize(vector), vectorCapacity(vector));
+    ck_assert_int_eq(vectorPush(vector, vectorGetAt(vector, 3)), VECTOR_SUCCESS);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 8), 3);
+
+    // 0 1 2 3 4 5 6 7 3 -> 5 0 1 2 3 4 5 6 7 3
+    ck_assert_int_eq(vectorInsertAt(vector, 0, vectorGetAt(vector, 5)), VECTOR_SUCCESS);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 0), 5);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 6), 5);
+
+    // -> 5 0 1 2 3 4 5 6 7 3 5 1
+    ck_assert_int_eq(vectorPush(vector, vectorGetAt(vector, 0)), VECTOR_SUCCESS);
+    ck_assert_int_eq(vectorInsertAt(vector, 100, vectorGetAt(vector, 2)), VECTOR_SUCCESS);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 11), 1);
+
+    // popped and removed elements, up to a full vector growing again
+    while (vectorSize(vector) < vectorCapacity(vector)) {
+        ck_assert_int_eq(vectorPush(vector, vectorPop(vector)), VECTOR_SUCCESS);
+        vectorPush(vector, &(int){9});
+    }
+    ck_assert_int_eq(vectorInsertAt(vector, 1, vectorRemoveAt(vector, 0)), VECTOR_SUCCESS);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, 1), 5);
+    ck_assert_uint_eq(vectorSize(vector), vectorCapacity(vector));
+    ck_assert_int_eq(vectorPush(vector, vectorRemoveAt(vector, 1)), VECTOR_SUCCESS);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, vectorSize(vector) - 1), 5);
+    ck_assert_int_eq(vectorPush(vector, vectorPop(vector)), VECTOR_SUCCESS);
+    ck_assert_int_eq(*(int*) vectorGetAt(vector, vectorSize(vector) - 1), 5);
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_append) {
+    Vector* vector = vectorCreate(str_copy, str_free, str_cmp);
+
+    const char* elements[] = {"AAA", "BBB", "CCC"};
+    vectorPush(vector, "000");
+    ck_assert_int_eq(vectorAppend(vector, elements, 3), VECTOR_SUCCESS);
+
+    ck_assert_uint_eq(vectorSize(vector), 4);
+    ck_assert_str_eq(vectorGetAt(vector, 1), "AAA");
+    ck_assert_str_eq(vectorGetAt(vector, 3), "CCC");
+    ck_assert_ptr_ne(vectorGetAt(vector, 1), elements[0]);
+
+    Vector* clone = vectorClone(vector);
+    ck_assert_str_eq(vectorGetAt(clone, 2), "BBB");
+    ck_assert_ptr_ne(vectorGetAt(clone, 2), vectorGetAt(vector, 2));
+    vectorDestroy(clone);
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+START_TEST(test_vector_binary_search) {
+    Vector* vector = vectorCreateInline(sizeof(int), int_cmp);
+
+    ck_assert_int_eq(vectorBinarySearch(vector, &(int){1}), -1);
+    ck_assert_uint_eq(vectorLowerBound(vector, &(int){1}), 0);
+
+    for (int i = 0; i < 100; ++i) {
+        int value = 2 * i;
+        vectorPush(vector, &value);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        int value = 2 * i;
+        ck_assert_int_eq(vectorBinarySearch(vector, &value), i);
+
+        ++value;
+        ck_assert_int_eq(vectorBinarySearch(vector, &value), -1);
+        ck_assert_uint_eq(vectorLowerBound(vector, &value), i + 1);
+    }
+
+    ck_assert_uint_eq(vectorLowerBound(vector, &(int){-5}), 0);
+    ck_assert_uint_eq(vectorLowerBound(vector, &(int){500}), 100);
+
+    vectorDestroy(vector);
+}
+END_TEST
+
+static void str_print(const void* element) {
+    printf("%s", (const char*) element);
+}
+
+static void test_vector_print(void) {
+    Vector* vector = vectorCreate(str_copy, str_free, str_cmp);
+
+    vectorPush(vector, "AAA");
+    vectorPush(vector, "BBB");
+    vectorPush(vector, "CCC");
+
+    vectorPrint(vector, str_print);
+
+    vectorDestroy(vector);
+}
+
+Suite* vector_tests_suite(void) {
+    Suite* s = suite_create("Vector Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_vector_create);
+    tcase_add_test(tc_core, test_vector_push_pop);
+    tcase_add_test(tc_core, test_vector_insert_remove);
+    tcase_add_test(tc_core, test_vector_reserve);
+    tcase_add_test(tc_core, test_vector_inline);
+    tcase_add_test(tc_core, test_vector_inline_aliasing);
+    tcase_add_test(tc_core, test_vector_append);
+    tcase_add_test(tc_core, test_vector_binary_search);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = vector_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    printf("Running print test (check visually):\n");
+    test_vector_print();
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
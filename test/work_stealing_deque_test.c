@@ -0,0 +1,148 @@
+#include <check.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "work_stealing_deque.h"
+
+#define STRESS_ELEMENTS 200000
+#define THIEVES 3
+
+typedef struct {
+    WorkStealingDeque* deque;
+    atomic_int done;
+    atomic_uchar seen[STRESS_ELEMENTS + 1];
+} StressContext;
+
+// elements are the integers 1..n, disguised as pointers
+static void* as_element(uintptr_t n) {
+    return (void*) n;
+}
+
+static void take(StressContext* ctx, void* element) {
+    uintptr_t n = (uintptr_t) element;
+    ck_assert_uint_ge(n, 1);
+    ck_assert_uint_le(n, STRESS_ELEMENTS);
+    ck_assert_uint_eq(atomic_fetch_add(&ctx->seen[n], 1), 0);
+}
+
+static void* steal(void* arg) {
+    StressContext* ctx = arg;
+
+    while (!atomic_load(&ctx->done)) {
+        void* element = workStealingDequeSteal(ctx->deque);
+        if (element) {
+            take(ctx, element);
+        } else {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+
+START_TEST(test_deque_owner) {
+    WorkStealingDeque* deque = workStealingDequeCreate(0);
+
+    ck_assert_ptr_null(workStealingDequePop(deque));
+    ck_assert_ptr_null(workStealingDequeSteal(deque));
+
+    // push far past the initial capacity, so the deque grows several times
+    for (uintptr_t n = 1; n <= 1000; ++n) {
+        ck_assert_int_eq(workStealingDequePush(deque, as_element(n)), WORK_STEALING_DEQUE_SUCCESS);
+    }
+    ck_assert_uint_eq(workStealingDequeSize(deque), 1000);
+
+    // the owner pops the newest elements, thieves steal the oldest
+    ck_assert_ptr_eq(workStealingDequePop(deque), as_element(1000));
+    ck_assert_ptr_eq(workStealingDequeSteal(deque), as_element(1));
+    ck_assert_ptr_eq(workStealingDequeSteal(deque), as_element(2));
+    ck_assert_ptr_eq(workStealingDequePop(deque), as_element(999));
+
+    for (uintptr_t n = 998; n >= 3; --n) {
+        ck_assert_ptr_eq(workStealingDequePop(deque), as_element(n));
+    }
+
+    ck_assert_uint_eq(workStealingDequeSize(deque), 0);
+    ck_assert_ptr_null(workStealingDequePop(deque));
+
+    // the emptied deque is still usable
+    workStealingDequePush(deque, as_element(7));
+    ck_assert_ptr_eq(workStealingDequeSteal(deque), as_element(7));
+
+    workStealingDequeDestroy(deque);
+}
+END_TEST
+
+START_TEST(test_deque_concurrent_steal) {
+    StressContext* ctx = calloc(1, sizeof(StressContext));
+    ctx->deque = workStealingDequeCreate(0);
+
+    pthread_t thieves[THIEVES];
+    for (int i = 0; i < THIEVES; ++i) {
+        pthread_create(&thieves[i], NULL, steal, ctx);
+    }
+
+    // the owner pushes in bursts and pops some of its own work back, racing the
+    // thieves for the last elements
+    uintptr_t next = 1;
+    while (next <= STRESS_ELEMENTS) {
+        for (int i = 0; i < 100 && next <= STRESS_ELEMENTS; ++i) {
+            ck_assert_int_eq(workStealingDequePush(ctx->deque, as_element(next++)), WORK_STEALING_DEQUE_SUCCESS);
+        }
+
+        for (int i = 0; i < 60; ++i) {
+            void* element = workStealingDequePop(ctx->deque);
+            if (!element) break;
+            take(ctx, element);
+        }
+    }
+
+    void* element;
+    while ((element = workStealingDequePop(ctx->deque))) {
+        take(ctx, element);
+    }
+
+    atomic_store(&ctx->done, 1);
+    for (int i = 0; i < THIEVES; ++i) {
+        pthread_join(thieves[i], NULL);
+    }
+
+    // every element was taken exactly once
+    for (uintptr_t n = 1; n <= STRESS_ELEMENTS; ++n) {
+        ck_assert_uint_eq(atomic_load(&ctx->seen[n]), 1);
+    }
+
+    workStealingDequeDestroy(ctx->deque);
+    free(ctx);
+}
+END_TEST
+
+Suite* work_stealing_deque_tests_suite(void) {
+    Suite* s = suite_create("Work Stealing Deque Tests");
+
+    /* Core test case */
+    TCase* tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, test_deque_owner);
+    tcase_add_test(tc_core, test_deque_concurrent_steal);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    Suite* s = work_stealing_deque_tests_suite();
+    SRunner* sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_VERBOSE);
+
+    int num_failures = srunner_ntests_failed(sr);
+
+    srunner_free(sr);
+
+    return (num_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,152 @@
+// decodes a trace file written by traceDump (see trace.h): prints every event,
+// one per line, followed by a summary. times are in microseconds since the
+// earliest event of the file.
+//
+// usage: trace_dump [-s] file
+//   -s  print the summary only
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+typedef struct {
+    TraceBufferHeader header;
+    TraceEvent* events;
+} BufferTrace;
+
+typedef struct {
+    uint64_t count;
+    uint64_t arg0_sum;
+    uint64_t arg0_max;
+} TypeSummary;
+
+#define SUMMARY_TYPES TRACE_USER
+
+static void print_event(const TraceEvent* event, double us) {
+    const char* name = traceEventName(event->type);
+    if (name) {
+        printf("%14.3f  thread %-4u %-24s %llu %llu", us, event->thread_id, name,
+               (unsigned long long) event->arg0, (unsigned long long) event->arg1);
+    } else {
+        printf("%14.3f  thread %-4u type %-19u %llu %llu", us, event->thread_id, event->type,
+               (unsigned long long) event->arg0, (unsigned long long) event->arg1);
+    }
+}
+
+int main(int argc, char** argv) {
+    int summary_only = argc > 1 && 0 == strcmp(argv[1], "-s");
+    if (argc != (summary_only ? 3 : 2)) {
+        fprintf(stderr, "usage: %s [-s] file\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char* path = argv[summary_only ? 2 : 1];
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    TraceFileHeader header;
+    if (1 != fread(&header, sizeof(header), 1, file) ||
+        0 != memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) || 1 != header.version) {
+        fprintf(stderr, "%s: not a trace file\n", path);
+        return EXIT_FAILURE;
+    }
+
+    BufferTrace* buffers = calloc(header.buffer_count ? header.buffer_count : 1, sizeof(*buffers));
+    if (!buffers) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t base = UINT64_MAX;
+    for (uint32_t i = 0; i < header.buffer_count; ++i) {
+        BufferTrace* buffer = &buffers[i];
+        if (1 != fread(&buffer->header, sizeof(buffer->header), 1, file)) {
+            fprintf(stderr, "%s: truncated\n", path);
+            return EXIT_FAILURE;
+        }
+
+        uint64_t count = buffer->header.event_count;
+        buffer->events = malloc((count ? count : 1) * sizeof(TraceEvent));
+        if (!buffer->events || count != fread(buffer->events, sizeof(TraceEvent), count, file)) {
+            fprintf(stderr, "%s: truncated\n", path);
+            return EXIT_FAILURE;
+        }
+
+        if (count && buffer->events[0].timestamp < base) {
+            base = buffer->events[0].timestamp;
+        }
+    }
+    fclose(file);
+
+    double us_per_tick = 1e6 / header.ticks_per_second;
+    TypeSummary summary[SUMMARY_TYPES];
+    memset(summary, 0, sizeof(summary));
+    uint64_t resizes = 0;
+    double resize_us = 0, resize_max_us = 0;
+    uint64_t lost = 0;
+
+    for (uint32_t i = 0; i < header.buffer_count; ++i) {
+        BufferTrace* buffer = &buffers[i];
+        lost += buffer->header.lost_count;
+
+        // a buffer holds one thread's events at a time, and resizes don't nest,
+        // so an end closes the latest begin of the buffer
+        const TraceEvent* resize_begin = NULL;
+        for (uint64_t j = 0; j < buffer->header.event_count; ++j) {
+            const TraceEvent* event = &buffer->events[j];
+            if (event->type < SUMMARY_TYPES) {
+                TypeSummary* type = &summary[event->type];
+                ++type->count;
+                type->arg0_sum += event->arg0;
+                if (event->arg0 > type->arg0_max) type->arg0_max = event->arg0;
+            }
+
+            if (!summary_only) {
+                print_event(event, (double) (event->timestamp - base) * us_per_tick);
+            }
+
+            if (TRACE_HASH_MAP_RESIZE_BEGIN == event->type) {
+                resize_begin = event;
+            } else if (TRACE_HASH_MAP_RESIZE_END == event->type && resize_begin &&
+                       resize_begin->thread_id == event->thread_id) {
+                double us = (double) (event->timestamp - resize_begin->timestamp) * us_per_tick;
+                if (!summary_only) printf("  (%.3f us%s)", us, event->arg0 == resize_begin->arg0 ? ", failed" : "");
+                ++resizes;
+                resize_us += us;
+                if (us > resize_max_us) resize_max_us = us;
+                resize_begin = NULL;
+            }
+
+            if (!summary_only) printf("\n");
+        }
+    }
+
+    printf("\n%u buffers, %llu events lost to overwriting\n", header.buffer_count, (unsigned long long) lost);
+    for (uint32_t type = 0; type < SUMMARY_TYPES; ++type) {
+        if (summary[type].count) {
+            const char* name = traceEventName(type);
+            printf("%-24s %10llu events", name ? name : "(unknown)", (unsigned long long) summary[type].count);
+            if (TRACE_HASH_MAP_LOOKUP == type) {
+                printf("  compared: avg %.2f, max %llu", (double) summary[type].arg0_sum / (double) summary[type].count,
+                       (unsigned long long) summary[type].arg0_max);
+            }
+            printf("\n");
+        }
+    }
+    if (resizes) {
+        printf("resizes: %llu, %.3f us total, %.3f us max\n", (unsigned long long) resizes, resize_us, resize_max_us);
+    }
+
+    for (uint32_t i = 0; i < header.buffer_count; ++i) {
+        free(buffers[i].events);
+    }
+    free(buffers);
+
+    return EXIT_SUCCESS;
+}